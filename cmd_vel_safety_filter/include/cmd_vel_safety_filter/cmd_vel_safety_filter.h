@@ -20,6 +20,7 @@
 #include <string>
 #include <vector>
 
+#include <boost/scoped_ptr.hpp>
 #include <pcl/point_cloud.h>
 #include <pcl/point_types.h>
 #include <ros/ros.h>
@@ -29,6 +30,10 @@
 #include <geometry_msgs/Twist.h>
 #include <sensor_msgs/LaserScan.h>
 
+#include "cmd_vel_safety_filter/obstacle_fusion.h"
+#include "cmd_vel_safety_filter/obstacle_grid.h"
+#include "cmd_vel_safety_filter/trajectory_rollout.h"
+
 namespace cmd_vel_safety_filter {
 
 class CmdVelSafetyFilter {
@@ -36,7 +41,9 @@ class CmdVelSafetyFilter {
   CmdVelSafetyFilter(const ros::NodeHandle &node_handle);
 
   /**
-   * Computes and applies a slow-down factor if a point in cloud is too close.
+   * Computes and applies a slow-down factor to the linear and angular
+   * velocity if a point in cloud is too close to the arc the robot
+   * drives.
    *
    * Public for testing.
    */
@@ -44,6 +51,14 @@ class CmdVelSafetyFilter {
       const geometry_msgs::Twist &cmd_vel, const std::vector<tf::Point> &cloud,
       geometry_msgs::Twist *filtered_cmd_vel);
 
+  /**
+   * Like the version above but uses an indexed cloud. Only the
+   * obstacles close to the arc are looked at.
+   */
+  bool FilterCmdVel(
+      const geometry_msgs::Twist &cmd_vel, const ObstacleGrid &obstacles,
+      geometry_msgs::Twist *filtered_cmd_vel);
+
   /**
    * Finds all pionts that might come close than radius when we move
    * along direction.
@@ -51,26 +66,41 @@ class CmdVelSafetyFilter {
    * Public for testing.
    */
   void FindPointsInDirection(
-      btVector3 direction, double radius, std::vector<tf::Point> points,
+      const btVector3 &direction, double radius, const std::vector<tf::Point> &points,
       std::vector<tf::Point> *filtered_points);
 
  private:
   static const double kDefaultScanTimeout;
   static const std::string kDefaultBaseFrame;
+  static const double kDefaultGridResolution;
+  static const double kDefaultGridRange;
 
   ros::NodeHandle node_handle_;
   tf::TransformListener tf_;
   double max_acceleration_;
   double radius_;
   double stop_distance_;
-  ros::Duration scan_timeout_;
   std::string base_frame_;
+  double grid_resolution_;
+  double grid_range_;
+  double rollout_horizon_;
   ros::Subscriber cmd_vel_subscriber_;
   ros::Subscriber scan_subscriber_;
   ros::Subscriber cloud_subscriber_;  
   ros::Publisher cmd_vel_publisher_;
-  ros::Time last_scan_reception_time_;
-  std::vector<tf::Point> last_cloud_;
+
+  /**
+   * The clouds of all sources, keyed by topic.
+   */
+  boost::scoped_ptr<ObstacleFusion> obstacle_sources_;
+
+  /**
+   * The fused clouds of all sources that did not time out, indexed
+   * for the rollouts of FilterCmdVel.
+   */
+  boost::scoped_ptr<ObstacleGrid> obstacles_;
+
+  boost::scoped_ptr<TrajectoryRollout> rollout_;
 
   void CmdVelCallback(const geometry_msgs::Twist::ConstPtr &cmd_vel);
   void ScanCallback(const sensor_msgs::LaserScan::ConstPtr &scan);
@@ -81,8 +111,6 @@ class CmdVelSafetyFilter {
   bool ConvertPointCloud(
       const pcl::PointCloud<pcl::PointXYZ> &cloud, const std::string &base_frame,
       std::vector<tf::Point> *tf_cloud);
-  bool FindClosestDistance(
-      const tf::Point &point, const std::vector<tf::Point> &cloud, double *distance);
 
   template<typename T>
   void ToPoint(const T &point_in, tf::Point *point) {
@@ -0,0 +1,123 @@
+// Copyright 2011 Google Inc.
+// Author: moesenle@google.com (Lorenz Moesenlechner)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef CMD_VEL_SAFETY_FILTER_OBSTACLE_FUSION_H
+#define CMD_VEL_SAFETY_FILTER_OBSTACLE_FUSION_H
+
+#include <deque>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <ros/time.h>
+#include <tf/transform_datatypes.h>
+
+#include "cmd_vel_safety_filter/obstacle_grid.h"
+
+namespace cmd_vel_safety_filter {
+
+/**
+ * Keeps the obstacle clouds of several sources, e.g. a base laser
+ * and a floor filtered tilting laser, and fuses them into one
+ * ObstacleGrid. Every source has its own timeout and keeps the
+ * clouds of a time window, so that sources that only see a slice of
+ * the environment per message, like a tilting laser, contribute all
+ * of their recent measurements. The grid is only rebuilt when it is
+ * needed and something changed.
+ */
+class ObstacleFusion {
+ public:
+  /**
+   * @param history_duration clouds of a source that are older than
+   *     its newest cloud by more than this are dropped. 0 only keeps
+   *     the newest cloud. All clouds are in the base frame, so a
+   *     history only makes sense if the robot moves slowly compared
+   *     to the duration.
+   */
+  explicit ObstacleFusion(const ros::Duration &history_duration);
+
+  /**
+   * Registers a source. Clouds of the source are ignored once they
+   * are older than timeout.
+   */
+  void AddSource(const std::string &source, const ros::Duration &timeout);
+
+  /**
+   * Adds the cloud of a registered source that was measured at
+   * stamp.
+   */
+  void AddCloud(const std::string &source, const ros::Time &stamp,
+                const std::vector<tf::Point> &cloud);
+
+  /**
+   * Returns true if no source received a cloud yet.
+   */
+  bool empty() const;
+
+  /**
+   * Fuses the clouds of all sources that did not time out at now
+   * into grid. Does nothing if the clouds that are used did not
+   * change since the last call with the same grid.
+   *
+   * @return false if all sources timed out. grid is not changed
+   *     then and still contains the obstacles of the last call.
+   */
+  bool Fuse(const ros::Time &now, ObstacleGrid *grid);
+
+  /**
+   * The number of times Fuse needed to rebuild the grid.
+   *
+   * Public for testing.
+   */
+  int rebuilds() const {
+    return rebuilds_;
+  }
+
+ private:
+  struct StampedCloud {
+    ros::Time stamp;
+    std::vector<tf::Point> points;
+  };
+
+  struct Source {
+    ros::Duration timeout;
+    // The newest cloud is at the back.
+    std::deque<StampedCloud> history;
+    // Incremented for every new cloud.
+    unsigned long version;
+    // The version and number of clouds fused into the grid last
+    // time. The number changes when clouds time out.
+    unsigned long fused_version;
+    size_t fused_clouds;
+  };
+
+  typedef std::map<std::string, Source> SourceMap;
+
+  ros::Duration history_duration_;
+  SourceMap sources_;
+  const ObstacleGrid *fused_grid_;
+  int rebuilds_;
+  std::vector<tf::Point> fused_points_;
+
+  /**
+   * Returns the number of clouds at the back of the history of
+   * source that did not time out at now.
+   */
+  size_t CountValidClouds(const Source &source, const ros::Time &now) const;
+};
+
+}  // namespace cmd_vel_safety_filter
+
+#endif  // CMD_VEL_SAFETY_FILTER_OBSTACLE_FUSION_H
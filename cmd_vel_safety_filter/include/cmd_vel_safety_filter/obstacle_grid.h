@@ -0,0 +1,148 @@
+// Copyright 2011 Google Inc.
+// Author: moesenle@google.com (Lorenz Moesenlechner)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef CMD_VEL_SAFETY_FILTER_OBSTACLE_GRID_H
+#define CMD_VEL_SAFETY_FILTER_OBSTACLE_GRID_H
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include <tf/transform_datatypes.h>
+
+namespace cmd_vel_safety_filter {
+
+/**
+ * A 2D grid of obstacle points around the origin of the base
+ * frame. The points are sorted into square cells once, so that
+ * distance queries only need to look at the points in cells that
+ * overlap the query area instead of the whole cloud. Points outside
+ * of the grid are kept in a list that is always checked. All
+ * distances are measured in the x-y-plane and are exact, i.e. the
+ * grid only prunes points.
+ */
+class ObstacleGrid {
+ public:
+  /**
+   * @param resolution the side length of a cell
+   * @param range the grid covers [-range, range] in x and y
+   */
+  ObstacleGrid(double resolution, double range);
+
+  /**
+   * Replaces all points in the grid. Reuses the memory of the
+   * previous points. Points with a NaN or infinite x or y coordinate,
+   * e.g. the invalid points of organized clouds, are skipped.
+   */
+  void Build(const std::vector<tf::Point> &points);
+
+  /**
+   * The number of points in the grid.
+   */
+  size_t size() const {
+    return number_of_points_;
+  }
+
+  /**
+   * Calls visitor->Visit(x, y) for every point in the grid with
+   * min_x <= x <= max_x and min_y <= y <= max_y. Points in cells that
+   * overlap the box but are outside of it may be visited, too.
+   */
+  template<typename Visitor>
+  void VisitPointsInBox(double min_x, double max_x, double min_y, double max_y,
+                        Visitor *visitor) const {
+    VisitCells(CellCoordinate(min_x), CellCoordinate(max_x),
+               CellCoordinate(min_y), CellCoordinate(max_y), visitor);
+    VisitOutsidePoints(visitor);
+  }
+
+  /**
+   * Finds the smallest distance of a point in the grid from point if
+   * it is not larger than max_distance.
+   *
+   * @return false if no point is closer than max_distance
+   */
+  bool FindClosestDistance(const tf::Point &point, double max_distance,
+                           double *distance) const;
+
+ private:
+  double resolution_;
+  double range_;
+  int cells_per_side_;
+  size_t number_of_points_;
+
+  // The points sorted by cell. The points of cell i are at
+  // [cell_start_[i], cell_start_[i + 1]).
+  std::vector<int> cell_start_;
+  std::vector<double> x_;
+  std::vector<double> y_;
+
+  // Points that are outside of the grid.
+  std::vector<double> outside_x_;
+  std::vector<double> outside_y_;
+
+  // Scratch space for Build.
+  std::vector<int> point_cells_;
+
+  /**
+   * Returns the cell coordinate of value, which may be outside of
+   * [0, cells_per_side_). Coordinates far outside are clamped to -1
+   * or cells_per_side_, because casting them to int is undefined.
+   */
+  int CellCoordinate(double value) const {
+    double cell = floor((value + range_) / resolution_);
+    return static_cast<int>(std::max(-1.0, std::min(static_cast<double>(cells_per_side_), cell)));
+  }
+
+  int ClampCellCoordinate(int coordinate) const {
+    return coordinate < 0 ? 0 :
+        (coordinate >= cells_per_side_ ? cells_per_side_ - 1 : coordinate);
+  }
+
+  /**
+   * Calls visitor for every point in the cells
+   * [min_x, max_x] x [min_y, max_y]. The cell ranges are clamped to
+   * the grid.
+   */
+  template<typename Visitor>
+  void VisitCells(int min_x, int max_x, int min_y, int max_y, Visitor *visitor) const {
+    if (max_x < 0 || max_y < 0 || min_x >= cells_per_side_ || min_y >= cells_per_side_) {
+      return;
+    }
+    min_x = ClampCellCoordinate(min_x);
+    max_x = ClampCellCoordinate(max_x);
+    min_y = ClampCellCoordinate(min_y);
+    max_y = ClampCellCoordinate(max_y);
+    for (int cell_y = min_y; cell_y <= max_y; cell_y++) {
+      // The cells of a row are consecutive, so are their points.
+      int row = cell_y * cells_per_side_;
+      int end = cell_start_[row + max_x + 1];
+      for (int i = cell_start_[row + min_x]; i < end; i++) {
+        visitor->Visit(x_[i], y_[i]);
+      }
+    }
+  }
+
+  template<typename Visitor>
+  void VisitOutsidePoints(Visitor *visitor) const {
+    for (size_t i = 0; i < outside_x_.size(); i++) {
+      visitor->Visit(outside_x_[i], outside_y_[i]);
+    }
+  }
+};
+
+}  // namespace cmd_vel_safety_filter
+
+#endif  // CMD_VEL_SAFETY_FILTER_OBSTACLE_GRID_H
@@ -0,0 +1,93 @@
+// Copyright 2011 Google Inc.
+// Author: moesenle@google.com (Lorenz Moesenlechner)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef CMD_VEL_SAFETY_FILTER_TRAJECTORY_ROLLOUT_H
+#define CMD_VEL_SAFETY_FILTER_TRAJECTORY_ROLLOUT_H
+
+#include <tf/transform_datatypes.h>
+
+#include "cmd_vel_safety_filter/obstacle_grid.h"
+
+namespace cmd_vel_safety_filter {
+
+/**
+ * Rolls out the arc a velocity command drives, i.e. a unicycle
+ * moving with constant linear and angular velocity, and finds how
+ * far the robot gets before an obstacle enters its circular
+ * footprint. Scaling linear and angular velocity by the same factor
+ * keeps the arc, so the largest safe factor follows directly from
+ * the free length along the arc.
+ *
+ * The free length is computed in closed form for every obstacle
+ * point near the arc, so the result does not depend on a sampling
+ * step.
+ */
+class TrajectoryRollout {
+ public:
+  /**
+   * @param clearance the robot collides with obstacles that are
+   *     closer than this to its center
+   * @param max_acceleration the deceleration the robot is able to brake with
+   * @param horizon only the first horizon seconds of the motion are
+   *     rolled out. 0 rolls out the whole motion until the robot
+   *     stopped.
+   */
+  TrajectoryRollout(double clearance, double max_acceleration, double horizon);
+
+  /**
+   * Returns the largest factor in [0, 1] linear and angular velocity
+   * can be scaled with. Like the slow-down ramp of the straight-line
+   * filter, the factor is 1 if the robot can drive
+   * velocity^2 / max_acceleration along the arc, and decreases
+   * linearly with the free length until it is 0 when an obstacle is
+   * closer than the clearance in the direction of motion. Turning on
+   * the spot never moves the footprint and is always safe.
+   */
+  double FindSafeScale(const ObstacleGrid &obstacles, const tf::Vector3 &linear_velocity,
+                       double angular_velocity) const;
+
+  /**
+   * Returns the length along the arc that starts at the origin in
+   * the direction of linear_velocity and has the curvature of the
+   * velocity until an obstacle is closer than the clearance, at most
+   * max_length. An obstacle that already is closer than the
+   * clearance only counts if the robot moves towards it.
+   *
+   * Public for testing.
+   */
+  double FindFreeLength(const ObstacleGrid &obstacles, const tf::Vector3 &linear_velocity,
+                        double angular_velocity, double max_length) const;
+
+  /**
+   * Returns the position after driving length along the arc.
+   *
+   * Public for testing.
+   */
+  static tf::Point ArcPosition(const tf::Vector3 &linear_velocity, double angular_velocity,
+                               double length);
+
+ private:
+  // Below this deviation of the arc from a straight line at its end,
+  // the arc is treated as a straight line.
+  static const double kMaxStraightDeviation;
+
+  double clearance_;
+  double max_acceleration_;
+  double horizon_;
+};
+
+}  // namespace cmd_vel_safety_filter
+
+#endif  // CMD_VEL_SAFETY_FILTER_TRAJECTORY_ROLLOUT_H
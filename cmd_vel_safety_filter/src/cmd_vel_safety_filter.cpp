@@ -28,6 +28,8 @@ namespace cmd_vel_safety_filter {
 
 const double CmdVelSafetyFilter::kDefaultScanTimeout = 1.0;
 const std::string CmdVelSafetyFilter::kDefaultBaseFrame = "base_link";
+const double CmdVelSafetyFilter::kDefaultGridResolution = 0.05;
+const double CmdVelSafetyFilter::kDefaultGridRange = 5.0;
 
 CmdVelSafetyFilter::CmdVelSafetyFilter(const ros::NodeHandle &node_handle)
     : node_handle_(node_handle) {
@@ -44,8 +46,17 @@ CmdVelSafetyFilter::CmdVelSafetyFilter(const ros::NodeHandle &node_handle)
   node_handle_.param("stop_distance", stop_distance_, radius_);
   double scan_timeout;
   node_handle_.param("scan_timeout", scan_timeout, kDefaultScanTimeout);
-  scan_timeout_ = ros::Duration(scan_timeout);
+  double cloud_timeout;
+  node_handle_.param("cloud_timeout", cloud_timeout, scan_timeout);
+  double history_duration;
+  node_handle_.param("history_duration", history_duration, 0.0);
   node_handle_.param("base_frame", base_frame_, kDefaultBaseFrame);
+  node_handle_.param("grid_resolution", grid_resolution_, kDefaultGridResolution);
+  node_handle_.param("grid_range", grid_range_, kDefaultGridRange);
+  node_handle_.param("rollout_horizon", rollout_horizon_, 0.0);
+  obstacle_sources_.reset(new ObstacleFusion(ros::Duration(history_duration)));
+  obstacles_.reset(new ObstacleGrid(grid_resolution_, grid_range_));
+  rollout_.reset(new TrajectoryRollout(stop_distance_, max_acceleration_, rollout_horizon_));
 
   cmd_vel_subscriber_ = node_handle_.subscribe<geometry_msgs::Twist>(
       "cmd_vel", 10, boost::bind(&CmdVelSafetyFilter::CmdVelCallback, this, _1));
@@ -55,21 +66,24 @@ CmdVelSafetyFilter::CmdVelSafetyFilter(const ros::NodeHandle &node_handle)
       "cloud", 10, boost::bind(&CmdVelSafetyFilter::CloudCallback, this, _1));
   cmd_vel_publisher_ = node_handle_.advertise<geometry_msgs::Twist>(
       "cmd_vel_filtered", 10);
+  obstacle_sources_->AddSource(scan_subscriber_.getTopic(), ros::Duration(scan_timeout));
+  obstacle_sources_->AddSource(cloud_subscriber_.getTopic(), ros::Duration(cloud_timeout));
 }
 
 void CmdVelSafetyFilter::CmdVelCallback(
     const geometry_msgs::Twist::ConstPtr &cmd_vel) {
-  geometry_msgs::Twist filtered_cmd_vel;
-  if (last_cloud_.size() == 0) {
+  geometry_msgs::Twist filtered_cmd_vel = *cmd_vel;
+  if (obstacle_sources_->empty()) {
     ROS_WARN("No laser scan received yet. Cannot filter.");
-    filtered_cmd_vel = *cmd_vel;
-  } else if (last_scan_reception_time_ + scan_timeout_ < ros::Time::now()) {
-    ROS_WARN("Laser scan is older than %f seconds. Cannot filter.",
-             scan_timeout_.toSec());
-    filtered_cmd_vel = *cmd_vel;
-  }
-  if (!FilterCmdVel(*cmd_vel, last_cloud_, &filtered_cmd_vel)) {
-    filtered_cmd_vel = *cmd_vel;
+  } else {
+    if (!obstacle_sources_->Fuse(ros::Time::now(), obstacles_.get())) {
+      // Never fail open. The last obstacles may miss anything that
+      // moved since, so stop until a source is fresh again.
+      ROS_WARN_THROTTLE(1.0, "All laser scans are older than their timeout. Stopping.");
+      filtered_cmd_vel = geometry_msgs::Twist();
+    } else if (!FilterCmdVel(*cmd_vel, *obstacles_, &filtered_cmd_vel)) {
+      filtered_cmd_vel = *cmd_vel;
+    }
   }
   cmd_vel_publisher_.publish(filtered_cmd_vel);
 }
@@ -78,8 +92,7 @@ void CmdVelSafetyFilter::ScanCallback(
     const sensor_msgs::LaserScan::ConstPtr &scan) {
   std::vector<tf::Point> cloud;
   if (ConvertLaserScan(*scan, base_frame_, &cloud)) {
-    last_cloud_.swap(cloud);
-    last_scan_reception_time_ = scan->header.stamp;
+    obstacle_sources_->AddCloud(scan_subscriber_.getTopic(), scan->header.stamp, cloud);
   }
 }
 
@@ -87,8 +100,7 @@ void CmdVelSafetyFilter::CloudCallback(
     const pcl::PointCloud<pcl::PointXYZ>::ConstPtr &cloud) {
   std::vector<tf::Point> tf_cloud;
   if (ConvertPointCloud(*cloud, base_frame_, &tf_cloud)) {
-    last_cloud_.swap(tf_cloud);
-    last_scan_reception_time_ = cloud->header.stamp;
+    obstacle_sources_->AddCloud(cloud_subscriber_.getTopic(), cloud->header.stamp, tf_cloud);
   }
 }
 
@@ -132,26 +144,18 @@ bool CmdVelSafetyFilter::ConvertPointCloud(
   return true;
 }
 
-bool CmdVelSafetyFilter::FindClosestDistance(
-    const tf::Point &point, const std::vector<tf::Point> &cloud,
-    double *distance) {
-  if (cloud.size() == 0) {
-    return false;
-  }
-  *distance = DistanceXY(point, cloud[0]);
-  for (size_t i = 1; i < cloud.size(); i++) {
-    double current_distance = DistanceXY(point, cloud[i]);
-    if (current_distance < *distance) {
-      *distance = current_distance;
-    }
-  }
-  return true;
+bool CmdVelSafetyFilter::FilterCmdVel(
+    const geometry_msgs::Twist &cmd_vel, const std::vector<tf::Point> &cloud,
+    geometry_msgs::Twist *filtered_cmd_vel) {
+  ObstacleGrid obstacles(grid_resolution_, grid_range_);
+  obstacles.Build(cloud);
+  return FilterCmdVel(cmd_vel, obstacles, filtered_cmd_vel);
 }
 
 bool CmdVelSafetyFilter::FilterCmdVel(
-    const geometry_msgs::Twist &cmd_vel, const std::vector<tf::Point> &cloud,
+    const geometry_msgs::Twist &cmd_vel, const ObstacleGrid &obstacles,
     geometry_msgs::Twist *filtered_cmd_vel) {
-  if (cloud.size() == 0) {
+  if (obstacles.size() == 0) {
     ROS_WARN("No laser scan received yet. Cannot filter.");
     return false;
   }
@@ -159,41 +163,19 @@ bool CmdVelSafetyFilter::FilterCmdVel(
   *filtered_cmd_vel = cmd_vel;
   tf::Point linear_velocity;
   ToPoint(cmd_vel.linear, &linear_velocity);
-  std::vector<tf::Point> possible_obstacles;
-  FindPointsInDirection(linear_velocity, radius_, cloud, &possible_obstacles);
-  if (possible_obstacles.size() == 0) {
-    return true;
-  }
-
-  double distance;
-  CHECK(FindClosestDistance(tf::Point(0, 0, 0), possible_obstacles, &distance));
-
-  // For extrapolation, we use the time needed to drive
-  // kDefaultStopDistance.
-  double extrapolation_time = stop_distance_ / linear_velocity.length();
-  tf::Point extrapolated_position = linear_velocity * extrapolation_time;
-  double extrapolated_distance;
-  CHECK(FindClosestDistance(extrapolated_position, possible_obstacles,
-                            &extrapolated_distance));
-  // Only filter the velocity if extrapilation reduced the distance to
-  // the closest obstacle.
-  double slow_down_distance =
-      linear_velocity.length2() / max_acceleration_ + stop_distance_;
-  if (extrapolated_distance < distance &&
-      distance < slow_down_distance) {
-    double slope = 1 / (slow_down_distance - stop_distance_);
-    double factor = fmax(slope * (distance - stop_distance_),
-                         0.0);
-    CHECK_LE(factor, 1);
-    CHECK_GE(factor, 0);
+  double factor = rollout_->FindSafeScale(obstacles, linear_velocity, cmd_vel.angular.z);
+  CHECK_LE(factor, 1);
+  CHECK_GE(factor, 0);
+  if (factor < 1.0) {
     tf::Point filtered_linear_velocity = linear_velocity * factor;
     FromPoint(filtered_linear_velocity, &filtered_cmd_vel->linear);
+    filtered_cmd_vel->angular.z = cmd_vel.angular.z * factor;
   }
   return true;
 }
 
 void CmdVelSafetyFilter::FindPointsInDirection(
-    btVector3 direction, double radius, std::vector<tf::Point> points,
+    const btVector3 &direction, double radius, const std::vector<tf::Point> &points,
     std::vector<tf::Point> *filtered_points) {
 
   btVector3 x_axis = btVector3(1, 0, 0);
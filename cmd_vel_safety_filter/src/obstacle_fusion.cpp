@@ -0,0 +1,116 @@
+// Copyright 2011 Google Inc.
+// Author: moesenle@google.com (Lorenz Moesenlechner)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "cmd_vel_safety_filter/obstacle_fusion.h"
+
+#include <ros/ros.h>
+#include <ros_check/ros_check.h>
+
+namespace cmd_vel_safety_filter {
+
+ObstacleFusion::ObstacleFusion(const ros::Duration &history_duration)
+    : history_duration_(history_duration),
+      fused_grid_(NULL),
+      rebuilds_(0) {
+}
+
+void ObstacleFusion::AddSource(const std::string &source, const ros::Duration &timeout) {
+  Source &new_source = sources_[source];
+  new_source.timeout = timeout;
+  new_source.history.clear();
+  new_source.version = 0;
+  new_source.fused_version = 0;
+  new_source.fused_clouds = 0;
+}
+
+void ObstacleFusion::AddCloud(
+    const std::string &source, const ros::Time &stamp, const std::vector<tf::Point> &cloud) {
+  SourceMap::iterator it = sources_.find(source);
+  CHECK(it != sources_.end());
+  std::deque<StampedCloud> &history = it->second.history;
+  history.push_back(StampedCloud());
+  history.back().stamp = stamp;
+  history.back().points = cloud;
+  while (history.size() > 1 && history.front().stamp + history_duration_ < stamp) {
+    history.pop_front();
+  }
+  it->second.version++;
+}
+
+bool ObstacleFusion::empty() const {
+  for (SourceMap::const_iterator it = sources_.begin(); it != sources_.end(); ++it) {
+    if (!it->second.history.empty()) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool ObstacleFusion::Fuse(const ros::Time &now, ObstacleGrid *grid) {
+  bool changed = grid != fused_grid_;
+  bool valid = false;
+  for (SourceMap::iterator it = sources_.begin(); it != sources_.end(); ++it) {
+    Source &source = it->second;
+    size_t valid_clouds = CountValidClouds(source, now);
+    if (valid_clouds > 0) {
+      valid = true;
+    } else if (!source.history.empty() && source.fused_clouds > 0) {
+      ROS_WARN("Obstacle source %s is older than %f seconds. Ignoring it.",
+               it->first.c_str(), source.timeout.toSec());
+    }
+    if (source.version != source.fused_version || valid_clouds != source.fused_clouds) {
+      changed = true;
+    }
+  }
+  if (!valid) {
+    // The grid keeps the last obstacles. Forget the fused clouds, so
+    // that the warning above is only printed once per source. A valid
+    // cloud can only come with a new version, which rebuilds the grid.
+    for (SourceMap::iterator it = sources_.begin(); it != sources_.end(); ++it) {
+      it->second.fused_clouds = 0;
+    }
+    return false;
+  }
+  if (!changed) {
+    return true;
+  }
+
+  fused_points_.clear();
+  for (SourceMap::iterator it = sources_.begin(); it != sources_.end(); ++it) {
+    Source &source = it->second;
+    size_t valid_clouds = CountValidClouds(source, now);
+    for (size_t i = source.history.size() - valid_clouds; i < source.history.size(); i++) {
+      const std::vector<tf::Point> &points = source.history[i].points;
+      fused_points_.insert(fused_points_.end(), points.begin(), points.end());
+    }
+    source.fused_version = source.version;
+    source.fused_clouds = valid_clouds;
+  }
+  grid->Build(fused_points_);
+  fused_grid_ = grid;
+  rebuilds_++;
+  return true;
+}
+
+size_t ObstacleFusion::CountValidClouds(const Source &source, const ros::Time &now) const {
+  size_t count = 0;
+  for (std::deque<StampedCloud>::const_reverse_iterator it = source.history.rbegin();
+       it != source.history.rend() && it->stamp + source.timeout >= now; ++it) {
+    count++;
+  }
+  return count;
+}
+
+}  // namespace cmd_vel_safety_filter
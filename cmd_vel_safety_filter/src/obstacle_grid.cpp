@@ -0,0 +1,131 @@
+// Copyright 2011 Google Inc.
+// Author: moesenle@google.com (Lorenz Moesenlechner)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "cmd_vel_safety_filter/obstacle_grid.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace cmd_vel_safety_filter {
+
+namespace {
+
+/**
+ * Finds the smallest distance from a point.
+ */
+class ClosestPointVisitor {
+ public:
+  ClosestPointVisitor(const tf::Point &point, double max_distance)
+      : x_(point.x()), y_(point.y()),
+        squared_distance_(max_distance * max_distance),
+        found_(false) {}
+
+  void Visit(double x, double y) {
+    double dx = x - x_;
+    double dy = y - y_;
+    double squared_distance = dx * dx + dy * dy;
+    if (squared_distance <= squared_distance_) {
+      squared_distance_ = squared_distance;
+      found_ = true;
+    }
+  }
+
+  bool found() const {
+    return found_;
+  }
+
+  double distance() const {
+    return sqrt(squared_distance_);
+  }
+
+ private:
+  double x_;
+  double y_;
+  double squared_distance_;
+  bool found_;
+};
+
+}  // namespace
+
+ObstacleGrid::ObstacleGrid(double resolution, double range)
+    : resolution_(resolution),
+      range_(range),
+      cells_per_side_(std::max(1, static_cast<int>(ceil(2 * range / resolution)))),
+      number_of_points_(0),
+      cell_start_(cells_per_side_ * cells_per_side_ + 1, 0) {
+}
+
+void ObstacleGrid::Build(const std::vector<tf::Point> &points) {
+  number_of_points_ = 0;
+  outside_x_.clear();
+  outside_y_.clear();
+  point_cells_.resize(points.size());
+  std::fill(cell_start_.begin(), cell_start_.end(), 0);
+
+  // Counting sort of the points by cell.
+  for (size_t i = 0; i < points.size(); i++) {
+    if (!std::isfinite(points[i].x()) || !std::isfinite(points[i].y())) {
+      point_cells_[i] = -1;
+      continue;
+    }
+    number_of_points_++;
+    int cell_x = CellCoordinate(points[i].x());
+    int cell_y = CellCoordinate(points[i].y());
+    if (cell_x < 0 || cell_x >= cells_per_side_ || cell_y < 0 || cell_y >= cells_per_side_) {
+      point_cells_[i] = -1;
+      outside_x_.push_back(points[i].x());
+      outside_y_.push_back(points[i].y());
+      continue;
+    }
+    int cell = cell_y * cells_per_side_ + cell_x;
+    point_cells_[i] = cell;
+    cell_start_[cell + 1]++;
+  }
+  for (size_t i = 1; i < cell_start_.size(); i++) {
+    cell_start_[i] += cell_start_[i - 1];
+  }
+  size_t points_inside = cell_start_.back();
+  x_.resize(points_inside);
+  y_.resize(points_inside);
+  // cell_start_[cell] is used as insertion position and is shifted
+  // to the start of the next cell afterwards.
+  for (size_t i = 0; i < points.size(); i++) {
+    int cell = point_cells_[i];
+    if (cell < 0) {
+      continue;
+    }
+    int position = cell_start_[cell]++;
+    x_[position] = points[i].x();
+    y_[position] = points[i].y();
+  }
+  for (size_t i = cell_start_.size() - 1; i > 0; i--) {
+    cell_start_[i] = cell_start_[i - 1];
+  }
+  cell_start_[0] = 0;
+}
+
+bool ObstacleGrid::FindClosestDistance(
+    const tf::Point &point, double max_distance, double *distance) const {
+  ClosestPointVisitor visitor(point, max_distance);
+  VisitPointsInBox(point.x() - max_distance, point.x() + max_distance,
+                   point.y() - max_distance, point.y() + max_distance, &visitor);
+  if (!visitor.found()) {
+    return false;
+  }
+  *distance = visitor.distance();
+  return true;
+}
+
+}  // namespace cmd_vel_safety_filter
@@ -0,0 +1,261 @@
+// Copyright 2011 Google Inc.
+// Author: moesenle@google.com (Lorenz Moesenlechner)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "cmd_vel_safety_filter/trajectory_rollout.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace cmd_vel_safety_filter {
+
+namespace {
+
+/**
+ * Transforms points from the base frame into the motion frame, in
+ * which the robot starts at the origin, moves along the x axis and
+ * turns to the left.
+ */
+class MotionFrame {
+ public:
+  MotionFrame(const tf::Vector3 &linear_velocity, double angular_velocity) {
+    double speed = sqrt(linear_velocity.x() * linear_velocity.x() +
+                        linear_velocity.y() * linear_velocity.y());
+    cos_ = linear_velocity.x() / speed;
+    sin_ = linear_velocity.y() / speed;
+    mirror_ = angular_velocity < 0 ? -1.0 : 1.0;
+  }
+
+  void ToMotionFrame(double x, double y, double *motion_x, double *motion_y) const {
+    *motion_x = cos_ * x + sin_ * y;
+    *motion_y = mirror_ * (-sin_ * x + cos_ * y);
+  }
+
+  void FromMotionFrame(double motion_x, double motion_y, double *x, double *y) const {
+    motion_y *= mirror_;
+    *x = cos_ * motion_x - sin_ * motion_y;
+    *y = sin_ * motion_x + cos_ * motion_y;
+  }
+
+ private:
+  double cos_;
+  double sin_;
+  double mirror_;
+};
+
+/**
+ * Finds the free length along a straight line.
+ */
+class StraightVisitor {
+ public:
+  StraightVisitor(const MotionFrame &frame, double clearance, double max_length)
+      : frame_(frame), clearance_(clearance), free_length_(max_length) {}
+
+  void Visit(double x, double y) {
+    double motion_x, motion_y;
+    frame_.ToMotionFrame(x, y, &motion_x, &motion_y);
+    if (fabs(motion_y) >= clearance_) {
+      return;
+    }
+    double half_chord = sqrt(clearance_ * clearance_ - motion_y * motion_y);
+    double entry = motion_x - half_chord;
+    if (entry >= free_length_) {
+      return;
+    }
+    if (entry >= 0) {
+      free_length_ = entry;
+    } else if (motion_x > 0) {
+      // Already too close and getting closer.
+      free_length_ = 0;
+    }
+  }
+
+  double free_length() const {
+    return free_length_;
+  }
+
+ private:
+  const MotionFrame &frame_;
+  double clearance_;
+  double free_length_;
+};
+
+/**
+ * Finds the free length along a left turn with the given radius. The
+ * center of the turn is at (0, radius) in the motion frame and the
+ * robot starts at angle 0, measured counter-clockwise from the
+ * negative y axis around the center.
+ */
+class ArcVisitor {
+ public:
+  ArcVisitor(const MotionFrame &frame, double radius, double clearance, double max_length)
+      : frame_(frame), radius_(radius), clearance_(clearance), free_length_(max_length) {}
+
+  void Visit(double x, double y) {
+    double motion_x, motion_y;
+    frame_.ToMotionFrame(x, y, &motion_x, &motion_y);
+    double dx = motion_x;
+    double dy = motion_y - radius_;
+    double distance_from_center = sqrt(dx * dx + dy * dy);
+    if (distance_from_center == 0.0 ||
+        fabs(distance_from_center - radius_) >= clearance_) {
+      return;
+    }
+    // The point is closer than clearance for all robot angles in
+    // [angle - half_width, angle + half_width].
+    double cos_half_width =
+        (radius_ * radius_ + distance_from_center * distance_from_center -
+         clearance_ * clearance_) / (2 * radius_ * distance_from_center);
+    double half_width = acos(std::max(-1.0, std::min(1.0, cos_half_width)));
+    double angle = atan2(dy, dx) + M_PI / 2;
+    if (angle > M_PI) {
+      angle -= 2 * M_PI;
+    }
+    double entry_angle;
+    if (fabs(angle) < half_width) {
+      if (angle > 0) {
+        // Already too close and getting closer.
+        free_length_ = 0;
+        return;
+      }
+      // Moving away. The robot only gets close again after a full turn.
+      entry_angle = angle - half_width + 2 * M_PI;
+    } else {
+      entry_angle = angle - half_width;
+      if (entry_angle < 0) {
+        entry_angle += 2 * M_PI;
+      }
+    }
+    free_length_ = std::min(free_length_, entry_angle * radius_);
+  }
+
+  double free_length() const {
+    return free_length_;
+  }
+
+ private:
+  const MotionFrame &frame_;
+  double radius_;
+  double clearance_;
+  double free_length_;
+};
+
+}  // namespace
+
+const double TrajectoryRollout::kMaxStraightDeviation = 1e-6;
+
+TrajectoryRollout::TrajectoryRollout(
+    double clearance, double max_acceleration, double horizon)
+    : clearance_(clearance),
+      max_acceleration_(max_acceleration),
+      horizon_(horizon) {
+}
+
+double TrajectoryRollout::FindSafeScale(
+    const ObstacleGrid &obstacles, const tf::Vector3 &linear_velocity,
+    double angular_velocity) const {
+  double speed = sqrt(linear_velocity.x() * linear_velocity.x() +
+                      linear_velocity.y() * linear_velocity.y());
+  if (speed == 0.0) {
+    return 1.0;
+  }
+  double duration = speed / max_acceleration_;
+  if (horizon_ > 0.0 && horizon_ < duration) {
+    duration = horizon_;
+  }
+  double look_ahead = speed * duration;
+  double free_length = FindFreeLength(obstacles, linear_velocity, angular_velocity, look_ahead);
+  return std::max(0.0, std::min(1.0, free_length / look_ahead));
+}
+
+double TrajectoryRollout::FindFreeLength(
+    const ObstacleGrid &obstacles, const tf::Vector3 &linear_velocity,
+    double angular_velocity, double max_length) const {
+  double speed = sqrt(linear_velocity.x() * linear_velocity.x() +
+                      linear_velocity.y() * linear_velocity.y());
+  if (speed == 0.0 || max_length <= 0.0) {
+    return max_length;
+  }
+  MotionFrame frame(linear_velocity, angular_velocity);
+  double curvature = fabs(angular_velocity) / speed;
+
+  // The bounding box of the arc in the motion frame.
+  double min_x, max_x, min_y, max_y;
+  bool straight = curvature * max_length * max_length / 2 < kMaxStraightDeviation;
+  double radius = straight ? 0.0 : 1 / curvature;
+  if (straight) {
+    min_x = 0.0;
+    max_x = max_length;
+    min_y = 0.0;
+    max_y = 0.0;
+  } else {
+    double end_angle = std::min(max_length / radius, 2 * M_PI);
+    min_x = end_angle >= 3 * M_PI / 2 ? -radius : std::min(0.0, radius * sin(end_angle));
+    max_x = end_angle >= M_PI / 2 ? radius : radius * sin(end_angle);
+    min_y = 0.0;
+    max_y = end_angle >= M_PI ? 2 * radius : radius * (1 - cos(end_angle));
+  }
+  min_x -= clearance_;
+  max_x += clearance_;
+  min_y -= clearance_;
+  max_y += clearance_;
+
+  // The bounding box in the base frame.
+  double corners_x[] = {min_x, max_x, max_x, min_x};
+  double corners_y[] = {min_y, min_y, max_y, max_y};
+  double box_min_x = std::numeric_limits<double>::infinity();
+  double box_max_x = -std::numeric_limits<double>::infinity();
+  double box_min_y = std::numeric_limits<double>::infinity();
+  double box_max_y = -std::numeric_limits<double>::infinity();
+  for (int i = 0; i < 4; i++) {
+    double x, y;
+    frame.FromMotionFrame(corners_x[i], corners_y[i], &x, &y);
+    box_min_x = std::min(box_min_x, x);
+    box_max_x = std::max(box_max_x, x);
+    box_min_y = std::min(box_min_y, y);
+    box_max_y = std::max(box_max_y, y);
+  }
+
+  if (straight) {
+    StraightVisitor visitor(frame, clearance_, max_length);
+    obstacles.VisitPointsInBox(box_min_x, box_max_x, box_min_y, box_max_y, &visitor);
+    return visitor.free_length();
+  }
+  ArcVisitor visitor(frame, radius, clearance_, max_length);
+  obstacles.VisitPointsInBox(box_min_x, box_max_x, box_min_y, box_max_y, &visitor);
+  return visitor.free_length();
+}
+
+tf::Point TrajectoryRollout::ArcPosition(
+    const tf::Vector3 &linear_velocity, double angular_velocity, double length) {
+  double speed = sqrt(linear_velocity.x() * linear_velocity.x() +
+                      linear_velocity.y() * linear_velocity.y());
+  if (speed == 0.0) {
+    return tf::Point(0, 0, 0);
+  }
+  MotionFrame frame(linear_velocity, angular_velocity);
+  double curvature = fabs(angular_velocity) / speed;
+  double motion_x = length;
+  double motion_y = 0.0;
+  if (curvature > 0.0) {
+    motion_x = sin(curvature * length) / curvature;
+    motion_y = (1 - cos(curvature * length)) / curvature;
+  }
+  double x, y;
+  frame.FromMotionFrame(motion_x, motion_y, &x, &y);
+  return tf::Point(x, y, 0);
+}
+
+}  // namespace cmd_vel_safety_filter
@@ -15,6 +15,8 @@
 
 #include "cmd_vel_safety_filter/cmd_vel_safety_filter.h"
 
+#include <cmath>
+
 #include <ros/ros.h>
 
 #include <gtest/gtest.h>
@@ -137,6 +139,39 @@ TEST_F(CmdVelSafetyFilterTest, FilterCmdVelPointInCollision) {
   EXPECT_DOUBLE_EQ(filtered_cmd_vel.linear.x, 0.0);
 }
 
+TEST_F(CmdVelSafetyFilterTest, FilterCmdVelTurnIntoPoint) {
+  // The robot drives a circle of radius 0.5 around (0, 0.5).
+  std::vector<tf::Point> points;
+  points.push_back(tf::Point(0.5, 0.5, 0));
+  geometry_msgs::Twist cmd_vel;
+  cmd_vel.linear.x = 1.0;
+  cmd_vel.angular.z = 2.0;
+  geometry_msgs::Twist filtered_cmd_vel;
+  EXPECT_TRUE(filter_->FilterCmdVel(cmd_vel, points, &filtered_cmd_vel));
+  double expected_factor = 0.5 * (M_PI / 2 - 2 * asin(0.25));
+  EXPECT_NEAR(filtered_cmd_vel.linear.x, expected_factor, 1e-9);
+  EXPECT_NEAR(filtered_cmd_vel.angular.z, 2.0 * expected_factor, 1e-9);
+
+  cmd_vel.angular.z = -2.0;
+  EXPECT_TRUE(filter_->FilterCmdVel(cmd_vel, points, &filtered_cmd_vel));
+  EXPECT_DOUBLE_EQ(filtered_cmd_vel.linear.x, 1.0);
+  EXPECT_DOUBLE_EQ(filtered_cmd_vel.angular.z, -2.0);
+
+  cmd_vel.angular.z = 0.0;
+  EXPECT_TRUE(filter_->FilterCmdVel(cmd_vel, points, &filtered_cmd_vel));
+  EXPECT_DOUBLE_EQ(filtered_cmd_vel.linear.x, 1.0);
+}
+
+TEST_F(CmdVelSafetyFilterTest, FilterCmdVelTurnInPlace) {
+  std::vector<tf::Point> points;
+  points.push_back(tf::Point(0.25, 0, 0));
+  geometry_msgs::Twist cmd_vel;
+  cmd_vel.angular.z = 1.0;
+  geometry_msgs::Twist filtered_cmd_vel;
+  EXPECT_TRUE(filter_->FilterCmdVel(cmd_vel, points, &filtered_cmd_vel));
+  EXPECT_DOUBLE_EQ(filtered_cmd_vel.angular.z, 1.0);
+}
+
 int main(int argc, char *argv[]) {
   ros::init(argc, argv, "priority_mux_test");
   testing::InitGoogleTest(&argc, argv);
@@ -0,0 +1,126 @@
+// Copyright 2011 Google Inc.
+// Author: moesenle@google.com (Lorenz Moesenlechner)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "cmd_vel_safety_filter/obstacle_fusion.h"
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+using cmd_vel_safety_filter::ObstacleFusion;
+using cmd_vel_safety_filter::ObstacleGrid;
+
+class ObstacleFusionTest : public testing::Test {
+ public:
+  ObstacleFusionTest()
+      : fusion_(ros::Duration(0.0)),
+        grid_(0.05, 5.0) {}
+
+ protected:
+  ObstacleFusion fusion_;
+  ObstacleGrid grid_;
+
+  virtual void SetUp() {
+    fusion_.AddSource("scan", ros::Duration(1.0));
+    fusion_.AddSource("cloud", ros::Duration(2.0));
+  }
+
+  static std::vector<tf::Point> MakeCloud(double x) {
+    return std::vector<tf::Point>(1, tf::Point(x, 0, 0));
+  }
+
+  double ClosestDistance() {
+    double distance = -1.0;
+    grid_.FindClosestDistance(tf::Point(0, 0, 0), 100.0, &distance);
+    return distance;
+  }
+};
+
+TEST_F(ObstacleFusionTest, Empty) {
+  EXPECT_TRUE(fusion_.empty());
+  EXPECT_FALSE(fusion_.Fuse(ros::Time(1.0), &grid_));
+}
+
+TEST_F(ObstacleFusionTest, FusesAllSources) {
+  fusion_.AddCloud("scan", ros::Time(10.0), MakeCloud(2.0));
+  fusion_.AddCloud("cloud", ros::Time(10.0), MakeCloud(1.0));
+  EXPECT_FALSE(fusion_.empty());
+  EXPECT_TRUE(fusion_.Fuse(ros::Time(10.5), &grid_));
+  EXPECT_EQ(grid_.size(), 2);
+  EXPECT_DOUBLE_EQ(ClosestDistance(), 1.0);
+
+  // A new cloud of one source must not erase the other source.
+  fusion_.AddCloud("scan", ros::Time(10.2), MakeCloud(3.0));
+  EXPECT_TRUE(fusion_.Fuse(ros::Time(10.5), &grid_));
+  EXPECT_EQ(grid_.size(), 2);
+  EXPECT_DOUBLE_EQ(ClosestDistance(), 1.0);
+}
+
+TEST_F(ObstacleFusionTest, ExcludesStaleSources) {
+  fusion_.AddCloud("scan", ros::Time(10.0), MakeCloud(1.0));
+  fusion_.AddCloud("cloud", ros::Time(10.0), MakeCloud(2.0));
+  // The scan times out after 1s, the cloud after 2s.
+  EXPECT_TRUE(fusion_.Fuse(ros::Time(11.5), &grid_));
+  EXPECT_EQ(grid_.size(), 1);
+  EXPECT_DOUBLE_EQ(ClosestDistance(), 2.0);
+  EXPECT_FALSE(fusion_.Fuse(ros::Time(12.5), &grid_));
+}
+
+TEST_F(ObstacleFusionTest, KeepsGridWhenAllSourcesTimedOut) {
+  fusion_.AddCloud("scan", ros::Time(10.0), MakeCloud(1.0));
+  EXPECT_TRUE(fusion_.Fuse(ros::Time(10.5), &grid_));
+  EXPECT_FALSE(fusion_.Fuse(ros::Time(11.5), &grid_));
+  EXPECT_FALSE(fusion_.Fuse(ros::Time(11.6), &grid_));
+  EXPECT_EQ(grid_.size(), 1);
+  EXPECT_DOUBLE_EQ(ClosestDistance(), 1.0);
+  EXPECT_EQ(fusion_.rebuilds(), 1);
+
+  fusion_.AddCloud("scan", ros::Time(12.0), MakeCloud(2.0));
+  EXPECT_TRUE(fusion_.Fuse(ros::Time(12.1), &grid_));
+  EXPECT_DOUBLE_EQ(ClosestDistance(), 2.0);
+  EXPECT_EQ(fusion_.rebuilds(), 2);
+}
+
+TEST_F(ObstacleFusionTest, RebuildsOnlyOnChange) {
+  fusion_.AddCloud("scan", ros::Time(10.0), MakeCloud(1.0));
+  EXPECT_TRUE(fusion_.Fuse(ros::Time(10.1), &grid_));
+  EXPECT_TRUE(fusion_.Fuse(ros::Time(10.2), &grid_));
+  EXPECT_EQ(fusion_.rebuilds(), 1);
+  fusion_.AddCloud("scan", ros::Time(10.3), MakeCloud(1.0));
+  EXPECT_TRUE(fusion_.Fuse(ros::Time(10.4), &grid_));
+  EXPECT_EQ(fusion_.rebuilds(), 2);
+}
+
+TEST(ObstacleFusionHistoryTest, KeepsHistory) {
+  ObstacleFusion fusion(ros::Duration(0.5));
+  fusion.AddSource("cloud", ros::Duration(1.0));
+  ObstacleGrid grid(0.05, 5.0);
+  fusion.AddCloud("cloud", ros::Time(10.0), std::vector<tf::Point>(1, tf::Point(1, 0, 0)));
+  fusion.AddCloud("cloud", ros::Time(10.4), std::vector<tf::Point>(1, tf::Point(2, 0, 0)));
+  EXPECT_TRUE(fusion.Fuse(ros::Time(10.5), &grid));
+  EXPECT_EQ(grid.size(), 2);
+  // Drops the first cloud because it is older than the history.
+  fusion.AddCloud("cloud", ros::Time(10.6), std::vector<tf::Point>(1, tf::Point(3, 0, 0)));
+  EXPECT_TRUE(fusion.Fuse(ros::Time(10.7), &grid));
+  EXPECT_EQ(grid.size(), 2);
+  // Only the newest cloud is not timed out.
+  EXPECT_TRUE(fusion.Fuse(ros::Time(11.5), &grid));
+  EXPECT_EQ(grid.size(), 1);
+}
+
+int main(int argc, char *argv[]) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
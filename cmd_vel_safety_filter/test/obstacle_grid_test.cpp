@@ -0,0 +1,140 @@
+// Copyright 2011 Google Inc.
+// Author: moesenle@google.com (Lorenz Moesenlechner)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "cmd_vel_safety_filter/obstacle_grid.h"
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+#include <vector>
+
+using cmd_vel_safety_filter::ObstacleGrid;
+
+struct PointCollector {
+  std::vector<tf::Point> points;
+
+  void Visit(double x, double y) {
+    points.push_back(tf::Point(x, y, 0));
+  }
+};
+
+class ObstacleGridTest : public testing::Test {
+ public:
+  ObstacleGridTest() : grid_(0.1, 2.0) {}
+
+ protected:
+  ObstacleGrid grid_;
+  std::vector<tf::Point> points_;
+
+  virtual void SetUp() {
+    srand(42);
+    // Some of the points are outside of the grid.
+    for (int i = 0; i < 2000; i++) {
+      points_.push_back(tf::Point(Random(-3.0, 3.0), Random(-3.0, 3.0), Random(0.0, 1.0)));
+    }
+    grid_.Build(points_);
+  }
+
+  static double Random(double min, double max) {
+    return min + (max - min) * rand() / RAND_MAX;
+  }
+
+  static double DistanceXY(const tf::Point &point_1, const tf::Point &point_2) {
+    double x = point_1.x() - point_2.x();
+    double y = point_1.y() - point_2.y();
+    return sqrt(x * x + y * y);
+  }
+};
+
+TEST_F(ObstacleGridTest, Size) {
+  EXPECT_EQ(grid_.size(), points_.size());
+}
+
+TEST_F(ObstacleGridTest, BoxVisitsAllPointsInBox) {
+  for (int i = 0; i < 100; i++) {
+    double min_x = Random(-3.0, 3.0);
+    double max_x = min_x + Random(0.0, 2.0);
+    double min_y = Random(-3.0, 3.0);
+    double max_y = min_y + Random(0.0, 2.0);
+    PointCollector collector;
+    grid_.VisitPointsInBox(min_x, max_x, min_y, max_y, &collector);
+    size_t expected_points = 0;
+    size_t points_in_box = 0;
+    for (size_t j = 0; j < points_.size(); j++) {
+      if (points_[j].x() < min_x || points_[j].x() > max_x ||
+          points_[j].y() < min_y || points_[j].y() > max_y) {
+        continue;
+      }
+      expected_points++;
+      for (size_t k = 0; k < collector.points.size(); k++) {
+        if (collector.points[k].x() == points_[j].x() &&
+            collector.points[k].y() == points_[j].y()) {
+          points_in_box++;
+          break;
+        }
+      }
+    }
+    EXPECT_EQ(points_in_box, expected_points);
+  }
+}
+
+TEST_F(ObstacleGridTest, ClosestDistanceMatchesLinearSearch) {
+  for (int i = 0; i < 100; i++) {
+    tf::Point point(Random(-3.0, 3.0), Random(-3.0, 3.0), 0.0);
+    double max_distance = Random(0.05, 1.0);
+    double expected_distance = std::numeric_limits<double>::infinity();
+    for (size_t j = 0; j < points_.size(); j++) {
+      expected_distance = std::min(expected_distance, DistanceXY(point, points_[j]));
+    }
+    double distance;
+    bool found = grid_.FindClosestDistance(point, max_distance, &distance);
+    ASSERT_EQ(found, expected_distance <= max_distance);
+    if (found) {
+      EXPECT_NEAR(distance, expected_distance, 1e-9);
+    }
+  }
+}
+
+TEST_F(ObstacleGridTest, Rebuild) {
+  std::vector<tf::Point> points;
+  points.push_back(tf::Point(1.0, 0.0, 0.0));
+  grid_.Build(points);
+  EXPECT_EQ(grid_.size(), 1);
+  double distance;
+  EXPECT_TRUE(grid_.FindClosestDistance(tf::Point(0.5, 0, 0), 1.0, &distance));
+  EXPECT_DOUBLE_EQ(distance, 0.5);
+  EXPECT_FALSE(grid_.FindClosestDistance(tf::Point(0, 0.5, 0), 1.0, &distance));
+}
+
+TEST_F(ObstacleGridTest, NonFinitePoints) {
+  std::vector<tf::Point> points;
+  points.push_back(tf::Point(std::numeric_limits<double>::quiet_NaN(), 0.0, 0.0));
+  points.push_back(tf::Point(0.0, std::numeric_limits<double>::infinity(), 0.0));
+  points.push_back(tf::Point(1e300, 0.0, 0.0));
+  points.push_back(tf::Point(1.0, 0.0, 0.0));
+  grid_.Build(points);
+  EXPECT_EQ(grid_.size(), 2);
+  double distance;
+  EXPECT_TRUE(grid_.FindClosestDistance(tf::Point(0.5, 0, 0), 1.0, &distance));
+  EXPECT_DOUBLE_EQ(distance, 0.5);
+  EXPECT_FALSE(grid_.FindClosestDistance(tf::Point(0, 0.5, 0), 0.5, &distance));
+}
+
+int main(int argc, char *argv[]) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
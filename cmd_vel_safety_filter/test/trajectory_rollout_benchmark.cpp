@@ -0,0 +1,121 @@
+// Copyright 2011 Google Inc.
+// Author: moesenle@google.com (Lorenz Moesenlechner)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Compares the latency of filtering one velocity command with the
+// straight-line linear search over all points that
+// CmdVelSafetyFilter::FilterCmdVel originally used and with the arc
+// rollout on an indexed cloud, for clouds of increasing density
+// around the robot. The filter runs for every command, i.e. at up to
+// 100 Hz, so a query has to stay well below 10 ms.
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include <ros/time.h>
+#include <tf/transform_datatypes.h>
+
+#include "cmd_vel_safety_filter/obstacle_grid.h"
+#include "cmd_vel_safety_filter/trajectory_rollout.h"
+
+static const int kIterations = 1000;
+static const double kRadius = 0.25;
+static const double kStopDistance = 0.25;
+static const double kMaxAcceleration = 1.0;
+
+static double DistanceXY(const tf::Point &point_1, const tf::Point &point_2) {
+  double x = point_1.x() - point_2.x();
+  double y = point_1.y() - point_2.y();
+  return sqrt(x * x + y * y);
+}
+
+static double FindClosestDistance(const tf::Point &point, const std::vector<tf::Point> &cloud) {
+  double distance = DistanceXY(point, cloud[0]);
+  for (size_t i = 1; i < cloud.size(); i++) {
+    distance = std::min(distance, DistanceXY(point, cloud[i]));
+  }
+  return distance;
+}
+
+static void LinearQuery(const tf::Vector3 &velocity, const std::vector<tf::Point> &cloud,
+                        double *distance, double *extrapolated_distance) {
+  btVector3 x_axis = btVector3(1, 0, 0);
+  btVector3 axis = velocity.cross(x_axis);
+  double angle = velocity.angle(x_axis);
+  std::vector<tf::Point> possible_obstacles;
+  for (size_t i = 0; i < cloud.size(); i++) {
+    tf::Point rotated_point = cloud[i].rotate(axis, angle);
+    if (fabs(rotated_point.y()) <= kRadius) {
+      possible_obstacles.push_back(cloud[i]);
+    }
+  }
+  if (possible_obstacles.size() == 0) {
+    return;
+  }
+  *distance = FindClosestDistance(tf::Point(0, 0, 0), possible_obstacles);
+  tf::Point extrapolated_position = velocity * (kStopDistance / velocity.length());
+  *extrapolated_distance = FindClosestDistance(extrapolated_position, possible_obstacles);
+}
+
+static void Benchmark(size_t number_of_points) {
+  std::vector<tf::Point> cloud;
+  for (size_t i = 0; i < number_of_points; i++) {
+    cloud.push_back(tf::Point(10.0 * rand() / RAND_MAX - 5.0,
+                              10.0 * rand() / RAND_MAX - 5.0, 0.0));
+  }
+  tf::Vector3 velocity(0.5, 0.1, 0.0);
+  double distance = 0.0;
+  double extrapolated_distance = 0.0;
+
+  ros::WallTime start = ros::WallTime::now();
+  for (int i = 0; i < kIterations; i++) {
+    LinearQuery(velocity, cloud, &distance, &extrapolated_distance);
+  }
+  double linear_time = (ros::WallTime::now() - start).toSec() / kIterations;
+
+  cmd_vel_safety_filter::ObstacleGrid grid(0.05, 5.0);
+  start = ros::WallTime::now();
+  for (int i = 0; i < kIterations; i++) {
+    grid.Build(cloud);
+  }
+  double build_time = (ros::WallTime::now() - start).toSec() / kIterations;
+
+  cmd_vel_safety_filter::TrajectoryRollout rollout(kStopDistance, kMaxAcceleration, 0.0);
+  double scale = 0.0;
+  start = ros::WallTime::now();
+  for (int i = 0; i < kIterations; i++) {
+    scale += rollout.FindSafeScale(grid, velocity, 0.0);
+  }
+  double straight_time = (ros::WallTime::now() - start).toSec() / kIterations;
+
+  start = ros::WallTime::now();
+  for (int i = 0; i < kIterations; i++) {
+    scale += rollout.FindSafeScale(grid, velocity, 1.0);
+  }
+  double arc_time = (ros::WallTime::now() - start).toSec() / kIterations;
+
+  printf("%7zu points: linear %9.1f us, straight rollout %6.1f us (speedup %6.1fx), "
+         "arc rollout %6.1f us, grid build per cloud %8.1f us\n",
+         number_of_points, linear_time * 1e6, straight_time * 1e6, linear_time / straight_time,
+         arc_time * 1e6, build_time * 1e6);
+}
+
+int main(int argc, char *argv[]) {
+  Benchmark(1000);
+  Benchmark(10000);
+  Benchmark(100000);
+  return 0;
+}
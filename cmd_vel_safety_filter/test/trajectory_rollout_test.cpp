@@ -0,0 +1,137 @@
+// Copyright 2011 Google Inc.
+// Author: moesenle@google.com (Lorenz Moesenlechner)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "cmd_vel_safety_filter/trajectory_rollout.h"
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+#include "cmd_vel_safety_filter/obstacle_grid.h"
+
+using cmd_vel_safety_filter::ObstacleGrid;
+using cmd_vel_safety_filter::TrajectoryRollout;
+
+static const double kClearance = 0.25;
+
+class TrajectoryRolloutTest : public testing::Test {
+ public:
+  TrajectoryRolloutTest()
+      : grid_(0.05, 5.0),
+        rollout_(kClearance, 1.0, 0.0) {}
+
+ protected:
+  ObstacleGrid grid_;
+  TrajectoryRollout rollout_;
+
+  void BuildGrid(const tf::Point &point) {
+    std::vector<tf::Point> points;
+    points.push_back(point);
+    grid_.Build(points);
+  }
+
+  static double Random(double min, double max) {
+    return min + (max - min) * rand() / RAND_MAX;
+  }
+
+  static double DistanceXY(const tf::Point &point_1, const tf::Point &point_2) {
+    double x = point_1.x() - point_2.x();
+    double y = point_1.y() - point_2.y();
+    return sqrt(x * x + y * y);
+  }
+};
+
+TEST_F(TrajectoryRolloutTest, StraightObstacleInFront) {
+  BuildGrid(tf::Point(1.0, 0, 0));
+  EXPECT_DOUBLE_EQ(rollout_.FindFreeLength(grid_, tf::Vector3(1, 0, 0), 0.0, 2.0), 0.75);
+  EXPECT_DOUBLE_EQ(rollout_.FindFreeLength(grid_, tf::Vector3(1, 0, 0), 0.0, 0.5), 0.5);
+  EXPECT_DOUBLE_EQ(rollout_.FindFreeLength(grid_, tf::Vector3(-1, 0, 0), 0.0, 2.0), 2.0);
+}
+
+TEST_F(TrajectoryRolloutTest, TurnIntoObstacle) {
+  // The robot drives a circle of radius 1 around (0, 1) and passes
+  // (1, 1) after a quarter turn.
+  BuildGrid(tf::Point(1.0, 1.0, 0));
+  double expected_length = M_PI / 2 - 2 * asin(kClearance / 2);
+  EXPECT_NEAR(rollout_.FindFreeLength(grid_, tf::Vector3(1, 0, 0), 1.0, 4.0),
+              expected_length, 1e-9);
+  EXPECT_NEAR(rollout_.FindFreeLength(grid_, tf::Vector3(0.5, 0, 0), 0.5, 4.0),
+              expected_length, 1e-9);
+  EXPECT_DOUBLE_EQ(rollout_.FindFreeLength(grid_, tf::Vector3(1, 0, 0), -1.0, 4.0), 4.0);
+}
+
+TEST_F(TrajectoryRolloutTest, LeaveObstacle) {
+  BuildGrid(tf::Point(-0.1, 0, 0));
+  EXPECT_DOUBLE_EQ(rollout_.FindFreeLength(grid_, tf::Vector3(1, 0, 0), 0.0, 1.0), 1.0);
+  EXPECT_DOUBLE_EQ(rollout_.FindFreeLength(grid_, tf::Vector3(1, 0, 0), 0.5, 1.0), 1.0);
+  EXPECT_DOUBLE_EQ(rollout_.FindFreeLength(grid_, tf::Vector3(-1, 0, 0), 0.0, 1.0), 0.0);
+  EXPECT_DOUBLE_EQ(rollout_.FindFreeLength(grid_, tf::Vector3(-1, 0, 0), 0.5, 1.0), 0.0);
+}
+
+TEST_F(TrajectoryRolloutTest, SafeScale) {
+  BuildGrid(tf::Point(0.75, 0, 0));
+  EXPECT_DOUBLE_EQ(rollout_.FindSafeScale(grid_, tf::Vector3(1, 0, 0), 0.0), 0.5);
+  EXPECT_DOUBLE_EQ(rollout_.FindSafeScale(grid_, tf::Vector3(0, 0, 0), 1.0), 1.0);
+  EXPECT_DOUBLE_EQ(rollout_.FindSafeScale(grid_, tf::Vector3(0.5, 0, 0), 0.0), 1.0);
+
+  TrajectoryRollout short_horizon(kClearance, 1.0, 0.25);
+  EXPECT_DOUBLE_EQ(short_horizon.FindSafeScale(grid_, tf::Vector3(1, 0, 0), 0.0), 1.0);
+  EXPECT_DOUBLE_EQ(short_horizon.FindSafeScale(grid_, tf::Vector3(4, 0, 0), 0.0), 0.5);
+}
+
+TEST_F(TrajectoryRolloutTest, MatchesSampling) {
+  srand(42);
+  const double kStep = 1e-3;
+  for (int i = 0; i < 50; i++) {
+    // Obstacles that are not closer than the clearance at the start.
+    std::vector<tf::Point> points;
+    while (points.size() < 100) {
+      tf::Point point(Random(-3.0, 3.0), Random(-3.0, 3.0), 0.0);
+      if (DistanceXY(point, tf::Point(0, 0, 0)) > kClearance) {
+        points.push_back(point);
+      }
+    }
+    grid_.Build(points);
+    double angle = Random(-M_PI, M_PI);
+    tf::Vector3 velocity(cos(angle), sin(angle), 0.0);
+    double angular_velocity = i % 5 == 0 ? 0.0 : Random(-3.0, 3.0);
+    double max_length = Random(0.5, 3.0);
+
+    double expected_length = max_length;
+    for (double length = 0.0; length < max_length; length += kStep) {
+      tf::Point position = TrajectoryRollout::ArcPosition(velocity, angular_velocity, length);
+      bool collision = false;
+      for (size_t j = 0; j < points.size(); j++) {
+        if (DistanceXY(position, points[j]) < kClearance) {
+          collision = true;
+          break;
+        }
+      }
+      if (collision) {
+        expected_length = length;
+        break;
+      }
+    }
+    EXPECT_NEAR(rollout_.FindFreeLength(grid_, velocity, angular_velocity, max_length),
+                expected_length, kStep);
+  }
+}
+
+int main(int argc, char *argv[]) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,84 @@
+/*
+ * slam_gmapping
+ * Copyright (c) 2008, Willow Garage, Inc.
+ *
+ * THE WORK (AS DEFINED BELOW) IS PROVIDED UNDER THE TERMS OF THIS CREATIVE
+ * COMMONS PUBLIC LICENSE ("CCPL" OR "LICENSE"). THE WORK IS PROTECTED BY
+ * COPYRIGHT AND/OR OTHER APPLICABLE LAW. ANY USE OF THE WORK OTHER THAN AS
+ * AUTHORIZED UNDER THIS LICENSE OR COPYRIGHT LAW IS PROHIBITED.
+ * 
+ * BY EXERCISING ANY RIGHTS TO THE WORK PROVIDED HERE, YOU ACCEPT AND AGREE TO
+ * BE BOUND BY THE TERMS OF THIS LICENSE. THE LICENSOR GRANTS YOU THE RIGHTS
+ * CONTAINED HERE IN CONSIDERATION OF YOUR ACCEPTANCE OF SUCH TERMS AND
+ * CONDITIONS.
+ *
+ */
+
+#ifndef GMAPPING_OFFLINE_BOUNDED_QUEUE_H
+#define GMAPPING_OFFLINE_BOUNDED_QUEUE_H
+
+#include <deque>
+
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+
+/**
+ * A FIFO queue between one producer and one consumer thread that
+ * holds at most capacity elements. push() blocks while the queue is
+ * full and pop() blocks while it is empty, until the producer calls
+ * close().
+ */
+template<typename T>
+class BoundedQueue
+{
+  public:
+    /// capacity must be at least 1, otherwise push() never returns.
+    explicit BoundedQueue(size_t capacity)
+      : capacity_(capacity), closed_(false) {}
+
+    /// Returns false if the queue was closed.
+    bool push(const T& element)
+    {
+      boost::mutex::scoped_lock lock(mutex_);
+      while(queue_.size() >= capacity_ && !closed_)
+        not_full_.wait(lock);
+      if(closed_)
+        return false;
+      queue_.push_back(element);
+      not_empty_.notify_one();
+      return true;
+    }
+
+    /// Returns false if the queue is closed and all elements were popped.
+    bool pop(T& element)
+    {
+      boost::mutex::scoped_lock lock(mutex_);
+      while(queue_.empty() && !closed_)
+        not_empty_.wait(lock);
+      if(queue_.empty())
+        return false;
+      element = queue_.front();
+      queue_.pop_front();
+      not_full_.notify_one();
+      return true;
+    }
+
+    /// Wakes up both sides. Elements in the queue can still be popped.
+    void close()
+    {
+      boost::mutex::scoped_lock lock(mutex_);
+      closed_ = true;
+      not_empty_.notify_all();
+      not_full_.notify_all();
+    }
+
+  private:
+    size_t capacity_;
+    bool closed_;
+    std::deque<T> queue_;
+    boost::mutex mutex_;
+    boost::condition_variable not_empty_;
+    boost::condition_variable not_full_;
+};
+
+#endif  // GMAPPING_OFFLINE_BOUNDED_QUEUE_H
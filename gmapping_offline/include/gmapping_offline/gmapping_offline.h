@@ -27,11 +27,24 @@
 
 #include "hector_nav_msgs/GetRobotTrajectory.h"
 
+#include "gmapping_offline/GetMapRegion.h"
+#include "gmapping_offline/bounded_queue.h"
+#include "gmapping_offline/gmapping_parameters.h"
+#include "gmapping_offline/particle_filter.h"
+#include "gmapping_offline/scan_sequence.h"
+#include "gmapping_offline/tiled_map.h"
+#include "gmapping_offline/trajectory_buffer.h"
+
 #include "gmapping/gridfastslam/gridslamprocessor.h"
 #include "gmapping/sensor/sensor_base/sensor.h"
 
 #include <boost/thread.hpp>
 
+namespace rosbag
+{
+class View;
+}
+
 class SlamGMapping
 {
   public:
@@ -43,6 +56,8 @@ class SlamGMapping
     void laserCallback(const sensor_msgs::LaserScan::ConstPtr& scan);
     bool mapCallback(nav_msgs::GetMap::Request  &req,
                      nav_msgs::GetMap::Response &res);
+    bool mapRegionCallback(gmapping_offline::GetMapRegion::Request  &req,
+                           gmapping_offline::GetMapRegion::Response &res);
     bool pathCallback(hector_nav_msgs::GetRobotTrajectory::Request  &req,
                       hector_nav_msgs::GetRobotTrajectory::Response &res);
     void publishLoop(double transform_publish_period);
@@ -53,25 +68,51 @@ class SlamGMapping
   private:
     ros::NodeHandle node_;
     ros::Publisher entropy_publisher_;
+    ros::Publisher map_update_latency_publisher_;
     ros::Publisher sst_;
     ros::Publisher sstm_;
+    ros::Publisher map_update_publisher_;
+    ros::Publisher trajectory_publisher_;
     ros::ServiceServer sp_;
     ros::ServiceServer ss_;
+    ros::ServiceServer sr_;
     tf::TransformListener tf_;
     message_filters::Subscriber<sensor_msgs::LaserScan>* scan_filter_sub_;
     tf::MessageFilter<sensor_msgs::LaserScan>* scan_filter_;
     tf::TransformBroadcaster* tfB_;
 
+    // Exactly one of them runs the particle filter, filter_ if
+    // ~particle_threads is positive. filter_ is created at the first
+    // scan.
     GMapping::GridSlamProcessor* gsp_;
+    ParticleFilter* filter_;
+    int particle_threads_;
     GMapping::RangeSensor* gsp_laser_;
+    double gsp_laser_angle_min_;
     double gsp_laser_angle_increment_;
     unsigned int gsp_laser_beam_count_;
     GMapping::OdometrySensor* gsp_odom_;
 
     bool got_first_scan_;
 
+    // The best particle's trajectory for the trajectory service and topic.
+    TrajectoryBuffer trajectory_;
+
     bool got_map_;
-    nav_msgs::GetMap::Response map_;
+    TiledMap map_;
+    ros::Time map_stamp_;
+
+    // The map of the best particle's trajectory up to the node with
+    // map_reading_ and map_pose_. Kept between map updates so that
+    // only new scans need to be registered while the best particle
+    // stays in the same lineage.
+    bool incremental_map_update_;
+    GMapping::ScanMatcherMap* smap_;
+    const GMapping::RangeReading* map_reading_;
+    GMapping::OrientedPoint map_pose_;
+
+    int map_conversion_threads_;
+    bool publish_map_updates_;
 
     ros::Duration map_update_interval_;
     tf::Transform map_to_odom_;
@@ -88,50 +129,58 @@ class SlamGMapping
     std::string map_frame_;
     std::string odom_frame_;
     
-    void updateMap(const sensor_msgs::LaserScan& scan);
+    ros::Time last_map_update_;
+
+    void updateMap();
+    void convertMap(const GMapping::ScanMatcherMap& smap, int min_x, int min_y, int max_x, int max_y);
+    void publishMapUpdate(int min_x, int min_y, int max_x, int max_y);
     bool getOdomPose(GMapping::OrientedPoint& gmap_pose, const ros::Time& t);
     bool initMapper(const sensor_msgs::LaserScan& scan);
+    void initMapper(const LaserParameters& laser, const GMapping::OrientedPoint& initialPose);
     bool addScan(const sensor_msgs::LaserScan& scan, GMapping::OrientedPoint& gmap_pose);
+    bool addScan(const ScanSequence& sequence, size_t i);
+    void addCachedScan(const ScanSequence& sequence, size_t i);
+    void scanAdded(const tf::Transform& map_to_odom, const ros::Time& stamp);
+    bool processReading(const GMapping::RangeReading& reading);
+    const GMapping::GridSlamProcessor::ParticleVector& particles() const;
+    const GMapping::GridSlamProcessor::Particle& bestParticle() const;
     double computePoseEntropy();
 
     // Members used when running directly from bag
     std::string bag_file_path_;
     std::string laser_topic_;
+    bool publish_tf_;
+    bool publish_clock_;
+    int prefetch_queue_size_;
+    double progress_log_period_;
+    std::string scan_cache_path_;
+    std::string map_file_directory_;
+    bool map_file_tiles_;
 
     ros::Publisher time_publisher_;
     boost::thread* process_bag_thread_;
 
+    // A deserialized message of the bag. Either scan or transforms is set.
+    struct BagMessage
+    {
+      ros::Time time;
+      sensor_msgs::LaserScan::ConstPtr scan;
+      tf::tfMessage::ConstPtr transforms;
+    };
+
+    void readBag(rosbag::View& view, BoundedQueue<BagMessage>& queue, bool& failed);
+    bool processScanCache();
+
     bool saveMap(const std::string& file_name);
     
     // Parameters used by GMapping
+    GMappingParameters params_;
+    // The resolved maxRange and maxUrange.
     double maxRange_;
     double maxUrange_;
-    double maxrange_;
-    double sigma_;
-    int kernelSize_;
-    double lstep_;
-    double astep_;
-    int iterations_;
-    double lsigma_;
-    double ogain_;
-    int lskip_;
-    double srr_;
-    double srt_;
-    double str_;
-    double stt_;
-    double linearUpdate_;
-    double angularUpdate_;
-    double temporalUpdate_;
-    double resampleThreshold_;
-    int particles_;
+    // The current extent of the map.
     double xmin_;
     double ymin_;
     double xmax_;
     double ymax_;
-    double delta_;
-    double occ_thresh_;
-    double llsamplerange_;
-    double llsamplestep_;
-    double lasamplerange_;
-    double lasamplestep_;
 };
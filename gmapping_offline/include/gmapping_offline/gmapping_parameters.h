@@ -0,0 +1,95 @@
+/*
+ * slam_gmapping
+ * Copyright (c) 2008, Willow Garage, Inc.
+ *
+ * THE WORK (AS DEFINED BELOW) IS PROVIDED UNDER THE TERMS OF THIS CREATIVE
+ * COMMONS PUBLIC LICENSE ("CCPL" OR "LICENSE"). THE WORK IS PROTECTED BY
+ * COPYRIGHT AND/OR OTHER APPLICABLE LAW. ANY USE OF THE WORK OTHER THAN AS
+ * AUTHORIZED UNDER THIS LICENSE OR COPYRIGHT LAW IS PROHIBITED.
+ *
+ * BY EXERCISING ANY RIGHTS TO THE WORK PROVIDED HERE, YOU ACCEPT AND AGREE TO
+ * BE BOUND BY THE TERMS OF THIS LICENSE. THE LICENSOR GRANTS YOU THE RIGHTS
+ * CONTAINED HERE IN CONSIDERATION OF YOUR ACCEPTANCE OF SUCH TERMS AND
+ * CONDITIONS.
+ *
+ */
+
+#ifndef GMAPPING_OFFLINE_GMAPPING_PARAMETERS_H
+#define GMAPPING_OFFLINE_GMAPPING_PARAMETERS_H
+
+#include <cstdio>
+
+#include "ros/ros.h"
+
+#include "gmapping/gridfastslam/gridslamprocessor.h"
+
+/**
+ * The parameters used by GMapping itself, named like the ROS
+ * parameters they are read from. They are documented in
+ * gmapping_offline.cpp.
+ */
+struct GMappingParameters
+{
+  /// Sets the defaults.
+  GMappingParameters();
+
+  /// Reads the parameters that are set in the namespace of nh and
+  /// keeps the others.
+  void load(const ros::NodeHandle& nh);
+
+  /// Reads the parameters that are members of the struct value, e.g.
+  /// one configuration of a parameter sweep, and keeps the others.
+  /// Returns the number of parameters read, or -1 if value is not a
+  /// struct or a member has the wrong type.
+  int load(XmlRpc::XmlRpcValue& value);
+
+  /// Writes the parameters as YAML mapping, one line per parameter.
+  void write(FILE* file, const char* indent) const;
+
+  /// Sets the matching, motion model and update parameters of gsp,
+  /// initializes its particles at initial_pose and seeds the random
+  /// numbers. max_range and max_urange are the resolved maxRange and
+  /// maxUrange.
+  void initProcessor(GMapping::GridSlamProcessor& gsp, double max_range, double max_urange,
+                     const GMapping::OrientedPoint& initial_pose) const;
+
+  /// Seeds GMapping's random numbers with seed, or the current time if
+  /// it is 0.
+  void seedRandomNumbers() const;
+
+  // 0 means the maximum range of the first scan minus 1 cm.
+  double maxRange;
+  // 0 means maxRange.
+  double maxUrange;
+  double sigma;
+  int kernelSize;
+  double lstep;
+  double astep;
+  int iterations;
+  double lsigma;
+  double ogain;
+  int lskip;
+  double srr;
+  double srt;
+  double str;
+  double stt;
+  double linearUpdate;
+  double angularUpdate;
+  double temporalUpdate;
+  double resampleThreshold;
+  int particles;
+  double xmin;
+  double ymin;
+  double xmax;
+  double ymax;
+  double delta;
+  double occ_thresh;
+  double llsamplerange;
+  double llsamplestep;
+  double lasamplerange;
+  double lasamplestep;
+  // 0 seeds from the current time.
+  int seed;
+};
+
+#endif  // GMAPPING_OFFLINE_GMAPPING_PARAMETERS_H
@@ -0,0 +1,46 @@
+/*
+ * slam_gmapping
+ * Copyright (c) 2008, Willow Garage, Inc.
+ *
+ * THE WORK (AS DEFINED BELOW) IS PROVIDED UNDER THE TERMS OF THIS CREATIVE
+ * COMMONS PUBLIC LICENSE ("CCPL" OR "LICENSE"). THE WORK IS PROTECTED BY
+ * COPYRIGHT AND/OR OTHER APPLICABLE LAW. ANY USE OF THE WORK OTHER THAN AS
+ * AUTHORIZED UNDER THIS LICENSE OR COPYRIGHT LAW IS PROHIBITED.
+ *
+ * BY EXERCISING ANY RIGHTS TO THE WORK PROVIDED HERE, YOU ACCEPT AND AGREE TO
+ * BE BOUND BY THE TERMS OF THIS LICENSE. THE LICENSOR GRANTS YOU THE RIGHTS
+ * CONTAINED HERE IN CONSIDERATION OF YOUR ACCEPTANCE OF SUCH TERMS AND
+ * CONDITIONS.
+ *
+ */
+
+#ifndef GMAPPING_OFFLINE_MAP_WRITER_H
+#define GMAPPING_OFFLINE_MAP_WRITER_H
+
+#include <string>
+
+#include "gmapping_offline/tiled_map.h"
+
+/**
+ * Writes map to file_name_base.pgm and file_name_base.yaml in the
+ * format of map_server's map_saver, so that map_server can load it.
+ * The image is streamed from the tiles one row at a time. Returns
+ * false if a file could not be written.
+ */
+bool writeMap(const TiledMap& map, const std::string& file_name_base);
+
+/**
+ * Writes every allocated tile of map like writeMap() to
+ * file_name_base_<tile x>_<tile y>.pgm and .yaml, each with its own
+ * origin, and lists them in file_name_base_tiles.yaml. Tiles without
+ * a file are unknown. Returns false if a file could not be written.
+ */
+bool writeMapTiles(const TiledMap& map, const std::string& file_name_base);
+
+/**
+ * Creates directory and its missing parents, like mkdir -p. Returns
+ * false if one of them could not be created.
+ */
+bool makeDirectories(const std::string& directory);
+
+#endif  // GMAPPING_OFFLINE_MAP_WRITER_H
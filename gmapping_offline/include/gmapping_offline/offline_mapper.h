@@ -0,0 +1,72 @@
+/*
+ * slam_gmapping
+ * Copyright (c) 2008, Willow Garage, Inc.
+ *
+ * THE WORK (AS DEFINED BELOW) IS PROVIDED UNDER THE TERMS OF THIS CREATIVE
+ * COMMONS PUBLIC LICENSE ("CCPL" OR "LICENSE"). THE WORK IS PROTECTED BY
+ * COPYRIGHT AND/OR OTHER APPLICABLE LAW. ANY USE OF THE WORK OTHER THAN AS
+ * AUTHORIZED UNDER THIS LICENSE OR COPYRIGHT LAW IS PROHIBITED.
+ *
+ * BY EXERCISING ANY RIGHTS TO THE WORK PROVIDED HERE, YOU ACCEPT AND AGREE TO
+ * BE BOUND BY THE TERMS OF THIS LICENSE. THE LICENSOR GRANTS YOU THE RIGHTS
+ * CONTAINED HERE IN CONSIDERATION OF YOUR ACCEPTANCE OF SUCH TERMS AND
+ * CONDITIONS.
+ *
+ */
+
+#ifndef GMAPPING_OFFLINE_OFFLINE_MAPPER_H
+#define GMAPPING_OFFLINE_OFFLINE_MAPPER_H
+
+#include "gmapping_offline/gmapping_parameters.h"
+#include "gmapping_offline/particle_filter.h"
+#include "gmapping_offline/scan_sequence.h"
+#include "gmapping_offline/tiled_map.h"
+
+#include "gmapping/gridfastslam/gridslamprocessor.h"
+#include "gmapping/sensor/sensor_range/rangesensor.h"
+
+/**
+ * Runs GMapping on a decoded scan sequence without ROS
+ * communication, e.g. for one configuration of a parameter sweep.
+ * Unlike the node, the map is only built once at the end.
+ */
+class OfflineMapper
+{
+  public:
+    /// With particle_threads 0, runs GMapping's GridSlamProcessor.
+    /// Otherwise runs a ParticleFilter on that many threads, whose maps
+    /// do not depend on the number of threads.
+    OfflineMapper(const GMappingParameters& params, const LaserParameters& laser,
+                  int particle_threads = 0);
+    ~OfflineMapper();
+
+    /// Feeds scan i of sequence to the particle filter. Returns true
+    /// if GMapping processed it, i.e. the robot moved far enough.
+    bool processScan(const ScanSequence& sequence, size_t i);
+
+    /// Registers the trajectory of the best particle into a new map
+    /// and converts it.
+    void buildMap(TiledMap& map) const;
+
+    /// Returns the entropy of the normalized particle weights.
+    double computePoseEntropy() const;
+
+    static double computePoseEntropy(const GMapping::GridSlamProcessor::ParticleVector& particles);
+
+  private:
+    const GMapping::GridSlamProcessor::ParticleVector& particles() const;
+
+    GMappingParameters params_;
+    LaserParameters laser_;
+    double maxRange_;
+    double maxUrange_;
+    int particle_threads_;
+    // Exactly one of them runs the particle filter. filter_ is created
+    // at the first scan.
+    GMapping::GridSlamProcessor* gsp_;
+    ParticleFilter* filter_;
+    GMapping::RangeSensor* gsp_laser_;
+    bool initialized_;
+};
+
+#endif  // GMAPPING_OFFLINE_OFFLINE_MAPPER_H
@@ -0,0 +1,35 @@
+/*
+ * slam_gmapping
+ * Copyright (c) 2008, Willow Garage, Inc.
+ *
+ * THE WORK (AS DEFINED BELOW) IS PROVIDED UNDER THE TERMS OF THIS CREATIVE
+ * COMMONS PUBLIC LICENSE ("CCPL" OR "LICENSE"). THE WORK IS PROTECTED BY
+ * COPYRIGHT AND/OR OTHER APPLICABLE LAW. ANY USE OF THE WORK OTHER THAN AS
+ * AUTHORIZED UNDER THIS LICENSE OR COPYRIGHT LAW IS PROHIBITED.
+ *
+ * BY EXERCISING ANY RIGHTS TO THE WORK PROVIDED HERE, YOU ACCEPT AND AGREE TO
+ * BE BOUND BY THE TERMS OF THIS LICENSE. THE LICENSOR GRANTS YOU THE RIGHTS
+ * CONTAINED HERE IN CONSIDERATION OF YOUR ACCEPTANCE OF SUCH TERMS AND
+ * CONDITIONS.
+ *
+ */
+
+#ifndef GMAPPING_OFFLINE_PARAMETER_SWEEP_H
+#define GMAPPING_OFFLINE_PARAMETER_SWEEP_H
+
+#include "ros/ros.h"
+
+/**
+ * Decodes the bag in ~bag_file_path once and runs GMapping with every
+ * configuration in ~sweep on it. The configurations run in separate
+ * processes, at most ~sweep_processes at a time, because GMapping
+ * draws all random numbers from one global generator. Every
+ * configuration writes its map and a YAML file with its metrics to
+ * ~map_file_directory.
+ *
+ * Returns the exit status of the node: 0 if all configurations
+ * succeeded.
+ */
+int runParameterSweep(const ros::NodeHandle& private_nh);
+
+#endif  // GMAPPING_OFFLINE_PARAMETER_SWEEP_H
@@ -0,0 +1,100 @@
+/*
+ * slam_gmapping
+ * Copyright (c) 2008, Willow Garage, Inc.
+ *
+ * THE WORK (AS DEFINED BELOW) IS PROVIDED UNDER THE TERMS OF THIS CREATIVE
+ * COMMONS PUBLIC LICENSE ("CCPL" OR "LICENSE"). THE WORK IS PROTECTED BY
+ * COPYRIGHT AND/OR OTHER APPLICABLE LAW. ANY USE OF THE WORK OTHER THAN AS
+ * AUTHORIZED UNDER THIS LICENSE OR COPYRIGHT LAW IS PROHIBITED.
+ *
+ * BY EXERCISING ANY RIGHTS TO THE WORK PROVIDED HERE, YOU ACCEPT AND AGREE TO
+ * BE BOUND BY THE TERMS OF THIS LICENSE. THE LICENSOR GRANTS YOU THE RIGHTS
+ * CONTAINED HERE IN CONSIDERATION OF YOUR ACCEPTANCE OF SUCH TERMS AND
+ * CONDITIONS.
+ *
+ */
+
+#ifndef GMAPPING_OFFLINE_PARTICLE_FILTER_H
+#define GMAPPING_OFFLINE_PARTICLE_FILTER_H
+
+#include <vector>
+
+#include "gmapping_offline/gmapping_parameters.h"
+
+#include "gmapping/gridfastslam/gridslamprocessor.h"
+#include "gmapping/gridfastslam/motionmodel.h"
+#include "gmapping/scanmatcher/scanmatcher.h"
+#include "gmapping/sensor/sensor_range/rangesensor.h"
+
+/**
+ * The particle filter of GMapping's GridSlamProcessor, rebuilt on the
+ * public ScanMatcher so that the particles are scan matched and their
+ * scans registered on several threads. GridSlamProcessor keeps these
+ * steps private and runs them one particle after the other.
+ *
+ * Everything that draws random numbers, i.e. the motion model and the
+ * resampling, and everything that shares map patches between
+ * particles runs on the calling thread in the order of the particles.
+ * The threads only work on their own particles and the weights are
+ * summed in the order of the particles afterwards, so the maps do not
+ * depend on the number of threads.
+ */
+class ParticleFilter
+{
+  public:
+    /// Initializes the particles at initial_pose. laser must outlive
+    /// the filter. max_range and max_urange are the resolved maxRange
+    /// and maxUrange.
+    ParticleFilter(const GMappingParameters& params, const GMapping::RangeSensor* laser,
+                   double max_range, double max_urange,
+                   const GMapping::OrientedPoint& initial_pose, int threads);
+    ~ParticleFilter();
+
+    /// Like GridSlamProcessor::processScan. Returns true if the reading
+    /// was processed, i.e. the robot moved far enough.
+    bool processScan(const GMapping::RangeReading& reading);
+
+    const GMapping::GridSlamProcessor::ParticleVector& getParticles() const { return particles_; }
+
+    /// The particle with the highest accumulated weight.
+    int getBestParticleIndex() const;
+
+  private:
+    // Runs step on the particles in contiguous ranges, one per thread.
+    void forEachParticle(void (ParticleFilter::*step)(const double*, size_t, size_t),
+                         const double* plain_reading);
+    // Scan matches particles begin to end and stores their likelihoods.
+    void matchParticles(const double* plain_reading, size_t begin, size_t end);
+    // Registers the reading into the maps of particles begin to end,
+    // whose active areas must be allocated.
+    void registerParticles(const double* plain_reading, size_t begin, size_t end);
+    // Registers the reading into all maps.
+    void registerScans(const double* plain_reading);
+    void normalize();
+    void resample(const double* plain_reading, const GMapping::RangeReading* reading);
+
+    GMappingParameters params_;
+    const GMapping::RangeSensor* laser_;
+    std::vector<double> laser_angles_;
+    double max_range_;
+    double max_urange_;
+    int threads_;
+    GMapping::MotionModel motion_model_;
+    // Only computes the active areas on the calling thread. Scan
+    // matching does not change it, so the threads share it.
+    GMapping::ScanMatcher matcher_;
+    GMapping::GridSlamProcessor::ParticleVector particles_;
+    GMapping::GridSlamProcessor::TNode* root_;
+    // The readings of the nodes, owned by the filter.
+    std::vector<GMapping::RangeReading*> readings_;
+    std::vector<double> likelihoods_;
+    std::vector<double> weights_;
+    double neff_;
+    GMapping::OrientedPoint odom_pose_;
+    double linear_distance_;
+    double angular_distance_;
+    double last_update_time_;
+    int count_;
+};
+
+#endif  // GMAPPING_OFFLINE_PARTICLE_FILTER_H
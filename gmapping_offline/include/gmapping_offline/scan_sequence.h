@@ -0,0 +1,151 @@
+/*
+ * slam_gmapping
+ * Copyright (c) 2008, Willow Garage, Inc.
+ *
+ * THE WORK (AS DEFINED BELOW) IS PROVIDED UNDER THE TERMS OF THIS CREATIVE
+ * COMMONS PUBLIC LICENSE ("CCPL" OR "LICENSE"). THE WORK IS PROTECTED BY
+ * COPYRIGHT AND/OR OTHER APPLICABLE LAW. ANY USE OF THE WORK OTHER THAN AS
+ * AUTHORIZED UNDER THIS LICENSE OR COPYRIGHT LAW IS PROHIBITED.
+ *
+ * BY EXERCISING ANY RIGHTS TO THE WORK PROVIDED HERE, YOU ACCEPT AND AGREE TO
+ * BE BOUND BY THE TERMS OF THIS LICENSE. THE LICENSOR GRANTS YOU THE RIGHTS
+ * CONTAINED HERE IN CONSIDERATION OF YOUR ACCEPTANCE OF SUCH TERMS AND
+ * CONDITIONS.
+ *
+ */
+
+#ifndef GMAPPING_OFFLINE_SCAN_SEQUENCE_H
+#define GMAPPING_OFFLINE_SCAN_SEQUENCE_H
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include <boost/utility.hpp>
+
+#include "gmapping/utils/point.h"
+
+/// The laser of a scan sequence.
+struct LaserParameters
+{
+  unsigned int beam_count;
+  // The angles of the scan messages. A negative increment means that
+  // the laser is mounted upside-down.
+  double angle_min;
+  double angle_increment;
+  double range_max;
+  // The pose of the laser relative to the base frame.
+  GMapping::OrientedPoint pose;
+};
+
+/**
+ * The laser scans of a bag with the odometry pose at their time
+ * stamps, i.e. all the input GMapping needs. Decoding the bag and
+ * looking up the poses once lets several mapper configurations share
+ * the work.
+ *
+ * The scans are stored in one block of fixed size records, either in
+ * memory or in a cache file that is mapped into memory. The cache
+ * file starts with a header that describes the laser, followed by a
+ * description of the source of the scans and the records. It uses
+ * the byte order of the machine that wrote it.
+ */
+class ScanSequence : boost::noncopyable
+{
+  public:
+    ScanSequence();
+    ~ScanSequence();
+
+    const LaserParameters& laser() const { return laser_; }
+    size_t size() const { return size_; }
+
+    double stamp(size_t i) const;
+    GMapping::OrientedPoint odomPose(size_t i) const;
+
+    /// Returns the laser().beam_count ranges of scan i in GMapping's
+    /// order, i.e. with increasing angle and with readings below the
+    /// minimum range replaced by the maximum range.
+    const float* ranges(size_t i) const;
+
+    /// Removes all scans and sets the laser.
+    void reset(const LaserParameters& laser);
+
+    /// Appends a scan with laser().beam_count ranges. Not possible
+    /// for a sequence that was loaded from a cache file.
+    void add(double stamp, const GMapping::OrientedPoint& odom_pose, const float* ranges);
+
+    /// Writes the scans to a cache file. source describes where the
+    /// scans came from. Returns false if the file could not be written.
+    bool save(const std::string& path, const std::string& source) const;
+
+    /// Maps a cache file written by save() into memory and sets source
+    /// to its description. Returns false if the file could not be read
+    /// or is not a valid cache file.
+    bool load(const std::string& path, std::string& source);
+
+  private:
+    struct RecordHeader
+    {
+      double stamp;
+      double x;
+      double y;
+      double theta;
+    };
+
+    struct FileHeader
+    {
+      char magic[8];
+      uint32_t version;
+      uint32_t beam_count;
+      uint64_t size;
+      uint64_t record_size;
+      // The size of the source description, padded to a multiple of 8.
+      uint64_t source_size;
+      double angle_min;
+      double angle_increment;
+      double range_max;
+      double laser_x;
+      double laser_y;
+      double laser_theta;
+    };
+
+    static const char kMagic[8];
+    static const uint32_t kVersion;
+
+    const RecordHeader& record(size_t i) const;
+    static size_t recordSize(unsigned int beam_count);
+    void unmap();
+
+    LaserParameters laser_;
+    size_t record_size_;
+    size_t size_;
+    // The records, either in records_ or in the mapped cache file.
+    const char* data_;
+    std::vector<char> records_;
+    void* mapping_;
+    size_t mapping_size_;
+};
+
+/**
+ * Decodes the scans on laser_topic in the bag and looks up their
+ * odometry poses in the transforms on /tf. Scans without a transform
+ * are dropped, like in the node. Keeps every throttle_scans-th scan.
+ * Returns false if the bag could not be read or contains no scan with
+ * odometry.
+ */
+bool readScanSequence(const std::string& bag_file_path, const std::string& laser_topic,
+                      const std::string& base_frame, const std::string& odom_frame,
+                      int throttle_scans, ScanSequence& sequence);
+
+/**
+ * Like readScanSequence(), but if cache_path is not empty, loads the
+ * scans from the cache file instead if it was written for the same
+ * arguments and a bag of the same size and modification time, or
+ * writes it after decoding the bag.
+ */
+bool loadScanSequence(const std::string& bag_file_path, const std::string& laser_topic,
+                      const std::string& base_frame, const std::string& odom_frame,
+                      int throttle_scans, const std::string& cache_path, ScanSequence& sequence);
+
+#endif  // GMAPPING_OFFLINE_SCAN_SEQUENCE_H
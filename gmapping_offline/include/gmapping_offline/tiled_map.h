@@ -0,0 +1,80 @@
+/*
+ * slam_gmapping
+ * Copyright (c) 2008, Willow Garage, Inc.
+ *
+ * THE WORK (AS DEFINED BELOW) IS PROVIDED UNDER THE TERMS OF THIS CREATIVE
+ * COMMONS PUBLIC LICENSE ("CCPL" OR "LICENSE"). THE WORK IS PROTECTED BY
+ * COPYRIGHT AND/OR OTHER APPLICABLE LAW. ANY USE OF THE WORK OTHER THAN AS
+ * AUTHORIZED UNDER THIS LICENSE OR COPYRIGHT LAW IS PROHIBITED.
+ *
+ * BY EXERCISING ANY RIGHTS TO THE WORK PROVIDED HERE, YOU ACCEPT AND AGREE TO
+ * BE BOUND BY THE TERMS OF THIS LICENSE. THE LICENSOR GRANTS YOU THE RIGHTS
+ * CONTAINED HERE IN CONSIDERATION OF YOUR ACCEPTANCE OF SUCH TERMS AND
+ * CONDITIONS.
+ *
+ */
+
+#ifndef GMAPPING_OFFLINE_TILED_MAP_H
+#define GMAPPING_OFFLINE_TILED_MAP_H
+
+#include <vector>
+
+#include "nav_msgs/MapMetaData.h"
+#include "nav_msgs/OccupancyGrid.h"
+
+#include "gmapping/gridfastslam/gridslamprocessor.h"
+
+/**
+ * An occupancy grid with the cell values of nav_msgs/OccupancyGrid,
+ * stored in square tiles that are allocated when a known cell is
+ * written to them. The unexplored parts of a large map take no
+ * memory, and regions are assembled into messages only on demand.
+ */
+class TiledMap
+{
+  public:
+    /// The edge length of the tiles in cells. A tile takes 4 KB.
+    static const int kTileSize;
+
+    TiledMap();
+
+    /// Removes all tiles and sets the size and position of the map.
+    /// All cells are unknown afterwards.
+    void reset(const nav_msgs::MapMetaData& info);
+
+    const nav_msgs::MapMetaData& info() const { return info_; }
+    int tilesX() const { return tiles_x_; }
+    int tilesY() const { return tiles_y_; }
+    size_t allocatedTiles() const;
+
+    /// Returns the kTileSize rows of kTileSize cells of the tile, or
+    /// NULL if it was never written, i.e. all its cells are unknown.
+    const int8_t* tile(int tile_x, int tile_y) const;
+
+    /// Like the const version, but allocates the tile with unknown
+    /// cells first if necessary. Tiles in different rows of tiles can
+    /// be written from different threads.
+    int8_t* tile(int tile_x, int tile_y);
+
+    /// Copies the cells in [min_x, max_x) x [min_y, max_y) into grid
+    /// and sets its info. Leaves the header of grid unchanged.
+    void getRegion(int min_x, int min_y, int max_x, int max_y, nav_msgs::OccupancyGrid& grid) const;
+
+  private:
+    nav_msgs::MapMetaData info_;
+    int tiles_x_;
+    int tiles_y_;
+    // Row-major, empty for tiles that were never written.
+    std::vector<std::vector<int8_t> > tiles_;
+};
+
+/**
+ * Converts the cells in [min_x, max_x) x [min_y, max_y) of smap into
+ * map, which must have the size of smap. Cells with an occupancy
+ * above occ_thresh are occupied. Tiles that only get unknown cells
+ * are not allocated.
+ */
+void convertMapRegion(const GMapping::ScanMatcherMap& smap, double occ_thresh,
+                      int min_x, int min_y, int max_x, int max_y, TiledMap& map);
+
+#endif  // GMAPPING_OFFLINE_TILED_MAP_H
@@ -0,0 +1,96 @@
+/*
+ * slam_gmapping
+ * Copyright (c) 2008, Willow Garage, Inc.
+ *
+ * THE WORK (AS DEFINED BELOW) IS PROVIDED UNDER THE TERMS OF THIS CREATIVE
+ * COMMONS PUBLIC LICENSE ("CCPL" OR "LICENSE"). THE WORK IS PROTECTED BY
+ * COPYRIGHT AND/OR OTHER APPLICABLE LAW. ANY USE OF THE WORK OTHER THAN AS
+ * AUTHORIZED UNDER THIS LICENSE OR COPYRIGHT LAW IS PROHIBITED.
+ *
+ * BY EXERCISING ANY RIGHTS TO THE WORK PROVIDED HERE, YOU ACCEPT AND AGREE TO
+ * BE BOUND BY THE TERMS OF THIS LICENSE. THE LICENSOR GRANTS YOU THE RIGHTS
+ * CONTAINED HERE IN CONSIDERATION OF YOUR ACCEPTANCE OF SUCH TERMS AND
+ * CONDITIONS.
+ *
+ */
+
+#ifndef GMAPPING_OFFLINE_TRAJECTORY_BUFFER_H
+#define GMAPPING_OFFLINE_TRAJECTORY_BUFFER_H
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include "geometry_msgs/PoseStamped.h"
+#include "nav_msgs/Path.h"
+
+#include "gmapping/gridfastslam/gridslamprocessor.h"
+
+/**
+ * The trajectory of the best particle. The thread that runs GMapping
+ * updates it after every processed scan, which only converts the nodes
+ * that are not in the path yet. If the best particle changed lineage,
+ * the path is cut back to the last node both lineages share first.
+ * The poses are kept in chunks that never change once they
+ * are full and are shared by all snapshots, so an update only copies
+ * the last chunk. Other threads read the snapshots, so they neither
+ * walk the trajectory tree nor wait for GMapping or the map.
+ */
+class TrajectoryBuffer
+{
+  public:
+    TrajectoryBuffer();
+
+    /// Makes the trajectory ending in best_node the current path, in
+    /// frame_id and with stamp. Returns false if it did not change.
+    bool update(const GMapping::GridSlamProcessor::TNode* best_node,
+                const std::string& frame_id, const ros::Time& stamp);
+
+    /// Returns the current path, oldest pose first. Assembling it takes
+    /// time linear in its length, but only waits while update() swaps
+    /// in a new snapshot.
+    nav_msgs::Path::ConstPtr path() const;
+
+  private:
+    typedef std::vector<geometry_msgs::PoseStamped> Poses;
+    typedef std::vector<boost::shared_ptr<const Poses> > Chunks;
+
+    struct Snapshot
+    {
+      std::string frame_id;
+      ros::Time stamp;
+      Chunks chunks;
+    };
+
+    // Identifies a node of the path like the map does. The nodes of
+    // all particles that processed the same scan share its reading.
+    struct NodeKey
+    {
+      const GMapping::RangeReading* reading;
+      GMapping::OrientedPoint pose;
+    };
+
+    static const size_t kChunkSize = 256;
+
+    // Returns the length of the path up to and including node, or 0 if
+    // node is not in the path.
+    size_t findNode(const GMapping::GridSlamProcessor::TNode* node) const;
+    // Drops all but the first size poses.
+    void truncate(size_t size);
+
+    // The full chunks and the poses after them, only used by update().
+    Chunks chunks_;
+    Poses last_chunk_;
+    std::string frame_id_;
+    // The nodes of the poses, and the index of the node of each reading.
+    std::vector<NodeKey> nodes_;
+    std::map<const GMapping::RangeReading*, size_t> node_indexes_;
+    // Only replaced as a whole, so that readers can keep snapshots.
+    boost::shared_ptr<const Snapshot> snapshot_;
+    mutable boost::mutex snapshot_mutex_;
+};
+
+#endif  // GMAPPING_OFFLINE_TRAJECTORY_BUFFER_H
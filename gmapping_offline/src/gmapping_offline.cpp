@@ -41,10 +41,15 @@ Subscribes to (name/type):
 
 Publishes to (name/type):
 - @b "/tf"/tf/tfMessage: position relative to the map
+- @b "~map_update_latency"/std_msgs/Float64: wall time in seconds the last map update took
+- @b "map_updates"/nav_msgs/OccupancyGrid: the region of the map that changed in the last update, if ~publish_map_updates is set
+- @b "trajectory"/nav_msgs/Path: the trajectory of the best particle, latched and updated with the map, i.e. at most every ~map_update_interval
 
 
 @section services
  - @b "~dynamic_map" : returns the map
+ - @b "trajectory"/hector_nav_msgs/GetRobotTrajectory : returns the trajectory of the best particle
+ - @b "map_region"/gmapping_offline/GetMapRegion : returns the cells of the map that overlap a rectangle, without assembling the rest of the map
 
 
 @section parameters ROS parameters
@@ -58,10 +63,28 @@ Parameters used by our GMapping wrapper:
 - @b "~map_frame": @b [string] the tf frame_id where the robot pose on the map is published
 - @b "~odom_frame": @b [string] the tf frame_id from which odometry is read
 - @b "~map_update_interval": @b [double] time in seconds between two recalculations of the map
+- @b "~incremental_map_update": @b [bool] only register new scans into the map while the best particle stays in the same lineage (default: true)
+- @b "~map_conversion_threads": @b [int] threads that convert the map into the map message (default: number of cores)
+- @b "~publish_map_updates": @b [bool] publish only the changed region of the map on "map_updates" and the full map only when it was rebuilt or resized (default: false)
+- @b "~particle_threads": @b [int] 0 runs GMapping's particle filter. A positive number runs a copy of it that scan matches the particles and registers their scans on that many threads. Its maps do not depend on the number of threads (default: 0)
 
 Parameters used when running GMapping directly from a bag file:
 - @b "~bag_file_path": @b [string] the path of the bag file to process
 - @b "~laser_topic": @b [string] the name of the laser topic to process from the bag file
+- @b "~publish_tf": @b [bool] rebroadcast the transforms of the bag file and the map to odom transform (default: true)
+- @b "~publish_clock": @b [bool] publish the time of the bag file on /clock (default: true)
+- @b "~prefetch_queue_size": @b [int] the number of messages deserialized ahead of processing, at least 1 (default: 1000)
+- @b "~progress_log_period": @b [double] wall time in seconds between two progress messages (default: 5.0)
+- @b "~scan_cache_path": @b [string] a file with the scans of the bag and their odometry poses. If it exists and was written for the same bag, with the same size and modification time, laser topic, frames and ~throttle_scans, the scans are read from it instead of the bag, otherwise the bag is decoded and the file written. The transforms of the bag are not republished then. Also used by a parameter sweep (default: "", no cache)
+- @b "~map_file_directory": @b [string] the directory that receives map.pgm and map.yaml, the final map, after the bag was processed. It is created if it does not exist (default: "", no file)
+- @b "~map_file_tiles": @b [bool] write the final map as one image per tile of 64x64 cells that has a known cell, map_<tile x>_<tile y>.pgm and .yaml, plus the list of tiles in map_tiles.yaml (default: false)
+- @b "~seed": @b [int] seed of the particle filter's random numbers. Together with ~publish_tf set to false, runs on the same bag produce identical maps, and the node warns if ~publish_tf is true. 0 seeds from the current time (default: 0)
+
+Parameters used by a parameter sweep. If ~sweep is set, the node decodes the bag in ~bag_file_path once, runs GMapping with every configuration in separate processes and exits:
+- @b "~sweep": @b [list] the configurations. Each is a dictionary of the GMapping parameters below that override the node's parameters, and an optional @b name (default: config_<index>)
+- @b "~sweep_processes": @b [int] the number of configurations that run at the same time, at least 1 (default: number of cores)
+- @b "~particle_threads": @b [int] the threads of each configuration's particle filter, like the node's ~particle_threads (default: 0)
+- @b "~map_file_directory": @b [string] the directory that receives <name>.pgm and <name>.yaml, the map of each configuration, and <name>_metrics.yaml with the number of processed scans, the final pose entropy, the runtime in seconds and the parameters. It is created if it does not exist (default: .)
 
 Parameters used by GMapping itself:
 
@@ -109,6 +132,8 @@ Initial map dimensions and resolution:
 
 #include "gmapping_offline/gmapping_offline.h"
 
+#include <algorithm>
+#include <cmath>
 #include <iostream>
 #include <sstream>
 #include <time.h>
@@ -123,27 +148,25 @@ Initial map dimensions and resolution:
 
 #include "nav_msgs/MapMetaData.h"
 
+#include "gmapping_offline/map_writer.h"
+#include "gmapping_offline/offline_mapper.h"
+#include "gmapping_offline/parameter_sweep.h"
+
 #include "gmapping/sensor/sensor_range/rangesensor.h"
 #include "gmapping/sensor/sensor_odometry/odometrysensor.h"
 
-// compute linear index for given map coords
-#define MAP_IDX(sx, i, j) ((sx) * (j) + (i))
-
 SlamGMapping::SlamGMapping():
   map_to_odom_(tf::Transform(tf::createQuaternionFromRPY( 0, 0, 0 ), tf::Point(0, 0, 0 ))),
-  laser_count_(0), transform_thread_(NULL), process_bag_thread_(NULL)
+  gsp_(NULL), filter_(NULL), laser_count_(0), smap_(NULL), map_reading_(NULL),
+  transform_thread_(NULL), process_bag_thread_(NULL)
 {
   // log4cxx::Logger::getLogger(ROSCONSOLE_DEFAULT_NAME)->setLevel(ros::console::g_level_lookup[ros::console::levels::Debug]);
 
-  // The library is pretty chatty
-  //gsp_ = new GMapping::GridSlamProcessor(std::cerr);
-  gsp_ = new GMapping::GridSlamProcessor();
-  ROS_ASSERT(gsp_);
-
   tfB_ = new tf::TransformBroadcaster();
   ROS_ASSERT(tfB_);
 
   gsp_laser_ = NULL;
+  gsp_laser_angle_min_ = 0.0;
   gsp_laser_angle_increment_ = 0.0;
   gsp_odom_ = NULL;
 
@@ -170,73 +193,67 @@ SlamGMapping::SlamGMapping():
     laser_topic_ = "scan";
   if(!private_nh_.getParam("bag_file_path", bag_file_path_))
     bag_file_path_ = "";
+  if(!private_nh_.getParam("publish_tf", publish_tf_) || bag_file_path_.empty())
+    publish_tf_ = true;
+  if(!private_nh_.getParam("publish_clock", publish_clock_))
+    publish_clock_ = true;
+  if(!private_nh_.getParam("prefetch_queue_size", prefetch_queue_size_))
+    prefetch_queue_size_ = 1000;
+  if(prefetch_queue_size_ < 1)
+  {
+    // An empty queue would block the reader forever.
+    ROS_WARN("~prefetch_queue_size must be at least 1, using 1 instead of %d", prefetch_queue_size_);
+    prefetch_queue_size_ = 1;
+  }
+  if(!private_nh_.getParam("progress_log_period", progress_log_period_))
+    progress_log_period_ = 5.0;
+  if(!private_nh_.getParam("scan_cache_path", scan_cache_path_))
+    scan_cache_path_ = "";
+  if(!private_nh_.getParam("map_file_directory", map_file_directory_))
+    map_file_directory_ = "";
+  if(!private_nh_.getParam("map_file_tiles", map_file_tiles_))
+    map_file_tiles_ = false;
 
   double tmp;
   if(!private_nh_.getParam("map_update_interval", tmp))
     tmp = 5.0;
   map_update_interval_.fromSec(tmp);
+  if(!private_nh_.getParam("incremental_map_update", incremental_map_update_))
+    incremental_map_update_ = true;
+  if(!private_nh_.getParam("map_conversion_threads", map_conversion_threads_))
+    map_conversion_threads_ = std::max(1, (int)boost::thread::hardware_concurrency());
+  if(!private_nh_.getParam("publish_map_updates", publish_map_updates_))
+    publish_map_updates_ = false;
+  if(!private_nh_.getParam("particle_threads", particle_threads_))
+    particle_threads_ = 0;
+
+  if(particle_threads_ <= 0)
+  {
+    // The library is pretty chatty
+    //gsp_ = new GMapping::GridSlamProcessor(std::cerr);
+    gsp_ = new GMapping::GridSlamProcessor();
+    ROS_ASSERT(gsp_);
+  }
 
   // Parameters used by GMapping itself
+  params_.load(private_nh_);
+  if(params_.seed > 0 && publish_tf_ && !bag_file_path_.empty())
+    ROS_WARN("~seed only makes runs reproducible with ~publish_tf set to false");
   maxUrange_ = 0.0;  maxRange_ = 0.0; // preliminary default, will be set in initMapper()
-  if(!private_nh_.getParam("sigma", sigma_))
-    sigma_ = 0.05;
-  if(!private_nh_.getParam("kernelSize", kernelSize_))
-    kernelSize_ = 1;
-  if(!private_nh_.getParam("lstep", lstep_))
-    lstep_ = 0.05;
-  if(!private_nh_.getParam("astep", astep_))
-    astep_ = 0.05;
-  if(!private_nh_.getParam("iterations", iterations_))
-    iterations_ = 5;
-  if(!private_nh_.getParam("lsigma", lsigma_))
-    lsigma_ = 0.075;
-  if(!private_nh_.getParam("ogain", ogain_))
-    ogain_ = 3.0;
-  if(!private_nh_.getParam("lskip", lskip_))
-    lskip_ = 0;
-  if(!private_nh_.getParam("srr", srr_))
-    srr_ = 0.1;
-  if(!private_nh_.getParam("srt", srt_))
-    srt_ = 0.2;
-  if(!private_nh_.getParam("str", str_))
-    str_ = 0.1;
-  if(!private_nh_.getParam("stt", stt_))
-    stt_ = 0.2;
-  if(!private_nh_.getParam("linearUpdate", linearUpdate_))
-    linearUpdate_ = 1.0;
-  if(!private_nh_.getParam("angularUpdate", angularUpdate_))
-    angularUpdate_ = 0.5;
-  if(!private_nh_.getParam("temporalUpdate", temporalUpdate_))
-    temporalUpdate_ = -1.0;
-  if(!private_nh_.getParam("resampleThreshold", resampleThreshold_))
-    resampleThreshold_ = 0.5;
-  if(!private_nh_.getParam("particles", particles_))
-    particles_ = 30;
-  if(!private_nh_.getParam("xmin", xmin_))
-    xmin_ = -100.0;
-  if(!private_nh_.getParam("ymin", ymin_))
-    ymin_ = -100.0;
-  if(!private_nh_.getParam("xmax", xmax_))
-    xmax_ = 100.0;
-  if(!private_nh_.getParam("ymax", ymax_))
-    ymax_ = 100.0;
-  if(!private_nh_.getParam("delta", delta_))
-    delta_ = 0.05;
-  if(!private_nh_.getParam("occ_thresh", occ_thresh_))
-    occ_thresh_ = 0.25;
-  if(!private_nh_.getParam("llsamplerange", llsamplerange_))
-    llsamplerange_ = 0.01;
-  if(!private_nh_.getParam("llsamplestep", llsamplestep_))
-    llsamplestep_ = 0.01;
-  if(!private_nh_.getParam("lasamplerange", lasamplerange_))
-    lasamplerange_ = 0.005;
-  if(!private_nh_.getParam("lasamplestep", lasamplestep_))
-    lasamplestep_ = 0.005;
+  xmin_ = params_.xmin;
+  ymin_ = params_.ymin;
+  xmax_ = params_.xmax;
+  ymax_ = params_.ymax;
 
   entropy_publisher_ = private_nh_.advertise<std_msgs::Float64>("entropy", 1, true);
+  map_update_latency_publisher_ = private_nh_.advertise<std_msgs::Float64>("map_update_latency", 1, true);
   sst_ = node_.advertise<nav_msgs::OccupancyGrid>("map", 1, true);
   sstm_ = node_.advertise<nav_msgs::MapMetaData>("map_metadata", 1, true);
+  if(publish_map_updates_)
+    map_update_publisher_ = node_.advertise<nav_msgs::OccupancyGrid>("map_updates", 10);
+  trajectory_publisher_ = node_.advertise<nav_msgs::Path>("trajectory", 1, true);
   ss_ = node_.advertiseService("dynamic_map", &SlamGMapping::mapCallback, this);
+  sr_ = node_.advertiseService("map_region", &SlamGMapping::mapRegionCallback, this);
   sp_ = node_.advertiseService("trajectory", &SlamGMapping::pathCallback, this);
 
   if (bag_file_path_.empty()) {
@@ -250,7 +267,8 @@ SlamGMapping::SlamGMapping():
   if (bag_file_path_.empty()) {
     transform_thread_ = new boost::thread(boost::bind(&SlamGMapping::publishLoop, this, transform_publish_period));
   } else {
-    time_publisher_ = node_.advertise<rosgraph_msgs::Clock>("clock", 1);
+    if (publish_clock_)
+      time_publisher_ = node_.advertise<rosgraph_msgs::Clock>("clock", 1);
     process_bag_thread_ = new boost::thread(boost::bind(&SlamGMapping::processBag, this));
   }
 }
@@ -279,6 +297,9 @@ SlamGMapping::~SlamGMapping()
   }
 
   delete gsp_;
+  delete filter_;
+  if(smap_)
+    delete smap_;
   if(gsp_laser_)
     delete gsp_laser_;
   if(gsp_odom_)
@@ -364,19 +385,36 @@ SlamGMapping::initMapper(const sensor_msgs::LaserScan& scan)
     return false;
   }
 
-  gsp_laser_beam_count_ = scan.ranges.size();
-
   double angle_min = tf::getYaw(min_q);
   double angle_max = tf::getYaw(max_q);
-  gsp_laser_angle_increment_ = scan.angle_increment;
-  ROS_DEBUG("Laser angles in base frame: min: %.3f max: %.3f inc: %.3f", angle_min, angle_max, gsp_laser_angle_increment_);
+  ROS_DEBUG("Laser angles in base frame: min: %.3f max: %.3f inc: %.3f", angle_min, angle_max, scan.angle_increment);
+
+  LaserParameters laser;
+  laser.beam_count = scan.ranges.size();
+  laser.angle_min = scan.angle_min;
+  laser.angle_increment = scan.angle_increment;
+  laser.range_max = scan.range_max;
+  laser.pose = gmap_pose;
+
+  /// @todo Expose setting an initial pose
+  GMapping::OrientedPoint initialPose;
+  if(!getOdomPose(initialPose, scan.header.stamp))
+    initialPose = GMapping::OrientedPoint(0.0, 0.0, 0.0);
+
+  initMapper(laser, initialPose);
+  return true;
+}
+
+void
+SlamGMapping::initMapper(const LaserParameters& laser, const GMapping::OrientedPoint& initialPose)
+{
+  gsp_laser_beam_count_ = laser.beam_count;
+  gsp_laser_angle_min_ = laser.angle_min;
+  gsp_laser_angle_increment_ = laser.angle_increment;
 
   // setting maxRange and maxUrange here so we can set a reasonable default
-  ros::NodeHandle private_nh_("~");
-  if(!private_nh_.getParam("maxRange", maxRange_))
-    maxRange_ = scan.range_max - 0.01;
-  if(!private_nh_.getParam("maxUrange", maxUrange_))
-    maxUrange_ = maxRange_;
+  maxRange_ = params_.maxRange > 0.0 ? params_.maxRange : laser.range_max - 0.01;
+  maxUrange_ = params_.maxUrange > 0.0 ? params_.maxUrange : maxRange_;
 
   // The laser must be called "FLASER".
   // We pass in the absolute value of the computed angle increment, on the
@@ -386,48 +424,28 @@ SlamGMapping::initMapper(const sensor_msgs::LaserScan& scan)
   gsp_laser_ = new GMapping::RangeSensor("FLASER",
                                          gsp_laser_beam_count_,
                                          fabs(gsp_laser_angle_increment_),
-                                         gmap_pose,
+                                         laser.pose,
                                          0.0,
                                          maxRange_);
   ROS_ASSERT(gsp_laser_);
 
-  GMapping::SensorMap smap;
-  smap.insert(make_pair(gsp_laser_->getName(), gsp_laser_));
-  gsp_->setSensorMap(smap);
-
   gsp_odom_ = new GMapping::OdometrySensor(odom_frame_);
   ROS_ASSERT(gsp_odom_);
 
-
-  /// @todo Expose setting an initial pose
-  GMapping::OrientedPoint initialPose;
-  if(!getOdomPose(initialPose, scan.header.stamp))
-    initialPose = GMapping::OrientedPoint(0.0, 0.0, 0.0);
-
-  gsp_->setMatchingParameters(maxUrange_, maxRange_, sigma_,
-                              kernelSize_, lstep_, astep_, iterations_,
-                              lsigma_, ogain_, lskip_);
-
-  gsp_->setMotionModelParameters(srr_, srt_, str_, stt_);
-  gsp_->setUpdateDistances(linearUpdate_, angularUpdate_, resampleThreshold_);
-  gsp_->setUpdatePeriod(temporalUpdate_);
-  gsp_->setgenerateMap(false);
-  gsp_->GridSlamProcessor::init(particles_, xmin_, ymin_, xmax_, ymax_,
-                                delta_, initialPose);
-  gsp_->setllsamplerange(llsamplerange_);
-  gsp_->setllsamplestep(llsamplestep_);
-  /// @todo Check these calls; in the gmapping gui, they use
-  /// llsamplestep and llsamplerange intead of lasamplestep and
-  /// lasamplerange.  It was probably a typo, but who knows.
-  gsp_->setlasamplerange(lasamplerange_);
-  gsp_->setlasamplestep(lasamplestep_);
-
-  // Call the sampling function once to set the seed.
-  GMapping::sampleGaussian(1,time(NULL));
+  if(gsp_)
+  {
+    GMapping::SensorMap smap;
+    smap.insert(make_pair(gsp_laser_->getName(), gsp_laser_));
+    gsp_->setSensorMap(smap);
+    params_.initProcessor(*gsp_, maxRange_, maxUrange_, initialPose);
+  }
+  else
+  {
+    filter_ = new ParticleFilter(params_, gsp_laser_, maxRange_, maxUrange_, initialPose,
+                                 particle_threads_);
+  }
 
   ROS_INFO("Initialization complete");
-
-  return true;
 }
 
 bool
@@ -486,12 +504,109 @@ SlamGMapping::addScan(const sensor_msgs::LaserScan& scan, GMapping::OrientedPoin
             gmap_pose.theta);
             */
 
+  return processReading(reading);
+}
+
+bool
+SlamGMapping::addScan(const ScanSequence& sequence, size_t i)
+{
+  // The ranges of the sequence are already inverted and filtered.
+  const float* ranges = sequence.ranges(i);
+  std::vector<double> ranges_double(ranges, ranges + gsp_laser_beam_count_);
+  GMapping::RangeReading reading(gsp_laser_beam_count_,
+                                 &ranges_double[0],
+                                 gsp_laser_,
+                                 sequence.stamp(i));
+  reading.setPose(sequence.odomPose(i));
+  return processReading(reading);
+}
+
+bool
+SlamGMapping::processReading(const GMapping::RangeReading& reading)
+{
+  if(filter_)
+    return filter_->processScan(reading);
   return gsp_->processScan(reading);
 }
 
+const GMapping::GridSlamProcessor::ParticleVector&
+SlamGMapping::particles() const
+{
+  if(filter_)
+    return filter_->getParticles();
+  return gsp_->getParticles();
+}
+
+const GMapping::GridSlamProcessor::Particle&
+SlamGMapping::bestParticle() const
+{
+  return particles()[filter_ ? filter_->getBestParticleIndex() : gsp_->getBestParticleIndex()];
+}
+
+void
+SlamGMapping::readBag(rosbag::View& view, BoundedQueue<BagMessage>& queue, bool& failed)
+{
+  try {
+    BOOST_FOREACH(rosbag::MessageInstance const m, view)
+    {
+      BagMessage message;
+      message.time = m.getTime();
+      message.scan = m.instantiate<sensor_msgs::LaserScan>();
+      if (message.scan == NULL)
+        message.transforms = m.instantiate<tf::tfMessage>();
+      if (!queue.push(message))
+        break;
+    }
+  } catch (rosbag::BagException exception) {
+    ROS_ERROR("Error reading bag: %s", exception.what());
+    failed = true;
+  }
+  queue.close();
+}
+
+bool
+SlamGMapping::processScanCache()
+{
+  ScanSequence sequence;
+  if(!loadScanSequence(bag_file_path_, laser_topic_, base_frame_, odom_frame_, throttle_scans_,
+                       scan_cache_path_, sequence))
+    return false;
+
+  ros::WallTime start_time = ros::WallTime::now();
+  ros::WallTime last_log_time = start_time;
+  size_t count = 0;
+  for(; count < sequence.size() && ros::ok(); count++)
+  {
+    ros::Time stamp(sequence.stamp(count));
+    ros::WallTime now = ros::WallTime::now();
+    if ((now - last_log_time).toSec() >= progress_log_period_) {
+      ROS_INFO("Processing %d/%d\t%d%%\t%.1fx real time", (int)count, (int)sequence.size(),
+               (int)(100.0 * count / sequence.size()),
+               (sequence.stamp(count) - sequence.stamp(0)) / (now - start_time).toSec());
+      last_log_time = now;
+    }
+
+    if (publish_clock_) {
+      rosgraph_msgs::Clock clock_msg;
+      clock_msg.clock = stamp;
+      time_publisher_.publish(clock_msg);
+    }
+    addCachedScan(sequence, count);
+  }
+  ROS_INFO("Processed %d scans in %.1f seconds", (int)count, (ros::WallTime::now() - start_time).toSec());
+  ROS_INFO("Finished processing.");
+  return true;
+}
+
 bool
 SlamGMapping::processBag()
 {
+  // The cache has the odometry of the scans, so neither the bag nor
+  // its transforms are needed.
+  if (!scan_cache_path_.empty())
+    return processScanCache() && saveMap();
+
+  bool failed = false;
   try {
     ROS_INFO("Opening bag: %s", bag_file_path_.c_str());
     rosbag::Bag bag(bag_file_path_);
@@ -500,39 +615,67 @@ SlamGMapping::processBag()
     int scan_count = view.size();
     view.addQuery(bag, rosbag::TopicQuery("/tf"));
 
+    // Deserialize in a separate thread while the scans are processed.
+    BoundedQueue<BagMessage> queue(prefetch_queue_size_);
+    boost::thread reader_thread(boost::bind(&SlamGMapping::readBag, this,
+                                            boost::ref(view), boost::ref(queue),
+                                            boost::ref(failed)));
+
     int count = 0;
-    BOOST_FOREACH(rosbag::MessageInstance const m, view)
+    ros::WallTime start_time = ros::WallTime::now();
+    ros::WallTime last_log_time = start_time;
+    ros::Time first_message_time;
+    BagMessage message;
+    while (queue.pop(message))
     {
-      sensor_msgs::LaserScan::ConstPtr scan = m.instantiate<sensor_msgs::LaserScan>();
-      if (scan != NULL) {
-        ROS_INFO("Processing %d/%d\t%d%%", count, scan_count, (int)(100.0 * count / scan_count));
-        scan_filter_->add(scan);
+      if (!ros::ok()) {
+        queue.close();
+        break;
+      }
+      if (first_message_time.isZero())
+        first_message_time = message.time;
+
+      if (message.scan != NULL) {
+        ros::WallTime now = ros::WallTime::now();
+        if ((now - last_log_time).toSec() >= progress_log_period_) {
+          ROS_INFO("Processing %d/%d\t%d%%\t%.1fx real time", count, scan_count,
+                   (int)(100.0 * count / scan_count),
+                   (message.time - first_message_time).toSec() / (now - start_time).toSec());
+          last_log_time = now;
+        }
+        scan_filter_->add(message.scan);
         count++;
       }
 
-      tf::tfMessage::ConstPtr transform = m.instantiate<tf::tfMessage>();
-      if (transform != NULL) {
-        for (unsigned int i=0; i < transform->transforms.size(); i++) {
+      if (message.transforms != NULL) {
+        for (unsigned int i=0; i < message.transforms->transforms.size(); i++) {
           tf::StampedTransform trans;
-          tf::transformStampedMsgToTF(transform->transforms[i], trans);
+          tf::transformStampedMsgToTF(message.transforms->transforms[i], trans);
           tf_.setTransform(trans);
-          tfB_->sendTransform(trans);
+          if (publish_tf_)
+            tfB_->sendTransform(trans);
         }
       }
 
-      rosgraph_msgs::Clock clock_msg;
-      clock_msg.clock = m.getTime();
-      time_publisher_.publish(clock_msg);
+      if (publish_clock_) {
+        rosgraph_msgs::Clock clock_msg;
+        clock_msg.clock = message.time;
+        time_publisher_.publish(clock_msg);
+      }
     }
+    reader_thread.join();
     bag.close();
+    ROS_INFO("Processed %d scans in %.1f seconds", count, (ros::WallTime::now() - start_time).toSec());
   } catch (rosbag::BagException exception) {
     ROS_INFO("Error processing bag.");
     return false;
   }
+  if (failed)
+    return false;
 
   ROS_INFO("Finished processing.");
 
-  return true;
+  return saveMap();
 }
 
 void
@@ -542,8 +685,6 @@ SlamGMapping::laserCallback(const sensor_msgs::LaserScan::ConstPtr& scan)
   if ((laser_count_ % throttle_scans_) != 0)
     return;
 
-  static ros::Time last_map_update(0,0);
-
   // We can't initialize the mapper until we've got the first scan
   if(!got_first_scan_)
   {
@@ -557,7 +698,7 @@ SlamGMapping::laserCallback(const sensor_msgs::LaserScan::ConstPtr& scan)
   {
     ROS_DEBUG("scan processed");
 
-    GMapping::OrientedPoint mpose = gsp_->getParticles()[gsp_->getBestParticleIndex()].pose;
+    GMapping::OrientedPoint mpose = bestParticle().pose;
     ROS_DEBUG("new best pose: %.3f %.3f %.3f", mpose.x, mpose.y, mpose.theta);
     ROS_DEBUG("odom pose: %.3f %.3f %.3f", odom_pose.x, odom_pose.y, odom_pose.theta);
     ROS_DEBUG("correction: %.3f %.3f %.3f", mpose.x - odom_pose.x, mpose.y - odom_pose.y, mpose.theta - odom_pose.theta);
@@ -574,60 +715,82 @@ SlamGMapping::laserCallback(const sensor_msgs::LaserScan::ConstPtr& scan)
       odom_to_map.setIdentity();
     }
 
-    map_to_odom_mutex_.lock();
-    map_to_odom_ = tf::Transform(tf::Quaternion( odom_to_map.getRotation() ),
-                                 tf::Point(      odom_to_map.getOrigin() ) ).inverse();
-    map_to_odom_mutex_.unlock();
+    scanAdded(tf::Transform(tf::Quaternion( odom_to_map.getRotation() ),
+                            tf::Point(      odom_to_map.getOrigin() ) ).inverse(),
+              scan->header.stamp);
+  }
+}
 
+void
+SlamGMapping::addCachedScan(const ScanSequence& sequence, size_t i)
+{
+  GMapping::OrientedPoint odom_pose = sequence.odomPose(i);
+  if(!got_first_scan_)
+  {
+    initMapper(sequence.laser(), odom_pose);
+    got_first_scan_ = true;
+  }
+
+  if(addScan(sequence, i))
+  {
+    GMapping::OrientedPoint mpose = bestParticle().pose;
+    // The transforms of the bag were not replayed, so the correction
+    // is computed from the odometry pose of the scan.
+    tf::Transform map_to_base(tf::createQuaternionFromRPY(0, 0, mpose.theta),
+                              tf::Vector3(mpose.x, mpose.y, 0.0));
+    tf::Transform odom_to_base(tf::createQuaternionFromRPY(0, 0, odom_pose.theta),
+                               tf::Vector3(odom_pose.x, odom_pose.y, 0.0));
+    scanAdded(map_to_base * odom_to_base.inverse(), ros::Time(sequence.stamp(i)));
+  }
+}
+
+void
+SlamGMapping::scanAdded(const tf::Transform& map_to_odom, const ros::Time& stamp)
+{
+  map_to_odom_mutex_.lock();
+  map_to_odom_ = map_to_odom;
+  map_to_odom_mutex_.unlock();
+
+  if(publish_tf_)
     tfB_->sendTransform( tf::StampedTransform (map_to_odom_, ros::Time::now(), map_frame_, odom_frame_));
 
-    if(!got_map_ || (scan->header.stamp - last_map_update) > map_update_interval_)
-    {
-      updateMap(*scan);
-      last_map_update = scan->header.stamp;
-      ROS_DEBUG("Updated the map");
-    }
+  trajectory_.update(bestParticle().node, map_frame_, stamp);
+
+  if(!got_map_ || (stamp - last_map_update_) > map_update_interval_)
+  {
+    updateMap();
+    // Assembling the message takes time linear in the length of the
+    // trajectory, so it is only published with the map.
+    trajectory_publisher_.publish(trajectory_.path());
+    last_map_update_ = stamp;
+    ROS_DEBUG("Updated the map");
   }
 }
 
 double
 SlamGMapping::computePoseEntropy()
 {
-  double weight_total=0.0;
-  for(std::vector<GMapping::GridSlamProcessor::Particle>::const_iterator it = gsp_->getParticles().begin();
-      it != gsp_->getParticles().end();
-      ++it)
-  {
-    weight_total += it->weight;
-  }
-  double entropy = 0.0;
-  for(std::vector<GMapping::GridSlamProcessor::Particle>::const_iterator it = gsp_->getParticles().begin();
-      it != gsp_->getParticles().end();
-      ++it)
-  {
-    if(it->weight/weight_total > 0.0)
-      entropy += it->weight/weight_total * log(it->weight/weight_total);
-  }
-  return -entropy;
+  return OfflineMapper::computePoseEntropy(particles());
 }
 
 void
-SlamGMapping::updateMap(const sensor_msgs::LaserScan& scan)
+SlamGMapping::updateMap()
 {
-  boost::mutex::scoped_lock(map_mutex_);
+  boost::mutex::scoped_lock lock(map_mutex_);
+  ros::WallTime start_time = ros::WallTime::now();
   GMapping::ScanMatcher matcher;
-  double* laser_angles = new double[scan.ranges.size()];
-  double theta = scan.angle_min;
-  for(unsigned int i=0; i<scan.ranges.size(); i++)
+  double* laser_angles = new double[gsp_laser_beam_count_];
+  double theta = gsp_laser_angle_min_;
+  for(unsigned int i=0; i<gsp_laser_beam_count_; i++)
   {
     if (gsp_laser_angle_increment_ < 0)
-        laser_angles[scan.ranges.size()-i-1]=theta;
+        laser_angles[gsp_laser_beam_count_-i-1]=theta;
     else
         laser_angles[i]=theta;
-    theta += scan.angle_increment;
+    theta += gsp_laser_angle_increment_;
   }
 
-  matcher.setLaserParameters(scan.ranges.size(), laser_angles,
+  matcher.setLaserParameters(gsp_laser_beam_count_, laser_angles,
                              gsp_laser_->getPose());
 
   delete[] laser_angles;
@@ -635,36 +798,48 @@ SlamGMapping::updateMap(const sensor_msgs::LaserScan& scan)
   matcher.setusableRange(maxUrange_);
   matcher.setgenerateMap(true);
 
-  GMapping::GridSlamProcessor::Particle best =
-          gsp_->getParticles()[gsp_->getBestParticleIndex()];
+  GMapping::GridSlamProcessor::Particle best = bestParticle();
   std_msgs::Float64 entropy;
   entropy.data = computePoseEntropy();
   if(entropy.data > 0.0)
     entropy_publisher_.publish(entropy);
 
-  if(!got_map_) {
-    map_.map.info.resolution = delta_;
-    map_.map.info.origin.position.x = 0.0;
-    map_.map.info.origin.position.y = 0.0;
-    map_.map.info.origin.position.z = 0.0;
-    map_.map.info.origin.orientation.x = 0.0;
-    map_.map.info.origin.orientation.y = 0.0;
-    map_.map.info.origin.orientation.z = 0.0;
-    map_.map.info.origin.orientation.w = 1.0;
-  } 
-
-  GMapping::Point center;
-  center.x=(xmin_ + xmax_) / 2.0;
-  center.y=(ymin_ + ymax_) / 2.0;
+  // Find the scans of the best particle's trajectory that are not in
+  // the map yet, newest first. If the trajectory does not pass through
+  // the last node that was registered, the best particle changed
+  // lineage and the map is rebuilt.
+  std::vector<GMapping::GridSlamProcessor::TNode*> new_nodes;
+  bool rebuild = !incremental_map_update_ || !smap_;
+  GMapping::GridSlamProcessor::TNode* node = best.node;
+  for(; node; node = node->parent)
+  {
+    if(!rebuild && node->reading == map_reading_ && node->pose.x == map_pose_.x &&
+       node->pose.y == map_pose_.y && node->pose.theta == map_pose_.theta)
+      break;
+    new_nodes.push_back(node);
+  }
+  if(!node)
+    rebuild = true;
 
-  GMapping::ScanMatcherMap smap(center, xmin_, ymin_, xmax_, ymax_, 
-                                delta_);
+  if(rebuild)
+  {
+    GMapping::Point center;
+    center.x=(xmin_ + xmax_) / 2.0;
+    center.y=(ymin_ + ymax_) / 2.0;
+
+    if(smap_)
+      delete smap_;
+    smap_ = new GMapping::ScanMatcherMap(center, xmin_, ymin_, xmax_, ymax_,
+                                         params_.delta);
+  }
+  GMapping::ScanMatcherMap& smap = *smap_;
 
   ROS_DEBUG("Trajectory tree:");
-  for(GMapping::GridSlamProcessor::TNode* n = best.node;
-      n;
-      n = n->parent)
+  for(std::vector<GMapping::GridSlamProcessor::TNode*>::reverse_iterator it = new_nodes.rbegin();
+      it != new_nodes.rend();
+      ++it)
   {
+    GMapping::GridSlamProcessor::TNode* n = *it;
     ROS_DEBUG("  %.3f %.3f %.3f",
               n->pose.x,
               n->pose.y,
@@ -678,10 +853,13 @@ SlamGMapping::updateMap(const sensor_msgs::LaserScan& scan)
     matcher.computeActiveArea(smap, n->pose, &((*n->reading)[0]));
     matcher.registerScan(smap, n->pose, &((*n->reading)[0]));
   }
+  map_reading_ = best.node->reading;
+  map_pose_ = best.node->pose;
 
-  // the map may have expanded, so resize ros message as well
-  if(map_.map.info.width != (unsigned int) smap.getMapSizeX() || map_.map.info.height != (unsigned int) smap.getMapSizeY()) {
-
+  // the map may have expanded, so resize the tiled map as well
+  bool resized = map_.info().width != (unsigned int) smap.getMapSizeX() ||
+                 map_.info().height != (unsigned int) smap.getMapSizeY();
+  if(resized) {
     // NOTE: The results of ScanMatcherMap::getSize() are different from the parameters given to the constructor
     //       so we must obtain the bounding box in a different way
     GMapping::Point wmin = smap.map2world(GMapping::IntPoint(0, 0));
@@ -691,83 +869,188 @@ SlamGMapping::updateMap(const sensor_msgs::LaserScan& scan)
 
     ROS_DEBUG("map size is now %dx%d pixels (%f,%f)-(%f, %f)", smap.getMapSizeX(), smap.getMapSizeY(),
               xmin_, ymin_, xmax_, ymax_);
-
-    map_.map.info.width = smap.getMapSizeX();
-    map_.map.info.height = smap.getMapSizeY();
-    map_.map.info.origin.position.x = xmin_;
-    map_.map.info.origin.position.y = ymin_;
-    map_.map.data.resize(map_.map.info.width * map_.map.info.height);
-
-    ROS_DEBUG("map origin: (%f, %f)", map_.map.info.origin.position.x, map_.map.info.origin.position.y);
+  }
+  if(rebuild || resized) {
+    // Start with no tiles, so that tiles which only have unknown cells
+    // after a rebuild are not kept.
+    nav_msgs::MapMetaData info;
+    info.resolution = params_.delta;
+    info.width = smap.getMapSizeX();
+    info.height = smap.getMapSizeY();
+    info.origin.position.x = xmin_;
+    info.origin.position.y = ymin_;
+    info.origin.orientation.w = 1.0;
+    map_.reset(info);
   }
 
-  for(int x=0; x < smap.getMapSizeX(); x++)
+  // Only the cells within the usable range of the new scans can have
+  // changed, unless the map was rebuilt or its coordinates changed.
+  bool full_update = !got_map_ || rebuild || resized;
+  int min_x = 0;
+  int min_y = 0;
+  int max_x = smap.getMapSizeX();
+  int max_y = smap.getMapSizeY();
+  if(!full_update)
   {
-    for(int y=0; y < smap.getMapSizeY(); y++)
+    double range = maxUrange_ + hypot(gsp_laser_->getPose().x, gsp_laser_->getPose().y) + 2 * params_.delta;
+    min_x = max_x;
+    min_y = max_y;
+    max_x = 0;
+    max_y = 0;
+    for(unsigned int i = 0; i < new_nodes.size(); i++)
     {
-      /// @todo Sort out the unknown vs. free vs. obstacle thresholding
-      GMapping::IntPoint p(x, y);
-      double occ=smap.cell(p);
-      assert(occ <= 1.0);
-      if(occ < 0)
-        map_.map.data[MAP_IDX(map_.map.info.width, x, y)] = -1;
-      else if(occ > occ_thresh_)
-      {
-        //map_.map.data[MAP_IDX(map_.map.info.width, x, y)] = (int)round(occ*100.0);
-        map_.map.data[MAP_IDX(map_.map.info.width, x, y)] = 100;
-      }
-      else
-        map_.map.data[MAP_IDX(map_.map.info.width, x, y)] = 0;
+      if(!new_nodes[i]->reading)
+        continue;
+      const GMapping::OrientedPoint& pose = new_nodes[i]->pose;
+      GMapping::IntPoint low = smap.world2map(GMapping::Point(pose.x - range, pose.y - range));
+      GMapping::IntPoint high = smap.world2map(GMapping::Point(pose.x + range, pose.y + range));
+      min_x = std::min(min_x, std::max(low.x, 0));
+      min_y = std::min(min_y, std::max(low.y, 0));
+      max_x = std::max(max_x, std::min(high.x + 1, smap.getMapSizeX()));
+      max_y = std::max(max_y, std::min(high.y + 1, smap.getMapSizeY()));
     }
   }
+  if(min_x < max_x && min_y < max_y)
+    convertMap(smap, min_x, min_y, max_x, max_y);
   got_map_ = true;
 
-  //make sure to set the header information on the map
-  map_.map.header.stamp = ros::Time::now();
-  map_.map.header.frame_id = map_frame_;
+  map_stamp_ = ros::Time::now();
+
+  if(!publish_map_updates_ || full_update)
+  {
+    nav_msgs::OccupancyGrid map;
+    map.header.stamp = map_stamp_;
+    map.header.frame_id = map_frame_;
+    map_.getRegion(0, 0, map_.info().width, map_.info().height, map);
+    sst_.publish(map);
+    sstm_.publish(map.info);
+  }
+  else if(min_x < max_x && min_y < max_y)
+    publishMapUpdate(min_x, min_y, max_x, max_y);
+
+  std_msgs::Float64 latency;
+  latency.data = (ros::WallTime::now() - start_time).toSec();
+  map_update_latency_publisher_.publish(latency);
+  ROS_DEBUG("Map update took %.3f seconds, %s, %d scans registered, %d of %d tiles allocated", latency.data,
+            rebuild ? "full rebuild" : "incremental", (int)new_nodes.size(),
+            (int)map_.allocatedTiles(), map_.tilesX() * map_.tilesY());
+}
 
-  sst_.publish(map_.map);
-  sstm_.publish(map_.map.info);
+void
+SlamGMapping::convertMap(const GMapping::ScanMatcherMap& smap, int min_x, int min_y, int max_x, int max_y)
+{
+  // Split the region into bands of whole rows of tiles, one per thread,
+  // so that no two threads allocate the same tile.
+  int first_tile_row = min_y / TiledMap::kTileSize;
+  int tile_rows = (max_y - 1) / TiledMap::kTileSize - first_tile_row + 1;
+  int threads = std::max(1, std::min(map_conversion_threads_, tile_rows));
+  int band_rows = (tile_rows + threads - 1) / threads * TiledMap::kTileSize;
+  int first_band_max_y = std::min(first_tile_row * TiledMap::kTileSize + band_rows, max_y);
+  boost::thread_group thread_group;
+  for(int band_min_y = first_band_max_y; band_min_y < max_y; band_min_y += band_rows)
+  {
+    thread_group.create_thread(boost::bind(&convertMapRegion, boost::cref(smap), params_.occ_thresh,
+                                           min_x, band_min_y, max_x,
+                                           std::min(band_min_y + band_rows, max_y),
+                                           boost::ref(map_)));
+  }
+  convertMapRegion(smap, params_.occ_thresh, min_x, min_y, max_x, first_band_max_y, map_);
+  thread_group.join_all();
+}
+
+void
+SlamGMapping::publishMapUpdate(int min_x, int min_y, int max_x, int max_y)
+{
+  nav_msgs::OccupancyGrid update;
+  update.header.stamp = map_stamp_;
+  update.header.frame_id = map_frame_;
+  map_.getRegion(min_x, min_y, max_x, max_y, update);
+  map_update_publisher_.publish(update);
 }
 
 bool 
 SlamGMapping::mapCallback(nav_msgs::GetMap::Request  &req,
                           nav_msgs::GetMap::Response &res)
 {
-  boost::mutex::scoped_lock(map_mutex_);
-  if(got_map_ && map_.map.info.width && map_.map.info.height)
+  boost::mutex::scoped_lock lock(map_mutex_);
+  if(got_map_ && map_.info().width && map_.info().height)
   {
-    res = map_;
+    res.map.header.stamp = map_stamp_;
+    res.map.header.frame_id = map_frame_;
+    map_.getRegion(0, 0, map_.info().width, map_.info().height, res.map);
     return true;
   }
   else
     return false;
 }
 
+// Returns the cell coordinate clamped to [0, size].
+static int
+clampCell(double cell, int size)
+{
+  return (int)std::max(0.0, std::min((double)size, cell));
+}
+
+bool
+SlamGMapping::mapRegionCallback(gmapping_offline::GetMapRegion::Request  &req,
+                                gmapping_offline::GetMapRegion::Response &res)
+{
+  boost::mutex::scoped_lock lock(map_mutex_);
+  if(!got_map_)
+    return false;
+
+  // The cells that overlap the requested rectangle.
+  const nav_msgs::MapMetaData& info = map_.info();
+  int min_x = clampCell(floor((req.min_x - info.origin.position.x) / info.resolution), info.width);
+  int min_y = clampCell(floor((req.min_y - info.origin.position.y) / info.resolution), info.height);
+  int max_x = clampCell(ceil((req.max_x - info.origin.position.x) / info.resolution), info.width);
+  int max_y = clampCell(ceil((req.max_y - info.origin.position.y) / info.resolution), info.height);
+  res.map.header.stamp = map_stamp_;
+  res.map.header.frame_id = map_frame_;
+  map_.getRegion(min_x, min_y, std::max(min_x, max_x), std::max(min_y, max_y), res.map);
+  return true;
+}
+
+bool
+SlamGMapping::saveMap()
+{
+  if(map_file_directory_.empty())
+    return true;
+  if(!got_first_scan_)
+  {
+    ROS_WARN("No scan was processed, not saving a map");
+    return false;
+  }
+  updateMap();
+  if(!makeDirectories(map_file_directory_))
+  {
+    ROS_ERROR("Failed to create the directory %s", map_file_directory_.c_str());
+    return false;
+  }
+  return saveMap(map_file_directory_ + "/map");
+}
+
+bool
+SlamGMapping::saveMap(const std::string& file_name)
+{
+  boost::mutex::scoped_lock lock(map_mutex_);
+  ros::WallTime start_time = ros::WallTime::now();
+  bool ok = map_file_tiles_ ? writeMapTiles(map_, file_name) : writeMap(map_, file_name);
+  if(!ok)
+  {
+    ROS_ERROR("Failed to write the map to %s", file_name.c_str());
+    return false;
+  }
+  ROS_INFO("Wrote the map to %s in %.1f seconds", file_name.c_str(),
+           (ros::WallTime::now() - start_time).toSec());
+  return true;
+}
+
 bool
 SlamGMapping::pathCallback(hector_nav_msgs::GetRobotTrajectory::Request  &req,
                            hector_nav_msgs::GetRobotTrajectory::Response &res)
 {
-  boost::mutex::scoped_lock(map_mutex_);
-
-  nav_msgs::Path path;
-  path.header.frame_id = map_frame_;
-  path.header.stamp = ros::Time::now();
-
-  GMapping::GridSlamProcessor::Particle best =
-      gsp_->getParticles()[gsp_->getBestParticleIndex()];
-  for (GMapping::GridSlamProcessor::TNode *node = best.node; node != NULL; node = node->parent ) {
-    geometry_msgs::PoseStamped pose;
-    pose.header.frame_id = map_frame_;
-    pose.pose.position.x = node->pose.x;
-    pose.pose.position.y = node->pose.y;
-    pose.pose.position.z = 0.0;
-    pose.pose.orientation = tf::createQuaternionMsgFromRollPitchYaw(0, 0, node->pose.theta);
-    path.poses.push_back(pose);
-  }
-
-  std::reverse(path.poses.begin(), path.poses.end());
-  res.trajectory = path;
+  res.trajectory = *trajectory_.path();
   return true;
 }
 
@@ -784,6 +1067,10 @@ main(int argc, char** argv)
 {
   ros::init(argc, argv, "slam_gmapping");
 
+  ros::NodeHandle private_nh("~");
+  if(private_nh.hasParam("sweep"))
+    return runParameterSweep(private_nh);
+
   SlamGMapping gn;
 
   ros::spin();
@@ -0,0 +1,213 @@
+/*
+ * slam_gmapping
+ * Copyright (c) 2008, Willow Garage, Inc.
+ *
+ * THE WORK (AS DEFINED BELOW) IS PROVIDED UNDER THE TERMS OF THIS CREATIVE
+ * COMMONS PUBLIC LICENSE ("CCPL" OR "LICENSE"). THE WORK IS PROTECTED BY
+ * COPYRIGHT AND/OR OTHER APPLICABLE LAW. ANY USE OF THE WORK OTHER THAN AS
+ * AUTHORIZED UNDER THIS LICENSE OR COPYRIGHT LAW IS PROHIBITED.
+ *
+ * BY EXERCISING ANY RIGHTS TO THE WORK PROVIDED HERE, YOU ACCEPT AND AGREE TO
+ * BE BOUND BY THE TERMS OF THIS LICENSE. THE LICENSOR GRANTS YOU THE RIGHTS
+ * CONTAINED HERE IN CONSIDERATION OF YOUR ACCEPTANCE OF SUCH TERMS AND
+ * CONDITIONS.
+ *
+ */
+
+#include "gmapping_offline/gmapping_parameters.h"
+
+#include <time.h>
+
+#include "gmapping/utils/stat.h"
+
+namespace
+{
+
+// Calls visitor with the name and a reference to every parameter, so
+// that reading and writing all parameters is written down only once.
+template<typename Parameters, typename Visitor>
+void
+visitParameters(Parameters& params, Visitor& visitor)
+{
+  visitor("maxRange", params.maxRange);
+  visitor("maxUrange", params.maxUrange);
+  visitor("sigma", params.sigma);
+  visitor("kernelSize", params.kernelSize);
+  visitor("lstep", params.lstep);
+  visitor("astep", params.astep);
+  visitor("iterations", params.iterations);
+  visitor("lsigma", params.lsigma);
+  visitor("ogain", params.ogain);
+  visitor("lskip", params.lskip);
+  visitor("srr", params.srr);
+  visitor("srt", params.srt);
+  visitor("str", params.str);
+  visitor("stt", params.stt);
+  visitor("linearUpdate", params.linearUpdate);
+  visitor("angularUpdate", params.angularUpdate);
+  visitor("temporalUpdate", params.temporalUpdate);
+  visitor("resampleThreshold", params.resampleThreshold);
+  visitor("particles", params.particles);
+  visitor("xmin", params.xmin);
+  visitor("ymin", params.ymin);
+  visitor("xmax", params.xmax);
+  visitor("ymax", params.ymax);
+  visitor("delta", params.delta);
+  visitor("occ_thresh", params.occ_thresh);
+  visitor("llsamplerange", params.llsamplerange);
+  visitor("llsamplestep", params.llsamplestep);
+  visitor("lasamplerange", params.lasamplerange);
+  visitor("lasamplestep", params.lasamplestep);
+  visitor("seed", params.seed);
+}
+
+class NodeHandleReader
+{
+  public:
+    explicit NodeHandleReader(const ros::NodeHandle& nh) : nh_(nh) {}
+
+    // getParam leaves the value unchanged if the parameter is not set.
+    template<typename T>
+    void operator()(const char* name, T& value)
+    {
+      nh_.getParam(name, value);
+    }
+
+  private:
+    const ros::NodeHandle& nh_;
+};
+
+class StructReader
+{
+  public:
+    explicit StructReader(XmlRpc::XmlRpcValue& value) : value_(value), valid_(true), count_(0) {}
+
+    void operator()(const char* name, double& value)
+    {
+      if(!value_.hasMember(name))
+        return;
+      count_++;
+      XmlRpc::XmlRpcValue& member = value_[name];
+      if(member.getType() == XmlRpc::XmlRpcValue::TypeDouble)
+        value = (double)member;
+      else if(member.getType() == XmlRpc::XmlRpcValue::TypeInt)
+        value = (int)member;
+      else
+      {
+        ROS_ERROR("Parameter %s must be a number", name);
+        valid_ = false;
+      }
+    }
+
+    void operator()(const char* name, int& value)
+    {
+      if(!value_.hasMember(name))
+        return;
+      count_++;
+      XmlRpc::XmlRpcValue& member = value_[name];
+      if(member.getType() == XmlRpc::XmlRpcValue::TypeInt)
+        value = (int)member;
+      else
+      {
+        ROS_ERROR("Parameter %s must be an integer", name);
+        valid_ = false;
+      }
+    }
+
+    bool valid() const { return valid_; }
+    int count() const { return count_; }
+
+  private:
+    XmlRpc::XmlRpcValue& value_;
+    bool valid_;
+    int count_;
+};
+
+class YamlWriter
+{
+  public:
+    YamlWriter(FILE* file, const char* indent) : file_(file), indent_(indent) {}
+
+    void operator()(const char* name, double value)
+    {
+      fprintf(file_, "%s%s: %.9g\n", indent_, name, value);
+    }
+
+    void operator()(const char* name, int value)
+    {
+      fprintf(file_, "%s%s: %d\n", indent_, name, value);
+    }
+
+  private:
+    FILE* file_;
+    const char* indent_;
+};
+
+}  // namespace
+
+GMappingParameters::GMappingParameters()
+  : maxRange(0.0), maxUrange(0.0), sigma(0.05), kernelSize(1), lstep(0.05), astep(0.05),
+    iterations(5), lsigma(0.075), ogain(3.0), lskip(0), srr(0.1), srt(0.2), str(0.1), stt(0.2),
+    linearUpdate(1.0), angularUpdate(0.5), temporalUpdate(-1.0), resampleThreshold(0.5),
+    particles(30), xmin(-100.0), ymin(-100.0), xmax(100.0), ymax(100.0), delta(0.05),
+    occ_thresh(0.25), llsamplerange(0.01), llsamplestep(0.01), lasamplerange(0.005),
+    lasamplestep(0.005), seed(0)
+{
+}
+
+void
+GMappingParameters::load(const ros::NodeHandle& nh)
+{
+  NodeHandleReader reader(nh);
+  visitParameters(*this, reader);
+}
+
+int
+GMappingParameters::load(XmlRpc::XmlRpcValue& value)
+{
+  if(value.getType() != XmlRpc::XmlRpcValue::TypeStruct)
+    return -1;
+  StructReader reader(value);
+  visitParameters(*this, reader);
+  return reader.valid() ? reader.count() : -1;
+}
+
+void
+GMappingParameters::write(FILE* file, const char* indent) const
+{
+  YamlWriter writer(file, indent);
+  visitParameters(*this, writer);
+}
+
+void
+GMappingParameters::initProcessor(GMapping::GridSlamProcessor& gsp, double max_range, double max_urange,
+                                  const GMapping::OrientedPoint& initial_pose) const
+{
+  gsp.setMatchingParameters(max_urange, max_range, sigma,
+                            kernelSize, lstep, astep, iterations,
+                            lsigma, ogain, lskip);
+
+  gsp.setMotionModelParameters(srr, srt, str, stt);
+  gsp.setUpdateDistances(linearUpdate, angularUpdate, resampleThreshold);
+  gsp.setUpdatePeriod(temporalUpdate);
+  gsp.setgenerateMap(false);
+  gsp.GridSlamProcessor::init(particles, xmin, ymin, xmax, ymax,
+                              delta, initial_pose);
+  gsp.setllsamplerange(llsamplerange);
+  gsp.setllsamplestep(llsamplestep);
+  /// @todo Check these calls; in the gmapping gui, they use
+  /// llsamplestep and llsamplerange intead of lasamplestep and
+  /// lasamplerange.  It was probably a typo, but who knows.
+  gsp.setlasamplerange(lasamplerange);
+  gsp.setlasamplestep(lasamplestep);
+
+  seedRandomNumbers();
+}
+
+void
+GMappingParameters::seedRandomNumbers() const
+{
+  // Call the sampling function once to set the seed. A fixed seed
+  // makes runs on the same bag reproducible.
+  GMapping::sampleGaussian(1, seed > 0 ? seed : time(NULL));
+}
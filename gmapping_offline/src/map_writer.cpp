@@ -0,0 +1,148 @@
+/*
+ * slam_gmapping
+ * Copyright (c) 2008, Willow Garage, Inc.
+ *
+ * THE WORK (AS DEFINED BELOW) IS PROVIDED UNDER THE TERMS OF THIS CREATIVE
+ * COMMONS PUBLIC LICENSE ("CCPL" OR "LICENSE"). THE WORK IS PROTECTED BY
+ * COPYRIGHT AND/OR OTHER APPLICABLE LAW. ANY USE OF THE WORK OTHER THAN AS
+ * AUTHORIZED UNDER THIS LICENSE OR COPYRIGHT LAW IS PROHIBITED.
+ *
+ * BY EXERCISING ANY RIGHTS TO THE WORK PROVIDED HERE, YOU ACCEPT AND AGREE TO
+ * BE BOUND BY THE TERMS OF THIS LICENSE. THE LICENSOR GRANTS YOU THE RIGHTS
+ * CONTAINED HERE IN CONSIDERATION OF YOUR ACCEPTANCE OF SUCH TERMS AND
+ * CONDITIONS.
+ *
+ */
+
+#include "gmapping_offline/map_writer.h"
+
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <vector>
+
+// Returns the part of path after the last slash. Images are referenced
+// relative to the YAML file.
+static std::string
+baseName(const std::string& path)
+{
+  return path.substr(path.find_last_of('/') + 1);
+}
+
+// Writes the cells in [min_x, max_x) x [min_y, max_y) of map as a PGM image.
+static bool
+writeImage(const TiledMap& map, int min_x, int min_y, int max_x, int max_y,
+           const std::string& image_file)
+{
+  FILE* out = fopen(image_file.c_str(), "w");
+  if(!out)
+    return false;
+  fprintf(out, "P5\n# CREATOR: gmapping_offline %.3f m/pix\n%d %d\n255\n",
+          map.info().resolution, max_x - min_x, max_y - min_y);
+  // The image starts with the top row, the map with the bottom row.
+  std::vector<unsigned char> row(max_x - min_x);
+  for(int y = max_y - 1; y >= min_y; y--)
+  {
+    int tile_y = y / TiledMap::kTileSize;
+    for(int x = min_x; x < max_x; )
+    {
+      int tile_x = x / TiledMap::kTileSize;
+      int end_x = std::min(max_x, (tile_x + 1) * TiledMap::kTileSize);
+      const int8_t* cells = map.tile(tile_x, tile_y);
+      if(cells)
+        cells += (y - tile_y * TiledMap::kTileSize) * TiledMap::kTileSize;
+      for(; x < end_x; x++)
+      {
+        int8_t cell = cells ? cells[x - tile_x * TiledMap::kTileSize] : -1;
+        if(cell == 0)
+          row[x - min_x] = 254;
+        else if(cell == 100)
+          row[x - min_x] = 0;
+        else
+          row[x - min_x] = 205;
+      }
+    }
+    fwrite(&row[0], 1, row.size(), out);
+  }
+  bool ok = !ferror(out);
+  return fclose(out) == 0 && ok;
+}
+
+static bool
+writeYaml(const std::string& yaml_file, const std::string& image_file, double resolution,
+          double origin_x, double origin_y)
+{
+  FILE* yaml = fopen(yaml_file.c_str(), "w");
+  if(!yaml)
+    return false;
+  fprintf(yaml, "image: %s\nresolution: %f\norigin: [%f, %f, %f]\nnegate: 0\n"
+          "occupied_thresh: 0.65\nfree_thresh: 0.196\n\n",
+          baseName(image_file).c_str(), resolution, origin_x, origin_y, 0.0);
+  bool ok = !ferror(yaml);
+  return fclose(yaml) == 0 && ok;
+}
+
+bool
+writeMap(const TiledMap& map, const std::string& file_name_base)
+{
+  const nav_msgs::MapMetaData& info = map.info();
+  std::string image_file = file_name_base + ".pgm";
+  return writeImage(map, 0, 0, info.width, info.height, image_file) &&
+         writeYaml(file_name_base + ".yaml", image_file, info.resolution,
+                   info.origin.position.x, info.origin.position.y);
+}
+
+bool
+writeMapTiles(const TiledMap& map, const std::string& file_name_base)
+{
+  const nav_msgs::MapMetaData& info = map.info();
+  std::string index_file = file_name_base + "_tiles.yaml";
+  FILE* index = fopen(index_file.c_str(), "w");
+  if(!index)
+    return false;
+  fprintf(index, "resolution: %f\norigin: [%f, %f, %f]\nwidth: %d\nheight: %d\ntile_size: %d\ntiles:\n",
+          info.resolution, info.origin.position.x, info.origin.position.y, 0.0,
+          info.width, info.height, TiledMap::kTileSize);
+  bool ok = true;
+  for(int tile_y = 0; ok && tile_y < map.tilesY(); tile_y++)
+  {
+    for(int tile_x = 0; ok && tile_x < map.tilesX(); tile_x++)
+    {
+      if(!map.tile(tile_x, tile_y))
+        continue;
+      int min_x = tile_x * TiledMap::kTileSize;
+      int min_y = tile_y * TiledMap::kTileSize;
+      int max_x = std::min((int)info.width, min_x + TiledMap::kTileSize);
+      int max_y = std::min((int)info.height, min_y + TiledMap::kTileSize);
+      char suffix[32];
+      snprintf(suffix, sizeof(suffix), "_%d_%d", tile_x, tile_y);
+      std::string tile_base = file_name_base + suffix;
+      std::string image_file = tile_base + ".pgm";
+      ok = writeImage(map, min_x, min_y, max_x, max_y, image_file) &&
+           writeYaml(tile_base + ".yaml", image_file, info.resolution,
+                     info.origin.position.x + min_x * info.resolution,
+                     info.origin.position.y + min_y * info.resolution);
+      fprintf(index, "  - {x: %d, y: %d, map: %s}\n", tile_x, tile_y,
+              baseName(tile_base + ".yaml").c_str());
+    }
+  }
+  ok = !ferror(index) && ok;
+  return fclose(index) == 0 && ok;
+}
+
+bool
+makeDirectories(const std::string& directory)
+{
+  for(size_t end = directory.find('/', 1); ; end = directory.find('/', end + 1))
+  {
+    std::string path = directory.substr(0, end);
+    struct stat path_stat;
+    if(mkdir(path.c_str(), 0777) != 0 &&
+       (stat(path.c_str(), &path_stat) != 0 || !S_ISDIR(path_stat.st_mode)))
+      return false;
+    if(end == std::string::npos)
+      return true;
+  }
+}
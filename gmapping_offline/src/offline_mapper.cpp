@@ -0,0 +1,180 @@
+/*
+ * slam_gmapping
+ * Copyright (c) 2008, Willow Garage, Inc.
+ *
+ * THE WORK (AS DEFINED BELOW) IS PROVIDED UNDER THE TERMS OF THIS CREATIVE
+ * COMMONS PUBLIC LICENSE ("CCPL" OR "LICENSE"). THE WORK IS PROTECTED BY
+ * COPYRIGHT AND/OR OTHER APPLICABLE LAW. ANY USE OF THE WORK OTHER THAN AS
+ * AUTHORIZED UNDER THIS LICENSE OR COPYRIGHT LAW IS PROHIBITED.
+ *
+ * BY EXERCISING ANY RIGHTS TO THE WORK PROVIDED HERE, YOU ACCEPT AND AGREE TO
+ * BE BOUND BY THE TERMS OF THIS LICENSE. THE LICENSOR GRANTS YOU THE RIGHTS
+ * CONTAINED HERE IN CONSIDERATION OF YOUR ACCEPTANCE OF SUCH TERMS AND
+ * CONDITIONS.
+ *
+ */
+
+#include "gmapping_offline/offline_mapper.h"
+
+#include <cmath>
+#include <vector>
+
+#include "gmapping/scanmatcher/scanmatcher.h"
+
+OfflineMapper::OfflineMapper(const GMappingParameters& params, const LaserParameters& laser,
+                             int particle_threads)
+  : params_(params), laser_(laser), particle_threads_(particle_threads), gsp_(NULL),
+    filter_(NULL), initialized_(false)
+{
+  maxRange_ = params_.maxRange > 0.0 ? params_.maxRange : laser_.range_max - 0.01;
+  maxUrange_ = params_.maxUrange > 0.0 ? params_.maxUrange : maxRange_;
+
+  if(particle_threads_ <= 0)
+    gsp_ = new GMapping::GridSlamProcessor();
+
+  // The laser must be called "FLASER". The ranges of the sequence are
+  // already in the order of increasing angle.
+  gsp_laser_ = new GMapping::RangeSensor("FLASER",
+                                         laser_.beam_count,
+                                         fabs(laser_.angle_increment),
+                                         laser_.pose,
+                                         0.0,
+                                         maxRange_);
+  if(gsp_)
+  {
+    GMapping::SensorMap smap;
+    smap.insert(make_pair(gsp_laser_->getName(), gsp_laser_));
+    gsp_->setSensorMap(smap);
+  }
+}
+
+OfflineMapper::~OfflineMapper()
+{
+  delete gsp_;
+  delete filter_;
+  delete gsp_laser_;
+}
+
+bool
+OfflineMapper::processScan(const ScanSequence& sequence, size_t i)
+{
+  GMapping::OrientedPoint odom_pose = sequence.odomPose(i);
+  if(!initialized_)
+  {
+    if(gsp_)
+      params_.initProcessor(*gsp_, maxRange_, maxUrange_, odom_pose);
+    else
+      filter_ = new ParticleFilter(params_, gsp_laser_, maxRange_, maxUrange_, odom_pose,
+                                   particle_threads_);
+    initialized_ = true;
+  }
+
+  // GMapping wants an array of doubles, but deep copies it.
+  const float* ranges = sequence.ranges(i);
+  std::vector<double> ranges_double(ranges, ranges + laser_.beam_count);
+  GMapping::RangeReading reading(laser_.beam_count,
+                                 &ranges_double[0],
+                                 gsp_laser_,
+                                 sequence.stamp(i));
+  reading.setPose(odom_pose);
+  if(filter_)
+    return filter_->processScan(reading);
+  return gsp_->processScan(reading);
+}
+
+void
+OfflineMapper::buildMap(TiledMap& map) const
+{
+  GMapping::ScanMatcher matcher;
+  std::vector<double> laser_angles(laser_.beam_count);
+  double theta = laser_.angle_min;
+  for(unsigned int i=0; i<laser_.beam_count; i++)
+  {
+    if (laser_.angle_increment < 0)
+        laser_angles[laser_.beam_count-i-1]=theta;
+    else
+        laser_angles[i]=theta;
+    theta += laser_.angle_increment;
+  }
+  matcher.setLaserParameters(laser_.beam_count, &laser_angles[0],
+                             gsp_laser_->getPose());
+  matcher.setlaserMaxRange(maxRange_);
+  matcher.setusableRange(maxUrange_);
+  matcher.setgenerateMap(true);
+
+  GMapping::Point center;
+  center.x=(params_.xmin + params_.xmax) / 2.0;
+  center.y=(params_.ymin + params_.ymax) / 2.0;
+  GMapping::ScanMatcherMap smap(center, params_.xmin, params_.ymin, params_.xmax, params_.ymax,
+                                params_.delta);
+
+  if(initialized_)
+  {
+    std::vector<GMapping::GridSlamProcessor::TNode*> nodes;
+    const GMapping::GridSlamProcessor::Particle& best =
+        particles()[filter_ ? filter_->getBestParticleIndex() : gsp_->getBestParticleIndex()];
+    for(GMapping::GridSlamProcessor::TNode* node = best.node; node; node = node->parent)
+      nodes.push_back(node);
+    for(std::vector<GMapping::GridSlamProcessor::TNode*>::reverse_iterator it = nodes.rbegin();
+        it != nodes.rend();
+        ++it)
+    {
+      GMapping::GridSlamProcessor::TNode* n = *it;
+      if(!n->reading)
+        continue;
+      matcher.invalidateActiveArea();
+      matcher.computeActiveArea(smap, n->pose, &((*n->reading)[0]));
+      matcher.registerScan(smap, n->pose, &((*n->reading)[0]));
+    }
+  }
+
+  GMapping::Point wmin = smap.map2world(GMapping::IntPoint(0, 0));
+  nav_msgs::MapMetaData info;
+  info.resolution = params_.delta;
+  info.width = smap.getMapSizeX();
+  info.height = smap.getMapSizeY();
+  info.origin.position.x = wmin.x;
+  info.origin.position.y = wmin.y;
+  info.origin.orientation.w = 1.0;
+  map.reset(info);
+  convertMapRegion(smap, params_.occ_thresh, 0, 0, info.width, info.height, map);
+}
+
+double
+OfflineMapper::computePoseEntropy() const
+{
+  return computePoseEntropy(particles());
+}
+
+double
+OfflineMapper::computePoseEntropy(const GMapping::GridSlamProcessor::ParticleVector& particles)
+{
+  double weight_total=0.0;
+  for(std::vector<GMapping::GridSlamProcessor::Particle>::const_iterator it = particles.begin();
+      it != particles.end();
+      ++it)
+  {
+    weight_total += it->weight;
+  }
+  double entropy = 0.0;
+  for(std::vector<GMapping::GridSlamProcessor::Particle>::const_iterator it = particles.begin();
+      it != particles.end();
+      ++it)
+  {
+    if(it->weight/weight_total > 0.0)
+      entropy += it->weight/weight_total * log(it->weight/weight_total);
+  }
+  return -entropy;
+}
+
+const GMapping::GridSlamProcessor::ParticleVector&
+OfflineMapper::particles() const
+{
+  if(gsp_)
+    return gsp_->getParticles();
+  if(filter_)
+    return filter_->getParticles();
+  // The filter is only created at the first scan.
+  static const GMapping::GridSlamProcessor::ParticleVector no_particles;
+  return no_particles;
+}
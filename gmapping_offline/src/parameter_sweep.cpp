@@ -0,0 +1,263 @@
+/*
+ * slam_gmapping
+ * Copyright (c) 2008, Willow Garage, Inc.
+ *
+ * THE WORK (AS DEFINED BELOW) IS PROVIDED UNDER THE TERMS OF THIS CREATIVE
+ * COMMONS PUBLIC LICENSE ("CCPL" OR "LICENSE"). THE WORK IS PROTECTED BY
+ * COPYRIGHT AND/OR OTHER APPLICABLE LAW. ANY USE OF THE WORK OTHER THAN AS
+ * AUTHORIZED UNDER THIS LICENSE OR COPYRIGHT LAW IS PROHIBITED.
+ *
+ * BY EXERCISING ANY RIGHTS TO THE WORK PROVIDED HERE, YOU ACCEPT AND AGREE TO
+ * BE BOUND BY THE TERMS OF THIS LICENSE. THE LICENSOR GRANTS YOU THE RIGHTS
+ * CONTAINED HERE IN CONSIDERATION OF YOUR ACCEPTANCE OF SUCH TERMS AND
+ * CONDITIONS.
+ *
+ */
+
+#include "gmapping_offline/parameter_sweep.h"
+
+#include <errno.h>
+#include <signal.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <boost/thread.hpp>
+
+#include "gmapping_offline/gmapping_parameters.h"
+#include "gmapping_offline/map_writer.h"
+#include "gmapping_offline/offline_mapper.h"
+#include "gmapping_offline/scan_sequence.h"
+#include "gmapping_offline/tiled_map.h"
+
+namespace
+{
+
+struct Configuration
+{
+  std::string name;
+  GMappingParameters params;
+};
+
+// Runs in the forked process of one configuration. Only writes to
+// stderr, since another thread of the node may have held a lock of
+// the ROS logging when the process was forked.
+bool
+runConfiguration(const ScanSequence& sequence, Configuration configuration, int index,
+                 const std::string& directory, int particle_threads)
+{
+  // Configurations that start in the same second must not share the seed.
+  if(configuration.params.seed <= 0)
+    configuration.params.seed = time(NULL) + index;
+
+  ros::WallTime start_time = ros::WallTime::now();
+  OfflineMapper mapper(configuration.params, sequence.laser(), particle_threads);
+  int processed_scans = 0;
+  for(size_t i = 0; i < sequence.size(); i++)
+  {
+    if(mapper.processScan(sequence, i))
+      processed_scans++;
+  }
+  double processing_time = (ros::WallTime::now() - start_time).toSec();
+  TiledMap map;
+  mapper.buildMap(map);
+  double runtime = (ros::WallTime::now() - start_time).toSec();
+  double entropy = mapper.computePoseEntropy();
+
+  std::string file_name_base = directory + "/" + configuration.name;
+  if(!writeMap(map, file_name_base))
+  {
+    fprintf(stderr, "Failed to write map %s\n", file_name_base.c_str());
+    return false;
+  }
+  std::string metrics_file = file_name_base + "_metrics.yaml";
+  FILE* metrics = fopen(metrics_file.c_str(), "w");
+  if(!metrics)
+  {
+    fprintf(stderr, "Failed to write metrics %s\n", metrics_file.c_str());
+    return false;
+  }
+  fprintf(metrics, "name: %s\n", configuration.name.c_str());
+  fprintf(metrics, "scans: %d\n", (int)sequence.size());
+  fprintf(metrics, "processed_scans: %d\n", processed_scans);
+  fprintf(metrics, "entropy: %f\n", entropy);
+  fprintf(metrics, "processing_time: %f\n", processing_time);
+  fprintf(metrics, "runtime: %f\n", runtime);
+  fprintf(metrics, "map_width: %d\n", map.info().width);
+  fprintf(metrics, "map_height: %d\n", map.info().height);
+  fprintf(metrics, "parameters:\n");
+  configuration.params.write(metrics, "  ");
+  bool ok = !ferror(metrics);
+  ok = fclose(metrics) == 0 && ok;
+
+  fprintf(stderr, "Configuration %s: %d of %d scans processed, entropy %.3f, %.1f seconds\n",
+          configuration.name.c_str(), processed_scans, (int)sequence.size(), entropy, runtime);
+  return ok;
+}
+
+}  // namespace
+
+int
+runParameterSweep(const ros::NodeHandle& private_nh)
+{
+  std::string bag_file_path;
+  std::string laser_topic;
+  std::string base_frame;
+  std::string odom_frame;
+  std::string directory;
+  std::string scan_cache_path;
+  int throttle_scans;
+  int processes;
+  int particle_threads;
+  if(!private_nh.getParam("bag_file_path", bag_file_path))
+  {
+    ROS_ERROR("A parameter sweep needs ~bag_file_path");
+    return 1;
+  }
+  if(!private_nh.getParam("laser_topic", laser_topic))
+    laser_topic = "scan";
+  if(!private_nh.getParam("base_frame", base_frame))
+    base_frame = "base_link";
+  if(!private_nh.getParam("odom_frame", odom_frame))
+    odom_frame = "odom";
+  if(!private_nh.getParam("throttle_scans", throttle_scans))
+    throttle_scans = 1;
+  if(!private_nh.getParam("map_file_directory", directory))
+    directory = ".";
+  if(!private_nh.getParam("scan_cache_path", scan_cache_path))
+    scan_cache_path = "";
+  if(!private_nh.getParam("sweep_processes", processes))
+    processes = std::max(1, (int)boost::thread::hardware_concurrency());
+  if(processes < 1)
+  {
+    // Without a process slot no configuration would ever run.
+    ROS_WARN("~sweep_processes must be at least 1, using 1 instead of %d", processes);
+    processes = 1;
+  }
+  if(!private_nh.getParam("particle_threads", particle_threads))
+    particle_threads = 0;
+
+  // Every configuration overrides some of the parameters of the node.
+  GMappingParameters base_params;
+  base_params.load(private_nh);
+  XmlRpc::XmlRpcValue sweep;
+  if(!private_nh.getParam("sweep", sweep) ||
+     sweep.getType() != XmlRpc::XmlRpcValue::TypeArray || sweep.size() == 0)
+  {
+    ROS_ERROR("~sweep must be a list of configurations");
+    return 1;
+  }
+  std::vector<Configuration> configurations(sweep.size());
+  for(int i = 0; i < sweep.size(); i++)
+  {
+    Configuration& configuration = configurations[i];
+    std::ostringstream name;
+    name << "config_" << i;
+    configuration.name = name.str();
+    configuration.params = base_params;
+    int loaded = configuration.params.load(sweep[i]);
+    if(loaded < 0)
+    {
+      ROS_ERROR("Configuration %d of ~sweep is invalid", i);
+      return 1;
+    }
+    int members = sweep[i].size();
+    if(sweep[i].hasMember("name"))
+    {
+      if(sweep[i]["name"].getType() != XmlRpc::XmlRpcValue::TypeString)
+      {
+        ROS_ERROR("The name of configuration %d of ~sweep must be a string", i);
+        return 1;
+      }
+      configuration.name = (std::string)sweep[i]["name"];
+      members--;
+    }
+    if(loaded < members)
+      ROS_WARN("Configuration %s sets unknown parameters", configuration.name.c_str());
+  }
+
+  if(!makeDirectories(directory))
+  {
+    ROS_ERROR("Failed to create the directory %s", directory.c_str());
+    return 1;
+  }
+
+  ros::WallTime start_time = ros::WallTime::now();
+  ScanSequence sequence;
+  if(!loadScanSequence(bag_file_path, laser_topic, base_frame, odom_frame, throttle_scans,
+                       scan_cache_path, sequence))
+    return 1;
+  ROS_INFO("Read the scans in %.1f seconds", (ros::WallTime::now() - start_time).toSec());
+
+  // The forked processes share the decoded scans with the node until
+  // they write to them, which they never do.
+  std::map<pid_t, int> running;
+  int failed = 0;
+  int next = 0;
+  while(next < (int)configurations.size() || !running.empty())
+  {
+    if(next < (int)configurations.size() && (int)running.size() < processes && ros::ok())
+    {
+      pid_t pid = fork();
+      if(pid == 0)
+      {
+        // Let Ctrl-C terminate the configuration instead of running
+        // the shutdown handler of the node.
+        signal(SIGINT, SIG_DFL);
+        _exit(runConfiguration(sequence, configurations[next], next, directory,
+                               particle_threads) ? 0 : 1);
+      }
+      if(pid < 0)
+      {
+        ROS_ERROR("Failed to start configuration %s: %s", configurations[next].name.c_str(),
+                  strerror(errno));
+        failed++;
+      }
+      else
+      {
+        ROS_INFO("Started configuration %s", configurations[next].name.c_str());
+        running[pid] = next;
+      }
+      next++;
+      continue;
+    }
+    if(running.empty())
+      break;
+
+    int status;
+    pid_t pid = waitpid(-1, &status, 0);
+    if(pid < 0)
+    {
+      if(errno == EINTR)
+        continue;
+      ROS_ERROR("Failed to wait for the configurations: %s", strerror(errno));
+      return 1;
+    }
+    std::map<pid_t, int>::iterator it = running.find(pid);
+    if(it == running.end())
+      continue;
+    const Configuration& configuration = configurations[it->second];
+    if(WIFEXITED(status) && WEXITSTATUS(status) == 0)
+      ROS_INFO("Finished configuration %s", configuration.name.c_str());
+    else
+    {
+      ROS_ERROR("Configuration %s failed", configuration.name.c_str());
+      failed++;
+    }
+    running.erase(it);
+  }
+
+  int skipped = configurations.size() - next;
+  ROS_INFO("Ran %d configurations in %.1f seconds, %d failed, %d skipped", next,
+           (ros::WallTime::now() - start_time).toSec(), failed, skipped);
+  return failed > 0 || skipped > 0 ? 1 : 0;
+}
@@ -0,0 +1,314 @@
+/*
+ * slam_gmapping
+ * Copyright (c) 2008, Willow Garage, Inc.
+ *
+ * THE WORK (AS DEFINED BELOW) IS PROVIDED UNDER THE TERMS OF THIS CREATIVE
+ * COMMONS PUBLIC LICENSE ("CCPL" OR "LICENSE"). THE WORK IS PROTECTED BY
+ * COPYRIGHT AND/OR OTHER APPLICABLE LAW. ANY USE OF THE WORK OTHER THAN AS
+ * AUTHORIZED UNDER THIS LICENSE OR COPYRIGHT LAW IS PROHIBITED.
+ *
+ * BY EXERCISING ANY RIGHTS TO THE WORK PROVIDED HERE, YOU ACCEPT AND AGREE TO
+ * BE BOUND BY THE TERMS OF THIS LICENSE. THE LICENSOR GRANTS YOU THE RIGHTS
+ * CONTAINED HERE IN CONSIDERATION OF YOUR ACCEPTANCE OF SUCH TERMS AND
+ * CONDITIONS.
+ *
+ */
+
+#include "gmapping_offline/particle_filter.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+
+#include "gmapping/particlefilter/particlefilter.h"
+
+// GridSlamProcessor's default: a match that scores less keeps the
+// pose of the motion model.
+static const double kMinimumScore = 0.0;
+
+ParticleFilter::ParticleFilter(const GMappingParameters& params, const GMapping::RangeSensor* laser,
+                               double max_range, double max_urange,
+                               const GMapping::OrientedPoint& initial_pose, int threads)
+  : params_(params), laser_(laser), max_range_(max_range), max_urange_(max_urange),
+    threads_(std::max(1, threads)), neff_(params.particles), odom_pose_(initial_pose),
+    linear_distance_(0.0), angular_distance_(0.0), last_update_time_(0.0), count_(0)
+{
+  motion_model_.srr = params_.srr;
+  motion_model_.srt = params_.srt;
+  motion_model_.str = params_.str;
+  motion_model_.stt = params_.stt;
+
+  // Configured like GridSlamProcessor configures its matcher.
+  laser_angles_.resize(laser_->beams().size());
+  for(size_t i = 0; i < laser_angles_.size(); i++)
+    laser_angles_[i] = laser_->beams()[i].pose.theta;
+  matcher_.setLaserParameters(laser_angles_.size(), &laser_angles_[0], laser_->getPose());
+  matcher_.setMatchingParameters(max_urange, max_range, params_.sigma,
+                                 params_.kernelSize, params_.lstep, params_.astep,
+                                 params_.iterations, params_.lsigma, params_.lskip);
+  matcher_.setgenerateMap(false);
+  matcher_.setllsamplerange(params_.llsamplerange);
+  matcher_.setllsamplestep(params_.llsamplestep);
+  matcher_.setlasamplerange(params_.lasamplerange);
+  matcher_.setlasamplestep(params_.lasamplestep);
+
+  // All particles start at the root, like in GridSlamProcessor::init.
+  root_ = new GMapping::GridSlamProcessor::TNode(initial_pose, 0, 0, 0);
+  GMapping::ScanMatcherMap map(GMapping::Point((params_.xmin + params_.xmax) * .5,
+                                               (params_.ymin + params_.ymax) * .5),
+                               params_.xmax - params_.xmin, params_.ymax - params_.ymin,
+                               params_.delta);
+  for(int i = 0; i < params_.particles; i++)
+  {
+    particles_.push_back(GMapping::GridSlamProcessor::Particle(map));
+    particles_.back().pose = initial_pose;
+    particles_.back().previousPose = initial_pose;
+    particles_.back().setWeight(0);
+    particles_.back().previousIndex = 0;
+    particles_.back().node = root_;
+  }
+  params_.seedRandomNumbers();
+}
+
+ParticleFilter::~ParticleFilter()
+{
+  // Deleting the leaves deletes the branches that end in them.
+  if(count_ == 0)
+    delete root_;
+  else
+  {
+    for(size_t i = 0; i < particles_.size(); i++)
+      delete particles_[i].node;
+  }
+  for(size_t i = 0; i < readings_.size(); i++)
+    delete readings_[i];
+}
+
+bool
+ParticleFilter::processScan(const GMapping::RangeReading& reading)
+{
+  // The motion model runs for every reading, like in GridSlamProcessor.
+  GMapping::OrientedPoint pose = reading.getPose();
+  if(count_ == 0)
+    odom_pose_ = pose;
+  for(size_t i = 0; i < particles_.size(); i++)
+    particles_[i].pose = motion_model_.drawFromMotion(particles_[i].pose, pose, odom_pose_);
+
+  double dx = pose.x - odom_pose_.x;
+  double dy = pose.y - odom_pose_.y;
+  double dtheta = pose.theta - odom_pose_.theta;
+  linear_distance_ += sqrt(dx * dx + dy * dy);
+  angular_distance_ += fabs(atan2(sin(dtheta), cos(dtheta)));
+  odom_pose_ = pose;
+
+  if(count_ > 0 && linear_distance_ < params_.linearUpdate && angular_distance_ < params_.angularUpdate &&
+     (params_.temporalUpdate < 0.0 || reading.getTime() - last_update_time_ <= params_.temporalUpdate))
+    return false;
+  last_update_time_ = reading.getTime();
+
+  std::vector<double> plain_reading(reading.begin(), reading.end());
+  GMapping::RangeReading* reading_copy = new GMapping::RangeReading(reading.size(), &reading[0],
+                                                                    laser_, reading.getTime());
+  readings_.push_back(reading_copy);
+  if(count_ > 0)
+  {
+    likelihoods_.resize(particles_.size());
+    forEachParticle(&ParticleFilter::matchParticles, &plain_reading[0]);
+    // Accumulate in the order of the particles, independent of the
+    // threads that computed the likelihoods.
+    for(size_t i = 0; i < particles_.size(); i++)
+    {
+      particles_[i].weight += likelihoods_[i];
+      particles_[i].weightSum += likelihoods_[i];
+    }
+    normalize();
+    resample(&plain_reading[0], reading_copy);
+  }
+  else
+  {
+    for(size_t i = 0; i < particles_.size(); i++)
+    {
+      GMapping::GridSlamProcessor::TNode* node =
+          new GMapping::GridSlamProcessor::TNode(particles_[i].pose, 0., particles_[i].node, 0);
+      node->reading = reading_copy;
+      particles_[i].node = node;
+    }
+    registerScans(&plain_reading[0]);
+  }
+  normalize();
+
+  linear_distance_ = 0.0;
+  angular_distance_ = 0.0;
+  count_++;
+  for(size_t i = 0; i < particles_.size(); i++)
+    particles_[i].previousPose = particles_[i].pose;
+  return true;
+}
+
+int
+ParticleFilter::getBestParticleIndex() const
+{
+  int best = 0;
+  double best_weight = -std::numeric_limits<double>::max();
+  for(size_t i = 0; i < particles_.size(); i++)
+  {
+    if(best_weight < particles_[i].weightSum)
+    {
+      best_weight = particles_[i].weightSum;
+      best = i;
+    }
+  }
+  return best;
+}
+
+void
+ParticleFilter::forEachParticle(void (ParticleFilter::*step)(const double*, size_t, size_t),
+                                const double* plain_reading)
+{
+  size_t count = particles_.size();
+  size_t threads = std::max((size_t)1, std::min((size_t)threads_, count));
+  if(threads == 1)
+  {
+    (this->*step)(plain_reading, 0, count);
+    return;
+  }
+  size_t range_size = (count + threads - 1) / threads;
+  boost::thread_group thread_group;
+  for(size_t t = 0; t < threads && t * range_size < count; t++)
+  {
+    thread_group.create_thread(boost::bind(step, this, plain_reading, t * range_size,
+                                           std::min(count, (t + 1) * range_size)));
+  }
+  thread_group.join_all();
+}
+
+void
+ParticleFilter::matchParticles(const double* plain_reading, size_t begin, size_t end)
+{
+  // Only reads the matcher and the maps, which may share patches with
+  // other particles.
+  for(size_t i = begin; i < end; i++)
+  {
+    GMapping::GridSlamProcessor::Particle& particle = particles_[i];
+    GMapping::OrientedPoint corrected;
+    double score = matcher_.optimize(corrected, particle.map, particle.pose, plain_reading);
+    if(score > kMinimumScore)
+      particle.pose = corrected;
+    double s;
+    matcher_.likelihoodAndScore(s, likelihoods_[i], particle.map, particle.pose, plain_reading);
+  }
+}
+
+void
+ParticleFilter::registerParticles(const double* plain_reading, size_t begin, size_t end)
+{
+  // What ScanMatcher::registerScan does without generateMap, except
+  // for copying the active area again. Every cell that is updated
+  // lies in a patch that registerScans copied for this particle.
+  const GMapping::OrientedPoint& laser_pose = laser_->getPose();
+  for(size_t i = begin; i < end; i++)
+  {
+    GMapping::ScanMatcherMap& map = particles_[i].map;
+    const GMapping::OrientedPoint& pose = particles_[i].pose;
+    GMapping::OrientedPoint lp = pose;
+    lp.x += cos(pose.theta) * laser_pose.x - sin(pose.theta) * laser_pose.y;
+    lp.y += sin(pose.theta) * laser_pose.x + cos(pose.theta) * laser_pose.y;
+    lp.theta += laser_pose.theta;
+    for(size_t j = 0; j < laser_angles_.size(); j++)
+    {
+      double range = plain_reading[j];
+      if(range > max_range_ || range > max_urange_ || range == 0.0 || std::isnan(range))
+        continue;
+      GMapping::Point hit = lp;
+      hit.x += range * cos(lp.theta + laser_angles_[j]);
+      hit.y += range * sin(lp.theta + laser_angles_[j]);
+      map.cell(map.world2map(hit)).update(true, hit);
+    }
+  }
+}
+
+void
+ParticleFilter::registerScans(const double* plain_reading)
+{
+  // Particles share map patches after resampling, and the reference
+  // counts of the patches are not thread safe. Resizing the maps and
+  // copying the patches that the scan changes therefore happens here,
+  // once per particle, and the threads only update the cells of the
+  // copies.
+  for(size_t i = 0; i < particles_.size(); i++)
+  {
+    matcher_.invalidateActiveArea();
+    matcher_.computeActiveArea(particles_[i].map, particles_[i].pose, plain_reading);
+    particles_[i].map.storage().allocActiveArea();
+  }
+  forEachParticle(&ParticleFilter::registerParticles, plain_reading);
+}
+
+void
+ParticleFilter::normalize()
+{
+  // Like GridSlamProcessor::normalize.
+  double gain = 1. / (params_.ogain * particles_.size());
+  double lmax = -std::numeric_limits<double>::max();
+  for(size_t i = 0; i < particles_.size(); i++)
+    lmax = std::max(lmax, particles_[i].weight);
+  weights_.resize(particles_.size());
+  double wcum = 0;
+  for(size_t i = 0; i < particles_.size(); i++)
+  {
+    weights_[i] = exp(gain * (particles_[i].weight - lmax));
+    wcum += weights_[i];
+  }
+  neff_ = 0;
+  for(size_t i = 0; i < weights_.size(); i++)
+  {
+    weights_[i] /= wcum;
+    neff_ += weights_[i] * weights_[i];
+  }
+  neff_ = 1. / neff_;
+}
+
+void
+ParticleFilter::resample(const double* plain_reading, const GMapping::RangeReading* reading)
+{
+  // Like GridSlamProcessor::resample, which also builds the trajectory tree.
+  if(neff_ < params_.resampleThreshold * particles_.size())
+  {
+    uniform_resampler<double, double> resampler;
+    std::vector<unsigned int> indexes = resampler.resampleIndexes(weights_, 0);
+
+    GMapping::GridSlamProcessor::ParticleVector resampled;
+    resampled.reserve(indexes.size());
+    std::vector<bool> kept(particles_.size(), false);
+    for(size_t i = 0; i < indexes.size(); i++)
+    {
+      const GMapping::GridSlamProcessor::Particle& particle = particles_[indexes[i]];
+      resampled.push_back(particle);
+      resampled.back().node = new GMapping::GridSlamProcessor::TNode(particle.pose, 0, particle.node, 0);
+      resampled.back().node->reading = reading;
+      resampled.back().previousIndex = indexes[i];
+      resampled.back().setWeight(0);
+      kept[indexes[i]] = true;
+    }
+    for(size_t i = 0; i < particles_.size(); i++)
+    {
+      if(!kept[i])
+        delete particles_[i].node;
+    }
+    particles_.swap(resampled);
+  }
+  else
+  {
+    for(size_t i = 0; i < particles_.size(); i++)
+    {
+      GMapping::GridSlamProcessor::Particle& particle = particles_[i];
+      particle.node = new GMapping::GridSlamProcessor::TNode(particle.pose, 0.0, particle.node, 0);
+      particle.node->reading = reading;
+      particle.previousIndex = i;
+    }
+  }
+  registerScans(plain_reading);
+}
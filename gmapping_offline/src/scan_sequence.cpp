@@ -0,0 +1,401 @@
+/*
+ * slam_gmapping
+ * Copyright (c) 2008, Willow Garage, Inc.
+ *
+ * THE WORK (AS DEFINED BELOW) IS PROVIDED UNDER THE TERMS OF THIS CREATIVE
+ * COMMONS PUBLIC LICENSE ("CCPL" OR "LICENSE"). THE WORK IS PROTECTED BY
+ * COPYRIGHT AND/OR OTHER APPLICABLE LAW. ANY USE OF THE WORK OTHER THAN AS
+ * AUTHORIZED UNDER THIS LICENSE OR COPYRIGHT LAW IS PROHIBITED.
+ *
+ * BY EXERCISING ANY RIGHTS TO THE WORK PROVIDED HERE, YOU ACCEPT AND AGREE TO
+ * BE BOUND BY THE TERMS OF THIS LICENSE. THE LICENSOR GRANTS YOU THE RIGHTS
+ * CONTAINED HERE IN CONSIDERATION OF YOUR ACCEPTANCE OF SUCH TERMS AND
+ * CONDITIONS.
+ *
+ */
+
+#include "gmapping_offline/scan_sequence.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <sstream>
+
+#include "ros/ros.h"
+#include "rosbag/bag.h"
+#include "rosbag/exceptions.h"
+#include "rosbag/query.h"
+#include "rosbag/view.h"
+#include "sensor_msgs/LaserScan.h"
+#include "tf/tf.h"
+#include "tf/tfMessage.h"
+
+namespace
+{
+
+// Scans wait this long in bag time for the transforms at their time
+// stamp before they are dropped.
+const double kMaxTransformDelay = 1.0;
+
+GMapping::OrientedPoint
+toOrientedPoint(const tf::Transform& transform)
+{
+  return GMapping::OrientedPoint(transform.getOrigin().x(),
+                                 transform.getOrigin().y(),
+                                 tf::getYaw(transform.getRotation()));
+}
+
+// Appends scan to sequence if the transformer has its odometry pose.
+// The first scan sets the laser of the sequence.
+bool
+addScan(const sensor_msgs::LaserScan& scan, const tf::Transformer& transformer,
+        const std::string& base_frame, const std::string& odom_frame,
+        std::vector<float>& ranges, ScanSequence& sequence)
+{
+  tf::StampedTransform odom_pose;
+  try
+  {
+    if(sequence.size() == 0)
+    {
+      tf::StampedTransform laser_pose;
+      transformer.lookupTransform(base_frame, tf::resolve("", scan.header.frame_id),
+                                  scan.header.stamp, laser_pose);
+      LaserParameters laser;
+      laser.beam_count = scan.ranges.size();
+      laser.angle_min = scan.angle_min;
+      laser.angle_increment = scan.angle_increment;
+      laser.range_max = scan.range_max;
+      laser.pose = toOrientedPoint(laser_pose);
+      sequence.reset(laser);
+    }
+    transformer.lookupTransform(odom_frame, base_frame, scan.header.stamp, odom_pose);
+  }
+  catch(tf::TransformException& e)
+  {
+    ROS_WARN("Failed to compute odom pose, skipping scan (%s)", e.what());
+    return false;
+  }
+
+  if(scan.ranges.size() != sequence.laser().beam_count)
+    return false;
+
+  // Invert the order of the readings of upside-down lasers and filter
+  // out short readings, because the mapper won't.
+  int num_ranges = scan.ranges.size();
+  ranges.resize(num_ranges);
+  for(int i=0; i < num_ranges; i++)
+  {
+    float range = scan.angle_increment < 0 ? scan.ranges[num_ranges - i - 1] : scan.ranges[i];
+    ranges[i] = range < scan.range_min ? scan.range_max : range;
+  }
+  sequence.add(scan.header.stamp.toSec(), toOrientedPoint(odom_pose), &ranges[0]);
+  return true;
+}
+
+}  // namespace
+
+const char ScanSequence::kMagic[8] = {'G', 'M', 'S', 'C', 'A', 'N', 'S', '\0'};
+const uint32_t ScanSequence::kVersion = 1;
+
+ScanSequence::ScanSequence()
+  : record_size_(sizeof(RecordHeader)), size_(0), data_(NULL), mapping_(NULL), mapping_size_(0)
+{
+  laser_.beam_count = 0;
+  laser_.angle_min = 0.0;
+  laser_.angle_increment = 0.0;
+  laser_.range_max = 0.0;
+}
+
+ScanSequence::~ScanSequence()
+{
+  unmap();
+}
+
+double
+ScanSequence::stamp(size_t i) const
+{
+  return record(i).stamp;
+}
+
+GMapping::OrientedPoint
+ScanSequence::odomPose(size_t i) const
+{
+  const RecordHeader& header = record(i);
+  return GMapping::OrientedPoint(header.x, header.y, header.theta);
+}
+
+const float*
+ScanSequence::ranges(size_t i) const
+{
+  return reinterpret_cast<const float*>(&record(i) + 1);
+}
+
+void
+ScanSequence::reset(const LaserParameters& laser)
+{
+  unmap();
+  laser_ = laser;
+  record_size_ = recordSize(laser.beam_count);
+  size_ = 0;
+  data_ = NULL;
+  records_.clear();
+}
+
+void
+ScanSequence::add(double stamp, const GMapping::OrientedPoint& odom_pose, const float* ranges)
+{
+  ROS_ASSERT(!mapping_);
+  records_.resize((size_ + 1) * record_size_);
+  data_ = &records_[0];
+  RecordHeader* header = reinterpret_cast<RecordHeader*>(&records_[size_ * record_size_]);
+  header->stamp = stamp;
+  header->x = odom_pose.x;
+  header->y = odom_pose.y;
+  header->theta = odom_pose.theta;
+  memcpy(header + 1, ranges, laser_.beam_count * sizeof(float));
+  size_++;
+}
+
+bool
+ScanSequence::save(const std::string& path, const std::string& source) const
+{
+  FileHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, kMagic, sizeof(header.magic));
+  header.version = kVersion;
+  header.beam_count = laser_.beam_count;
+  header.size = size_;
+  header.record_size = record_size_;
+  header.source_size = (source.size() + 7) / 8 * 8;
+  header.angle_min = laser_.angle_min;
+  header.angle_increment = laser_.angle_increment;
+  header.range_max = laser_.range_max;
+  header.laser_x = laser_.pose.x;
+  header.laser_y = laser_.pose.y;
+  header.laser_theta = laser_.pose.theta;
+  std::vector<char> padded_source(header.source_size, '\0');
+  std::copy(source.begin(), source.end(), padded_source.begin());
+
+  // Write to a temporary file first, so that an interrupted run never
+  // leaves a truncated cache file behind.
+  std::string temporary_path = path + ".tmp";
+  FILE* file = fopen(temporary_path.c_str(), "wb");
+  if(!file)
+    return false;
+  fwrite(&header, sizeof(header), 1, file);
+  if(!padded_source.empty())
+    fwrite(&padded_source[0], 1, padded_source.size(), file);
+  if(size_ > 0)
+    fwrite(data_, record_size_, size_, file);
+  bool ok = !ferror(file);
+  ok = fclose(file) == 0 && ok;
+  if(!ok || rename(temporary_path.c_str(), path.c_str()) != 0)
+  {
+    unlink(temporary_path.c_str());
+    return false;
+  }
+  return true;
+}
+
+bool
+ScanSequence::load(const std::string& path, std::string& source)
+{
+  reset(LaserParameters());
+  int fd = open(path.c_str(), O_RDONLY);
+  if(fd < 0)
+    return false;
+  struct stat file_stat;
+  if(fstat(fd, &file_stat) != 0 || (size_t)file_stat.st_size < sizeof(FileHeader))
+  {
+    close(fd);
+    return false;
+  }
+  void* mapping = mmap(NULL, file_stat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if(mapping == MAP_FAILED)
+    return false;
+  mapping_ = mapping;
+  mapping_size_ = file_stat.st_size;
+
+  const FileHeader& header = *static_cast<const FileHeader*>(mapping_);
+  // Check source_size before adding it, so that a corrupt size cannot
+  // wrap the offset around.
+  if(header.source_size > mapping_size_ - sizeof(FileHeader))
+  {
+    unmap();
+    return false;
+  }
+  uint64_t data_offset = sizeof(FileHeader) + header.source_size;
+  if(memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 || header.version != kVersion ||
+     header.record_size != recordSize(header.beam_count) || header.source_size % 8 != 0 ||
+     header.size != (mapping_size_ - data_offset) / header.record_size ||
+     (mapping_size_ - data_offset) % header.record_size != 0)
+  {
+    unmap();
+    return false;
+  }
+  // The records are read once from start to end.
+  madvise(mapping_, mapping_size_, MADV_SEQUENTIAL);
+
+  laser_.beam_count = header.beam_count;
+  laser_.angle_min = header.angle_min;
+  laser_.angle_increment = header.angle_increment;
+  laser_.range_max = header.range_max;
+  laser_.pose = GMapping::OrientedPoint(header.laser_x, header.laser_y, header.laser_theta);
+  record_size_ = header.record_size;
+  size_ = header.size;
+  const char* source_begin = static_cast<const char*>(mapping_) + sizeof(FileHeader);
+  source.assign(source_begin, strnlen(source_begin, header.source_size));
+  data_ = static_cast<const char*>(mapping_) + data_offset;
+  return true;
+}
+
+const ScanSequence::RecordHeader&
+ScanSequence::record(size_t i) const
+{
+  return *reinterpret_cast<const RecordHeader*>(data_ + i * record_size_);
+}
+
+size_t
+ScanSequence::recordSize(unsigned int beam_count)
+{
+  // Keep the records aligned for the doubles in their headers.
+  size_t size = sizeof(RecordHeader) + beam_count * sizeof(float);
+  return (size + sizeof(double) - 1) / sizeof(double) * sizeof(double);
+}
+
+void
+ScanSequence::unmap()
+{
+  if(!mapping_)
+    return;
+  munmap(mapping_, mapping_size_);
+  mapping_ = NULL;
+  mapping_size_ = 0;
+  data_ = NULL;
+  size_ = 0;
+}
+
+bool
+readScanSequence(const std::string& bag_file_path, const std::string& laser_topic,
+                 const std::string& base_frame, const std::string& odom_frame,
+                 int throttle_scans, ScanSequence& sequence)
+{
+  sequence.reset(LaserParameters());
+  // Resolve the frames like the transform listener of the node does.
+  std::string resolved_base_frame = tf::resolve("", base_frame);
+  std::string resolved_odom_frame = tf::resolve("", odom_frame);
+  tf::Transformer transformer(true);
+  // Scans are kept until the transforms at their time stamp arrived,
+  // like the message filter of the node does.
+  std::deque<sensor_msgs::LaserScan::ConstPtr> pending;
+  ros::Time latest_transform;
+  std::vector<float> ranges;
+  int scan_count = 0;
+  int dropped = 0;
+  try {
+    ROS_INFO("Decoding bag: %s", bag_file_path.c_str());
+    rosbag::Bag bag(bag_file_path);
+    rosbag::View view(bag, rosbag::TopicQuery(laser_topic));
+    view.addQuery(bag, rosbag::TopicQuery("/tf"));
+    rosbag::View::iterator it = view.begin();
+    while(true)
+    {
+      bool done = it == view.end();
+      if(!done)
+      {
+        sensor_msgs::LaserScan::ConstPtr scan = it->instantiate<sensor_msgs::LaserScan>();
+        if(scan != NULL)
+        {
+          scan_count++;
+          if((scan_count % throttle_scans) == 0)
+            pending.push_back(scan);
+        }
+        else
+        {
+          tf::tfMessage::ConstPtr transforms = it->instantiate<tf::tfMessage>();
+          for(unsigned int i=0; transforms != NULL && i < transforms->transforms.size(); i++)
+          {
+            tf::StampedTransform trans;
+            tf::transformStampedMsgToTF(transforms->transforms[i], trans);
+            transformer.setTransform(trans);
+            latest_transform = std::max(latest_transform, trans.stamp_);
+          }
+        }
+        ++it;
+      }
+
+      while(!pending.empty())
+      {
+        const sensor_msgs::LaserScan& scan = *pending.front();
+        bool ready = transformer.canTransform(resolved_odom_frame, resolved_base_frame,
+                                              scan.header.stamp);
+        if(!ready && !done && (latest_transform - scan.header.stamp).toSec() < kMaxTransformDelay)
+          break;
+        if(!ready || !addScan(scan, transformer, resolved_base_frame, resolved_odom_frame,
+                              ranges, sequence))
+          dropped++;
+        pending.pop_front();
+      }
+      if(done)
+        break;
+    }
+    bag.close();
+  } catch (rosbag::BagException exception) {
+    ROS_ERROR("Error reading bag: %s", exception.what());
+    return false;
+  }
+
+  ROS_INFO("Decoded %d scans, dropped %d scans without odometry", (int)sequence.size(), dropped);
+  return sequence.size() > 0;
+}
+
+bool
+loadScanSequence(const std::string& bag_file_path, const std::string& laser_topic,
+                 const std::string& base_frame, const std::string& odom_frame,
+                 int throttle_scans, const std::string& cache_path, ScanSequence& sequence)
+{
+  if(cache_path.empty())
+    return readScanSequence(bag_file_path, laser_topic, base_frame, odom_frame,
+                            throttle_scans, sequence);
+
+  // A bag that was rewritten in place gets a new size or modification time.
+  struct stat bag_stat;
+  if(stat(bag_file_path.c_str(), &bag_stat) != 0)
+    return readScanSequence(bag_file_path, laser_topic, base_frame, odom_frame,
+                            throttle_scans, sequence);
+  std::ostringstream source;
+  source << "bag_file_path: " << bag_file_path << "\n"
+         << "bag_size: " << (long long)bag_stat.st_size << "\n"
+         << "bag_mtime: " << (long long)bag_stat.st_mtime << "\n"
+         << "laser_topic: " << laser_topic << "\n"
+         << "base_frame: " << base_frame << "\n"
+         << "odom_frame: " << odom_frame << "\n"
+         << "throttle_scans: " << throttle_scans << "\n";
+  std::string cache_source;
+  if(sequence.load(cache_path, cache_source))
+  {
+    if(cache_source == source.str())
+    {
+      ROS_INFO("Read %d scans from cache %s", (int)sequence.size(), cache_path.c_str());
+      return true;
+    }
+    ROS_WARN("Cache %s was written for other parameters, decoding the bag again",
+             cache_path.c_str());
+  }
+
+  if(!readScanSequence(bag_file_path, laser_topic, base_frame, odom_frame,
+                       throttle_scans, sequence))
+    return false;
+  if(sequence.save(cache_path, source.str()))
+    ROS_INFO("Wrote cache %s", cache_path.c_str());
+  else
+    ROS_WARN("Failed to write cache %s", cache_path.c_str());
+  return true;
+}
@@ -0,0 +1,142 @@
+/*
+ * slam_gmapping
+ * Copyright (c) 2008, Willow Garage, Inc.
+ *
+ * THE WORK (AS DEFINED BELOW) IS PROVIDED UNDER THE TERMS OF THIS CREATIVE
+ * COMMONS PUBLIC LICENSE ("CCPL" OR "LICENSE"). THE WORK IS PROTECTED BY
+ * COPYRIGHT AND/OR OTHER APPLICABLE LAW. ANY USE OF THE WORK OTHER THAN AS
+ * AUTHORIZED UNDER THIS LICENSE OR COPYRIGHT LAW IS PROHIBITED.
+ *
+ * BY EXERCISING ANY RIGHTS TO THE WORK PROVIDED HERE, YOU ACCEPT AND AGREE TO
+ * BE BOUND BY THE TERMS OF THIS LICENSE. THE LICENSOR GRANTS YOU THE RIGHTS
+ * CONTAINED HERE IN CONSIDERATION OF YOUR ACCEPTANCE OF SUCH TERMS AND
+ * CONDITIONS.
+ *
+ */
+
+#include "gmapping_offline/tiled_map.h"
+
+#include <algorithm>
+#include <cassert>
+
+const int TiledMap::kTileSize = 64;
+
+TiledMap::TiledMap()
+  : tiles_x_(0), tiles_y_(0)
+{
+}
+
+void
+TiledMap::reset(const nav_msgs::MapMetaData& info)
+{
+  info_ = info;
+  tiles_x_ = (info.width + kTileSize - 1) / kTileSize;
+  tiles_y_ = (info.height + kTileSize - 1) / kTileSize;
+  tiles_.clear();
+  tiles_.resize(tiles_x_ * tiles_y_);
+}
+
+size_t
+TiledMap::allocatedTiles() const
+{
+  size_t count = 0;
+  for(size_t i = 0; i < tiles_.size(); i++)
+  {
+    if(!tiles_[i].empty())
+      count++;
+  }
+  return count;
+}
+
+const int8_t*
+TiledMap::tile(int tile_x, int tile_y) const
+{
+  const std::vector<int8_t>& cells = tiles_[tile_y * tiles_x_ + tile_x];
+  return cells.empty() ? NULL : &cells[0];
+}
+
+int8_t*
+TiledMap::tile(int tile_x, int tile_y)
+{
+  std::vector<int8_t>& cells = tiles_[tile_y * tiles_x_ + tile_x];
+  if(cells.empty())
+    cells.resize(kTileSize * kTileSize, -1);
+  return &cells[0];
+}
+
+void
+TiledMap::getRegion(int min_x, int min_y, int max_x, int max_y, nav_msgs::OccupancyGrid& grid) const
+{
+  grid.info = info_;
+  grid.info.width = max_x - min_x;
+  grid.info.height = max_y - min_y;
+  grid.info.origin.position.x += min_x * info_.resolution;
+  grid.info.origin.position.y += min_y * info_.resolution;
+  grid.data.resize(grid.info.width * grid.info.height);
+  for(int y = min_y; y < max_y; y++)
+  {
+    int tile_y = y / kTileSize;
+    std::vector<int8_t>::iterator out = grid.data.begin() + (y - min_y) * grid.info.width;
+    for(int x = min_x; x < max_x; )
+    {
+      int tile_x = x / kTileSize;
+      int end_x = std::min(max_x, (tile_x + 1) * kTileSize);
+      const int8_t* cells = tile(tile_x, tile_y);
+      if(cells)
+      {
+        const int8_t* row = cells + (y - tile_y * kTileSize) * kTileSize;
+        std::copy(row + x - tile_x * kTileSize, row + end_x - tile_x * kTileSize, out);
+      }
+      else
+        std::fill(out, out + end_x - x, -1);
+      out += end_x - x;
+      x = end_x;
+    }
+  }
+}
+
+void
+convertMapRegion(const GMapping::ScanMatcherMap& smap, double occ_thresh,
+                 int min_x, int min_y, int max_x, int max_y, TiledMap& map)
+{
+  const TiledMap& const_map = map;
+  const int tile_size = TiledMap::kTileSize;
+  for(int tile_y = min_y / tile_size; tile_y * tile_size < max_y; tile_y++)
+  {
+    int tile_min_y = std::max(min_y, tile_y * tile_size);
+    int tile_max_y = std::min(max_y, (tile_y + 1) * tile_size);
+    for(int tile_x = min_x / tile_size; tile_x * tile_size < max_x; tile_x++)
+    {
+      int tile_min_x = std::max(min_x, tile_x * tile_size);
+      int tile_max_x = std::min(max_x, (tile_x + 1) * tile_size);
+      // Allocated at the first known cell. Cells that were skipped
+      // before are unknown in a new tile anyway.
+      int8_t* cells = const_map.tile(tile_x, tile_y) ? map.tile(tile_x, tile_y) : NULL;
+      // GMapping stores cells in patches of columns while tiles are
+      // row-major. Converting tile by tile keeps both in cache.
+      for(int x = tile_min_x; x < tile_max_x; x++)
+      {
+        for(int y = tile_min_y; y < tile_max_y; y++)
+        {
+          /// @todo Sort out the unknown vs. free vs. obstacle thresholding
+          // The const accessor does not allocate patches that were
+          // never touched, so threads only read the map.
+          double occ = smap.cell(GMapping::IntPoint(x, y));
+          assert(occ <= 1.0);
+          int8_t value = 0;
+          if(occ < 0)
+            value = -1;
+          else if(occ > occ_thresh)
+            value = 100;
+          if(!cells)
+          {
+            if(value == -1)
+              continue;
+            cells = map.tile(tile_x, tile_y);
+          }
+          cells[(y - tile_y * tile_size) * tile_size + x - tile_x * tile_size] = value;
+        }
+      }
+    }
+  }
+}
@@ -0,0 +1,148 @@
+/*
+ * slam_gmapping
+ * Copyright (c) 2008, Willow Garage, Inc.
+ *
+ * THE WORK (AS DEFINED BELOW) IS PROVIDED UNDER THE TERMS OF THIS CREATIVE
+ * COMMONS PUBLIC LICENSE ("CCPL" OR "LICENSE"). THE WORK IS PROTECTED BY
+ * COPYRIGHT AND/OR OTHER APPLICABLE LAW. ANY USE OF THE WORK OTHER THAN AS
+ * AUTHORIZED UNDER THIS LICENSE OR COPYRIGHT LAW IS PROHIBITED.
+ *
+ * BY EXERCISING ANY RIGHTS TO THE WORK PROVIDED HERE, YOU ACCEPT AND AGREE TO
+ * BE BOUND BY THE TERMS OF THIS LICENSE. THE LICENSOR GRANTS YOU THE RIGHTS
+ * CONTAINED HERE IN CONSIDERATION OF YOUR ACCEPTANCE OF SUCH TERMS AND
+ * CONDITIONS.
+ *
+ */
+
+#include "gmapping_offline/trajectory_buffer.h"
+
+#include <vector>
+
+#include "tf/transform_datatypes.h"
+
+TrajectoryBuffer::TrajectoryBuffer()
+  : snapshot_(new Snapshot)
+{
+}
+
+bool
+TrajectoryBuffer::update(const GMapping::GridSlamProcessor::TNode* best_node,
+                         const std::string& frame_id, const ros::Time& stamp)
+{
+  // Find the nodes that are not in the path yet, newest first, and the
+  // newest node that is. If the best particle changed lineage, that is
+  // where the lineages split.
+  std::vector<const GMapping::GridSlamProcessor::TNode*> new_nodes;
+  size_t kept = 0;
+  if(frame_id_ == frame_id)
+  {
+    for(const GMapping::GridSlamProcessor::TNode* node = best_node; node; node = node->parent)
+    {
+      kept = findNode(node);
+      if(kept > 0)
+        break;
+      new_nodes.push_back(node);
+    }
+  }
+  else
+  {
+    for(const GMapping::GridSlamProcessor::TNode* node = best_node; node; node = node->parent)
+      new_nodes.push_back(node);
+  }
+  if(new_nodes.empty() && kept == nodes_.size())
+    return false;
+
+  truncate(kept);
+  frame_id_ = frame_id;
+  for(std::vector<const GMapping::GridSlamProcessor::TNode*>::reverse_iterator it = new_nodes.rbegin();
+      it != new_nodes.rend();
+      ++it)
+  {
+    const GMapping::GridSlamProcessor::TNode* n = *it;
+    geometry_msgs::PoseStamped pose;
+    pose.header.frame_id = frame_id;
+    if(n->reading)
+      pose.header.stamp = ros::Time(n->reading->getTime());
+    pose.pose.position.x = n->pose.x;
+    pose.pose.position.y = n->pose.y;
+    pose.pose.position.z = 0.0;
+    pose.pose.orientation = tf::createQuaternionMsgFromYaw(n->pose.theta);
+    last_chunk_.push_back(pose);
+    if(last_chunk_.size() == kChunkSize)
+    {
+      boost::shared_ptr<Poses> chunk(new Poses);
+      chunk->swap(last_chunk_);
+      chunks_.push_back(chunk);
+    }
+    NodeKey key;
+    key.reading = n->reading;
+    key.pose = n->pose;
+    node_indexes_[n->reading] = nodes_.size();
+    nodes_.push_back(key);
+  }
+
+  // The full chunks are shared, only the last one is copied.
+  boost::shared_ptr<Snapshot> snapshot(new Snapshot);
+  snapshot->frame_id = frame_id;
+  snapshot->stamp = stamp;
+  snapshot->chunks.reserve(chunks_.size() + 1);
+  snapshot->chunks = chunks_;
+  if(!last_chunk_.empty())
+    snapshot->chunks.push_back(boost::shared_ptr<const Poses>(new Poses(last_chunk_)));
+
+  boost::mutex::scoped_lock lock(snapshot_mutex_);
+  snapshot_ = snapshot;
+  return true;
+}
+
+nav_msgs::Path::ConstPtr
+TrajectoryBuffer::path() const
+{
+  boost::shared_ptr<const Snapshot> snapshot;
+  {
+    boost::mutex::scoped_lock lock(snapshot_mutex_);
+    snapshot = snapshot_;
+  }
+  nav_msgs::Path::Ptr path(new nav_msgs::Path);
+  path->header.frame_id = snapshot->frame_id;
+  path->header.stamp = snapshot->stamp;
+  path->poses.reserve(snapshot->chunks.size() * kChunkSize);
+  for(Chunks::const_iterator it = snapshot->chunks.begin(); it != snapshot->chunks.end(); ++it)
+    path->poses.insert(path->poses.end(), (*it)->begin(), (*it)->end());
+  return path;
+}
+
+size_t
+TrajectoryBuffer::findNode(const GMapping::GridSlamProcessor::TNode* node) const
+{
+  std::map<const GMapping::RangeReading*, size_t>::const_iterator it = node_indexes_.find(node->reading);
+  if(it == node_indexes_.end())
+    return 0;
+  const NodeKey& key = nodes_[it->second];
+  if(key.pose.x != node->pose.x || key.pose.y != node->pose.y || key.pose.theta != node->pose.theta)
+    return 0;
+  return it->second + 1;
+}
+
+void
+TrajectoryBuffer::truncate(size_t size)
+{
+  for(size_t i = size; i < nodes_.size(); i++)
+  {
+    std::map<const GMapping::RangeReading*, size_t>::iterator it = node_indexes_.find(nodes_[i].reading);
+    if(it != node_indexes_.end() && it->second == i)
+      node_indexes_.erase(it);
+  }
+  nodes_.resize(size);
+
+  // The full chunks before size stay shared with the snapshots.
+  size_t full_size = chunks_.size() * kChunkSize;
+  if(size >= full_size)
+  {
+    last_chunk_.resize(size - full_size);
+    return;
+  }
+  size_t chunk = size / kChunkSize;
+  last_chunk_.assign(chunks_[chunk]->begin(), chunks_[chunk]->begin() + size % kChunkSize);
+  chunks_.resize(chunk);
+}
@@ -0,0 +1,133 @@
+/*
+ * slam_gmapping
+ * Copyright (c) 2008, Willow Garage, Inc.
+ *
+ * THE WORK (AS DEFINED BELOW) IS PROVIDED UNDER THE TERMS OF THIS CREATIVE
+ * COMMONS PUBLIC LICENSE ("CCPL" OR "LICENSE"). THE WORK IS PROTECTED BY
+ * COPYRIGHT AND/OR OTHER APPLICABLE LAW. ANY USE OF THE WORK OTHER THAN AS
+ * AUTHORIZED UNDER THIS LICENSE OR COPYRIGHT LAW IS PROHIBITED.
+ *
+ * BY EXERCISING ANY RIGHTS TO THE WORK PROVIDED HERE, YOU ACCEPT AND AGREE TO
+ * BE BOUND BY THE TERMS OF THIS LICENSE. THE LICENSOR GRANTS YOU THE RIGHTS
+ * CONTAINED HERE IN CONSIDERATION OF YOUR ACCEPTANCE OF SUCH TERMS AND
+ * CONDITIONS.
+ *
+ */
+
+#include "gmapping_offline/bounded_queue.h"
+
+#include <vector>
+
+#include <boost/bind.hpp>
+#include <boost/thread/thread.hpp>
+
+#include <gtest/gtest.h>
+
+// Pushes the numbers from 0 to count - 1 and closes the queue.
+static void
+produce(BoundedQueue<int>* queue, int count)
+{
+  for(int i = 0; i < count; i++)
+  {
+    if(!queue->push(i))
+      return;
+  }
+  queue->close();
+}
+
+// Pops elements until the queue is closed and empty.
+static void
+consume(BoundedQueue<int>* queue, std::vector<int>* elements)
+{
+  int element;
+  while(queue->pop(element))
+    elements->push_back(element);
+}
+
+TEST(BoundedQueueTest, PopsInOrder)
+{
+  BoundedQueue<int> queue(3);
+  EXPECT_TRUE(queue.push(1));
+  EXPECT_TRUE(queue.push(2));
+  EXPECT_TRUE(queue.push(3));
+  int element = 0;
+  EXPECT_TRUE(queue.pop(element));
+  EXPECT_EQ(1, element);
+  EXPECT_TRUE(queue.push(4));
+  EXPECT_TRUE(queue.pop(element));
+  EXPECT_EQ(2, element);
+  EXPECT_TRUE(queue.pop(element));
+  EXPECT_EQ(3, element);
+  EXPECT_TRUE(queue.pop(element));
+  EXPECT_EQ(4, element);
+}
+
+TEST(BoundedQueueTest, PopsRemainingElementsAfterClose)
+{
+  BoundedQueue<int> queue(3);
+  ASSERT_TRUE(queue.push(1));
+  ASSERT_TRUE(queue.push(2));
+  queue.close();
+  int element = 0;
+  EXPECT_TRUE(queue.pop(element));
+  EXPECT_EQ(1, element);
+  EXPECT_TRUE(queue.pop(element));
+  EXPECT_EQ(2, element);
+  element = 0;
+  EXPECT_FALSE(queue.pop(element));
+  EXPECT_EQ(0, element);
+  EXPECT_FALSE(queue.pop(element));
+}
+
+TEST(BoundedQueueTest, PushAfterCloseFails)
+{
+  BoundedQueue<int> queue(3);
+  queue.close();
+  EXPECT_FALSE(queue.push(1));
+  int element;
+  EXPECT_FALSE(queue.pop(element));
+}
+
+TEST(BoundedQueueTest, CloseWakesBlockedPop)
+{
+  BoundedQueue<int> queue(1);
+  std::vector<int> elements;
+  boost::thread consumer(boost::bind(&consume, &queue, &elements));
+  boost::this_thread::sleep(boost::posix_time::milliseconds(50));
+  queue.close();
+  ASSERT_TRUE(consumer.timed_join(boost::posix_time::seconds(10)));
+  EXPECT_TRUE(elements.empty());
+}
+
+TEST(BoundedQueueTest, CloseWakesBlockedPush)
+{
+  BoundedQueue<int> queue(1);
+  ASSERT_TRUE(queue.push(0));
+  boost::thread producer(boost::bind(&BoundedQueue<int>::push, &queue, 1));
+  boost::this_thread::sleep(boost::posix_time::milliseconds(50));
+  queue.close();
+  ASSERT_TRUE(producer.timed_join(boost::posix_time::seconds(10)));
+  int element;
+  EXPECT_TRUE(queue.pop(element));
+  EXPECT_EQ(0, element);
+  // The blocked element was not added.
+  EXPECT_FALSE(queue.pop(element));
+}
+
+TEST(BoundedQueueTest, PassesAllElementsBetweenThreads)
+{
+  BoundedQueue<int> queue(4);
+  std::vector<int> elements;
+  boost::thread consumer(boost::bind(&consume, &queue, &elements));
+  produce(&queue, 10000);
+  ASSERT_TRUE(consumer.timed_join(boost::posix_time::seconds(10)));
+  ASSERT_EQ(10000u, elements.size());
+  for(int i = 0; i < 10000; i++)
+    ASSERT_EQ(i, elements[i]);
+}
+
+int main(int argc, char *argv[])
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,102 @@
+/*
+ * slam_gmapping
+ * Copyright (c) 2008, Willow Garage, Inc.
+ *
+ * THE WORK (AS DEFINED BELOW) IS PROVIDED UNDER THE TERMS OF THIS CREATIVE
+ * COMMONS PUBLIC LICENSE ("CCPL" OR "LICENSE"). THE WORK IS PROTECTED BY
+ * COPYRIGHT AND/OR OTHER APPLICABLE LAW. ANY USE OF THE WORK OTHER THAN AS
+ * AUTHORIZED UNDER THIS LICENSE OR COPYRIGHT LAW IS PROHIBITED.
+ *
+ * BY EXERCISING ANY RIGHTS TO THE WORK PROVIDED HERE, YOU ACCEPT AND AGREE TO
+ * BE BOUND BY THE TERMS OF THIS LICENSE. THE LICENSOR GRANTS YOU THE RIGHTS
+ * CONTAINED HERE IN CONSIDERATION OF YOUR ACCEPTANCE OF SUCH TERMS AND
+ * CONDITIONS.
+ *
+ */
+
+#include "gmapping_offline/map_writer.h"
+
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <string>
+
+#include <gtest/gtest.h>
+
+class MakeDirectoriesTest : public testing::Test
+{
+  protected:
+    virtual void SetUp()
+    {
+      char directory[] = "/tmp/map_writer_test.XXXXXX";
+      ASSERT_TRUE(mkdtemp(directory) != NULL);
+      directory_ = directory;
+    }
+
+    virtual void TearDown()
+    {
+      std::string command = "rm -rf " + directory_;
+      ASSERT_EQ(0, system(command.c_str()));
+    }
+
+    static bool isDirectory(const std::string& path)
+    {
+      struct stat path_stat;
+      return stat(path.c_str(), &path_stat) == 0 && S_ISDIR(path_stat.st_mode);
+    }
+
+    std::string directory_;
+};
+
+TEST_F(MakeDirectoriesTest, CreatesParents)
+{
+  EXPECT_TRUE(makeDirectories(directory_ + "/a/b/c"));
+  EXPECT_TRUE(isDirectory(directory_ + "/a"));
+  EXPECT_TRUE(isDirectory(directory_ + "/a/b"));
+  EXPECT_TRUE(isDirectory(directory_ + "/a/b/c"));
+}
+
+TEST_F(MakeDirectoriesTest, ExistingDirectory)
+{
+  EXPECT_TRUE(makeDirectories(directory_));
+  ASSERT_TRUE(makeDirectories(directory_ + "/a/b"));
+  EXPECT_TRUE(makeDirectories(directory_ + "/a/b"));
+  EXPECT_TRUE(makeDirectories(directory_ + "/a"));
+}
+
+TEST_F(MakeDirectoriesTest, TrailingSlash)
+{
+  EXPECT_TRUE(makeDirectories(directory_ + "/a/b/"));
+  EXPECT_TRUE(isDirectory(directory_ + "/a/b"));
+  EXPECT_TRUE(makeDirectories(directory_ + "/a/b/"));
+}
+
+TEST_F(MakeDirectoriesTest, RelativePath)
+{
+  char* cwd = getcwd(NULL, 0);
+  ASSERT_TRUE(cwd != NULL);
+  ASSERT_EQ(0, chdir(directory_.c_str()));
+  bool made = makeDirectories("a/b");
+  ASSERT_EQ(0, chdir(cwd));
+  free(cwd);
+  EXPECT_TRUE(made);
+  EXPECT_TRUE(isDirectory(directory_ + "/a/b"));
+}
+
+TEST_F(MakeDirectoriesTest, FileInPathFails)
+{
+  std::string file_path = directory_ + "/file";
+  FILE* file = fopen(file_path.c_str(), "w");
+  ASSERT_TRUE(file != NULL);
+  fclose(file);
+  EXPECT_FALSE(makeDirectories(file_path));
+  EXPECT_FALSE(makeDirectories(file_path + "/a"));
+}
+
+int main(int argc, char *argv[])
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
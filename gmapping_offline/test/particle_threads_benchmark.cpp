@@ -0,0 +1,99 @@
+/*
+ * slam_gmapping
+ * Copyright (c) 2008, Willow Garage, Inc.
+ *
+ * THE WORK (AS DEFINED BELOW) IS PROVIDED UNDER THE TERMS OF THIS CREATIVE
+ * COMMONS PUBLIC LICENSE ("CCPL" OR "LICENSE"). THE WORK IS PROTECTED BY
+ * COPYRIGHT AND/OR OTHER APPLICABLE LAW. ANY USE OF THE WORK OTHER THAN AS
+ * AUTHORIZED UNDER THIS LICENSE OR COPYRIGHT LAW IS PROHIBITED.
+ *
+ * BY EXERCISING ANY RIGHTS TO THE WORK PROVIDED HERE, YOU ACCEPT AND AGREE TO
+ * BE BOUND BY THE TERMS OF THIS LICENSE. THE LICENSOR GRANTS YOU THE RIGHTS
+ * CONTAINED HERE IN CONSIDERATION OF YOUR ACCEPTANCE OF SUCH TERMS AND
+ * CONDITIONS.
+ *
+ */
+
+// Reports the wall time of mapping a bag with the particle filter on
+// 1, 2, 4 and 8 threads, next to GMapping's own particle filter. All
+// runs use the same seed, and the maps of the threaded runs must be
+// identical.
+//
+// Usage: particle_threads_benchmark BAG LASER_TOPIC BASE_FRAME ODOM_FRAME [PARTICLES]
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+#include "ros/ros.h"
+
+#include "gmapping_offline/gmapping_parameters.h"
+#include "gmapping_offline/offline_mapper.h"
+#include "gmapping_offline/scan_sequence.h"
+#include "gmapping_offline/tiled_map.h"
+
+static const int kSeed = 1;
+
+// Runs GMapping with the default parameters and returns the wall time
+// the particle filter took. Building the map is not timed.
+static double
+RunMapper(const ScanSequence& sequence, int particles, int particle_threads,
+          nav_msgs::OccupancyGrid& grid)
+{
+  GMappingParameters params;
+  params.seed = kSeed;
+  if(particles > 0)
+    params.particles = particles;
+  ros::WallTime start_time = ros::WallTime::now();
+  OfflineMapper mapper(params, sequence.laser(), particle_threads);
+  for(size_t i = 0; i < sequence.size(); i++)
+    mapper.processScan(sequence, i);
+  double time = (ros::WallTime::now() - start_time).toSec();
+  TiledMap map;
+  mapper.buildMap(map);
+  map.getRegion(0, 0, map.info().width, map.info().height, grid);
+  return time;
+}
+
+int
+main(int argc, char** argv)
+{
+  if(argc < 5)
+  {
+    fprintf(stderr, "Usage: %s BAG LASER_TOPIC BASE_FRAME ODOM_FRAME [PARTICLES]\n", argv[0]);
+    return 1;
+  }
+  int particles = argc > 5 ? atoi(argv[5]) : 0;
+  ros::Time::init();
+
+  ScanSequence sequence;
+  if(!readScanSequence(argv[1], argv[2], argv[3], argv[4], 1, sequence))
+    return 1;
+  printf("%d scans with %d beams\n", (int)sequence.size(), sequence.laser().beam_count);
+
+  nav_msgs::OccupancyGrid gsp_grid;
+  double gsp_time = RunMapper(sequence, particles, 0, gsp_grid);
+  printf("GridSlamProcessor: %8.2f s\n", gsp_time);
+
+  nav_msgs::OccupancyGrid first_grid;
+  double first_time = 0.0;
+  bool identical = true;
+  for(int threads = 1; threads <= 8; threads *= 2)
+  {
+    nav_msgs::OccupancyGrid grid;
+    double time = RunMapper(sequence, particles, threads, grid);
+    if(threads == 1)
+    {
+      first_grid = grid;
+      first_time = time;
+    }
+    bool same = grid.info.width == first_grid.info.width && grid.data == first_grid.data;
+    identical = identical && same;
+    printf("%d thread%s: %8.2f s (speedup %.2fx)%s\n", threads, threads == 1 ? " " : "s",
+           time, first_time / time, same ? "" : ", map DIFFERS");
+  }
+  bool same_as_gsp = gsp_grid.info.width == first_grid.info.width && gsp_grid.data == first_grid.data;
+  printf("threaded maps %s, %s GridSlamProcessor's\n", identical ? "identical" : "DIFFER",
+         same_as_gsp ? "identical to" : "differ from");
+  return identical ? 0 : 1;
+}
@@ -0,0 +1,108 @@
+/*
+ * slam_gmapping
+ * Copyright (c) 2008, Willow Garage, Inc.
+ *
+ * THE WORK (AS DEFINED BELOW) IS PROVIDED UNDER THE TERMS OF THIS CREATIVE
+ * COMMONS PUBLIC LICENSE ("CCPL" OR "LICENSE"). THE WORK IS PROTECTED BY
+ * COPYRIGHT AND/OR OTHER APPLICABLE LAW. ANY USE OF THE WORK OTHER THAN AS
+ * AUTHORIZED UNDER THIS LICENSE OR COPYRIGHT LAW IS PROHIBITED.
+ *
+ * BY EXERCISING ANY RIGHTS TO THE WORK PROVIDED HERE, YOU ACCEPT AND AGREE TO
+ * BE BOUND BY THE TERMS OF THIS LICENSE. THE LICENSOR GRANTS YOU THE RIGHTS
+ * CONTAINED HERE IN CONSIDERATION OF YOUR ACCEPTANCE OF SUCH TERMS AND
+ * CONDITIONS.
+ *
+ */
+
+// Compares the end-to-end runtime of mapping a bag, i.e. decoding the
+// scans and looking up their odometry plus running GMapping, with
+// mapping the same scans from a scan cache file. Both runs use the
+// same seed, so the maps also show that the cache is lossless.
+//
+// Usage: scan_cache_benchmark BAG LASER_TOPIC BASE_FRAME ODOM_FRAME [CACHE]
+
+#include <cstdio>
+#include <string>
+
+#include "ros/ros.h"
+
+#include "gmapping_offline/gmapping_parameters.h"
+#include "gmapping_offline/offline_mapper.h"
+#include "gmapping_offline/scan_sequence.h"
+#include "gmapping_offline/tiled_map.h"
+
+static const int kSeed = 1;
+
+// Runs GMapping with the default parameters and returns the wall time it took.
+static double
+RunMapper(const ScanSequence& sequence, TiledMap& map)
+{
+  GMappingParameters params;
+  params.seed = kSeed;
+  ros::WallTime start_time = ros::WallTime::now();
+  OfflineMapper mapper(params, sequence.laser());
+  for(size_t i = 0; i < sequence.size(); i++)
+    mapper.processScan(sequence, i);
+  mapper.buildMap(map);
+  return (ros::WallTime::now() - start_time).toSec();
+}
+
+int
+main(int argc, char** argv)
+{
+  if(argc < 5)
+  {
+    fprintf(stderr, "Usage: %s BAG LASER_TOPIC BASE_FRAME ODOM_FRAME [CACHE]\n", argv[0]);
+    return 1;
+  }
+  std::string bag_file_path = argv[1];
+  std::string cache_path = argc > 5 ? argv[5] : "/tmp/scan_cache_benchmark.scans";
+  ros::Time::init();
+
+  ScanSequence bag_sequence;
+  ros::WallTime start_time = ros::WallTime::now();
+  if(!readScanSequence(bag_file_path, argv[2], argv[3], argv[4], 1, bag_sequence))
+    return 1;
+  double decode_time = (ros::WallTime::now() - start_time).toSec();
+
+  start_time = ros::WallTime::now();
+  if(!bag_sequence.save(cache_path, bag_file_path))
+  {
+    fprintf(stderr, "Failed to write %s\n", cache_path.c_str());
+    return 1;
+  }
+  double save_time = (ros::WallTime::now() - start_time).toSec();
+
+  // The cache was just written, so it is read from the page cache.
+  // Mapping the file is lazy and its pages are read during mapping, so
+  // only the end-to-end times compare fairly.
+  ScanSequence cache_sequence;
+  std::string source;
+  start_time = ros::WallTime::now();
+  if(!cache_sequence.load(cache_path, source))
+  {
+    fprintf(stderr, "Failed to read %s\n", cache_path.c_str());
+    return 1;
+  }
+  double load_time = (ros::WallTime::now() - start_time).toSec();
+
+  TiledMap bag_map;
+  double bag_mapping_time = RunMapper(bag_sequence, bag_map);
+  TiledMap cache_map;
+  double cache_mapping_time = RunMapper(cache_sequence, cache_map);
+  nav_msgs::OccupancyGrid bag_grid;
+  bag_map.getRegion(0, 0, bag_map.info().width, bag_map.info().height, bag_grid);
+  nav_msgs::OccupancyGrid cache_grid;
+  cache_map.getRegion(0, 0, cache_map.info().width, cache_map.info().height, cache_grid);
+
+  printf("%d scans with %d beams\n", (int)bag_sequence.size(), bag_sequence.laser().beam_count);
+  printf("bag:   decode %8.2f s, mapping %8.2f s, end to end %8.2f s\n",
+         decode_time, bag_mapping_time, decode_time + bag_mapping_time);
+  printf("cache: load   %8.4f s, mapping %8.2f s, end to end %8.2f s (speedup %.1fx)\n",
+         load_time, cache_mapping_time, load_time + cache_mapping_time,
+         (decode_time + bag_mapping_time) / (load_time + cache_mapping_time));
+  printf("writing the cache took %.2f s\n", save_time);
+  bool identical = bag_grid.info.width == cache_grid.info.width && bag_grid.data == cache_grid.data;
+  printf("maps %s\n", identical ? "identical" : "DIFFER");
+  return identical ? 0 : 1;
+}
@@ -0,0 +1,228 @@
+/*
+ * slam_gmapping
+ * Copyright (c) 2008, Willow Garage, Inc.
+ *
+ * THE WORK (AS DEFINED BELOW) IS PROVIDED UNDER THE TERMS OF THIS CREATIVE
+ * COMMONS PUBLIC LICENSE ("CCPL" OR "LICENSE"). THE WORK IS PROTECTED BY
+ * COPYRIGHT AND/OR OTHER APPLICABLE LAW. ANY USE OF THE WORK OTHER THAN AS
+ * AUTHORIZED UNDER THIS LICENSE OR COPYRIGHT LAW IS PROHIBITED.
+ *
+ * BY EXERCISING ANY RIGHTS TO THE WORK PROVIDED HERE, YOU ACCEPT AND AGREE TO
+ * BE BOUND BY THE TERMS OF THIS LICENSE. THE LICENSOR GRANTS YOU THE RIGHTS
+ * CONTAINED HERE IN CONSIDERATION OF YOUR ACCEPTANCE OF SUCH TERMS AND
+ * CONDITIONS.
+ *
+ */
+
+#include "gmapping_offline/scan_sequence.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <string>
+
+#include <gtest/gtest.h>
+
+// Writes a sequence of two scans with three beams to a cache file in
+// a new temporary directory.
+class ScanSequenceTest : public testing::Test
+{
+  protected:
+    virtual void SetUp()
+    {
+      char directory[] = "/tmp/scan_sequence_test.XXXXXX";
+      ASSERT_TRUE(mkdtemp(directory) != NULL);
+      directory_ = directory;
+      path_ = directory_ + "/scans";
+
+      LaserParameters laser;
+      laser.beam_count = 3;
+      laser.angle_min = -0.5;
+      laser.angle_increment = 0.5;
+      laser.range_max = 30.0;
+      laser.pose = GMapping::OrientedPoint(0.1, 0.0, 0.0);
+      sequence_.reset(laser);
+      const float ranges0[] = {1.0f, 2.0f, 3.0f};
+      const float ranges1[] = {4.0f, 5.0f, 30.0f};
+      sequence_.add(10.0, GMapping::OrientedPoint(0.0, 0.0, 0.0), ranges0);
+      sequence_.add(10.5, GMapping::OrientedPoint(1.0, 2.0, 0.5), ranges1);
+      ASSERT_TRUE(sequence_.save(path_, "bag 1234"));
+    }
+
+    virtual void TearDown()
+    {
+      unlink(path_.c_str());
+      rmdir(directory_.c_str());
+    }
+
+    // Overwrites the 64 bit field at offset in the cache file.
+    void corrupt(long offset, uint64_t value)
+    {
+      FILE* file = fopen(path_.c_str(), "r+b");
+      ASSERT_TRUE(file != NULL);
+      ASSERT_EQ(0, fseek(file, offset, SEEK_SET));
+      ASSERT_EQ(1u, fwrite(&value, sizeof(value), 1, file));
+      fclose(file);
+    }
+
+    long fileSize()
+    {
+      FILE* file = fopen(path_.c_str(), "rb");
+      fseek(file, 0, SEEK_END);
+      long size = ftell(file);
+      fclose(file);
+      return size;
+    }
+
+    std::string directory_;
+    std::string path_;
+    ScanSequence sequence_;
+};
+
+// The offsets of the fields of the file header.
+static const long kMagicOffset = 0;
+static const long kVersionOffset = 8;
+static const long kSizeOffset = 16;
+static const long kRecordSizeOffset = 24;
+static const long kSourceSizeOffset = 32;
+
+TEST_F(ScanSequenceTest, SaveAndLoad)
+{
+  ScanSequence loaded;
+  std::string source;
+  ASSERT_TRUE(loaded.load(path_, source));
+  EXPECT_EQ("bag 1234", source);
+  EXPECT_EQ(3u, loaded.laser().beam_count);
+  EXPECT_EQ(-0.5, loaded.laser().angle_min);
+  EXPECT_EQ(0.5, loaded.laser().angle_increment);
+  EXPECT_EQ(30.0, loaded.laser().range_max);
+  EXPECT_EQ(0.1, loaded.laser().pose.x);
+  ASSERT_EQ(2u, loaded.size());
+  for(size_t i = 0; i < loaded.size(); i++)
+  {
+    EXPECT_EQ(sequence_.stamp(i), loaded.stamp(i));
+    EXPECT_EQ(sequence_.odomPose(i).x, loaded.odomPose(i).x);
+    EXPECT_EQ(sequence_.odomPose(i).y, loaded.odomPose(i).y);
+    EXPECT_EQ(sequence_.odomPose(i).theta, loaded.odomPose(i).theta);
+    for(unsigned int j = 0; j < loaded.laser().beam_count; j++)
+      EXPECT_EQ(sequence_.ranges(i)[j], loaded.ranges(i)[j]);
+  }
+}
+
+TEST_F(ScanSequenceTest, SaveAndLoadEmpty)
+{
+  sequence_.reset(sequence_.laser());
+  ASSERT_TRUE(sequence_.save(path_, ""));
+  ScanSequence loaded;
+  std::string source = "previous";
+  ASSERT_TRUE(loaded.load(path_, source));
+  EXPECT_EQ("", source);
+  EXPECT_EQ(0u, loaded.size());
+}
+
+TEST_F(ScanSequenceTest, SaveReplacesFile)
+{
+  sequence_.reset(sequence_.laser());
+  ASSERT_TRUE(sequence_.save(path_, "other bag"));
+  ScanSequence loaded;
+  std::string source;
+  ASSERT_TRUE(loaded.load(path_, source));
+  EXPECT_EQ("other bag", source);
+  EXPECT_EQ(0u, loaded.size());
+  EXPECT_NE(0, access((path_ + ".tmp").c_str(), F_OK));
+}
+
+TEST_F(ScanSequenceTest, SaveToMissingDirectoryFails)
+{
+  EXPECT_FALSE(sequence_.save(directory_ + "/missing/scans", ""));
+}
+
+TEST_F(ScanSequenceTest, LoadMissingFileFails)
+{
+  ScanSequence loaded;
+  std::string source;
+  EXPECT_FALSE(loaded.load(directory_ + "/missing", source));
+}
+
+TEST_F(ScanSequenceTest, LoadRejectsBadMagic)
+{
+  corrupt(kMagicOffset, 0);
+  ScanSequence loaded;
+  std::string source;
+  EXPECT_FALSE(loaded.load(path_, source));
+}
+
+TEST_F(ScanSequenceTest, LoadRejectsOtherVersion)
+{
+  // Also overwrites beam_count, which follows the version.
+  corrupt(kVersionOffset, 2);
+  ScanSequence loaded;
+  std::string source;
+  EXPECT_FALSE(loaded.load(path_, source));
+}
+
+TEST_F(ScanSequenceTest, LoadRejectsFileShorterThanHeader)
+{
+  ASSERT_EQ(0, truncate(path_.c_str(), 20));
+  ScanSequence loaded;
+  std::string source;
+  EXPECT_FALSE(loaded.load(path_, source));
+}
+
+TEST_F(ScanSequenceTest, LoadRejectsTruncatedRecords)
+{
+  ASSERT_EQ(0, truncate(path_.c_str(), fileSize() - 4));
+  ScanSequence loaded;
+  std::string source;
+  EXPECT_FALSE(loaded.load(path_, source));
+}
+
+TEST_F(ScanSequenceTest, LoadRejectsWrongSize)
+{
+  corrupt(kSizeOffset, 3);
+  ScanSequence loaded;
+  std::string source;
+  EXPECT_FALSE(loaded.load(path_, source));
+}
+
+TEST_F(ScanSequenceTest, LoadRejectsWrongRecordSize)
+{
+  corrupt(kRecordSizeOffset, 8);
+  ScanSequence loaded;
+  std::string source;
+  EXPECT_FALSE(loaded.load(path_, source));
+}
+
+TEST_F(ScanSequenceTest, LoadRejectsSourceSizeBeyondFile)
+{
+  // Would wrap around when subtracted from the file size.
+  corrupt(kSourceSizeOffset, (uint64_t)0 - 40);
+  ScanSequence loaded;
+  std::string source;
+  EXPECT_FALSE(loaded.load(path_, source));
+}
+
+TEST_F(ScanSequenceTest, LoadRejectsUnpaddedSourceSize)
+{
+  corrupt(kSourceSizeOffset, 4);
+  ScanSequence loaded;
+  std::string source;
+  EXPECT_FALSE(loaded.load(path_, source));
+}
+
+TEST_F(ScanSequenceTest, FailedLoadKeepsNoScans)
+{
+  corrupt(kMagicOffset, 0);
+  ScanSequence loaded;
+  std::string source;
+  ASSERT_FALSE(loaded.load(path_, source));
+  EXPECT_EQ(0u, loaded.size());
+}
+
+int main(int argc, char *argv[])
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
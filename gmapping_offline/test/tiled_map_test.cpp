@@ -0,0 +1,248 @@
+/*
+ * slam_gmapping
+ * Copyright (c) 2008, Willow Garage, Inc.
+ *
+ * THE WORK (AS DEFINED BELOW) IS PROVIDED UNDER THE TERMS OF THIS CREATIVE
+ * COMMONS PUBLIC LICENSE ("CCPL" OR "LICENSE"). THE WORK IS PROTECTED BY
+ * COPYRIGHT AND/OR OTHER APPLICABLE LAW. ANY USE OF THE WORK OTHER THAN AS
+ * AUTHORIZED UNDER THIS LICENSE OR COPYRIGHT LAW IS PROHIBITED.
+ *
+ * BY EXERCISING ANY RIGHTS TO THE WORK PROVIDED HERE, YOU ACCEPT AND AGREE TO
+ * BE BOUND BY THE TERMS OF THIS LICENSE. THE LICENSOR GRANTS YOU THE RIGHTS
+ * CONTAINED HERE IN CONSIDERATION OF YOUR ACCEPTANCE OF SUCH TERMS AND
+ * CONDITIONS.
+ *
+ */
+
+#include "gmapping_offline/tiled_map.h"
+
+#include <gtest/gtest.h>
+
+using GMapping::IntPoint;
+using GMapping::Point;
+using GMapping::ScanMatcherMap;
+
+// 8.0 x 4.8 m at 5 cm, i.e. 160 x 96 cells or 3 x 2 tiles, the last
+// column of tiles only half full.
+static const double kResolution = 0.05;
+static const double kWidth = 8.0;
+static const double kHeight = 4.8;
+static const double kOccupiedThreshold = 0.25;
+
+static nav_msgs::MapMetaData
+mapInfo(unsigned int width, unsigned int height)
+{
+  nav_msgs::MapMetaData info;
+  info.resolution = kResolution;
+  info.width = width;
+  info.height = height;
+  info.origin.position.x = -1.0;
+  info.origin.position.y = -2.0;
+  info.origin.position.z = 0.0;
+  info.origin.orientation.x = 0.0;
+  info.origin.orientation.y = 0.0;
+  info.origin.orientation.z = 0.0;
+  info.origin.orientation.w = 1.0;
+  return info;
+}
+
+static int8_t
+cellAt(const TiledMap& map, int x, int y)
+{
+  const int8_t* cells = map.tile(x / TiledMap::kTileSize, y / TiledMap::kTileSize);
+  if(!cells)
+    return -1;
+  return cells[(y % TiledMap::kTileSize) * TiledMap::kTileSize + x % TiledMap::kTileSize];
+}
+
+static void
+setCell(TiledMap& map, int x, int y, int8_t value)
+{
+  int8_t* cells = map.tile(x / TiledMap::kTileSize, y / TiledMap::kTileSize);
+  cells[(y % TiledMap::kTileSize) * TiledMap::kTileSize + x % TiledMap::kTileSize] = value;
+}
+
+TEST(TiledMapTest, ResetRoundsTilesUp)
+{
+  TiledMap map;
+  map.reset(mapInfo(160, 96));
+  EXPECT_EQ(3, map.tilesX());
+  EXPECT_EQ(2, map.tilesY());
+  EXPECT_EQ(0u, map.allocatedTiles());
+  const TiledMap& const_map = map;
+  EXPECT_TRUE(const_map.tile(2, 1) == NULL);
+}
+
+TEST(TiledMapTest, TileAllocatesUnknownCells)
+{
+  TiledMap map;
+  map.reset(mapInfo(160, 96));
+  int8_t* cells = map.tile(1, 0);
+  ASSERT_TRUE(cells != NULL);
+  EXPECT_EQ(1u, map.allocatedTiles());
+  for(int i = 0; i < TiledMap::kTileSize * TiledMap::kTileSize; i++)
+    ASSERT_EQ(-1, cells[i]);
+  const TiledMap& const_map = map;
+  EXPECT_EQ(cells, const_map.tile(1, 0));
+  EXPECT_TRUE(const_map.tile(0, 0) == NULL);
+
+  map.reset(mapInfo(160, 96));
+  EXPECT_EQ(0u, map.allocatedTiles());
+}
+
+TEST(TiledMapTest, GetRegionAcrossTileEdges)
+{
+  TiledMap map;
+  map.reset(mapInfo(160, 96));
+  // The four cells around the corner of the first four tiles.
+  setCell(map, 63, 63, 100);
+  setCell(map, 64, 63, 0);
+  setCell(map, 63, 64, 0);
+  setCell(map, 64, 64, 100);
+  // The last cell of the map.
+  setCell(map, 159, 95, 100);
+
+  nav_msgs::OccupancyGrid grid;
+  grid.header.frame_id = "map";
+  map.getRegion(62, 62, 66, 65, grid);
+  EXPECT_EQ("map", grid.header.frame_id);
+  EXPECT_EQ(4u, grid.info.width);
+  EXPECT_EQ(3u, grid.info.height);
+  EXPECT_FLOAT_EQ(kResolution, grid.info.resolution);
+  EXPECT_NEAR(-1.0 + 62 * kResolution, grid.info.origin.position.x, 1e-6);
+  EXPECT_NEAR(-2.0 + 62 * kResolution, grid.info.origin.position.y, 1e-6);
+  ASSERT_EQ(12u, grid.data.size());
+  const int8_t expected[] = {-1, -1, -1, -1,
+                             -1, 100, 0, -1,
+                             -1, 0, 100, -1};
+  for(size_t i = 0; i < grid.data.size(); i++)
+    EXPECT_EQ(expected[i], grid.data[i]) << "cell " << i;
+
+  map.getRegion(0, 0, 160, 96, grid);
+  ASSERT_EQ(160u * 96u, grid.data.size());
+  EXPECT_EQ(100, grid.data[95 * 160 + 159]);
+  EXPECT_EQ(0, grid.data[63 * 160 + 64]);
+  EXPECT_EQ(-1, grid.data[0]);
+}
+
+TEST(TiledMapTest, GetRegionOfUnallocatedTiles)
+{
+  TiledMap map;
+  map.reset(mapInfo(160, 96));
+  setCell(map, 0, 0, 0);
+
+  nav_msgs::OccupancyGrid grid;
+  // Ends in the half full last column of tiles, none of them allocated.
+  map.getRegion(60, 10, 160, 96, grid);
+  ASSERT_EQ(100u * 86u, grid.data.size());
+  for(size_t i = 0; i < grid.data.size(); i++)
+    ASSERT_EQ(-1, grid.data[i]) << "cell " << i;
+  EXPECT_EQ(1u, map.allocatedTiles());
+}
+
+TEST(TiledMapTest, GetEmptyRegion)
+{
+  TiledMap map;
+  map.reset(mapInfo(160, 96));
+  nav_msgs::OccupancyGrid grid;
+  grid.data.resize(10);
+  map.getRegion(64, 64, 64, 64, grid);
+  EXPECT_EQ(0u, grid.info.width);
+  EXPECT_EQ(0u, grid.info.height);
+  EXPECT_TRUE(grid.data.empty());
+}
+
+class ConvertMapRegionTest : public testing::Test
+{
+  protected:
+    ConvertMapRegionTest()
+      : smap_(Point(kWidth / 2, kHeight / 2), 0.0, 0.0, kWidth, kHeight, kResolution)
+    {
+      map_.reset(mapInfo(smap_.getMapSizeX(), smap_.getMapSizeY()));
+    }
+
+    void observe(int x, int y, bool occupied)
+    {
+      smap_.cell(IntPoint(x, y)).update(occupied, Point(x * kResolution, y * kResolution));
+    }
+
+    ScanMatcherMap smap_;
+    TiledMap map_;
+};
+
+TEST_F(ConvertMapRegionTest, ConvertsAcrossTileEdges)
+{
+  ASSERT_EQ(160, smap_.getMapSizeX());
+  ASSERT_EQ(96, smap_.getMapSizeY());
+  observe(63, 0, true);
+  observe(64, 0, false);
+  observe(127, 63, true);
+  observe(128, 64, false);
+  // Hit once in four observations, i.e. not above the threshold.
+  observe(0, 95, true);
+  observe(0, 95, false);
+  observe(0, 95, false);
+  observe(0, 95, false);
+
+  convertMapRegion(smap_, kOccupiedThreshold, 0, 0, smap_.getMapSizeX(), smap_.getMapSizeY(), map_);
+  EXPECT_EQ(100, cellAt(map_, 63, 0));
+  EXPECT_EQ(0, cellAt(map_, 64, 0));
+  EXPECT_EQ(100, cellAt(map_, 127, 63));
+  EXPECT_EQ(0, cellAt(map_, 128, 64));
+  EXPECT_EQ(0, cellAt(map_, 0, 95));
+  EXPECT_EQ(-1, cellAt(map_, 62, 0));
+  EXPECT_EQ(-1, cellAt(map_, 128, 63));
+  // Tiles (0, 0), (1, 0), (2, 1) and (0, 1), but not (1, 1) and (2, 0).
+  EXPECT_EQ(4u, map_.allocatedTiles());
+  const TiledMap& map = map_;
+  EXPECT_TRUE(map.tile(1, 1) == NULL);
+  EXPECT_TRUE(map.tile(2, 0) == NULL);
+}
+
+TEST_F(ConvertMapRegionTest, UnknownMapAllocatesNoTiles)
+{
+  convertMapRegion(smap_, kOccupiedThreshold, 0, 0, smap_.getMapSizeX(), smap_.getMapSizeY(), map_);
+  EXPECT_EQ(0u, map_.allocatedTiles());
+}
+
+TEST_F(ConvertMapRegionTest, ConvertsOnlyRegion)
+{
+  observe(10, 10, true);
+  observe(70, 10, true);
+  observe(100, 80, true);
+
+  // Starts and ends inside tiles.
+  convertMapRegion(smap_, kOccupiedThreshold, 60, 5, 110, 70, map_);
+  EXPECT_EQ(-1, cellAt(map_, 10, 10));
+  EXPECT_EQ(100, cellAt(map_, 70, 10));
+  EXPECT_EQ(-1, cellAt(map_, 100, 80));
+  EXPECT_EQ(1u, map_.allocatedTiles());
+
+  // Converting another region keeps the cells converted before.
+  convertMapRegion(smap_, kOccupiedThreshold, 64, 64, 160, 96, map_);
+  EXPECT_EQ(100, cellAt(map_, 70, 10));
+  EXPECT_EQ(100, cellAt(map_, 100, 80));
+  EXPECT_EQ(2u, map_.allocatedTiles());
+}
+
+TEST_F(ConvertMapRegionTest, OverwritesCellsInAllocatedTiles)
+{
+  observe(5, 5, true);
+  convertMapRegion(smap_, kOccupiedThreshold, 0, 0, 64, 64, map_);
+  ASSERT_EQ(100, cellAt(map_, 5, 5));
+  setCell(map_, 6, 6, 100);
+
+  observe(5, 5, false);
+  observe(5, 5, false);
+  observe(5, 5, false);
+  convertMapRegion(smap_, kOccupiedThreshold, 0, 0, 64, 64, map_);
+  EXPECT_EQ(0, cellAt(map_, 5, 5));
+  // Unknown in smap, so it becomes unknown again.
+  EXPECT_EQ(-1, cellAt(map_, 6, 6));
+}
+
+int main(int argc, char *argv[])
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,232 @@
+/*
+ * slam_gmapping
+ * Copyright (c) 2008, Willow Garage, Inc.
+ *
+ * THE WORK (AS DEFINED BELOW) IS PROVIDED UNDER THE TERMS OF THIS CREATIVE
+ * COMMONS PUBLIC LICENSE ("CCPL" OR "LICENSE"). THE WORK IS PROTECTED BY
+ * COPYRIGHT AND/OR OTHER APPLICABLE LAW. ANY USE OF THE WORK OTHER THAN AS
+ * AUTHORIZED UNDER THIS LICENSE OR COPYRIGHT LAW IS PROHIBITED.
+ *
+ * BY EXERCISING ANY RIGHTS TO THE WORK PROVIDED HERE, YOU ACCEPT AND AGREE TO
+ * BE BOUND BY THE TERMS OF THIS LICENSE. THE LICENSOR GRANTS YOU THE RIGHTS
+ * CONTAINED HERE IN CONSIDERATION OF YOUR ACCEPTANCE OF SUCH TERMS AND
+ * CONDITIONS.
+ *
+ */
+
+#include "gmapping_offline/trajectory_buffer.h"
+
+#include <vector>
+
+#include <gtest/gtest.h>
+
+using GMapping::OrientedPoint;
+using GMapping::RangeReading;
+
+typedef GMapping::GridSlamProcessor::TNode TNode;
+
+// Builds trajectory trees like GMapping does: the root has no reading,
+// and the nodes of all particles for the same scan share its reading.
+class TrajectoryBufferTest : public testing::Test
+{
+  protected:
+    virtual ~TrajectoryBufferTest()
+    {
+      // Deleting a leaf deletes the ancestors it was the last child of.
+      std::vector<TNode*> leaves;
+      for(size_t i = 0; i < nodes_.size(); i++)
+      {
+        if(nodes_[i]->childs == 0)
+          leaves.push_back(nodes_[i]);
+      }
+      for(size_t i = 0; i < leaves.size(); i++)
+        delete leaves[i];
+      for(size_t i = 0; i < readings_.size(); i++)
+        delete readings_[i];
+    }
+
+    // The reading of scan i, which is taken at time i.
+    const RangeReading* reading(size_t i)
+    {
+      while(readings_.size() <= i)
+        readings_.push_back(new RangeReading(0, NULL, NULL, readings_.size()));
+      return readings_[i];
+    }
+
+    TNode* root()
+    {
+      TNode* node = new TNode(OrientedPoint(0.0, 0.0, 0.0), 0.0);
+      nodes_.push_back(node);
+      return node;
+    }
+
+    // Adds the nodes for scans first_scan to last_scan below parent,
+    // at x = scan and y.
+    TNode* addNodes(TNode* parent, size_t first_scan, size_t last_scan, double y)
+    {
+      for(size_t i = first_scan; i <= last_scan; i++)
+      {
+        TNode* node = new TNode(OrientedPoint(i, y, 0.0), 0.0, parent);
+        node->reading = reading(i);
+        nodes_.push_back(node);
+        parent = node;
+      }
+      return parent;
+    }
+
+    static TNode* ancestor(TNode* node, size_t generations)
+    {
+      for(size_t i = 0; i < generations; i++)
+        node = node->parent;
+      return node;
+    }
+
+    // Checks that path has the poses of scans 0 to size - 1, at y for
+    // scans from branch_scan on and at 0 before.
+    static void expectPath(const nav_msgs::Path& path, size_t size, size_t branch_scan, double y)
+    {
+      ASSERT_EQ(size, path.poses.size());
+      for(size_t i = 0; i < size; i++)
+      {
+        ASSERT_EQ(double(i), path.poses[i].pose.position.x) << "pose " << i;
+        ASSERT_EQ(i < branch_scan ? 0.0 : y, path.poses[i].pose.position.y) << "pose " << i;
+        ASSERT_EQ(path.header.frame_id, path.poses[i].header.frame_id) << "pose " << i;
+      }
+    }
+
+    TrajectoryBuffer buffer_;
+    std::vector<TNode*> nodes_;
+    std::vector<RangeReading*> readings_;
+};
+
+TEST_F(TrajectoryBufferTest, EmptyPath)
+{
+  nav_msgs::Path::ConstPtr path = buffer_.path();
+  EXPECT_TRUE(path->poses.empty());
+}
+
+TEST_F(TrajectoryBufferTest, AppendsNewNodes)
+{
+  TNode* node = root();
+  ASSERT_TRUE(buffer_.update(node, "map", ros::Time(1.0)));
+  // Crosses several chunk boundaries one node at a time.
+  for(size_t i = 1; i <= 600; i++)
+  {
+    nav_msgs::Path::ConstPtr before = buffer_.path();
+    node = addNodes(node, i, i, 0.0);
+    ASSERT_TRUE(buffer_.update(node, "map", ros::Time(i)));
+    nav_msgs::Path::ConstPtr path = buffer_.path();
+    ASSERT_EQ(i + 1, path->poses.size());
+    ASSERT_EQ(double(i), path->poses.back().pose.position.x);
+    ASSERT_EQ(double(i), path->poses.back().header.stamp.toSec());
+    // Snapshots taken before do not change.
+    ASSERT_EQ(i, before->poses.size());
+  }
+  nav_msgs::Path::ConstPtr path = buffer_.path();
+  EXPECT_EQ("map", path->header.frame_id);
+  EXPECT_EQ(600.0, path->header.stamp.toSec());
+  expectPath(*path, 601, 601, 0.0);
+}
+
+TEST_F(TrajectoryBufferTest, AppendsSeveralNodes)
+{
+  TNode* node = addNodes(root(), 1, 300, 0.0);
+  ASSERT_TRUE(buffer_.update(ancestor(node, 200), "map", ros::Time()));
+  ASSERT_TRUE(buffer_.update(node, "map", ros::Time()));
+  expectPath(*buffer_.path(), 301, 301, 0.0);
+}
+
+TEST_F(TrajectoryBufferTest, UnchangedPath)
+{
+  TNode* node = addNodes(root(), 1, 10, 0.0);
+  ASSERT_TRUE(buffer_.update(node, "map", ros::Time(1.0)));
+  EXPECT_FALSE(buffer_.update(node, "map", ros::Time(2.0)));
+  EXPECT_EQ(1.0, buffer_.path()->header.stamp.toSec());
+}
+
+TEST_F(TrajectoryBufferTest, KeepsSharedPrefixOnLineageSwitch)
+{
+  // Branches right before, at and right after a chunk boundary.
+  const size_t branch_scans[] = {255, 256, 257, 258, 513};
+  for(size_t i = 0; i < sizeof(branch_scans) / sizeof(branch_scans[0]); i++)
+  {
+    SCOPED_TRACE(branch_scans[i]);
+    size_t branch_scan = branch_scans[i];
+    TrajectoryBuffer buffer;
+    TNode* node = addNodes(root(), 1, 600, 0.0);
+    ASSERT_TRUE(buffer.update(node, "map", ros::Time()));
+    nav_msgs::Path::ConstPtr before = buffer.path();
+
+    // The other particle took a different pose from branch_scan on.
+    TNode* branch = addNodes(ancestor(node, 600 - (branch_scan - 1)), branch_scan, 610, 1.0);
+    ASSERT_TRUE(buffer.update(branch, "map", ros::Time()));
+    expectPath(*buffer.path(), 611, branch_scan, 1.0);
+    expectPath(*before, 601, 601, 0.0);
+
+    // And back.
+    ASSERT_TRUE(buffer.update(node, "map", ros::Time()));
+    expectPath(*buffer.path(), 601, 601, 0.0);
+  }
+}
+
+TEST_F(TrajectoryBufferTest, SwitchesToShorterLineage)
+{
+  TNode* node = addNodes(root(), 1, 600, 0.0);
+  ASSERT_TRUE(buffer_.update(node, "map", ros::Time()));
+  TNode* branch = addNodes(ancestor(node, 600 - 99), 100, 100, 1.0);
+  ASSERT_TRUE(buffer_.update(branch, "map", ros::Time()));
+  expectPath(*buffer_.path(), 101, 100, 1.0);
+  // Appending to the new lineage still works.
+  branch = addNodes(branch, 101, 400, 1.0);
+  ASSERT_TRUE(buffer_.update(branch, "map", ros::Time()));
+  expectPath(*buffer_.path(), 401, 100, 1.0);
+}
+
+TEST_F(TrajectoryBufferTest, SwitchesToAncestor)
+{
+  TNode* node = addNodes(root(), 1, 300, 0.0);
+  ASSERT_TRUE(buffer_.update(node, "map", ros::Time()));
+  ASSERT_TRUE(buffer_.update(ancestor(node, 44), "map", ros::Time()));
+  expectPath(*buffer_.path(), 257, 257, 0.0);
+}
+
+TEST_F(TrajectoryBufferTest, SwitchesLineageAtRoot)
+{
+  TNode* start = root();
+  TNode* node = addNodes(start, 1, 300, 0.0);
+  ASSERT_TRUE(buffer_.update(node, "map", ros::Time()));
+  TNode* branch = addNodes(start, 1, 300, 1.0);
+  ASSERT_TRUE(buffer_.update(branch, "map", ros::Time()));
+  expectPath(*buffer_.path(), 301, 1, 1.0);
+}
+
+TEST_F(TrajectoryBufferTest, SwitchesToOtherTree)
+{
+  TNode* node = addNodes(root(), 1, 300, 0.0);
+  ASSERT_TRUE(buffer_.update(node, "map", ros::Time()));
+  // After a reset of GMapping, the new root has a different pose.
+  TNode* other_root = new TNode(OrientedPoint(0.0, 1.0, 0.0), 0.0);
+  nodes_.push_back(other_root);
+  TNode* other = addNodes(other_root, 1, 20, 1.0);
+  ASSERT_TRUE(buffer_.update(other, "map", ros::Time()));
+  expectPath(*buffer_.path(), 21, 0, 1.0);
+}
+
+TEST_F(TrajectoryBufferTest, FrameChangeRebuildsPath)
+{
+  TNode* node = addNodes(root(), 1, 300, 0.0);
+  ASSERT_TRUE(buffer_.update(node, "map", ros::Time()));
+  nav_msgs::Path::ConstPtr before = buffer_.path();
+  ASSERT_TRUE(buffer_.update(node, "other_map", ros::Time()));
+  nav_msgs::Path::ConstPtr path = buffer_.path();
+  EXPECT_EQ("other_map", path->header.frame_id);
+  expectPath(*path, 301, 301, 0.0);
+  EXPECT_EQ("map", before->header.frame_id);
+  expectPath(*before, 301, 301, 0.0);
+}
+
+int main(int argc, char *argv[])
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -17,13 +17,20 @@
 #define PARSEC_PERCEPTION_CIRCULAR_ROBOT_SELF_FILTER_H
 
 #include <string>
+#include <vector>
 
+#include <boost/shared_ptr.hpp>
+#include <message_filters/subscriber.h>
+#include <message_filters/time_synchronizer.h>
 #include <nodelet/nodelet.h>
+#include <pcl/PointIndices.h>
 #include <pcl/point_types.h>
 #include <pcl_ros/point_cloud.h>
 #include <ros/ros.h>
 #include <tf/transform_listener.h>
 
+#include "parsec_perception/point_kernels.h"
+
 namespace parsec_perception {
 
 class CircularRobotSelfFilter : public nodelet::Nodelet {
@@ -49,12 +56,37 @@ class CircularRobotSelfFilter : public nodelet::Nodelet {
    * Maximal z value. All points above are not filtered.
    */
   double maximal_z_value_;
+  /**
+   * If set, subscribes to input and indices and only filters the
+   * points referenced by indices, e.g. the outputs of a FloorFilter
+   * running with publish_indices. Default: false
+   */
+  bool use_indices_;
   ros::Subscriber input_cloud_subscriber_;
+  boost::shared_ptr<message_filters::Subscriber<pcl::PointCloud<pcl::PointXYZ> > >
+      input_cloud_filter_subscriber_;
+  boost::shared_ptr<message_filters::Subscriber<pcl::PointIndices> >
+      input_indices_filter_subscriber_;
+  boost::shared_ptr<message_filters::TimeSynchronizer<
+    pcl::PointCloud<pcl::PointXYZ>, pcl::PointIndices> > input_synchronizer_;
   ros::Publisher output_cloud_publisher_;
   tf::TransformListener tf_listener_;
+  point_kernels::PointBuffer point_buffer_;
+  point_kernels::Mask point_mask_;
 
   virtual void onInit();
   void CloudCallback(const pcl::PointCloud<pcl::PointXYZ>::ConstPtr &cloud);
+  void IndexedCloudCallback(
+      const pcl::PointCloud<pcl::PointXYZ>::ConstPtr &cloud,
+      const pcl::PointIndices::ConstPtr &indices);
+
+  /**
+   * Filters the points of cloud referenced by input_indices and
+   * publishes the result. If input_indices is NULL, all points are
+   * considered.
+   */
+  void FilterCloud(const pcl::PointCloud<pcl::PointXYZ>::ConstPtr &cloud,
+                   const std::vector<int> *input_indices);
 };
 
 }  // namespace parsec_perception
@@ -16,8 +16,16 @@
 #ifndef PARSEC_PERCEPTION_FLOOR_FILTER_H
 #define PARSEC_PERCEPTION_FLOOR_FILTER_H
 
+#include <deque>
+#include <map>
 #include <vector>
 
+#include <boost/scoped_ptr.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+#include <diagnostic_updater/diagnostic_updater.h>
 #include <nodelet/nodelet.h>
 #include <ros/ros.h>
 #include <pcl/point_types.h>
@@ -25,25 +33,47 @@
 #include <sensor_msgs/LaserScan.h>
 #include <tf/transform_listener.h>
 
-#include <pcl/ModelCoefficients.h>
+#include <pcl/PointIndices.h>
+
+#include "parsec_perception/floor_line_estimator.h"
+#include "parsec_perception/point_kernels.h"
+#include "parsec_perception/sensor_pose_cache.h"
 
 namespace parsec_perception {
 
 class FloorFilter {
  public:
   FloorFilter(const ros::NodeHandle &node_handle);
+  ~FloorFilter();
 
   /**
-   * Generates the indices of all points that are not in indices.
+   * Partitions cloud into floor points, i.e. floor_line_inliers,
+   * all other points and the non-floor points that generate cliff
+   * points. All points are labeled in a mask that is reused between
+   * clouds and the three index lists are extracted from it in a
+   * single pass. The outputs are sorted.
    *
    * Public for testing.
    *
-   * @param cloud_size the number of points in the point cloud
-   * @param indices the indices that should not be in the result
-   * @param difference cloud indices not in indices
+   * @param floor_line the Eigen representation of the floor line
+   * @param cloud the input cloud
+   * @param floor_line_inliers indices of the floor line inliers
+   * @param floor_indices the floor partition
+   * @param non_floor_indices all points not in floor_indices
+   * @param cliff_indices points in non_floor_indices that generate
+   *     cliff points
+   * @param cliff_cloud the generated cliff points
+   *
+   * @return false if no cliffs could be generated because the
+   *     viewpoint is unknown
    */
-  void GetIndicesDifference(size_t cloud_size, const std::vector<int> &indices,
-                            std::vector<int> *difference);
+  bool PartitionCloud(const Eigen::ParametrizedLine<float, 3> &floor_line,
+                      const pcl::PointCloud<pcl::PointXYZ> &cloud,
+                      const std::vector<int> &floor_line_inliers,
+                      std::vector<int> *floor_indices,
+                      std::vector<int> *non_floor_indices,
+                      std::vector<int> *cliff_indices,
+                      pcl::PointCloud<pcl::PointXYZ> *cliff_cloud);
  
   /**
    * Get the indices of points that are possibly the floor. Uses a
@@ -146,6 +176,55 @@ private:
   static const double kDefaultMaxFloorXRotation = 0.087;  // 5 degrees
   static const double kDefaultLineDistanceThreshold = 0.03;
   static const double kDefaultCliffDistanceThreshold = 0.02;
+  // Accounts for rounding errors when pre-filtering cliff candidates.
+  static const double kCliffPrefilterMargin = 0.001;
+  static const double kDefaultTrackingMaxInlierRatioDrop;
+  static const double kDefaultTrackingMaxPlaneMotion;
+  static const int kDefaultPipelineQueueSize;
+
+  /**
+   * The stages of cloud processing. In pipelined mode, clouds are
+   * transformed and floor candidates are filtered concurrently by a
+   * pool of workers. Floor segmentation depends on the floor line of
+   * the previous cloud and publishing needs to keep the order, so
+   * both run in one thread each.
+   */
+  enum Stage {
+    kTransformStage = 0,
+    kSegmentationStage,
+    kPublishStage,
+    kNumberOfStages
+  };
+
+  /**
+   * A cloud and the intermediate results of all stages.
+   */
+  struct CloudJob {
+    // Assigned in input order when the transform stage starts.
+    unsigned long sequence_number;
+    bool transformed;
+    pcl::PointCloud<pcl::PointXYZ>::ConstPtr input_cloud;
+    pcl::PointCloud<pcl::PointXYZ>::Ptr transformed_cloud;
+    std::vector<int> floor_candidate_indices;
+    pcl::PointIndices::Ptr floor_indices;
+    pcl::PointIndices::Ptr non_floor_indices;
+    pcl::PointIndices::Ptr cliff_indices;
+    pcl::PointCloud<pcl::PointXYZ>::Ptr cliff_cloud;
+  };
+  typedef boost::shared_ptr<CloudJob> CloudJobPtr;
+
+  /**
+   * Processing time and queue depth of one stage since the last
+   * diagnostics update.
+   */
+  struct StageStatistics {
+    StageStatistics()
+        : processed(0), total_latency(0.0), max_latency(0.0), max_queue_depth(0) {}
+    int processed;
+    double total_latency;
+    double max_latency;
+    size_t max_queue_depth;
+  };
   static const std::string kDefaultReferenceFrame;
 
   ros::NodeHandle node_handle_;
@@ -154,7 +233,23 @@ private:
   ros::Publisher filtered_cloud_publisher_;
   ros::Publisher cliff_cloud_publisher_;
   ros::Publisher cliff_generating_cloud_publisher_;
+  ros::Publisher reference_cloud_publisher_;
+  ros::Publisher floor_indices_publisher_;
+  ros::Publisher filtered_indices_publisher_;
+  ros::Publisher cliff_generating_indices_publisher_;
   tf::TransformListener tf_listener_;
+  boost::scoped_ptr<SensorPoseCache> sensor_pose_cache_;
+  boost::scoped_ptr<FloorLineEstimator> floor_line_estimator_;
+  diagnostic_updater::Updater diagnostic_updater_;
+
+  /**
+   * Scratch space for the point kernels, reused between clouds to
+   * avoid allocations.
+   */
+  point_kernels::PointBuffer point_buffer_;
+  point_kernels::Mask point_mask_;
+  point_kernels::Mask partition_labels_;
+  std::vector<int> floor_line_inliers_;
 
   /**
    * The maximal distance from the x-y-planes points can have to be
@@ -180,8 +275,8 @@ private:
   double max_floor_x_rotation_;
   
   /**
-   * Distance threshold for points to be considered as inliers. This
-   * parameter is directly used by PCL's ransac.
+   * Distance threshold for points to be considered as inliers of the
+   * floor line.
    */
   double line_distance_threshold_;
 
@@ -202,8 +297,149 @@ private:
    */
   std::string reference_frame_;
 
+  /**
+   * If set, the transformed input cloud is published once on
+   * reference_cloud and the floor, filtered and cliff generating
+   * outputs are additionally published as pcl::PointIndices into
+   * that cloud. In a nodelet manager, downstream nodelets can then
+   * work on the shared cloud without any point copies. The point
+   * cloud outputs are only assembled if somebody subscribed to
+   * them.
+   */
+  bool publish_indices_;
+
+  /**
+   * If set, the floor line of the previous cloud is verified against
+   * the new floor candidates first and RANSAC only runs if it
+   * doesn't fit anymore.
+   */
+  bool track_floor_line_;
+
+  /**
+   * The tracked line is dropped if its inlier ratio is smaller than
+   * the inlier ratio of the last RANSAC line minus this value.
+   */
+  double tracking_max_inlier_ratio_drop_;
+
+  /**
+   * The tracked line is dropped if the intersection of sensor plane
+   * and floor moved further than this distance in m since the last
+   * RANSAC line, e.g. because the laser tilted.
+   */
+  double tracking_max_plane_motion_;
+
+  /**
+   * The tracker state: the last floor line, the intersection of
+   * sensor plane and floor and the inlier ratio when RANSAC found the
+   * line.
+   */
+  bool tracked_line_valid_;
+  Eigen::ParametrizedLine<float, 3> tracked_line_;
+  Eigen::ParametrizedLine<float, 3> tracked_sensor_floor_intersection_line_;
+  double tracked_inlier_ratio_;
+
+  /**
+   * Statistics of how many floor lines were served by the tracker.
+   * Protected by pipeline_mutex_.
+   */
+  int floor_lines_;
+  int tracked_floor_lines_;
+
+  /**
+   * The number of transform workers. If 0, clouds are processed in
+   * the subscriber callback.
+   */
+  int pipeline_threads_;
+
+  /**
+   * The maximal number of clouds waiting for a transform worker. If
+   * the queue is full, the oldest cloud is dropped.
+   */
+  int pipeline_queue_size_;
+
+  /**
+   * Protects the pipeline queues and statistics.
+   */
+  boost::mutex pipeline_mutex_;
+  boost::condition_variable transform_condition_;
+  boost::condition_variable segmentation_condition_;
+  boost::condition_variable publish_condition_;
+  bool pipeline_shutdown_;
+  boost::thread_group pipeline_thread_group_;
+  std::deque<pcl::PointCloud<pcl::PointXYZ>::ConstPtr> transform_queue_;
+  unsigned long next_sequence_number_;
+  // Transformed clouds can finish out of order. The segmentation
+  // stage takes them in order of their sequence numbers.
+  std::map<unsigned long, CloudJobPtr> segmentation_queue_;
+  unsigned long next_segmentation_sequence_number_;
+  std::deque<CloudJobPtr> publish_queue_;
+  StageStatistics stage_statistics_[kNumberOfStages];
+  int dropped_clouds_;
+
   void CloudCallback(const pcl::PointCloud<pcl::PointXYZ>::ConstPtr &cloud);
 
+  /**
+   * The first stage. Transforms the input cloud of job into the
+   * reference frame and filters floor candidates. points and mask
+   * are scratch space, so this can run in several threads.
+   *
+   * @return false if the cloud could not be transformed or is empty
+   */
+  bool TransformCloud(CloudJob *job, point_kernels::PointBuffer *points,
+                      point_kernels::Mask *mask);
+
+  /**
+   * The second stage. Finds the floor line and partitions the cloud.
+   */
+  void SegmentFloor(CloudJob *job);
+
+  /**
+   * The third stage. Publishes all results of job.
+   */
+  void PublishResults(const CloudJob &job);
+
+  void TransformWorker();
+  void SegmentationWorker();
+  void PublishWorker();
+
+  void RecordStageLatency(Stage stage, const ros::WallDuration &latency);
+
+  void UpdateDiagnostics(diagnostic_updater::DiagnosticStatusWrapper &status);
+
+  /**
+   * Like the public version but takes the viewpoint directly instead
+   * of looking it up for every point.
+   */
+  bool IntersectWithSightline(
+      const pcl::PointXYZ &viewpoint, const Eigen::ParametrizedLine<float, 3> &line,
+      const pcl::PointXYZ &point, pcl::PointXYZ *intersection_point);
+
+  /**
+   * Like the public version but with explicit scratch space.
+   */
+  static void FilterFloorCandidates(
+      double floor_z_distance, double max_slope, const pcl::PointCloud<pcl::PointXYZ> &cloud,
+      point_kernels::PointBuffer *points, point_kernels::Mask *mask,
+      std::vector<int> *indices);
+
+  /**
+   * Checks if point is below the floor and generates its cliff
+   * point, i.e. the intersection of its sight line with floor_line.
+   */
+  bool IsCliffPoint(const pcl::PointXYZ &viewpoint,
+                    const Eigen::ParametrizedLine<float, 3> &floor_line,
+                    const pcl::PointXYZ &point, pcl::PointXYZ *cliff_point);
+
+  /**
+   * Labels all non-floor points in labels that generate a cliff
+   * point as cliff points and adds their cliff points to
+   * cliff_cloud.
+   */
+  bool LabelCliffPoints(const Eigen::ParametrizedLine<float, 3> &floor_line,
+                        const pcl::PointCloud<pcl::PointXYZ> &cloud,
+                        point_kernels::Mask *labels,
+                        pcl::PointCloud<pcl::PointXYZ> *cliff_cloud);
+
   /**
    * Takes an input cloud and point indices and returns the
    * coefficients of the dominant line as well as the indices of all
@@ -235,6 +471,19 @@ private:
                     Eigen::ParametrizedLine<float, 3> *line,
                     std::vector<int> *inlier_indices);
 
+  /**
+   * Tries to find the floor line by verifying the tracked line
+   * against the candidates in indices.
+   *
+   * @param sensor_floor_intersection_line
+   *     the current intersection of sensor plane and floor
+   */
+  bool TrackFloorLine(const pcl::PointCloud<pcl::PointXYZ> &input_cloud,
+                      const std::vector<int> &indices,
+                      const Eigen::ParametrizedLine<float, 3> &sensor_floor_intersection_line,
+                      Eigen::ParametrizedLine<float, 3> *line,
+                      std::vector<int> *inlier_indices);
+
   void MakeCloudFromIndices(const pcl::PointCloud<pcl::PointXYZ> &input_cloud,
                             const std::vector<int> &input_indices,
                             pcl::PointCloud<pcl::PointXYZ> *output_cloud);
@@ -243,8 +492,14 @@ private:
                                const std::vector<int> &indices,
                                ros::Publisher &publisher);
 
-  Eigen::ParametrizedLine<float, 3> LineFromCoefficients(
-      const pcl::ModelCoefficients &line_coefficients);
+  /**
+   * Publishes indices into cloud. The indices message gets the
+   * header of cloud so that subscribers can synchronize both
+   * messages with an exact time policy.
+   */
+  void PublishIndices(const pcl::PointCloud<pcl::PointXYZ> &cloud,
+                      const pcl::PointIndices::Ptr &indices,
+                      ros::Publisher &publisher);
 
   /**
    * Checks if a transform to the reference frame is available.
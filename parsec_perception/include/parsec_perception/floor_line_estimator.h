@@ -0,0 +1,153 @@
+// Copyright 2011 Google Inc.
+// Author: moesenle@google.com (Lorenz Moesenlechner)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef PARSEC_PERCEPTION_FLOOR_LINE_ESTIMATOR_H
+#define PARSEC_PERCEPTION_FLOOR_LINE_ESTIMATOR_H
+
+#include <vector>
+
+#include <boost/random/mersenne_twister.hpp>
+#include <Eigen/Geometry>
+#include <pcl/point_cloud.h>
+#include <pcl/point_types.h>
+
+#include "parsec_perception/point_kernels.h"
+
+namespace parsec_perception {
+
+/**
+ * RANSAC estimator for a 3D line that is roughly parallel to a given
+ * axis, i.e. the floor line seen by a tilting laser. Only samples
+ * whose direction is within the angular constraint are scored, the
+ * search stops as soon as enough points are inliers and the final
+ * model is refined with a closed-form least squares fit.
+ *
+ * All scratch memory is kept between calls, so after the first few
+ * clouds an estimation does not allocate. The random generator is
+ * re-seeded on every call, i.e. the result only depends on the input.
+ */
+class FloorLineEstimator {
+ public:
+  static const int kDefaultMaxIterations;
+  static const double kDefaultTargetInlierRatio;
+  static const unsigned int kDefaultSeed;
+
+  /**
+   * @param axis the axis the line needs to be parallel to
+   * @param max_angle maximal angle between line and axis in radians
+   * @param distance_threshold maximal distance of inliers from the line
+   */
+  FloorLineEstimator(const Eigen::Vector3f &axis, double max_angle,
+                     double distance_threshold);
+
+  /**
+   * Stop sampling as soon as this ratio of the input points are
+   * inliers of the best model.
+   */
+  void set_target_inlier_ratio(double ratio) {
+    target_inlier_ratio_ = ratio;
+  }
+
+  void set_max_iterations(int max_iterations) {
+    max_iterations_ = max_iterations;
+  }
+
+  void set_seed(unsigned int seed) {
+    seed_ = seed;
+  }
+
+  /**
+   * The number of models that were scored in the last call to
+   * Estimate.
+   */
+  int iterations() const {
+    return iterations_;
+  }
+
+  /**
+   * Finds the dominant line in the points of cloud referenced by
+   * indices.
+   *
+   * @param line the refined line
+   * @param inlier_indices indices into cloud of all points on line
+   *
+   * @return false if no line satisfying the constraints was found
+   */
+  bool Estimate(const pcl::PointCloud<pcl::PointXYZ> &cloud,
+                const std::vector<int> &indices,
+                Eigen::ParametrizedLine<float, 3> *line,
+                std::vector<int> *inlier_indices);
+
+  /**
+   * Checks if previous_line, e.g. the floor line of the last cloud,
+   * still explains the points of cloud referenced by indices. This
+   * only needs a single inlier count instead of a full RANSAC
+   * search.
+   *
+   * @param min_inlier_ratio
+   *     the minimal ratio of points that need to be inliers
+   * @param line previous_line refined with the new inliers
+   * @param inlier_indices indices into cloud of all points on line
+   *
+   * @return false if previous_line has too few inliers
+   */
+  bool Verify(const pcl::PointCloud<pcl::PointXYZ> &cloud,
+              const std::vector<int> &indices,
+              const Eigen::ParametrizedLine<float, 3> &previous_line,
+              double min_inlier_ratio,
+              Eigen::ParametrizedLine<float, 3> *line,
+              std::vector<int> *inlier_indices);
+
+ private:
+  Eigen::Vector3f axis_;
+  double min_axis_cosine_;
+  double distance_threshold_;
+  double target_inlier_ratio_;
+  int max_iterations_;
+  unsigned int seed_;
+  int iterations_;
+  boost::mt19937 generator_;
+  point_kernels::PointBuffer points_;
+  point_kernels::Mask inlier_mask_;
+
+  /**
+   * Counts the points that are closer than distance_threshold_ to
+   * the line through origin with unit direction direction. If mask
+   * is not NULL, marks the inliers.
+   */
+  size_t CountInliers(const Eigen::Vector3f &origin, const Eigen::Vector3f &direction,
+                      point_kernels::Mask *mask) const;
+
+  /**
+   * Refines the model by a least squares fit through its inliers in
+   * points_ and returns the refined line and its inliers.
+   */
+  void RefineModel(const Eigen::Vector3f &origin, const Eigen::Vector3f &direction,
+                   const std::vector<int> &indices,
+                   Eigen::ParametrizedLine<float, 3> *line,
+                   std::vector<int> *inlier_indices);
+
+  /**
+   * Fits a line through the marked points by least squares, i.e. the
+   * line through their centroid along the principal axis of their
+   * scatter matrix.
+   */
+  bool FitLine(const point_kernels::Mask &mask, Eigen::Vector3f *origin,
+               Eigen::Vector3f *direction) const;
+};
+
+}  // namespace parsec_perception
+
+#endif  // PARSEC_PERCEPTION_FLOOR_LINE_ESTIMATOR_H
@@ -0,0 +1,133 @@
+// Copyright 2011 Google Inc.
+// Author: moesenle@google.com (Lorenz Moesenlechner)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef PARSEC_PERCEPTION_POINT_KERNELS_H
+#define PARSEC_PERCEPTION_POINT_KERNELS_H
+
+#include <vector>
+
+#include <pcl/point_cloud.h>
+#include <pcl/point_types.h>
+
+namespace parsec_perception {
+
+namespace point_kernels {
+
+/**
+ * One byte per point, 1 if the point matches a predicate, 0
+ * otherwise.
+ */
+typedef std::vector<unsigned char> Mask;
+
+/**
+ * Structure-of-arrays copy of the coordinates of a point cloud. The
+ * predicates below process four points at a time on this layout.
+ */
+struct PointBuffer {
+  std::vector<float> x;
+  std::vector<float> y;
+  std::vector<float> z;
+
+  size_t size() const {
+    return x.size();
+  }
+
+  /**
+   * Copies all points of cloud.
+   */
+  void Assign(const pcl::PointCloud<pcl::PointXYZ> &cloud);
+
+  /**
+   * Copies the points of cloud referenced by indices. Mask entry i
+   * then refers to the point indices[i].
+   */
+  void Assign(const pcl::PointCloud<pcl::PointXYZ> &cloud,
+              const std::vector<int> &indices);
+};
+
+/**
+ * Marks points with |z| < floor_z_distance + max_slope * d where d
+ * is the distance of the point from the z axis. Matches
+ * FloorFilter's floor candidate check bit by bit, i.e. the sum of
+ * squares is computed in single and everything else in double
+ * precision.
+ */
+void FloorCandidateMask(const PointBuffer &points, double floor_z_distance,
+                        double max_slope, Mask *mask);
+
+/**
+ * Marks points that are not inside the cylinder around the z axis
+ * with radius between minimal_z and maximal_z. The distance from
+ * the z axis is computed in single precision like
+ * pcl::euclideanDistance.
+ */
+void OutsideCylinderMask(const PointBuffer &points, double radius,
+                         double minimal_z, double maximal_z, Mask *mask);
+
+/**
+ * Marks points with |z - reference_z| > min_distance.
+ */
+void ZDistanceMask(const PointBuffer &points, double reference_z,
+                   double min_distance, Mask *mask);
+
+/**
+ * Appends the index of every marked entry to indices.
+ *
+ * @return the number of appended indices
+ */
+size_t CompactMask(const Mask &mask, std::vector<int> *indices);
+
+/**
+ * Appends input_indices[i] for every marked entry i to indices. Use
+ * this for buffers that were filled from an index list.
+ *
+ * @return the number of appended indices
+ */
+size_t CompactMask(const Mask &mask, const std::vector<int> &input_indices,
+                   std::vector<int> *indices);
+
+/**
+ * Labels for partitioning a cloud with a Mask. Cliff generating
+ * points are never floor points.
+ */
+enum PartitionLabel {
+  kNonFloorPoint = 0,
+  kFloorPoint = 1,
+  kCliffPoint = 2
+};
+
+/**
+ * Resizes labels to size entries, labels all of them kNonFloorPoint
+ * and then labels every point in indices with label.
+ */
+void LabelIndices(size_t size, const std::vector<int> &indices,
+                  unsigned char label, Mask *labels);
+
+/**
+ * Splits labels into the indices of floor points, of all other
+ * points including cliff points and of cliff points in a single
+ * pass. The outputs are overwritten but keep their capacity, so
+ * reusing them between clouds avoids allocations. All outputs are
+ * sorted.
+ */
+void PartitionLabels(const Mask &labels, std::vector<int> *floor_indices,
+                     std::vector<int> *non_floor_indices,
+                     std::vector<int> *cliff_indices);
+
+}  // namespace point_kernels
+
+}  // namespace parsec_perception
+
+#endif  // PARSEC_PERCEPTION_POINT_KERNELS_H
@@ -0,0 +1,93 @@
+// Copyright 2011 Google Inc.
+// Author: moesenle@google.com (Lorenz Moesenlechner)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef PARSEC_PERCEPTION_SENSOR_POSE_CACHE_H
+#define PARSEC_PERCEPTION_SENSOR_POSE_CACHE_H
+
+#include <deque>
+#include <string>
+#include <utility>
+
+#include <boost/thread/mutex.hpp>
+#include <ros/ros.h>
+#include <tf/transform_listener.h>
+
+namespace parsec_perception {
+
+/**
+ * Caches the pose of a sensor frame in a reference frame for the
+ * stamps of the clouds that are currently being processed. All
+ * geometry calculations on one cloud need the sensor pose at the
+ * same time, so only the first request for a new stamp needs to
+ * walk the TF tree.
+ *
+ * The cache is thread safe. If several clouds are processed
+ * concurrently, the capacity should be at least the number of
+ * clouds in flight.
+ */
+class SensorPoseCache {
+ public:
+  /**
+   * @param capacity the number of stamps to keep poses for
+   */
+  SensorPoseCache(tf::TransformListener &tf_listener,
+                  const std::string &reference_frame,
+                  const std::string &sensor_frame,
+                  const ros::Duration &timeout,
+                  size_t capacity = 1);
+
+  /**
+   * Returns the transform from the sensor frame to the reference
+   * frame at time. Waits for at most the timeout passed to the
+   * constructor if the transform is not available yet.
+   *
+   * @return false if the transform could not be looked up
+   */
+  bool GetSensorPose(const ros::Time &time, tf::StampedTransform *sensor_pose);
+
+  /**
+   * The number of requests that needed a TF lookup.
+   */
+  size_t lookups() const {
+    boost::mutex::scoped_lock lock(mutex_);
+    return lookups_;
+  }
+
+  /**
+   * The number of requests that were answered from the cache.
+   */
+  size_t lookups_avoided() const {
+    boost::mutex::scoped_lock lock(mutex_);
+    return lookups_avoided_;
+  }
+
+ private:
+  typedef std::pair<ros::Time, tf::StampedTransform> CacheEntry;
+
+  tf::TransformListener &tf_listener_;
+  std::string reference_frame_;
+  std::string sensor_frame_;
+  ros::Duration timeout_;
+  size_t capacity_;
+  mutable boost::mutex mutex_;
+  // The most recently added entry is at the back.
+  std::deque<CacheEntry> entries_;
+  size_t lookups_;
+  size_t lookups_avoided_;
+};
+
+}  // namespace parsec_perception
+
+#endif  // PARSEC_PERCEPTION_SENSOR_POSE_CACHE_H
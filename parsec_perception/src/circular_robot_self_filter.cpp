@@ -37,38 +37,75 @@ void CircularRobotSelfFilter::onInit() {
     ROS_FATAL("Parameter 'maximal_z_value' not found.");
     return;
   }
-  input_cloud_subscriber_ =
-      getPrivateNodeHandle().subscribe<pcl::PointCloud<pcl::PointXYZ> >(
-          "input", 100, boost::bind(&CircularRobotSelfFilter::CloudCallback, this, _1));
+  getPrivateNodeHandle().param("use_indices", use_indices_, false);
+  if (use_indices_) {
+    input_cloud_filter_subscriber_.reset(
+        new message_filters::Subscriber<pcl::PointCloud<pcl::PointXYZ> >(
+            getPrivateNodeHandle(), "input", 100));
+    input_indices_filter_subscriber_.reset(
+        new message_filters::Subscriber<pcl::PointIndices>(
+            getPrivateNodeHandle(), "indices", 100));
+    input_synchronizer_.reset(
+        new message_filters::TimeSynchronizer<
+          pcl::PointCloud<pcl::PointXYZ>, pcl::PointIndices>(
+              *input_cloud_filter_subscriber_, *input_indices_filter_subscriber_, 100));
+    input_synchronizer_->registerCallback(
+        boost::bind(&CircularRobotSelfFilter::IndexedCloudCallback, this, _1, _2));
+  } else {
+    input_cloud_subscriber_ =
+        getPrivateNodeHandle().subscribe<pcl::PointCloud<pcl::PointXYZ> >(
+            "input", 100, boost::bind(&CircularRobotSelfFilter::CloudCallback, this, _1));
+  }
   output_cloud_publisher_ =
       getPrivateNodeHandle().advertise<pcl::PointCloud<pcl::PointXYZ> >(
           "output", 100);
 }
 
 void CircularRobotSelfFilter::CloudCallback(const pcl::PointCloud<pcl::PointXYZ>::ConstPtr &cloud) {
-  pcl::PointCloud<pcl::PointXYZ>::Ptr transformed_cloud(new pcl::PointCloud<pcl::PointXYZ>);
-  try {
-    pcl_ros::transformPointCloud(base_frame_, *cloud, *transformed_cloud, tf_listener_);
-  } catch (tf::TransformException e) {
-    // Transformation fails in particular at start up because tilting
-    // laser transforms might not be coming in yet. This is logged by
-    // TF already, so we don't add another logging here.
-    return;
+  FilterCloud(cloud, NULL);
+}
+
+void CircularRobotSelfFilter::IndexedCloudCallback(
+    const pcl::PointCloud<pcl::PointXYZ>::ConstPtr &cloud,
+    const pcl::PointIndices::ConstPtr &indices) {
+  FilterCloud(cloud, &indices->indices);
+}
+
+void CircularRobotSelfFilter::FilterCloud(
+    const pcl::PointCloud<pcl::PointXYZ>::ConstPtr &cloud,
+    const std::vector<int> *input_indices) {
+  // Clouds that are already in the base frame, e.g. the shared
+  // reference cloud of a floor filter, are used without a copy.
+  pcl::PointCloud<pcl::PointXYZ>::ConstPtr base_cloud = cloud;
+  if (cloud->header.frame_id != base_frame_) {
+    pcl::PointCloud<pcl::PointXYZ>::Ptr transformed_cloud(new pcl::PointCloud<pcl::PointXYZ>);
+    try {
+      pcl_ros::transformPointCloud(base_frame_, *cloud, *transformed_cloud, tf_listener_);
+    } catch (tf::TransformException e) {
+      // Transformation fails in particular at start up because tilting
+      // laser transforms might not be coming in yet. This is logged by
+      // TF already, so we don't add another logging here.
+      return;
+    }
+    base_cloud = transformed_cloud;
   }
 
+  if (input_indices) {
+    point_buffer_.Assign(*base_cloud, *input_indices);
+  } else {
+    point_buffer_.Assign(*base_cloud);
+  }
+  point_kernels::OutsideCylinderMask(
+      point_buffer_, radius_, minimal_z_value_, maximal_z_value_, &point_mask_);
   boost::shared_ptr<std::vector<int> > indices(new std::vector<int>);
-  for (size_t i = 0; i < transformed_cloud->points.size(); i++) {
-    pcl::PointXYZ point = transformed_cloud->points[i];
-    pcl::PointXYZ origin_xy(0, 0, transformed_cloud->points[i].z);
-    if (point.z <= maximal_z_value_ && point.z >= minimal_z_value_ &&
-        pcl::euclideanDistance(point, origin_xy) <= radius_) {
-      continue;
-    }
-    indices->push_back(i);
+  if (input_indices) {
+    point_kernels::CompactMask(point_mask_, *input_indices, indices.get());
+  } else {
+    point_kernels::CompactMask(point_mask_, indices.get());
   }
   pcl::ExtractIndices<pcl::PointXYZ> extract_indices;
   extract_indices.setIndices(indices);
-  extract_indices.setInputCloud(transformed_cloud);
+  extract_indices.setInputCloud(base_cloud);
   pcl::PointCloud<pcl::PointXYZ>::Ptr output_cloud(new pcl::PointCloud<pcl::PointXYZ>);
   extract_indices.filter(*output_cloud);
   output_cloud_publisher_.publish(output_cloud);
@@ -18,7 +18,7 @@
 #include <cmath>
 
 #include <algorithm>
-#include <iterator>
+#include <string>
 
 #include <boost/bind.hpp>
 #include <boost/timer.hpp>
@@ -27,20 +27,29 @@
 #include <laser_geometry/laser_geometry.h>
 #include <pcl/point_types.h>
 #include <pcl/ros/conversions.h>
-#include <pcl/sample_consensus/method_types.h>
-#include <pcl/sample_consensus/model_types.h>
-#include <pcl/segmentation/sac_segmentation.h>
 #include <pcl_ros/transforms.h>
 #include <ros_check/ros_check.h>
 
 #include "parsec_perception/geometry.h"
+#include "parsec_perception/point_kernels.h"
 
 namespace parsec_perception {
 
 const std::string FloorFilter::kDefaultReferenceFrame("base_link");
+const double FloorFilter::kDefaultTrackingMaxInlierRatioDrop = 0.1;
+const double FloorFilter::kDefaultTrackingMaxPlaneMotion = 0.02;
+const int FloorFilter::kDefaultPipelineQueueSize = 10;
 
 FloorFilter::FloorFilter(const ros::NodeHandle &node_handle)
-    : node_handle_(node_handle) {
+    : node_handle_(node_handle),
+      tracked_line_valid_(false),
+      tracked_inlier_ratio_(0.0),
+      floor_lines_(0),
+      tracked_floor_lines_(0),
+      pipeline_shutdown_(false),
+      next_sequence_number_(0),
+      next_segmentation_sequence_number_(0),
+      dropped_clouds_(0) {
   if (!node_handle_.getParam("sensor_frame", sensor_frame_)) {
     ROS_FATAL("Parameter 'sensor_frame' not found.");
     return;
@@ -57,10 +66,39 @@ FloorFilter::FloorFilter(const ros::NodeHandle &node_handle)
       "line_distance_threshold", line_distance_threshold_, kDefaultLineDistanceThreshold);
   node_handle_.param(
       "cliff_distance_threshold", cliff_distance_threshold_, kDefaultCliffDistanceThreshold);
+  node_handle_.param("publish_indices", publish_indices_, false);
+  int line_max_iterations;
+  node_handle_.param(
+      "line_max_iterations", line_max_iterations, FloorLineEstimator::kDefaultMaxIterations);
+  double line_inlier_ratio;
+  node_handle_.param(
+      "line_inlier_ratio", line_inlier_ratio, FloorLineEstimator::kDefaultTargetInlierRatio);
+  floor_line_estimator_.reset(
+      new FloorLineEstimator(Eigen::Vector3f(0, 1, 0), max_floor_x_rotation_,
+                             line_distance_threshold_));
+  floor_line_estimator_->set_max_iterations(line_max_iterations);
+  floor_line_estimator_->set_target_inlier_ratio(line_inlier_ratio);
+  node_handle_.param("track_floor_line", track_floor_line_, true);
+  node_handle_.param(
+      "tracking_max_inlier_ratio_drop", tracking_max_inlier_ratio_drop_,
+      kDefaultTrackingMaxInlierRatioDrop);
+  node_handle_.param(
+      "tracking_max_plane_motion", tracking_max_plane_motion_, kDefaultTrackingMaxPlaneMotion);
+  node_handle_.param("pipeline_threads", pipeline_threads_, 0);
+  node_handle_.param("pipeline_queue_size", pipeline_queue_size_, kDefaultPipelineQueueSize);
+  // In pipelined mode, every transform worker and the segmentation
+  // stage can work on a different stamp.
+  sensor_pose_cache_.reset(
+      new SensorPoseCache(tf_listener_, reference_frame_, sensor_frame_,
+                          ros::Duration(0.2), pipeline_threads_ + 1));
+
+  diagnostic_updater_.setHardwareID("none");
+  diagnostic_updater_.add("Floor filter", this, &FloorFilter::UpdateDiagnostics);
 
   input_cloud_subscriber_ =
       node_handle_.subscribe<pcl::PointCloud<pcl::PointXYZ> >(
-          "input", 1, boost::bind(&FloorFilter::CloudCallback, this, _1));
+          "input", pipeline_threads_ > 0 ? pipeline_queue_size_ : 1,
+          boost::bind(&FloorFilter::CloudCallback, this, _1));
   filtered_cloud_publisher_ =
       node_handle_.advertise<pcl::PointCloud<pcl::PointXYZ> >(
           "output", 10);
@@ -73,71 +111,294 @@ FloorFilter::FloorFilter(const ros::NodeHandle &node_handle)
   cliff_generating_cloud_publisher_ =
       node_handle_.advertise<pcl::PointCloud<pcl::PointXYZ> >(
           "cliff_generating_cloud", 10);
+  if (publish_indices_) {
+    reference_cloud_publisher_ =
+        node_handle_.advertise<pcl::PointCloud<pcl::PointXYZ> >(
+            "reference_cloud", 10);
+    floor_indices_publisher_ =
+        node_handle_.advertise<pcl::PointIndices>("floor_indices", 10);
+    filtered_indices_publisher_ =
+        node_handle_.advertise<pcl::PointIndices>("output_indices", 10);
+    cliff_generating_indices_publisher_ =
+        node_handle_.advertise<pcl::PointIndices>("cliff_generating_indices", 10);
+  }
+
+  if (pipeline_threads_ > 0) {
+    for (int i = 0; i < pipeline_threads_; i++) {
+      pipeline_thread_group_.create_thread(boost::bind(&FloorFilter::TransformWorker, this));
+    }
+    pipeline_thread_group_.create_thread(boost::bind(&FloorFilter::SegmentationWorker, this));
+    pipeline_thread_group_.create_thread(boost::bind(&FloorFilter::PublishWorker, this));
+  }
+}
+
+FloorFilter::~FloorFilter() {
+  {
+    boost::mutex::scoped_lock lock(pipeline_mutex_);
+    pipeline_shutdown_ = true;
+  }
+  transform_condition_.notify_all();
+  segmentation_condition_.notify_all();
+  publish_condition_.notify_all();
+  pipeline_thread_group_.join_all();
 }
 
 void FloorFilter::CloudCallback(const pcl::PointCloud<pcl::PointXYZ>::ConstPtr &cloud) {
-  pcl::PointCloud<pcl::PointXYZ>::Ptr transformed_cloud(
-      new pcl::PointCloud<pcl::PointXYZ>);
-  if (!WaitForTransformToReferenceFrame(cloud->header.frame_id, cloud->header.stamp)) {
-    ROS_WARN("Cannot transform pointcloud to reference frame (%s -> %s).",
-             cloud->header.frame_id.c_str(), reference_frame_.c_str());
+  if (pipeline_threads_ > 0) {
+    {
+      boost::mutex::scoped_lock lock(pipeline_mutex_);
+      if (transform_queue_.size() >= static_cast<size_t>(pipeline_queue_size_)) {
+        transform_queue_.pop_front();
+        dropped_clouds_++;
+      }
+      transform_queue_.push_back(cloud);
+      StageStatistics &statistics = stage_statistics_[kTransformStage];
+      statistics.max_queue_depth = std::max(statistics.max_queue_depth, transform_queue_.size());
+    }
+    transform_condition_.notify_one();
     return;
   }
-  try {
-    pcl_ros::transformPointCloud(reference_frame_, *cloud, *transformed_cloud, tf_listener_);
-  } catch (tf::TransformException e) {
-    // Transformation fails in particular at start up because tilting
-    // laser transforms might not be coming in yet. This is logged by
-    // TF already, so we don't add another logging here.
+
+  CloudJob job;
+  job.input_cloud = cloud;
+  ros::WallTime start_time = ros::WallTime::now();
+  if (!TransformCloud(&job, &point_buffer_, &point_mask_)) {
     return;
   }
+  RecordStageLatency(kTransformStage, ros::WallTime::now() - start_time);
+  start_time = ros::WallTime::now();
+  SegmentFloor(&job);
+  RecordStageLatency(kSegmentationStage, ros::WallTime::now() - start_time);
+  start_time = ros::WallTime::now();
+  PublishResults(job);
+  RecordStageLatency(kPublishStage, ros::WallTime::now() - start_time);
+}
+
+bool FloorFilter::TransformCloud(
+    CloudJob *job, point_kernels::PointBuffer *points, point_kernels::Mask *mask) {
+  const pcl::PointCloud<pcl::PointXYZ>::ConstPtr &cloud = job->input_cloud;
+  job->transformed_cloud.reset(new pcl::PointCloud<pcl::PointXYZ>);
+  pcl::PointCloud<pcl::PointXYZ>::Ptr &transformed_cloud = job->transformed_cloud;
+  if (cloud->header.frame_id == sensor_frame_) {
+    // The common case. The sensor pose is needed for all further
+    // calculations anyway, so use it for transforming the cloud, too.
+    tf::StampedTransform sensor_pose;
+    if (!sensor_pose_cache_->GetSensorPose(cloud->header.stamp, &sensor_pose)) {
+      return false;
+    }
+    pcl_ros::transformPointCloud(*cloud, *transformed_cloud, sensor_pose);
+    transformed_cloud->header.frame_id = reference_frame_;
+  } else {
+    if (!WaitForTransformToReferenceFrame(cloud->header.frame_id, cloud->header.stamp)) {
+      ROS_WARN("Cannot transform pointcloud to reference frame (%s -> %s).",
+               cloud->header.frame_id.c_str(), reference_frame_.c_str());
+      return false;
+    }
+    try {
+      pcl_ros::transformPointCloud(reference_frame_, *cloud, *transformed_cloud, tf_listener_);
+    } catch (tf::TransformException e) {
+      // Transformation fails in particular at start up because tilting
+      // laser transforms might not be coming in yet. This is logged by
+      // TF already, so we don't add another logging here.
+      return false;
+    }
+  }
   if(!transformed_cloud->points.size()) {
     ROS_WARN("The input cloud is empty. No obstacles in range?");
-    return;
+    return false;
   }
 
-  std::vector<int> floor_candidate_indices;
   FilterFloorCandidates(floor_z_distance_, tan(max_floor_y_rotation_), *transformed_cloud,
-                        &floor_candidate_indices);
+                        points, mask, &job->floor_candidate_indices);
+  return true;
+}
 
+void FloorFilter::SegmentFloor(CloudJob *job) {
   Eigen::ParametrizedLine<float, 3> floor_line;
-  std::vector<int> line_inlier_indices;
-  std::vector<int> indices_without_floor;
-  pcl::PointCloud<pcl::PointXYZ>::Ptr cliff_cloud(new pcl::PointCloud<pcl::PointXYZ>);
-  std::vector<int> cliff_indices;
-  if (GetFloorLine(transformed_cloud, floor_candidate_indices, &floor_line, &line_inlier_indices)) {
-    GetIndicesDifference(transformed_cloud->size(), line_inlier_indices, &indices_without_floor);
-    GenerateCliffCloud(floor_line, *transformed_cloud, indices_without_floor,
-                       cliff_cloud.get(), &cliff_indices);
+  job->floor_indices.reset(new pcl::PointIndices);
+  job->non_floor_indices.reset(new pcl::PointIndices);
+  job->cliff_indices.reset(new pcl::PointIndices);
+  job->cliff_cloud.reset(new pcl::PointCloud<pcl::PointXYZ>);
+  if (GetFloorLine(job->transformed_cloud, job->floor_candidate_indices, &floor_line,
+                   &floor_line_inliers_)) {
+    PartitionCloud(floor_line, *job->transformed_cloud, floor_line_inliers_,
+                   &job->floor_indices->indices, &job->non_floor_indices->indices,
+                   &job->cliff_indices->indices, job->cliff_cloud.get());
   }
   else {
-    cliff_cloud->header = transformed_cloud->header;
+    job->cliff_cloud->header = job->transformed_cloud->header;
   }
+}
+
+void FloorFilter::PublishResults(const CloudJob &job) {
+  const pcl::PointCloud<pcl::PointXYZ> &transformed_cloud = *job.transformed_cloud;
   // Always publish clouds even if they are empty to signal that
   // perception is still alive.
-  PublishCloudFromIndices(*transformed_cloud, line_inlier_indices, floor_cloud_publisher_);
-  PublishCloudFromIndices(*transformed_cloud, indices_without_floor, filtered_cloud_publisher_);
-  PublishCloudFromIndices(*transformed_cloud, cliff_indices, cliff_generating_cloud_publisher_);
-  cliff_cloud_publisher_.publish(cliff_cloud);
-
-  ros::Duration message_age = ros::Time::now() - cloud->header.stamp;
+  if (publish_indices_) {
+    // From here on, the transformed cloud is shared with subscribers
+    // and must not be modified anymore.
+    reference_cloud_publisher_.publish(job.transformed_cloud);
+    PublishIndices(transformed_cloud, job.floor_indices, floor_indices_publisher_);
+    PublishIndices(transformed_cloud, job.non_floor_indices, filtered_indices_publisher_);
+    PublishIndices(transformed_cloud, job.cliff_indices, cliff_generating_indices_publisher_);
+  }
+  PublishCloudFromIndices(transformed_cloud, job.floor_indices->indices,
+                          floor_cloud_publisher_);
+  PublishCloudFromIndices(transformed_cloud, job.non_floor_indices->indices,
+                          filtered_cloud_publisher_);
+  PublishCloudFromIndices(transformed_cloud, job.cliff_indices->indices,
+                          cliff_generating_cloud_publisher_);
+  cliff_cloud_publisher_.publish(job.cliff_cloud);
+
+  ros::Duration message_age = ros::Time::now() - job.input_cloud->header.stamp;
   // This is just a hint. Throw a warning to make the user know
   // about something being fishy with the current configuration
   // because input data is pretty old.
   if (message_age > ros::Duration(1.0)) {
     ROS_WARN("Filtered cloud already %lf seconds old.", message_age.toSec());
   }
+  diagnostic_updater_.update();
+}
+
+void FloorFilter::TransformWorker() {
+  // Each worker has its own scratch space.
+  point_kernels::PointBuffer points;
+  point_kernels::Mask mask;
+  while (true) {
+    CloudJobPtr job(new CloudJob);
+    {
+      boost::mutex::scoped_lock lock(pipeline_mutex_);
+      while (!pipeline_shutdown_ && transform_queue_.empty()) {
+        transform_condition_.wait(lock);
+      }
+      if (pipeline_shutdown_) {
+        return;
+      }
+      job->input_cloud = transform_queue_.front();
+      transform_queue_.pop_front();
+      job->sequence_number = next_sequence_number_++;
+    }
+    ros::WallTime start_time = ros::WallTime::now();
+    job->transformed = TransformCloud(job.get(), &points, &mask);
+    RecordStageLatency(kTransformStage, ros::WallTime::now() - start_time);
+    {
+      boost::mutex::scoped_lock lock(pipeline_mutex_);
+      // Failed jobs are queued, too. Otherwise the segmentation stage
+      // would wait for them forever.
+      segmentation_queue_[job->sequence_number] = job;
+      StageStatistics &statistics = stage_statistics_[kSegmentationStage];
+      statistics.max_queue_depth =
+          std::max(statistics.max_queue_depth, segmentation_queue_.size());
+    }
+    segmentation_condition_.notify_one();
+  }
+}
+
+void FloorFilter::SegmentationWorker() {
+  while (true) {
+    CloudJobPtr job;
+    {
+      boost::mutex::scoped_lock lock(pipeline_mutex_);
+      while (!pipeline_shutdown_ &&
+             (segmentation_queue_.empty() ||
+              segmentation_queue_.begin()->first != next_segmentation_sequence_number_)) {
+        segmentation_condition_.wait(lock);
+      }
+      if (pipeline_shutdown_) {
+        return;
+      }
+      job = segmentation_queue_.begin()->second;
+      segmentation_queue_.erase(segmentation_queue_.begin());
+      next_segmentation_sequence_number_++;
+    }
+    if (!job->transformed) {
+      continue;
+    }
+    ros::WallTime start_time = ros::WallTime::now();
+    SegmentFloor(job.get());
+    RecordStageLatency(kSegmentationStage, ros::WallTime::now() - start_time);
+    {
+      boost::mutex::scoped_lock lock(pipeline_mutex_);
+      publish_queue_.push_back(job);
+      StageStatistics &statistics = stage_statistics_[kPublishStage];
+      statistics.max_queue_depth = std::max(statistics.max_queue_depth, publish_queue_.size());
+    }
+    publish_condition_.notify_one();
+  }
+}
+
+void FloorFilter::PublishWorker() {
+  while (true) {
+    CloudJobPtr job;
+    {
+      boost::mutex::scoped_lock lock(pipeline_mutex_);
+      while (!pipeline_shutdown_ && publish_queue_.empty()) {
+        publish_condition_.wait(lock);
+      }
+      if (pipeline_shutdown_) {
+        return;
+      }
+      job = publish_queue_.front();
+      publish_queue_.pop_front();
+    }
+    ros::WallTime start_time = ros::WallTime::now();
+    PublishResults(*job);
+    RecordStageLatency(kPublishStage, ros::WallTime::now() - start_time);
+  }
+}
+
+void FloorFilter::RecordStageLatency(Stage stage, const ros::WallDuration &latency) {
+  boost::mutex::scoped_lock lock(pipeline_mutex_);
+  StageStatistics &statistics = stage_statistics_[stage];
+  statistics.processed++;
+  statistics.total_latency += latency.toSec();
+  statistics.max_latency = std::max(statistics.max_latency, latency.toSec());
+}
+
+void FloorFilter::UpdateDiagnostics(diagnostic_updater::DiagnosticStatusWrapper &status) {
+  status.summary(diagnostic_msgs::DiagnosticStatus::OK, "Floor filter running.");
+  status.add("TF lookups", sensor_pose_cache_->lookups());
+  status.add("TF lookups avoided", sensor_pose_cache_->lookups_avoided());
+
+  static const char *stage_names[kNumberOfStages] = {"Transform", "Segmentation", "Publish"};
+  boost::mutex::scoped_lock lock(pipeline_mutex_);
+  status.add("Floor lines", floor_lines_);
+  status.add("Tracked floor lines", tracked_floor_lines_);
+  status.add("Tracked floor line ratio",
+             floor_lines_ > 0 ? static_cast<double>(tracked_floor_lines_) / floor_lines_ : 0.0);
+  size_t queue_depths[kNumberOfStages] = {
+    transform_queue_.size(), segmentation_queue_.size(), publish_queue_.size()
+  };
+  for (int i = 0; i < kNumberOfStages; i++) {
+    StageStatistics &statistics = stage_statistics_[i];
+    std::string name(stage_names[i]);
+    status.add(name + " clouds", statistics.processed);
+    status.add(name + " mean latency (ms)",
+               statistics.processed > 0 ?
+               statistics.total_latency / statistics.processed * 1000.0 : 0.0);
+    status.add(name + " max latency (ms)", statistics.max_latency * 1000.0);
+    status.add(name + " queue depth", queue_depths[i]);
+    status.add(name + " max queue depth", std::max(statistics.max_queue_depth, queue_depths[i]));
+    // Report latencies and queue depths per diagnostics period.
+    statistics = StageStatistics();
+  }
+  status.add("Dropped clouds", dropped_clouds_);
 }
 
 void FloorFilter::FilterFloorCandidates(
     double floor_z_distance, double max_slope, pcl::PointCloud<pcl::PointXYZ> &cloud,
     std::vector<int> *indices) {
-  for (size_t i = 0; i < cloud.points.size(); i++) {
-    double point_distance_xy = sqrt(cloud.points[i].x * cloud.points[i].x + cloud.points[i].y * cloud.points[i].y);
-    if (fabs(cloud.points[i].z) < floor_z_distance + max_slope * point_distance_xy) {
-      indices->push_back(i);
-    }
-  }
+  FilterFloorCandidates(floor_z_distance, max_slope, cloud, &point_buffer_, &point_mask_,
+                        indices);
+}
+
+void FloorFilter::FilterFloorCandidates(
+    double floor_z_distance, double max_slope, const pcl::PointCloud<pcl::PointXYZ> &cloud,
+    point_kernels::PointBuffer *points, point_kernels::Mask *mask,
+    std::vector<int> *indices) {
+  points->Assign(cloud);
+  point_kernels::FloorCandidateMask(*points, floor_z_distance, max_slope, mask);
+  point_kernels::CompactMask(*mask, indices);
 }
 
 bool FloorFilter::FindLine(
@@ -148,36 +409,10 @@ bool FloorFilter::FindLine(
   if (indices.size() == 0) {
     return false;
   }
-  pcl::SACSegmentation<pcl::PointXYZ> ransac_line_finder;
-
-  ransac_line_finder.setOptimizeCoefficients(true);
-  ransac_line_finder.setModelType(pcl::SACMODEL_LINE);
-  ransac_line_finder.setMethodType(pcl::SAC_RANSAC);
-  ransac_line_finder.setDistanceThreshold(line_distance_threshold_);
-  ransac_line_finder.setAxis(Eigen::Vector3f(0, 1, 0));
-  ransac_line_finder.setEpsAngle(max_floor_x_rotation_);
-  ransac_line_finder.setMaxIterations(100);
-
-  ransac_line_finder.setInputCloud(input_cloud);
-  pcl::PointIndicesPtr point_input_indices(new pcl::PointIndices);
-  point_input_indices->indices.resize(indices.size());
-  std::copy(indices.begin(), indices.end(), point_input_indices->indices.begin());
-  ransac_line_finder.setIndices(point_input_indices);
-
-  pcl::PointIndices point_inlier_indices;
-  pcl::ModelCoefficients line_coefficients;
-  ransac_line_finder.segment(point_inlier_indices, line_coefficients);
-
-  if (point_inlier_indices.indices.size() == 0) {
+  if (!floor_line_estimator_->Estimate(*input_cloud, indices, line, inlier_indices)) {
     ROS_WARN("Could not estimate a line model for the given dataset.");
     return false;
   }
-
-  *line = LineFromCoefficients(line_coefficients);
-  inlier_indices->resize(point_inlier_indices.indices.size());
-  std::copy(point_inlier_indices.indices.begin(),  point_inlier_indices.indices.end(),
-            inlier_indices->begin());
-
   return true;
 }
 
@@ -192,6 +427,21 @@ bool FloorFilter::GetFloorLine(
     // with it behind the robot.
     return false;
   }
+  bool tracked = TrackFloorLine(*input_cloud, indices, sensor_floor_intersection_line,
+                                line, inlier_indices);
+  {
+    // UpdateDiagnostics reads the statistics from another thread in
+    // pipelined mode.
+    boost::mutex::scoped_lock lock(pipeline_mutex_);
+    floor_lines_++;
+    if (tracked) {
+      tracked_floor_lines_++;
+    }
+  }
+  if (tracked) {
+    return true;
+  }
+  tracked_line_valid_ = false;
   Eigen::Vector3f y_axis(0, 1, 0);
   if (!FindLine(input_cloud, indices, line, inlier_indices)) {
     ROS_DEBUG("RANSAC couldn't find a floor line.");
@@ -203,6 +453,42 @@ bool FloorFilter::GetFloorLine(
     inlier_indices->clear();
     *line = sensor_floor_intersection_line;
   }
+  else {
+    tracked_line_valid_ = true;
+    tracked_line_ = *line;
+    tracked_sensor_floor_intersection_line_ = sensor_floor_intersection_line;
+    tracked_inlier_ratio_ = static_cast<double>(inlier_indices->size()) / indices.size();
+  }
+  return true;
+}
+
+bool FloorFilter::TrackFloorLine(
+    const pcl::PointCloud<pcl::PointXYZ> &input_cloud,
+    const std::vector<int> &indices,
+    const Eigen::ParametrizedLine<float, 3> &sensor_floor_intersection_line,
+    Eigen::ParametrizedLine<float, 3> *line,
+    std::vector<int> *inlier_indices) {
+  if (!track_floor_line_ || !tracked_line_valid_) {
+    return false;
+  }
+  // The floor line moves with the sensor plane. Compare against the
+  // intersection line at the time RANSAC found the tracked line so
+  // that slow drift is detected, too.
+  if (!geometry::VectorsParallel(
+          sensor_floor_intersection_line.direction(),
+          tracked_sensor_floor_intersection_line_.direction(), max_floor_x_rotation_) ||
+      tracked_sensor_floor_intersection_line_.distance(
+          sensor_floor_intersection_line.origin()) > tracking_max_plane_motion_) {
+    ROS_DEBUG("Sensor plane moved. Not tracking the floor line.");
+    return false;
+  }
+  if (!floor_line_estimator_->Verify(
+          input_cloud, indices, tracked_line_,
+          tracked_inlier_ratio_ - tracking_max_inlier_ratio_drop_, line, inlier_indices)) {
+    ROS_DEBUG("Tracked floor line lost too many inliers.");
+    return false;
+  }
+  tracked_line_ = *line;
   return true;
 }
 
@@ -245,24 +531,76 @@ bool FloorFilter::GenerateCliffCloud(
   if (!GetViewpointPoint(input_cloud.header.stamp, &viewpoint)) {
     return false;
   }
-  for (size_t i = 0; i < input_indices.size(); i++) {
+  // The cliff point lies on the sight line between the viewpoint and
+  // the point. Its height difference to the point is at most the
+  // height difference between viewpoint and point, so points that
+  // are too close to the viewpoint's height can never generate a
+  // cliff. This cheap test rejects most points before the expensive
+  // intersection below.
+  point_buffer_.Assign(input_cloud, input_indices);
+  point_kernels::ZDistanceMask(
+      point_buffer_, viewpoint.z, cliff_distance_threshold_ - kCliffPrefilterMargin,
+      &point_mask_);
+  std::vector<int> candidate_indices;
+  point_kernels::CompactMask(point_mask_, input_indices, &candidate_indices);
+  cliff_indices->reserve(cliff_indices->size() + candidate_indices.size());
+  cliff_cloud->points.reserve(candidate_indices.size());
+
+  for (size_t i = 0; i < candidate_indices.size(); i++) {
+    const pcl::PointXYZ &point = input_cloud.points[candidate_indices[i]];
     pcl::PointXYZ cliff_point;
-    if (!IntersectWithSightline(input_cloud.header.stamp, floor_line, input_cloud.points[i],
-                                &cliff_point)) {
+    if (IsCliffPoint(viewpoint, floor_line, point, &cliff_point)) {
+      cliff_indices->push_back(candidate_indices[i]);
+      cliff_cloud->points.push_back(cliff_point);
+    }
+  }
+  cliff_cloud->width = cliff_cloud->points.size();
+  return true;
+}
+
+bool FloorFilter::PartitionCloud(
+    const Eigen::ParametrizedLine<float, 3> &floor_line,
+    const pcl::PointCloud<pcl::PointXYZ> &cloud,
+    const std::vector<int> &floor_line_inliers,
+    std::vector<int> *floor_indices,
+    std::vector<int> *non_floor_indices,
+    std::vector<int> *cliff_indices,
+    pcl::PointCloud<pcl::PointXYZ> *cliff_cloud) {
+  point_kernels::LabelIndices(
+      cloud.points.size(), floor_line_inliers, point_kernels::kFloorPoint, &partition_labels_);
+  bool cliffs_generated = LabelCliffPoints(floor_line, cloud, &partition_labels_, cliff_cloud);
+  point_kernels::PartitionLabels(
+      partition_labels_, floor_indices, non_floor_indices, cliff_indices);
+  return cliffs_generated;
+}
+
+bool FloorFilter::LabelCliffPoints(
+    const Eigen::ParametrizedLine<float, 3> &floor_line,
+    const pcl::PointCloud<pcl::PointXYZ> &cloud,
+    point_kernels::Mask *labels,
+    pcl::PointCloud<pcl::PointXYZ> *cliff_cloud) {
+  cliff_cloud->header = cloud.header;
+  cliff_cloud->height = 1;
+  cliff_cloud->is_dense = false;
+  cliff_cloud->points.clear();
+  cliff_cloud->width = 0;
+
+  pcl::PointXYZ viewpoint;
+  if (!GetViewpointPoint(cloud.header.stamp, &viewpoint)) {
+    return false;
+  }
+  // The same pre-filtering as in GenerateCliffCloud.
+  point_buffer_.Assign(cloud);
+  point_kernels::ZDistanceMask(
+      point_buffer_, viewpoint.z, cliff_distance_threshold_ - kCliffPrefilterMargin,
+      &point_mask_);
+  for (size_t i = 0; i < point_mask_.size(); i++) {
+    if (!point_mask_[i] || (*labels)[i] != point_kernels::kNonFloorPoint) {
       continue;
     }
-    double distance_cliff_from_point =
-        pcl::euclideanDistance(cliff_point, input_cloud.points[i]);
-    double distance_cliff_from_point_xy =
-      pcl::euclideanDistance(
-          cliff_point, pcl::PointXYZ(
-              input_cloud.points[i].x, input_cloud.points[i].y, cliff_point.z));
-    CHECK_LE(distance_cliff_from_point_xy, distance_cliff_from_point);
-    double distance_from_floor =
-      sqrt(distance_cliff_from_point * distance_cliff_from_point
-           - distance_cliff_from_point_xy * distance_cliff_from_point_xy);
-    if (distance_from_floor > cliff_distance_threshold_) {
-      cliff_indices->push_back(i);
+    pcl::PointXYZ cliff_point;
+    if (IsCliffPoint(viewpoint, floor_line, cloud.points[i], &cliff_point)) {
+      (*labels)[i] = point_kernels::kCliffPoint;
       cliff_cloud->points.push_back(cliff_point);
     }
   }
@@ -270,6 +608,24 @@ bool FloorFilter::GenerateCliffCloud(
   return true;
 }
 
+bool FloorFilter::IsCliffPoint(
+    const pcl::PointXYZ &viewpoint, const Eigen::ParametrizedLine<float, 3> &floor_line,
+    const pcl::PointXYZ &point, pcl::PointXYZ *cliff_point) {
+  if (!IntersectWithSightline(viewpoint, floor_line, point, cliff_point)) {
+    return false;
+  }
+  double distance_cliff_from_point =
+      pcl::euclideanDistance(*cliff_point, point);
+  double distance_cliff_from_point_xy =
+    pcl::euclideanDistance(
+        *cliff_point, pcl::PointXYZ(point.x, point.y, cliff_point->z));
+  CHECK_LE(distance_cliff_from_point_xy, distance_cliff_from_point);
+  double distance_from_floor =
+    sqrt(distance_cliff_from_point * distance_cliff_from_point
+         - distance_cliff_from_point_xy * distance_cliff_from_point_xy);
+  return distance_from_floor > cliff_distance_threshold_;
+}
+
 void FloorFilter::MakeCloudFromIndices(const pcl::PointCloud<pcl::PointXYZ> &input_cloud,
                                        const std::vector<int> &input_indices,
                                        pcl::PointCloud<pcl::PointXYZ> *output_cloud) {
@@ -287,18 +643,36 @@ void FloorFilter::MakeCloudFromIndices(const pcl::PointCloud<pcl::PointXYZ> &inp
 void FloorFilter::PublishCloudFromIndices(const pcl::PointCloud<pcl::PointXYZ> &cloud,
                                           const std::vector<int> &indices,
                                           ros::Publisher &publisher) {
+  // Copying points is the most expensive part of publishing. Don't
+  // do it if nobody is listening.
+  if (publisher.getNumSubscribers() == 0) {
+    return;
+  }
   pcl::PointCloud<pcl::PointXYZ>::Ptr indices_cloud(new pcl::PointCloud<pcl::PointXYZ>);
   MakeCloudFromIndices(cloud, indices, indices_cloud.get());
   publisher.publish(indices_cloud);
 }
 
+void FloorFilter::PublishIndices(const pcl::PointCloud<pcl::PointXYZ> &cloud,
+                                 const pcl::PointIndices::Ptr &indices,
+                                 ros::Publisher &publisher) {
+  indices->header = cloud.header;
+  publisher.publish(indices);
+}
+
 bool FloorFilter::IntersectWithSightline(
     const ros::Time &time, const Eigen::ParametrizedLine<float, 3> &line, const pcl::PointXYZ &point,
     pcl::PointXYZ *intersection_point) {
-  pcl::PointXYZ viewpoint_pcl;
-  if (!GetViewpointPoint(time, &viewpoint_pcl)) {
+  pcl::PointXYZ viewpoint;
+  if (!GetViewpointPoint(time, &viewpoint)) {
     return false;
   }
+  return IntersectWithSightline(viewpoint, line, point, intersection_point);
+}
+
+bool FloorFilter::IntersectWithSightline(
+    const pcl::PointXYZ &viewpoint_pcl, const Eigen::ParametrizedLine<float, 3> &line,
+    const pcl::PointXYZ &point, pcl::PointXYZ *intersection_point) {
   Eigen::ParametrizedLine<float, 3>::VectorType viewpoint = viewpoint_pcl.getVector3fMap();
   Eigen::ParametrizedLine<float, 3> viewpoint_line(viewpoint, point.getVector3fMap() - viewpoint);
   Eigen::ParametrizedLine<float, 3>::VectorType intersection;
@@ -322,58 +696,31 @@ bool FloorFilter::IntersectWithSightline(
 }
 
 bool FloorFilter::GetViewpointPoint(const ros::Time &time, pcl::PointXYZ *point) {
-  tf::Stamped<tf::Point> sensor_point(btVector3(0, 0, 0), time, sensor_frame_);
-  tf::Stamped<tf::Point> viewpoint;
-  if (!WaitForTransformToReferenceFrame(sensor_frame_, time)) {
-    ROS_WARN("Cannot get sensor transform (%s -> %s).",
-             reference_frame_.c_str(), sensor_frame_.c_str());
-    return false;
-  }
-  try {
-    tf_listener_.transformPoint(reference_frame_, sensor_point, viewpoint);
-  } catch (tf::TransformException e) {
+  tf::StampedTransform sensor_pose;
+  if (!sensor_pose_cache_->GetSensorPose(time, &sensor_pose)) {
     return false;
   }
+  const tf::Vector3 &viewpoint = sensor_pose.getOrigin();
   *point = pcl::PointXYZ(viewpoint.x(), viewpoint.y(), viewpoint.z());
   return true;
 }
 
-Eigen::ParametrizedLine<float, 3> FloorFilter::LineFromCoefficients(
-    const pcl::ModelCoefficients &line_coefficients) {
-  Eigen::ParametrizedLine<float, 3>::VectorType point_on_line(
-      line_coefficients.values[0], line_coefficients.values[1], line_coefficients.values[2]);
-  Eigen::ParametrizedLine<float, 3>::VectorType direction(
-      line_coefficients.values[3], line_coefficients.values[4], line_coefficients.values[5]);
-  return Eigen::ParametrizedLine<float, 3>(point_on_line, direction);
-}
-
 bool FloorFilter::GetSensorPlane(
     const ros::Time &time, Eigen::Hyperplane<float, 3> *sensor_plane) {
-  tf::Stamped<tf::Vector3> z_axis;
-  z_axis.stamp_ = time;
-  z_axis.frame_id_ = sensor_frame_;
-  z_axis.setX(0.0);
-  z_axis.setY(0.0);
-  z_axis.setZ(1.0);
-  tf::Stamped<tf::Vector3> z_axis_in_reference;
-  if (!WaitForTransformToReferenceFrame(sensor_frame_, time)) {
-    ROS_WARN("Cannot get sensor transform to calculate sensor plane (%s -> %s).",
-             reference_frame_.c_str(), sensor_frame_.c_str());
-    return false;
-  }
-  try {
-    tf_listener_.transformVector(reference_frame_, z_axis, z_axis_in_reference);
-  } catch (tf::TransformException e) {
+  tf::StampedTransform sensor_pose;
+  if (!sensor_pose_cache_->GetSensorPose(time, &sensor_pose)) {
     return false;
   }
+  // The sensor plane is spanned by the x and y axes of the sensor
+  // frame, i.e. its normal is the sensor's z axis.
+  tf::Vector3 z_axis_in_reference = sensor_pose.getBasis() * tf::Vector3(0.0, 0.0, 1.0);
   Eigen::Hyperplane<float, 3>::VectorType normal(
       z_axis_in_reference.x(),
       z_axis_in_reference.y(),
       z_axis_in_reference.z());
-  pcl::PointXYZ viewpoint;
-  if (!GetViewpointPoint(time, &viewpoint)) {
-    return false;
-  }
+  pcl::PointXYZ viewpoint(
+      sensor_pose.getOrigin().x(), sensor_pose.getOrigin().y(),
+      sensor_pose.getOrigin().z());
   // Eigen seems to have a bug. This prevents us from using the
   // constructor that takes a normal and a point on the
   // plane. Instead, we calculate the distance of the plane from the
@@ -383,17 +730,4 @@ bool FloorFilter::GetSensorPlane(
   return true;
 }
 
-void FloorFilter::GetIndicesDifference(size_t cloud_size, const std::vector<int> &indices,
-                                       std::vector<int> *difference) {
-  std::vector<int> all_indices(cloud_size);
-  for (size_t i = 0; i < all_indices.size(); i++) {
-    all_indices[i] = i;
-  }
-  std::vector<int> copied_indices(indices.begin(), indices.end());
-  std::sort(copied_indices.begin(), copied_indices.end());
-  std::set_difference(all_indices.begin(), all_indices.end(),
-                      copied_indices.begin(), copied_indices.end(),
-                      std::back_insert_iterator<std::vector<int> >(*difference));
-}
-
 }  // namespace parsec_perception
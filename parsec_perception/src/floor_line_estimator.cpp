@@ -0,0 +1,221 @@
+// Copyright 2011 Google Inc.
+// Author: moesenle@google.com (Lorenz Moesenlechner)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "parsec_perception/floor_line_estimator.h"
+
+#include <cmath>
+
+#include <algorithm>
+
+#include <Eigen/Eigenvalues>
+
+namespace parsec_perception {
+
+namespace {
+
+// Samples that violate the angular constraint or are degenerate are
+// rejected before scoring. This bounds the number of draws per
+// scored model so that we terminate on clouds without any valid
+// sample.
+const int kMaxSamplesPerIteration = 10;
+
+// The probability that at least one of the scored samples contains
+// only inliers, used to adapt the number of iterations.
+const double kSuccessProbability = 0.99;
+
+}  // namespace
+
+const int FloorLineEstimator::kDefaultMaxIterations = 100;
+const double FloorLineEstimator::kDefaultTargetInlierRatio = 0.9;
+const unsigned int FloorLineEstimator::kDefaultSeed = 42;
+
+FloorLineEstimator::FloorLineEstimator(
+    const Eigen::Vector3f &axis, double max_angle, double distance_threshold)
+    : axis_(axis.normalized()),
+      min_axis_cosine_(cos(max_angle)),
+      distance_threshold_(distance_threshold),
+      target_inlier_ratio_(kDefaultTargetInlierRatio),
+      max_iterations_(kDefaultMaxIterations),
+      seed_(kDefaultSeed),
+      iterations_(0) {
+}
+
+bool FloorLineEstimator::Estimate(
+    const pcl::PointCloud<pcl::PointXYZ> &cloud, const std::vector<int> &indices,
+    Eigen::ParametrizedLine<float, 3> *line, std::vector<int> *inlier_indices) {
+  iterations_ = 0;
+  inlier_indices->clear();
+  if (indices.size() < 2) {
+    return false;
+  }
+  points_.Assign(cloud, indices);
+  size_t number_of_points = points_.size();
+  generator_.seed(seed_);
+
+  size_t target_inliers = ceil(target_inlier_ratio_ * number_of_points);
+  size_t best_inliers = 0;
+  Eigen::Vector3f best_origin;
+  Eigen::Vector3f best_direction;
+  double required_iterations = max_iterations_;
+  int max_samples = max_iterations_ * kMaxSamplesPerIteration;
+  for (int samples = 0; samples < max_samples && iterations_ < required_iterations;
+       samples++) {
+    size_t first = generator_() % number_of_points;
+    size_t second = generator_() % (number_of_points - 1);
+    if (second >= first) {
+      second++;
+    }
+    Eigen::Vector3f origin(points_.x[first], points_.y[first], points_.z[first]);
+    Eigen::Vector3f direction =
+        Eigen::Vector3f(points_.x[second], points_.y[second], points_.z[second]) - origin;
+    float length = direction.norm();
+    if (length < 1e-6) {
+      continue;
+    }
+    direction /= length;
+    if (fabs(direction.dot(axis_)) < min_axis_cosine_) {
+      continue;
+    }
+    iterations_++;
+    size_t inliers = CountInliers(origin, direction, NULL);
+    if (inliers <= best_inliers) {
+      continue;
+    }
+    best_inliers = inliers;
+    best_origin = origin;
+    best_direction = direction;
+    if (best_inliers >= target_inliers) {
+      break;
+    }
+    double inlier_ratio = static_cast<double>(best_inliers) / number_of_points;
+    double sample_success = inlier_ratio * inlier_ratio;
+    required_iterations = std::min(
+        static_cast<double>(max_iterations_),
+        log(1.0 - kSuccessProbability) / log(1.0 - sample_success));
+  }
+  if (best_inliers < 2) {
+    return false;
+  }
+
+  RefineModel(best_origin, best_direction, indices, line, inlier_indices);
+  return true;
+}
+
+bool FloorLineEstimator::Verify(
+    const pcl::PointCloud<pcl::PointXYZ> &cloud, const std::vector<int> &indices,
+    const Eigen::ParametrizedLine<float, 3> &previous_line, double min_inlier_ratio,
+    Eigen::ParametrizedLine<float, 3> *line, std::vector<int> *inlier_indices) {
+  iterations_ = 0;
+  inlier_indices->clear();
+  if (indices.size() < 2) {
+    return false;
+  }
+  Eigen::Vector3f direction = previous_line.direction().normalized();
+  if (fabs(direction.dot(axis_)) < min_axis_cosine_) {
+    return false;
+  }
+  points_.Assign(cloud, indices);
+  size_t min_inliers = std::max(
+      static_cast<size_t>(2), static_cast<size_t>(ceil(min_inlier_ratio * points_.size())));
+  if (CountInliers(previous_line.origin(), direction, NULL) < min_inliers) {
+    return false;
+  }
+  RefineModel(previous_line.origin(), direction, indices, line, inlier_indices);
+  return true;
+}
+
+void FloorLineEstimator::RefineModel(
+    const Eigen::Vector3f &origin, const Eigen::Vector3f &direction,
+    const std::vector<int> &indices, Eigen::ParametrizedLine<float, 3> *line,
+    std::vector<int> *inlier_indices) {
+  // Like PCL's coefficient optimization, refine the model with all
+  // inliers and select the inliers of the refined model.
+  Eigen::Vector3f best_origin = origin;
+  Eigen::Vector3f best_direction = direction;
+  CountInliers(best_origin, best_direction, &inlier_mask_);
+  Eigen::Vector3f refined_origin;
+  Eigen::Vector3f refined_direction;
+  if (FitLine(inlier_mask_, &refined_origin, &refined_direction) &&
+      fabs(refined_direction.dot(axis_)) >= min_axis_cosine_ &&
+      CountInliers(refined_origin, refined_direction, NULL) >= 2) {
+    best_origin = refined_origin;
+    best_direction = refined_direction;
+    CountInliers(best_origin, best_direction, &inlier_mask_);
+  }
+  point_kernels::CompactMask(inlier_mask_, indices, inlier_indices);
+  *line = Eigen::ParametrizedLine<float, 3>(best_origin, best_direction);
+}
+
+size_t FloorLineEstimator::CountInliers(
+    const Eigen::Vector3f &origin, const Eigen::Vector3f &direction,
+    point_kernels::Mask *mask) const {
+  float squared_threshold = distance_threshold_ * distance_threshold_;
+  float origin_x = origin(0), origin_y = origin(1), origin_z = origin(2);
+  float direction_x = direction(0), direction_y = direction(1), direction_z = direction(2);
+  size_t number_of_points = points_.size();
+  if (mask) {
+    mask->resize(number_of_points);
+  }
+  size_t count = 0;
+  for (size_t i = 0; i < number_of_points; i++) {
+    // The distance of a point from the line is the length of the
+    // cross product of its offset and the unit direction.
+    float dx = points_.x[i] - origin_x;
+    float dy = points_.y[i] - origin_y;
+    float dz = points_.z[i] - origin_z;
+    float cx = dy * direction_z - dz * direction_y;
+    float cy = dz * direction_x - dx * direction_z;
+    float cz = dx * direction_y - dy * direction_x;
+    unsigned char inlier = cx * cx + cy * cy + cz * cz <= squared_threshold;
+    if (mask) {
+      (*mask)[i] = inlier;
+    }
+    count += inlier;
+  }
+  return count;
+}
+
+bool FloorLineEstimator::FitLine(
+    const point_kernels::Mask &mask, Eigen::Vector3f *origin,
+    Eigen::Vector3f *direction) const {
+  Eigen::Vector3d centroid = Eigen::Vector3d::Zero();
+  size_t count = 0;
+  for (size_t i = 0; i < mask.size(); i++) {
+    if (mask[i]) {
+      centroid += Eigen::Vector3d(points_.x[i], points_.y[i], points_.z[i]);
+      count++;
+    }
+  }
+  if (count < 2) {
+    return false;
+  }
+  centroid /= count;
+  Eigen::Matrix3d scatter = Eigen::Matrix3d::Zero();
+  for (size_t i = 0; i < mask.size(); i++) {
+    if (mask[i]) {
+      Eigen::Vector3d offset =
+          Eigen::Vector3d(points_.x[i], points_.y[i], points_.z[i]) - centroid;
+      scatter += offset * offset.transpose();
+    }
+  }
+  // The eigenvalues are sorted in increasing order, i.e. the last
+  // eigenvector is the direction of largest variance.
+  Eigen::SelfAdjointEigenSolver<Eigen::Matrix3d> solver(scatter);
+  *origin = centroid.cast<float>();
+  *direction = solver.eigenvectors().col(2).cast<float>().normalized();
+  return true;
+}
+
+}  // namespace parsec_perception
@@ -0,0 +1,255 @@
+// Copyright 2011 Google Inc.
+// Author: moesenle@google.com (Lorenz Moesenlechner)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "parsec_perception/point_kernels.h"
+
+#include <cmath>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace parsec_perception {
+
+namespace point_kernels {
+
+namespace {
+
+// Scalar versions of the predicates. They are used for the points
+// that don't fill a complete SSE register and if SSE2 is not
+// available. The SSE versions must produce exactly the same results.
+
+inline unsigned char IsFloorCandidate(
+    float x, float y, float z, double floor_z_distance, double max_slope) {
+  float squared_distance_xy = x * x + y * y;
+  double distance_xy = std::sqrt(static_cast<double>(squared_distance_xy));
+  return std::fabs(static_cast<double>(z)) < floor_z_distance + max_slope * distance_xy;
+}
+
+inline unsigned char IsOutsideCylinder(
+    float x, float y, float z, double radius, double minimal_z, double maximal_z) {
+  float distance_xy = std::sqrt(x * x + y * y);
+  return !(z <= maximal_z && z >= minimal_z && distance_xy <= radius);
+}
+
+inline unsigned char IsZDistant(float z, double reference_z, double min_distance) {
+  return std::fabs(z - reference_z) > min_distance;
+}
+
+#if defined(__SSE2__)
+
+inline void StoreMask(int bits, unsigned char *mask) {
+  mask[0] = bits & 1;
+  mask[1] = (bits >> 1) & 1;
+  mask[2] = (bits >> 2) & 1;
+  mask[3] = (bits >> 3) & 1;
+}
+
+inline __m128d LowToDouble(__m128 values) {
+  return _mm_cvtps_pd(values);
+}
+
+inline __m128d HighToDouble(__m128 values) {
+  return _mm_cvtps_pd(_mm_movehl_ps(values, values));
+}
+
+inline __m128d AbsDouble(__m128d values) {
+  return _mm_andnot_pd(_mm_set1_pd(-0.0), values);
+}
+
+#endif  // defined(__SSE2__)
+
+}  // namespace
+
+void PointBuffer::Assign(const pcl::PointCloud<pcl::PointXYZ> &cloud) {
+  size_t n = cloud.points.size();
+  x.resize(n);
+  y.resize(n);
+  z.resize(n);
+  for (size_t i = 0; i < n; i++) {
+    x[i] = cloud.points[i].x;
+    y[i] = cloud.points[i].y;
+    z[i] = cloud.points[i].z;
+  }
+}
+
+void PointBuffer::Assign(const pcl::PointCloud<pcl::PointXYZ> &cloud,
+                         const std::vector<int> &indices) {
+  size_t n = indices.size();
+  x.resize(n);
+  y.resize(n);
+  z.resize(n);
+  for (size_t i = 0; i < n; i++) {
+    const pcl::PointXYZ &point = cloud.points[indices[i]];
+    x[i] = point.x;
+    y[i] = point.y;
+    z[i] = point.z;
+  }
+}
+
+void FloorCandidateMask(const PointBuffer &points, double floor_z_distance,
+                        double max_slope, Mask *mask) {
+  size_t n = points.size();
+  mask->resize(n);
+  size_t i = 0;
+#if defined(__SSE2__)
+  __m128d distance = _mm_set1_pd(floor_z_distance);
+  __m128d slope = _mm_set1_pd(max_slope);
+  for (; i + 4 <= n; i += 4) {
+    __m128 x = _mm_loadu_ps(&points.x[i]);
+    __m128 y = _mm_loadu_ps(&points.y[i]);
+    __m128 z = _mm_loadu_ps(&points.z[i]);
+    __m128 squared_distance_xy = _mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y));
+    __m128d threshold_low = _mm_add_pd(
+        distance, _mm_mul_pd(slope, _mm_sqrt_pd(LowToDouble(squared_distance_xy))));
+    __m128d threshold_high = _mm_add_pd(
+        distance, _mm_mul_pd(slope, _mm_sqrt_pd(HighToDouble(squared_distance_xy))));
+    int bits =
+        _mm_movemask_pd(_mm_cmplt_pd(AbsDouble(LowToDouble(z)), threshold_low)) |
+        _mm_movemask_pd(_mm_cmplt_pd(AbsDouble(HighToDouble(z)), threshold_high)) << 2;
+    StoreMask(bits, &(*mask)[i]);
+  }
+#endif
+  for (; i < n; i++) {
+    (*mask)[i] = IsFloorCandidate(
+        points.x[i], points.y[i], points.z[i], floor_z_distance, max_slope);
+  }
+}
+
+void OutsideCylinderMask(const PointBuffer &points, double radius,
+                         double minimal_z, double maximal_z, Mask *mask) {
+  size_t n = points.size();
+  mask->resize(n);
+  size_t i = 0;
+#if defined(__SSE2__)
+  __m128d radius_sse = _mm_set1_pd(radius);
+  __m128d minimal_z_sse = _mm_set1_pd(minimal_z);
+  __m128d maximal_z_sse = _mm_set1_pd(maximal_z);
+  for (; i + 4 <= n; i += 4) {
+    __m128 x = _mm_loadu_ps(&points.x[i]);
+    __m128 y = _mm_loadu_ps(&points.y[i]);
+    __m128 z = _mm_loadu_ps(&points.z[i]);
+    __m128 distance_xy = _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)));
+    __m128d z_low = LowToDouble(z);
+    __m128d z_high = HighToDouble(z);
+    __m128d inside_low = _mm_and_pd(
+        _mm_and_pd(_mm_cmple_pd(z_low, maximal_z_sse), _mm_cmpge_pd(z_low, minimal_z_sse)),
+        _mm_cmple_pd(LowToDouble(distance_xy), radius_sse));
+    __m128d inside_high = _mm_and_pd(
+        _mm_and_pd(_mm_cmple_pd(z_high, maximal_z_sse), _mm_cmpge_pd(z_high, minimal_z_sse)),
+        _mm_cmple_pd(HighToDouble(distance_xy), radius_sse));
+    int bits = _mm_movemask_pd(inside_low) | _mm_movemask_pd(inside_high) << 2;
+    StoreMask(~bits, &(*mask)[i]);
+  }
+#endif
+  for (; i < n; i++) {
+    (*mask)[i] = IsOutsideCylinder(
+        points.x[i], points.y[i], points.z[i], radius, minimal_z, maximal_z);
+  }
+}
+
+void ZDistanceMask(const PointBuffer &points, double reference_z,
+                   double min_distance, Mask *mask) {
+  size_t n = points.size();
+  mask->resize(n);
+  size_t i = 0;
+#if defined(__SSE2__)
+  __m128d reference_z_sse = _mm_set1_pd(reference_z);
+  __m128d min_distance_sse = _mm_set1_pd(min_distance);
+  for (; i + 4 <= n; i += 4) {
+    __m128 z = _mm_loadu_ps(&points.z[i]);
+    __m128d distance_low = AbsDouble(_mm_sub_pd(LowToDouble(z), reference_z_sse));
+    __m128d distance_high = AbsDouble(_mm_sub_pd(HighToDouble(z), reference_z_sse));
+    int bits =
+        _mm_movemask_pd(_mm_cmpgt_pd(distance_low, min_distance_sse)) |
+        _mm_movemask_pd(_mm_cmpgt_pd(distance_high, min_distance_sse)) << 2;
+    StoreMask(bits, &(*mask)[i]);
+  }
+#endif
+  for (; i < n; i++) {
+    (*mask)[i] = IsZDistant(points.z[i], reference_z, min_distance);
+  }
+}
+
+size_t CompactMask(const Mask &mask, std::vector<int> *indices) {
+  size_t offset = indices->size();
+  // Write every index and only advance the output position for
+  // marked entries. This avoids a hard to predict branch per point.
+  indices->resize(offset + mask.size());
+  size_t count = 0;
+  for (size_t i = 0; i < mask.size(); i++) {
+    (*indices)[offset + count] = i;
+    count += mask[i];
+  }
+  indices->resize(offset + count);
+  return count;
+}
+
+size_t CompactMask(const Mask &mask, const std::vector<int> &input_indices,
+                   std::vector<int> *indices) {
+  size_t offset = indices->size();
+  indices->resize(offset + mask.size());
+  size_t count = 0;
+  for (size_t i = 0; i < mask.size(); i++) {
+    (*indices)[offset + count] = input_indices[i];
+    count += mask[i];
+  }
+  indices->resize(offset + count);
+  return count;
+}
+
+void LabelIndices(size_t size, const std::vector<int> &indices,
+                  unsigned char label, Mask *labels) {
+  labels->assign(size, kNonFloorPoint);
+  for (size_t i = 0; i < indices.size(); i++) {
+    (*labels)[indices[i]] = label;
+  }
+}
+
+void PartitionLabels(const Mask &labels, std::vector<int> *floor_indices,
+                     std::vector<int> *non_floor_indices,
+                     std::vector<int> *cliff_indices) {
+  size_t size = labels.size();
+  floor_indices->resize(size);
+  non_floor_indices->resize(size);
+  cliff_indices->resize(size);
+  if (size == 0) {
+    return;
+  }
+  // Like in CompactMask, write every index to all outputs and only
+  // advance the positions that match the label.
+  int *floor = &(*floor_indices)[0];
+  int *non_floor = &(*non_floor_indices)[0];
+  int *cliff = &(*cliff_indices)[0];
+  size_t floor_count = 0;
+  size_t non_floor_count = 0;
+  size_t cliff_count = 0;
+  for (size_t i = 0; i < size; i++) {
+    unsigned char label = labels[i];
+    floor[floor_count] = i;
+    non_floor[non_floor_count] = i;
+    cliff[cliff_count] = i;
+    floor_count += label == kFloorPoint;
+    non_floor_count += label != kFloorPoint;
+    cliff_count += label == kCliffPoint;
+  }
+  floor_indices->resize(floor_count);
+  non_floor_indices->resize(non_floor_count);
+  cliff_indices->resize(cliff_count);
+}
+
+}  // namespace point_kernels
+
+}  // namespace parsec_perception
@@ -0,0 +1,69 @@
+// Copyright 2011 Google Inc.
+// Author: moesenle@google.com (Lorenz Moesenlechner)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "parsec_perception/sensor_pose_cache.h"
+
+#include <algorithm>
+
+namespace parsec_perception {
+
+SensorPoseCache::SensorPoseCache(
+    tf::TransformListener &tf_listener, const std::string &reference_frame,
+    const std::string &sensor_frame, const ros::Duration &timeout, size_t capacity)
+    : tf_listener_(tf_listener),
+      reference_frame_(reference_frame),
+      sensor_frame_(sensor_frame),
+      timeout_(timeout),
+      capacity_(std::max(capacity, static_cast<size_t>(1))),
+      lookups_(0),
+      lookups_avoided_(0) {
+}
+
+bool SensorPoseCache::GetSensorPose(
+    const ros::Time &time, tf::StampedTransform *sensor_pose) {
+  {
+    boost::mutex::scoped_lock lock(mutex_);
+    for (std::deque<CacheEntry>::const_reverse_iterator it = entries_.rbegin();
+         it != entries_.rend(); ++it) {
+      if (it->first == time) {
+        lookups_avoided_++;
+        *sensor_pose = it->second;
+        return true;
+      }
+    }
+    lookups_++;
+  }
+  // Don't hold the lock while waiting for TF. Other threads might
+  // request stamps that are already available.
+  if (!tf_listener_.waitForTransform(
+          reference_frame_, sensor_frame_, time, timeout_)) {
+    ROS_WARN("Cannot get sensor transform (%s -> %s).",
+             reference_frame_.c_str(), sensor_frame_.c_str());
+    return false;
+  }
+  try {
+    tf_listener_.lookupTransform(reference_frame_, sensor_frame_, time, *sensor_pose);
+  } catch (tf::TransformException e) {
+    return false;
+  }
+  boost::mutex::scoped_lock lock(mutex_);
+  entries_.push_back(CacheEntry(time, *sensor_pose));
+  if (entries_.size() > capacity_) {
+    entries_.pop_front();
+  }
+  return true;
+}
+
+}  // namespace parsec_perception
@@ -61,19 +61,6 @@ class FloorFilterTest : public testing::Test {
   }
 };
 
-TEST_F(FloorFilterTest, IndicesDifference) {
-  std::vector<int> indices;
-  indices.push_back(0);
-  indices.push_back(2);
-  indices.push_back(4);
-  std::vector<int> indices_difference;
-  floor_filter_->GetIndicesDifference(6, indices, &indices_difference);
-  EXPECT_EQ(indices_difference.size(), 3);
-  EXPECT_EQ(indices_difference[0], 1);
-  EXPECT_EQ(indices_difference[1], 3);
-  EXPECT_EQ(indices_difference[2], 5);
-}
-
 TEST_F(FloorFilterTest, FilterFloorCandidates) {
   pcl::PointCloud<pcl::PointXYZ> cloud;
   cloud.width = 4;
@@ -208,6 +195,48 @@ TEST_F(FloorFilterTest, GenerateCliffCloud) {
   EXPECT_DOUBLE_EQ(cliff_cloud[1].z, 0.0);
 }
 
+TEST_F(FloorFilterTest, PartitionCloud) {
+  Eigen::ParametrizedLine<float, 3> floor_line(
+      Eigen::Vector3f(1, 0, 0), Eigen::Vector3f(0, 1, 0));
+  pcl::PointCloud<pcl::PointXYZ> input_cloud;
+  input_cloud.header.stamp = sensor_transform_stamp_;
+  input_cloud.width = 5;
+  input_cloud.height = 1;
+  input_cloud.points.push_back(pcl::PointXYZ(1, 0, 0));
+  input_cloud.points.push_back(pcl::PointXYZ(0.5, 0, 0.5));
+  input_cloud.points.push_back(pcl::PointXYZ(2, 2, -1));
+  input_cloud.points.push_back(pcl::PointXYZ(1, 1, 0));
+  input_cloud.points.push_back(pcl::PointXYZ(2, -2, -1));
+  std::vector<int> floor_line_inliers;
+  floor_line_inliers.push_back(3);
+  floor_line_inliers.push_back(0);
+  std::vector<int> floor_indices;
+  std::vector<int> non_floor_indices;
+  std::vector<int> cliff_indices;
+  pcl::PointCloud<pcl::PointXYZ> cliff_cloud;
+  EXPECT_TRUE(
+      floor_filter_->PartitionCloud(
+          floor_line, input_cloud, floor_line_inliers, &floor_indices,
+          &non_floor_indices, &cliff_indices, &cliff_cloud));
+  ASSERT_EQ(floor_indices.size(), 2);
+  EXPECT_EQ(floor_indices[0], 0);
+  EXPECT_EQ(floor_indices[1], 3);
+  ASSERT_EQ(non_floor_indices.size(), 3);
+  EXPECT_EQ(non_floor_indices[0], 1);
+  EXPECT_EQ(non_floor_indices[1], 2);
+  EXPECT_EQ(non_floor_indices[2], 4);
+  ASSERT_EQ(cliff_indices.size(), 2);
+  EXPECT_EQ(cliff_indices[0], 2);
+  EXPECT_EQ(cliff_indices[1], 4);
+  ASSERT_EQ(cliff_cloud.points.size(), 2);
+  EXPECT_DOUBLE_EQ(cliff_cloud[0].x, 1.0);
+  EXPECT_DOUBLE_EQ(cliff_cloud[0].y, 1.0);
+  EXPECT_DOUBLE_EQ(cliff_cloud[0].z, 0.0);
+  EXPECT_DOUBLE_EQ(cliff_cloud[1].x, 1.0);
+  EXPECT_DOUBLE_EQ(cliff_cloud[1].y, -1.0);
+  EXPECT_DOUBLE_EQ(cliff_cloud[1].z, 0.0);
+}
+
 int main(int argc, char *argv[]) {
   ros::init(argc, argv, "floor_filter_test");
   testing::InitGoogleTest(&argc, argv);
@@ -0,0 +1,113 @@
+// Copyright 2011 Google Inc.
+// Author: moesenle@google.com (Lorenz Moesenlechner)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Compares the latency of the floor line estimator with the generic
+// PCL RANSAC segmentation that FloorFilter::FindLine used before. The
+// clouds use the geometry of the floor filter test: a laser at 1m
+// height pitched down by 45 degrees that sees the floor in the line
+// x = 1 and a few obstacles in front of it. Usage:
+// floor_line_benchmark [points]
+
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include <Eigen/Geometry>
+#include <pcl/ModelCoefficients.h>
+#include <pcl/point_types.h>
+#include <pcl/sample_consensus/method_types.h>
+#include <pcl/sample_consensus/model_types.h>
+#include <pcl/segmentation/sac_segmentation.h>
+#include <ros/time.h>
+
+#include "parsec_perception/floor_line_estimator.h"
+
+static const int kIterations = 200;
+static const double kLineDistanceThreshold = 0.03;
+static const double kMaxFloorXRotation = 0.087;
+
+static float Noise() {
+  return 0.01 * rand() / RAND_MAX - 0.005;
+}
+
+static void GenerateCloud(size_t number_of_points, pcl::PointCloud<pcl::PointXYZ> *cloud) {
+  // Three quarters of the points are on the floor, the rest are
+  // obstacles in the sensor plane x + z = 1.
+  for (size_t i = 0; i < number_of_points; i++) {
+    if (i % 4 != 3) {
+      cloud->points.push_back(pcl::PointXYZ(
+          1.0 + Noise(), -2.0 + 4.0 * i / number_of_points, Noise()));
+    } else {
+      float x = 0.8 * rand() / RAND_MAX;
+      cloud->points.push_back(pcl::PointXYZ(
+          x, -2.0 + 4.0 * i / number_of_points, 1.0 - x));
+    }
+  }
+  cloud->width = cloud->points.size();
+  cloud->height = 1;
+}
+
+static void Report(const char *name, const ros::WallDuration &duration, size_t inliers) {
+  printf("%-24s %10.1f us/cloud %8zu inliers\n", name,
+         duration.toSec() / kIterations * 1e6, inliers);
+}
+
+int main(int argc, char *argv[]) {
+  size_t number_of_points = argc > 1 ? atoi(argv[1]) : 1000;
+  pcl::PointCloud<pcl::PointXYZ>::Ptr cloud(new pcl::PointCloud<pcl::PointXYZ>);
+  GenerateCloud(number_of_points, cloud.get());
+  std::vector<int> indices(cloud->points.size());
+  for (size_t i = 0; i < indices.size(); i++) {
+    indices[i] = i;
+  }
+
+  // The old FloorFilter::FindLine, including the per-cloud setup.
+  size_t pcl_inliers = 0;
+  ros::WallTime start = ros::WallTime::now();
+  for (int i = 0; i < kIterations; i++) {
+    pcl::SACSegmentation<pcl::PointXYZ> ransac_line_finder;
+    ransac_line_finder.setOptimizeCoefficients(true);
+    ransac_line_finder.setModelType(pcl::SACMODEL_LINE);
+    ransac_line_finder.setMethodType(pcl::SAC_RANSAC);
+    ransac_line_finder.setDistanceThreshold(kLineDistanceThreshold);
+    ransac_line_finder.setAxis(Eigen::Vector3f(0, 1, 0));
+    ransac_line_finder.setEpsAngle(kMaxFloorXRotation);
+    ransac_line_finder.setMaxIterations(100);
+    ransac_line_finder.setInputCloud(cloud);
+    pcl::PointIndicesPtr point_input_indices(new pcl::PointIndices);
+    point_input_indices->indices = indices;
+    ransac_line_finder.setIndices(point_input_indices);
+    pcl::PointIndices point_inlier_indices;
+    pcl::ModelCoefficients line_coefficients;
+    ransac_line_finder.segment(point_inlier_indices, line_coefficients);
+    pcl_inliers = point_inlier_indices.indices.size();
+  }
+  ros::WallDuration pcl_duration = ros::WallTime::now() - start;
+  Report("pcl::SACSegmentation", pcl_duration, pcl_inliers);
+
+  parsec_perception::FloorLineEstimator estimator(
+      Eigen::Vector3f(0, 1, 0), kMaxFloorXRotation, kLineDistanceThreshold);
+  Eigen::ParametrizedLine<float, 3> line;
+  std::vector<int> inlier_indices;
+  start = ros::WallTime::now();
+  for (int i = 0; i < kIterations; i++) {
+    estimator.Estimate(*cloud, indices, &line, &inlier_indices);
+  }
+  ros::WallDuration estimator_duration = ros::WallTime::now() - start;
+  Report("FloorLineEstimator", estimator_duration, inlier_indices.size());
+
+  printf("speedup: %.1fx\n", pcl_duration.toSec() / estimator_duration.toSec());
+  return 0;
+}
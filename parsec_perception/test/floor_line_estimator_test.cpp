@@ -0,0 +1,155 @@
+// Copyright 2011 Google Inc.
+// Author: moesenle@google.com (Lorenz Moesenlechner)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "parsec_perception/floor_line_estimator.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <vector>
+
+#include <Eigen/Geometry>
+
+#include "parsec_perception/geometry.h"
+
+class FloorLineEstimatorTest : public testing::Test {
+ public:
+  FloorLineEstimatorTest()
+      : estimator_(Eigen::Vector3f(0, 1, 0), 0.087, 0.03) {}
+
+ protected:
+  static const int kNumberOfFloorPoints = 200;
+  static const int kNumberOfObstaclePoints = 50;
+
+  parsec_perception::FloorLineEstimator estimator_;
+  pcl::PointCloud<pcl::PointXYZ> cloud_;
+  std::vector<int> indices_;
+
+  virtual void SetUp() {
+    // The same geometry as in the floor filter test: the sensor
+    // plane has an angle of 45 degrees to the floor and intersects
+    // it in the line x = 1. Obstacles are in the sensor plane.
+    srand(42);
+    for (int i = 0; i < kNumberOfFloorPoints; i++) {
+      cloud_.points.push_back(pcl::PointXYZ(
+          1.0 + Noise(), -1.0 + 2.0 * i / kNumberOfFloorPoints, Noise()));
+    }
+    for (int i = 0; i < kNumberOfObstaclePoints; i++) {
+      float x = 0.5 * rand() / RAND_MAX + 0.2;
+      cloud_.points.push_back(pcl::PointXYZ(
+          x, 2.0 * rand() / RAND_MAX - 1.0, 1.0 - x));
+    }
+    cloud_.width = cloud_.points.size();
+    cloud_.height = 1;
+    for (size_t i = 0; i < cloud_.points.size(); i++) {
+      indices_.push_back(i);
+    }
+  }
+
+  float Noise() {
+    return 0.01 * rand() / RAND_MAX - 0.005;
+  }
+};
+
+const int FloorLineEstimatorTest::kNumberOfFloorPoints;
+const int FloorLineEstimatorTest::kNumberOfObstaclePoints;
+
+TEST_F(FloorLineEstimatorTest, FindsFloorLine) {
+  Eigen::ParametrizedLine<float, 3> line;
+  std::vector<int> inlier_indices;
+  EXPECT_TRUE(estimator_.Estimate(cloud_, indices_, &line, &inlier_indices));
+  EXPECT_TRUE(parsec_perception::geometry::VectorsParallel(
+      line.direction(), Eigen::Vector3f(0, 1, 0), 0.01));
+  EXPECT_NEAR(line.origin()(0), 1.0, 0.01);
+  EXPECT_NEAR(line.origin()(2), 0.0, 0.01);
+  EXPECT_GE(inlier_indices.size(), kNumberOfFloorPoints);
+  for (int i = 0; i < kNumberOfFloorPoints; i++) {
+    EXPECT_TRUE(std::find(inlier_indices.begin(), inlier_indices.end(), i) !=
+                inlier_indices.end());
+  }
+}
+
+TEST_F(FloorLineEstimatorTest, Deterministic) {
+  Eigen::ParametrizedLine<float, 3> line_1;
+  std::vector<int> inlier_indices_1;
+  EXPECT_TRUE(estimator_.Estimate(cloud_, indices_, &line_1, &inlier_indices_1));
+  Eigen::ParametrizedLine<float, 3> line_2;
+  std::vector<int> inlier_indices_2;
+  EXPECT_TRUE(estimator_.Estimate(cloud_, indices_, &line_2, &inlier_indices_2));
+  EXPECT_TRUE(inlier_indices_1 == inlier_indices_2);
+  EXPECT_EQ(line_1.origin(), line_2.origin());
+  EXPECT_EQ(line_1.direction(), line_2.direction());
+}
+
+TEST_F(FloorLineEstimatorTest, RespectsInputIndices) {
+  std::vector<int> odd_indices;
+  for (size_t i = 1; i < indices_.size(); i += 2) {
+    odd_indices.push_back(i);
+  }
+  Eigen::ParametrizedLine<float, 3> line;
+  std::vector<int> inlier_indices;
+  EXPECT_TRUE(estimator_.Estimate(cloud_, odd_indices, &line, &inlier_indices));
+  EXPECT_GE(inlier_indices.size(), kNumberOfFloorPoints / 2);
+  for (size_t i = 0; i < inlier_indices.size(); i++) {
+    EXPECT_EQ(inlier_indices[i] % 2, 1);
+  }
+}
+
+TEST_F(FloorLineEstimatorTest, RejectsLinesOutsideAngle) {
+  pcl::PointCloud<pcl::PointXYZ> diagonal_cloud;
+  std::vector<int> indices;
+  for (int i = 0; i < 100; i++) {
+    diagonal_cloud.points.push_back(pcl::PointXYZ(0.01 * i, 0.01 * i, 0.0));
+    indices.push_back(i);
+  }
+  Eigen::ParametrizedLine<float, 3> line;
+  std::vector<int> inlier_indices;
+  EXPECT_FALSE(estimator_.Estimate(diagonal_cloud, indices, &line, &inlier_indices));
+  EXPECT_TRUE(inlier_indices.empty());
+}
+
+TEST_F(FloorLineEstimatorTest, TooFewPoints) {
+  std::vector<int> indices(1, 0);
+  Eigen::ParametrizedLine<float, 3> line;
+  std::vector<int> inlier_indices;
+  EXPECT_FALSE(estimator_.Estimate(cloud_, indices, &line, &inlier_indices));
+}
+
+TEST_F(FloorLineEstimatorTest, VerifiesPreviousLine) {
+  Eigen::ParametrizedLine<float, 3> previous_line(
+      Eigen::Vector3f(1.0, 0.0, 0.0), Eigen::Vector3f(0.01, 1.0, 0.0).normalized());
+  Eigen::ParametrizedLine<float, 3> line;
+  std::vector<int> inlier_indices;
+  EXPECT_TRUE(estimator_.Verify(cloud_, indices_, previous_line, 0.7, &line, &inlier_indices));
+  EXPECT_TRUE(parsec_perception::geometry::VectorsParallel(
+      line.direction(), Eigen::Vector3f(0, 1, 0), 0.01));
+  EXPECT_GE(inlier_indices.size(), kNumberOfFloorPoints);
+  EXPECT_EQ(estimator_.iterations(), 0);
+}
+
+TEST_F(FloorLineEstimatorTest, RejectsMovedLine) {
+  Eigen::ParametrizedLine<float, 3> previous_line(
+      Eigen::Vector3f(1.2, 0.0, 0.0), Eigen::Vector3f(0.0, 1.0, 0.0));
+  Eigen::ParametrizedLine<float, 3> line;
+  std::vector<int> inlier_indices;
+  EXPECT_FALSE(estimator_.Verify(cloud_, indices_, previous_line, 0.7, &line, &inlier_indices));
+  EXPECT_TRUE(inlier_indices.empty());
+}
+
+int main(int argc, char *argv[]) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
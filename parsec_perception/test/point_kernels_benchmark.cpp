@@ -0,0 +1,112 @@
+// Copyright 2011 Google Inc.
+// Author: moesenle@google.com (Lorenz Moesenlechner)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Measures the throughput of the point kernels against the scalar
+// loops they replaced. Like in the filters, the structure-of-arrays
+// buffer and the mask are reused between clouds. Usage:
+// point_kernels_benchmark [points]
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include <pcl/point_types.h>
+#include <ros/time.h>
+
+#include "parsec_perception/point_kernels.h"
+
+namespace point_kernels = parsec_perception::point_kernels;
+
+static const int kIterations = 100;
+
+static void ScalarFloorCandidates(
+    double floor_z_distance, double max_slope, const pcl::PointCloud<pcl::PointXYZ> &cloud,
+    std::vector<int> *indices) {
+  for (size_t i = 0; i < cloud.points.size(); i++) {
+    double point_distance_xy = sqrt(cloud.points[i].x * cloud.points[i].x + cloud.points[i].y * cloud.points[i].y);
+    if (fabs(cloud.points[i].z) < floor_z_distance + max_slope * point_distance_xy) {
+      indices->push_back(i);
+    }
+  }
+}
+
+static void ScalarOutsideCylinder(
+    double radius, double minimal_z_value, double maximal_z_value,
+    const pcl::PointCloud<pcl::PointXYZ> &cloud, std::vector<int> *indices) {
+  for (size_t i = 0; i < cloud.points.size(); i++) {
+    pcl::PointXYZ point = cloud.points[i];
+    pcl::PointXYZ origin_xy(0, 0, cloud.points[i].z);
+    if (point.z <= maximal_z_value && point.z >= minimal_z_value &&
+        pcl::euclideanDistance(point, origin_xy) <= radius) {
+      continue;
+    }
+    indices->push_back(i);
+  }
+}
+
+static void Report(const char *name, size_t points, const ros::WallDuration &duration) {
+  printf("%-28s %10.2f Mpoints/s\n", name,
+         points * kIterations / duration.toSec() / 1e6);
+}
+
+int main(int argc, char *argv[]) {
+  size_t number_of_points = argc > 1 ? atoi(argv[1]) : 100000;
+  pcl::PointCloud<pcl::PointXYZ> cloud;
+  for (size_t i = 0; i < number_of_points; i++) {
+    cloud.points.push_back(pcl::PointXYZ(
+        10.0 * rand() / RAND_MAX - 5.0, 10.0 * rand() / RAND_MAX - 5.0,
+        1.0 * rand() / RAND_MAX - 0.5));
+  }
+  cloud.width = cloud.points.size();
+  cloud.height = 1;
+
+  point_kernels::PointBuffer points;
+  point_kernels::Mask mask;
+
+  ros::WallTime start = ros::WallTime::now();
+  for (int i = 0; i < kIterations; i++) {
+    std::vector<int> indices;
+    ScalarFloorCandidates(0.05, 0.035, cloud, &indices);
+  }
+  Report("floor candidates (scalar)", number_of_points, ros::WallTime::now() - start);
+
+  start = ros::WallTime::now();
+  for (int i = 0; i < kIterations; i++) {
+    points.Assign(cloud);
+    point_kernels::FloorCandidateMask(points, 0.05, 0.035, &mask);
+    std::vector<int> indices;
+    point_kernels::CompactMask(mask, &indices);
+  }
+  Report("floor candidates (kernel)", number_of_points, ros::WallTime::now() - start);
+
+  start = ros::WallTime::now();
+  for (int i = 0; i < kIterations; i++) {
+    std::vector<int> indices;
+    ScalarOutsideCylinder(0.25, 0.0, 1.0, cloud, &indices);
+  }
+  Report("self filter (scalar)", number_of_points, ros::WallTime::now() - start);
+
+  start = ros::WallTime::now();
+  for (int i = 0; i < kIterations; i++) {
+    points.Assign(cloud);
+    point_kernels::OutsideCylinderMask(points, 0.25, 0.0, 1.0, &mask);
+    std::vector<int> indices;
+    point_kernels::CompactMask(mask, &indices);
+  }
+  Report("self filter (kernel)", number_of_points, ros::WallTime::now() - start);
+
+  return 0;
+}
@@ -0,0 +1,211 @@
+// Copyright 2011 Google Inc.
+// Author: moesenle@google.com (Lorenz Moesenlechner)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "parsec_perception/point_kernels.h"
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+#include <vector>
+
+#include <pcl/point_types.h>
+
+using parsec_perception::point_kernels::CompactMask;
+using parsec_perception::point_kernels::FloorCandidateMask;
+using parsec_perception::point_kernels::LabelIndices;
+using parsec_perception::point_kernels::Mask;
+using parsec_perception::point_kernels::OutsideCylinderMask;
+using parsec_perception::point_kernels::PartitionLabels;
+using parsec_perception::point_kernels::PointBuffer;
+using parsec_perception::point_kernels::ZDistanceMask;
+using parsec_perception::point_kernels::kCliffPoint;
+using parsec_perception::point_kernels::kFloorPoint;
+
+class PointKernelsTest : public testing::Test {
+ protected:
+  static const size_t kNumberOfPoints = 10007;
+
+  pcl::PointCloud<pcl::PointXYZ> cloud_;
+
+  virtual void SetUp() {
+    srand(42);
+    for (size_t i = 0; i < kNumberOfPoints; i++) {
+      cloud_.points.push_back(
+          pcl::PointXYZ(RandomCoordinate(5.0), RandomCoordinate(5.0),
+                        RandomCoordinate(0.5)));
+    }
+    // Points exactly on the decision boundaries and invalid points.
+    cloud_.points.push_back(pcl::PointXYZ(0.0, 0.0, 0.0));
+    cloud_.points.push_back(pcl::PointXYZ(1.0, 0.0, 0.1));
+    cloud_.points.push_back(pcl::PointXYZ(0.0, 0.25, 0.0));
+    cloud_.points.push_back(pcl::PointXYZ(
+        0.0, 0.0, std::numeric_limits<float>::quiet_NaN()));
+    cloud_.points.push_back(pcl::PointXYZ(
+        std::numeric_limits<float>::infinity(), 0.0, 0.0));
+    cloud_.width = cloud_.points.size();
+    cloud_.height = 1;
+  }
+
+  float RandomCoordinate(double range) {
+    return (static_cast<double>(rand()) / RAND_MAX - 0.5) * 2 * range;
+  }
+};
+
+// Reference implementation: the original loop of
+// FloorFilter::FilterFloorCandidates.
+static void ScalarFloorCandidates(
+    double floor_z_distance, double max_slope, pcl::PointCloud<pcl::PointXYZ> &cloud,
+    std::vector<int> *indices) {
+  for (size_t i = 0; i < cloud.points.size(); i++) {
+    double point_distance_xy = sqrt(cloud.points[i].x * cloud.points[i].x + cloud.points[i].y * cloud.points[i].y);
+    if (fabs(cloud.points[i].z) < floor_z_distance + max_slope * point_distance_xy) {
+      indices->push_back(i);
+    }
+  }
+}
+
+// Reference implementation: the original loop of
+// CircularRobotSelfFilter::CloudCallback.
+static void ScalarOutsideCylinder(
+    double radius, double minimal_z_value, double maximal_z_value,
+    const pcl::PointCloud<pcl::PointXYZ> &cloud, std::vector<int> *indices) {
+  for (size_t i = 0; i < cloud.points.size(); i++) {
+    pcl::PointXYZ point = cloud.points[i];
+    pcl::PointXYZ origin_xy(0, 0, cloud.points[i].z);
+    if (point.z <= maximal_z_value && point.z >= minimal_z_value &&
+        pcl::euclideanDistance(point, origin_xy) <= radius) {
+      continue;
+    }
+    indices->push_back(i);
+  }
+}
+
+TEST_F(PointKernelsTest, FloorCandidateMask) {
+  PointBuffer points;
+  points.Assign(cloud_);
+  Mask mask;
+  for (double slope = 0.0; slope < 0.2; slope += 0.05) {
+    std::vector<int> expected;
+    ScalarFloorCandidates(0.1, slope, cloud_, &expected);
+    FloorCandidateMask(points, 0.1, slope, &mask);
+    std::vector<int> indices;
+    EXPECT_EQ(CompactMask(mask, &indices), expected.size());
+    EXPECT_TRUE(indices == expected);
+  }
+}
+
+TEST_F(PointKernelsTest, OutsideCylinderMask) {
+  PointBuffer points;
+  points.Assign(cloud_);
+  Mask mask;
+  std::vector<int> expected;
+  ScalarOutsideCylinder(0.25, 0.0, 0.3, cloud_, &expected);
+  OutsideCylinderMask(points, 0.25, 0.0, 0.3, &mask);
+  std::vector<int> indices;
+  EXPECT_EQ(CompactMask(mask, &indices), expected.size());
+  EXPECT_TRUE(indices == expected);
+}
+
+TEST_F(PointKernelsTest, ZDistanceMask) {
+  PointBuffer points;
+  points.Assign(cloud_);
+  Mask mask;
+  ZDistanceMask(points, 0.1, 0.2, &mask);
+  ASSERT_EQ(mask.size(), cloud_.points.size());
+  for (size_t i = 0; i < cloud_.points.size(); i++) {
+    EXPECT_EQ(mask[i], fabs(cloud_.points[i].z - 0.1) > 0.2);
+  }
+}
+
+TEST_F(PointKernelsTest, CompactMaskWithIndices) {
+  std::vector<int> input_indices;
+  for (size_t i = 0; i < cloud_.points.size(); i += 3) {
+    input_indices.push_back(i);
+  }
+  PointBuffer points;
+  points.Assign(cloud_, input_indices);
+  ASSERT_EQ(points.size(), input_indices.size());
+  Mask mask;
+  FloorCandidateMask(points, 0.1, 0.05, &mask);
+  std::vector<int> indices;
+  CompactMask(mask, input_indices, &indices);
+
+  std::vector<int> all_indices;
+  ScalarFloorCandidates(0.1, 0.05, cloud_, &all_indices);
+  std::vector<int> expected;
+  for (size_t i = 0; i < all_indices.size(); i++) {
+    if (all_indices[i] % 3 == 0) {
+      expected.push_back(all_indices[i]);
+    }
+  }
+  EXPECT_TRUE(indices == expected);
+}
+
+TEST(PointKernelsCompactTest, AppendsToIndices) {
+  Mask mask;
+  mask.push_back(1);
+  mask.push_back(0);
+  mask.push_back(1);
+  std::vector<int> indices(1, 42);
+  EXPECT_EQ(CompactMask(mask, &indices), 2);
+  ASSERT_EQ(indices.size(), 3);
+  EXPECT_EQ(indices[0], 42);
+  EXPECT_EQ(indices[1], 0);
+  EXPECT_EQ(indices[2], 2);
+}
+
+TEST(PointKernelsPartitionTest, PartitionLabels) {
+  std::vector<int> floor_points;
+  floor_points.push_back(4);
+  floor_points.push_back(0);
+  floor_points.push_back(2);
+  Mask labels;
+  LabelIndices(6, floor_points, kFloorPoint, &labels);
+  labels[3] = kCliffPoint;
+  // Stale content must be overwritten.
+  std::vector<int> floor_indices(10, -1);
+  std::vector<int> non_floor_indices;
+  std::vector<int> cliff_indices(1, -1);
+  PartitionLabels(labels, &floor_indices, &non_floor_indices, &cliff_indices);
+  ASSERT_EQ(floor_indices.size(), 3);
+  EXPECT_EQ(floor_indices[0], 0);
+  EXPECT_EQ(floor_indices[1], 2);
+  EXPECT_EQ(floor_indices[2], 4);
+  ASSERT_EQ(non_floor_indices.size(), 3);
+  EXPECT_EQ(non_floor_indices[0], 1);
+  EXPECT_EQ(non_floor_indices[1], 3);
+  EXPECT_EQ(non_floor_indices[2], 5);
+  ASSERT_EQ(cliff_indices.size(), 1);
+  EXPECT_EQ(cliff_indices[0], 3);
+}
+
+TEST(PointKernelsPartitionTest, EmptyCloud) {
+  Mask labels;
+  LabelIndices(0, std::vector<int>(), kFloorPoint, &labels);
+  std::vector<int> floor_indices(1, 0);
+  std::vector<int> non_floor_indices(1, 0);
+  std::vector<int> cliff_indices(1, 0);
+  PartitionLabels(labels, &floor_indices, &non_floor_indices, &cliff_indices);
+  EXPECT_TRUE(floor_indices.empty());
+  EXPECT_TRUE(non_floor_indices.empty());
+  EXPECT_TRUE(cliff_indices.empty());
+}
+
+int main(int argc, char *argv[]) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
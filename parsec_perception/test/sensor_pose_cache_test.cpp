@@ -0,0 +1,92 @@
+// Copyright 2011 Google Inc.
+// Author: moesenle@google.com (Lorenz Moesenlechner)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "parsec_perception/sensor_pose_cache.h"
+
+#include <gtest/gtest.h>
+
+#include <ros/ros.h>
+#include <tf/transform_listener.h>
+
+TEST(SensorPoseCacheTest, LookupOncePerStamp) {
+  tf::TransformListener tf_listener;
+  tf::Pose sensor_pose;
+  sensor_pose.setIdentity();
+  sensor_pose.getOrigin().setZ(1.0);
+  tf_listener.setTransform(
+      tf::StampedTransform(sensor_pose, ros::Time(1.0), "base_link", "laser"));
+  tf_listener.setTransform(
+      tf::StampedTransform(sensor_pose, ros::Time(2.0), "base_link", "laser"));
+  parsec_perception::SensorPoseCache cache(
+      tf_listener, "base_link", "laser", ros::Duration(0.1));
+
+  tf::StampedTransform transform;
+  EXPECT_TRUE(cache.GetSensorPose(ros::Time(1.0), &transform));
+  EXPECT_DOUBLE_EQ(transform.getOrigin().z(), 1.0);
+  EXPECT_TRUE(cache.GetSensorPose(ros::Time(1.0), &transform));
+  EXPECT_DOUBLE_EQ(transform.getOrigin().z(), 1.0);
+  EXPECT_EQ(cache.lookups(), 1);
+  EXPECT_EQ(cache.lookups_avoided(), 1);
+
+  EXPECT_TRUE(cache.GetSensorPose(ros::Time(2.0), &transform));
+  EXPECT_EQ(cache.lookups(), 2);
+  EXPECT_EQ(cache.lookups_avoided(), 1);
+}
+
+TEST(SensorPoseCacheTest, KeepsCapacityStamps) {
+  tf::TransformListener tf_listener;
+  tf::Pose sensor_pose;
+  sensor_pose.setIdentity();
+  for (int i = 1; i <= 3; i++) {
+    sensor_pose.getOrigin().setZ(i);
+    tf_listener.setTransform(
+        tf::StampedTransform(sensor_pose, ros::Time(i), "base_link", "laser"));
+  }
+  parsec_perception::SensorPoseCache cache(
+      tf_listener, "base_link", "laser", ros::Duration(0.1), 2);
+
+  tf::StampedTransform transform;
+  EXPECT_TRUE(cache.GetSensorPose(ros::Time(1.0), &transform));
+  EXPECT_TRUE(cache.GetSensorPose(ros::Time(2.0), &transform));
+  EXPECT_TRUE(cache.GetSensorPose(ros::Time(1.0), &transform));
+  EXPECT_DOUBLE_EQ(transform.getOrigin().z(), 1.0);
+  EXPECT_EQ(cache.lookups(), 2);
+  EXPECT_EQ(cache.lookups_avoided(), 1);
+
+  // Evicts the pose at 1.0.
+  EXPECT_TRUE(cache.GetSensorPose(ros::Time(3.0), &transform));
+  EXPECT_TRUE(cache.GetSensorPose(ros::Time(2.0), &transform));
+  EXPECT_DOUBLE_EQ(transform.getOrigin().z(), 2.0);
+  EXPECT_TRUE(cache.GetSensorPose(ros::Time(1.0), &transform));
+  EXPECT_EQ(cache.lookups(), 4);
+  EXPECT_EQ(cache.lookups_avoided(), 2);
+}
+
+TEST(SensorPoseCacheTest, UnknownFrame) {
+  tf::TransformListener tf_listener;
+  parsec_perception::SensorPoseCache cache(
+      tf_listener, "base_link", "unknown_frame", ros::Duration(0.01));
+  tf::StampedTransform transform;
+  EXPECT_FALSE(cache.GetSensorPose(ros::Time(1.0), &transform));
+  EXPECT_FALSE(cache.GetSensorPose(ros::Time(1.0), &transform));
+  EXPECT_EQ(cache.lookups(), 2);
+  EXPECT_EQ(cache.lookups_avoided(), 0);
+}
+
+int main(int argc, char *argv[]) {
+  ros::init(argc, argv, "sensor_pose_cache_test");
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -16,36 +16,82 @@
 #ifndef PRIORITY_MUX_EXPIRING_SUBSCRIPTION_H
 #define PRIORITY_MUX_EXPIRING_SUBSCRIPTION_H
 
+#include <stdint.h>
+
 #include <string>
 
 #include <ros/ros.h>
 
 namespace priority_mux {
 
+/**
+ * A subscription that is alive while it receives messages at least
+ * every timeout. Pinging and checking for expiry are lock-free, so
+ * the callbacks of several subscriptions can run concurrently.
+ */
 class ExpiringSubscription {
  public:
   ExpiringSubscription(
       const std::string name, int priority, ros::Duration timeout,
       const ros::Subscriber &subscriber);
-  bool IsExpired();
+  bool IsExpired() const;
   void Ping();
 
+  /**
+   * Like IsExpired() but at a given time, which saves calling
+   * ros::Time::now() for every subscription.
+   */
+  bool IsExpired(const ros::Time &now) const;
+
+  /**
+   * Marks that a message of the subscription was used at now. The
+   * time since the last ping is added to the runtime if it is not
+   * longer than the timeout. A ping that is older than the last one
+   * is ignored. Implies Touch.
+   */
+  void Ping(const ros::Time &now);
+
+  /**
+   * Marks that a message of the subscription was received at now
+   * without adding to the runtime, e.g. because a subscription with
+   * a higher priority won. Keeps the subscription from expiring.
+   */
+  void Touch(const ros::Time &now);
+
+  /**
+   * The time after which the subscription expires if it does not
+   * receive messages anymore, or ros::Time() if it never received
+   * one.
+   */
+  ros::Time deadline() const;
+
   const std::string &name() const {
     return name_;
   }
   size_t priority() const {
     return priority_;
   }
-  const ros::Duration &runtime() const {
-    return runtime_;
-  }
+  ros::Duration runtime() const;
 
   std::string name_;
   size_t priority_;
   ros::Duration timeout_;
   ros::Subscriber subscriber_;
-  ros::Time last_ping_time_;
-  ros::Duration runtime_;
+  // In nanoseconds. Only accessed atomically. 0 means never.
+  volatile int64_t last_ping_time_;
+  volatile int64_t last_message_time_;
+  volatile int64_t runtime_;
+
+ private:
+  static int64_t AtomicLoad(const volatile int64_t *value);
+
+  /**
+   * Sets value to new_value if that is larger. Returns false if
+   * value was not smaller. previous_value is set to the value that
+   * was replaced.
+   */
+  static bool AtomicAdvance(volatile int64_t *value, int64_t new_value,
+                            int64_t *previous_value);
 };
 
 }  // namespace priority_mux
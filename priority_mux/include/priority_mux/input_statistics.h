@@ -0,0 +1,76 @@
+// Copyright 2011 Google Inc.
+// Author: moesenle@google.com (Lorenz Moesenlechner)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef PRIORITY_MUX_INPUT_STATISTICS_H
+#define PRIORITY_MUX_INPUT_STATISTICS_H
+
+#include <stdint.h>
+
+#include <vector>
+
+#include <ros/ros.h>
+
+namespace priority_mux {
+
+/**
+ * Counts the messages of one input of the mux and keeps a histogram
+ * of how long the messages that were republished spent in the
+ * mux. All updates are lock-free. The counts are collected and reset
+ * with Take.
+ */
+class InputStatistics {
+ public:
+  // Bucket i counts latencies below 2^i microseconds that do not fit
+  // into bucket i - 1. The last bucket counts all larger latencies.
+  static const int kLatencyBuckets = 16;
+
+  InputStatistics();
+
+  void AddReceived() {
+    __sync_fetch_and_add(&received_, 1);
+  }
+
+  void AddDropped() {
+    __sync_fetch_and_add(&dropped_, 1);
+  }
+
+  void AddLatency(const ros::Duration &latency) {
+    __sync_fetch_and_add(&latency_histogram_[FindLatencyBucket(latency)], 1);
+  }
+
+  /**
+   * Returns the counts since the last call and resets them.
+   */
+  void Take(uint32_t *received, uint32_t *dropped, std::vector<uint32_t> *latency_histogram);
+
+  /**
+   * The upper limits of all but the last bucket.
+   */
+  static void GetLatencyBucketLimits(std::vector<ros::Duration> *limits);
+
+  /**
+   * Public for testing.
+   */
+  static int FindLatencyBucket(const ros::Duration &latency);
+
+ private:
+  volatile uint32_t received_;
+  volatile uint32_t dropped_;
+  volatile uint32_t latency_histogram_[kLatencyBuckets];
+};
+
+}  // namespace priority_mux
+
+#endif  // PRIORITY_MUX_INPUT_STATISTICS_H
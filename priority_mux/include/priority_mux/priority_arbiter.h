@@ -0,0 +1,134 @@
+// Copyright 2011 Google Inc.
+// Author: moesenle@google.com (Lorenz Moesenlechner)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef PRIORITY_MUX_PRIORITY_ARBITER_H
+#define PRIORITY_MUX_PRIORITY_ARBITER_H
+
+#include <deque>
+#include <string>
+#include <vector>
+
+#include <boost/thread/mutex.hpp>
+#include <ros/ros.h>
+
+#include "priority_mux/expiring_subscription.h"
+
+namespace priority_mux {
+
+/**
+ * A change of the active source.
+ */
+struct PriorityTransition {
+  ros::Time stamp;
+  // PriorityArbiter::kNoSource if no source was or is active.
+  size_t from_priority;
+  size_t to_priority;
+};
+
+/**
+ * Decides which of several prioritized sources is allowed to
+ * publish. Priority 0 is the highest priority. A message of a source
+ * wins if no source with a higher priority is active.
+ *
+ * The arbiter keeps track of the active source, i.e. the source with
+ * the highest priority that did not expire. Sources that lose still
+ * count as alive. A source with a higher priority takes over with its
+ * first message. When the active source expires, Expire needs to be
+ * called at its deadline to hand over to the next source that is
+ * alive, so that the switch happens at the timeout instead of with
+ * the next message. Every switch is recorded.
+ *
+ * Arbitrate is lock-free unless the active source changes and can be
+ * called from several callback threads at once.
+ */
+class PriorityArbiter {
+ public:
+  static const size_t kMaxSources = 64;
+  static const size_t kNoSource = static_cast<size_t>(-1);
+
+  explicit PriorityArbiter(const ros::Duration &timeout);
+
+  /**
+   * Adds a source with a lower priority than all sources added
+   * before and returns its priority. Must not be called concurrently
+   * with itself, size() or source(), but Arbitrate can run for the
+   * sources that were added before.
+   */
+  size_t AddSource(const std::string &name);
+
+  /**
+   * Returns true if a message of the source with priority that was
+   * received at now wins. The source is marked active if it wins.
+   */
+  bool Arbitrate(size_t priority, const ros::Time &now);
+
+  /**
+   * Hands over to the source with the highest priority that did not
+   * expire at now if the active source expired.
+   */
+  void Expire(const ros::Time &now);
+
+  /**
+   * The priority of the active source or kNoSource.
+   */
+  size_t active_priority() const {
+    return active_priority_;
+  }
+
+  /**
+   * The time at which the active source expires if it does not
+   * receive messages anymore, or ros::Time() if no source is active.
+   */
+  ros::Time ActiveDeadline() const;
+
+  /**
+   * Moves the transitions recorded since the last call to
+   * transitions.
+   */
+  void TakeTransitions(std::vector<PriorityTransition> *transitions);
+
+  size_t size() const {
+    return sources_.size();
+  }
+
+  const ExpiringSubscription &source(size_t priority) const {
+    return sources_[priority];
+  }
+
+ private:
+  // Transitions that are not taken yet are dropped beyond this.
+  static const size_t kMaxTransitions = 1000;
+
+  ros::Duration timeout_;
+  // Reserved to kMaxSources, so that adding a source never moves the
+  // sources that are in use.
+  std::vector<ExpiringSubscription> sources_;
+  // Only written with mutex_ held, read without.
+  volatile size_t active_priority_;
+
+  // Protects changes of the active source, the transitions and
+  // adding sources.
+  boost::mutex mutex_;
+  std::deque<PriorityTransition> transitions_;
+
+  /**
+   * Makes priority the active source. mutex_ needs to be held.
+   */
+  void SetActivePriority(size_t priority, const ros::Time &now);
+};
+
+}  // namespace priority_mux
+
+#endif  // PRIORITY_MUX_PRIORITY_ARBITER_H
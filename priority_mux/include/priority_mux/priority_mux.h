@@ -18,11 +18,14 @@
 
 #include <vector>
 
+#include <boost/scoped_array.hpp>
+#include <boost/scoped_ptr.hpp>
 #include <boost/thread/mutex.hpp>
 #include <ros/ros.h>
 #include <topic_tools/shape_shifter.h>
 
-#include "priority_mux/expiring_subscription.h"
+#include "priority_mux/input_statistics.h"
+#include "priority_mux/priority_arbiter.h"
 
 namespace priority_mux {
 
@@ -34,22 +37,49 @@ class PriorityMux {
  private:
   static const double kDefaultTimeout = 3.0;
   static const double kDefaultLogRate = 30.0;
+  // Sources expire once they are older than the timeout, so the
+  // expiry timer fires a little after the deadline.
+  static const double kExpiryDelay = 0.001;
 
   ros::NodeHandle global_node_handle_;
   ros::NodeHandle private_node_handle_;
-  std::vector<ExpiringSubscription> expiring_subscriptions_;
+  boost::scoped_ptr<PriorityArbiter> arbiter_;
+  std::vector<ros::Subscriber> subscribers_;
+  // One per possible priority, so that adding topics does not move
+  // statistics that are in use.
+  boost::scoped_array<InputStatistics> statistics_;
   ros::Publisher output_publisher_;
+  // Set once output_publisher_ has been advertised. Only written
+  // with mutex_ held.
+  volatile bool output_advertised_;
   ros::Publisher log_publisher_;
   ros::Timer log_timer_;
-  
+  // One-shot timer for the deadline of the active source.
+  ros::Timer expiry_timer_;
+  // Set while expiry_timer_ is armed for an active source. Only
+  // written with mutex_ held.
+  volatile bool expiry_scheduled_;
+
+  // Protects adding topics, the log, the expiry timer and advertising
+  // the output. The arbitration of messages does not lock.
   boost::mutex mutex_;
   ros::Duration timeout_;
 
+  /**
+   * Arbitrates a message of the topic with priority before it is
+   * deserialized. Returns false if the message loses.
+   */
+  bool Gate(size_t priority);
   void TopicCallback(
-      size_t priority, const topic_tools::ShapeShifter::ConstPtr &message);
+      size_t priority, const ros::MessageEvent<topic_tools::ShapeShifter const> &event);
   void LogTimerCallback(const ros::TimerEvent &);
+  void ExpiryTimerCallback(const ros::TimerEvent &);
+
+  /**
+   * Arms the expiry timer for the deadline of the active source.
+   */
+  void ScheduleExpiry(const ros::Time &now);
   void Republish(const topic_tools::ShapeShifter::ConstPtr &message);
-  size_t FindActivePriority();
 };
 
 }  // namespace priority_mux
@@ -22,20 +22,79 @@ ExpiringSubscription::ExpiringSubscription(
     const ros::Subscriber &subscriber)
     : name_(name), priority_(priority), timeout_(timeout),
       subscriber_(subscriber),
-      runtime_(0.0) {
+      last_ping_time_(0),
+      last_message_time_(0),
+      runtime_(0) {
 }
 
-bool ExpiringSubscription::IsExpired() {
-  return last_ping_time_ == ros::Time() ||
-      ros::Time::now() - last_ping_time_ > timeout_;
+bool ExpiringSubscription::IsExpired() const {
+  return IsExpired(ros::Time::now());
+}
+
+bool ExpiringSubscription::IsExpired(const ros::Time &now) const {
+  int64_t last_message_time = AtomicLoad(&last_message_time_);
+  return last_message_time == 0 ||
+      static_cast<int64_t>(now.toNSec()) - last_message_time > timeout_.toNSec();
 }
 
 void ExpiringSubscription::Ping() {
-  ros::Time now = ros::Time::now();
-  if (!IsExpired() && last_ping_time_ != ros::Time()) {
-    runtime_ += now - last_ping_time_;
+  Ping(ros::Time::now());
+}
+
+void ExpiringSubscription::Ping(const ros::Time &now) {
+  int64_t now_nsec = now.toNSec();
+  int64_t last_ping_time;
+  if (AtomicAdvance(&last_ping_time_, now_nsec, &last_ping_time) &&
+      last_ping_time != 0 && now_nsec - last_ping_time <= timeout_.toNSec()) {
+    __sync_fetch_and_add(&runtime_, now_nsec - last_ping_time);
+  }
+  Touch(now);
+}
+
+void ExpiringSubscription::Touch(const ros::Time &now) {
+  int64_t last_message_time;
+  AtomicAdvance(&last_message_time_, now.toNSec(), &last_message_time);
+}
+
+ros::Time ExpiringSubscription::deadline() const {
+  int64_t last_message_time = AtomicLoad(&last_message_time_);
+  if (last_message_time == 0) {
+    return ros::Time();
+  }
+  ros::Time deadline;
+  deadline.fromNSec(last_message_time + timeout_.toNSec());
+  return deadline;
+}
+
+ros::Duration ExpiringSubscription::runtime() const {
+  ros::Duration runtime;
+  runtime.fromNSec(AtomicLoad(&runtime_));
+  return runtime;
+}
+
+int64_t ExpiringSubscription::AtomicLoad(const volatile int64_t *value) {
+#if defined(__LP64__)
+  // Aligned 64 bit loads are atomic on 64 bit platforms.
+  return *value;
+#else
+  return __sync_val_compare_and_swap(const_cast<volatile int64_t *>(value), 0, 0);
+#endif
+}
+
+bool ExpiringSubscription::AtomicAdvance(
+    volatile int64_t *value, int64_t new_value, int64_t *previous_value) {
+  int64_t current_value = AtomicLoad(value);
+  while (new_value > current_value) {
+    int64_t replaced_value = __sync_val_compare_and_swap(value, current_value, new_value);
+    if (replaced_value == current_value) {
+      *previous_value = current_value;
+      return true;
+    }
+    // Another thread advanced the value in between.
+    current_value = replaced_value;
   }
-  last_ping_time_ = now;
+  *previous_value = current_value;
+  return false;
 }
 
 }  // namespace priority_mux
@@ -0,0 +1,58 @@
+// Copyright 2011 Google Inc.
+// Author: moesenle@google.com (Lorenz Moesenlechner)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "priority_mux/input_statistics.h"
+
+namespace priority_mux {
+
+const int InputStatistics::kLatencyBuckets;
+
+InputStatistics::InputStatistics()
+    : received_(0),
+      dropped_(0) {
+  for (int i = 0; i < kLatencyBuckets; i++) {
+    latency_histogram_[i] = 0;
+  }
+}
+
+void InputStatistics::Take(
+    uint32_t *received, uint32_t *dropped, std::vector<uint32_t> *latency_histogram) {
+  *received = __sync_fetch_and_and(&received_, 0);
+  *dropped = __sync_fetch_and_and(&dropped_, 0);
+  latency_histogram->resize(kLatencyBuckets);
+  for (int i = 0; i < kLatencyBuckets; i++) {
+    (*latency_histogram)[i] = __sync_fetch_and_and(&latency_histogram_[i], 0);
+  }
+}
+
+void InputStatistics::GetLatencyBucketLimits(std::vector<ros::Duration> *limits) {
+  limits->clear();
+  for (int i = 0; i < kLatencyBuckets - 1; i++) {
+    ros::Duration limit;
+    limit.fromNSec(1000LL << i);
+    limits->push_back(limit);
+  }
+}
+
+int InputStatistics::FindLatencyBucket(const ros::Duration &latency) {
+  int64_t microseconds = latency.toNSec() / 1000;
+  int bucket = 0;
+  while (bucket < kLatencyBuckets - 1 && microseconds >= (1LL << bucket)) {
+    bucket++;
+  }
+  return bucket;
+}
+
+}  // namespace priority_mux
@@ -0,0 +1,103 @@
+// Copyright 2011 Google Inc.
+// Author: moesenle@google.com (Lorenz Moesenlechner)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "priority_mux/priority_arbiter.h"
+
+namespace priority_mux {
+
+const size_t PriorityArbiter::kMaxSources;
+const size_t PriorityArbiter::kNoSource;
+const size_t PriorityArbiter::kMaxTransitions;
+
+PriorityArbiter::PriorityArbiter(const ros::Duration &timeout)
+    : timeout_(timeout),
+      active_priority_(kNoSource) {
+  sources_.reserve(kMaxSources);
+}
+
+size_t PriorityArbiter::AddSource(const std::string &name) {
+  boost::mutex::scoped_lock lock(mutex_);
+  ROS_ASSERT_MSG(sources_.size() < kMaxSources,
+                 "Too many sources. At most %zu are supported.", kMaxSources);
+  size_t priority = sources_.size();
+  sources_.push_back(ExpiringSubscription(name, priority, timeout_, ros::Subscriber()));
+  return priority;
+}
+
+bool PriorityArbiter::Arbitrate(size_t priority, const ros::Time &now) {
+  size_t active_priority = active_priority_;
+  if (priority > active_priority) {
+    if (!sources_[active_priority].IsExpired(now)) {
+      sources_[priority].Touch(now);
+      return false;
+    }
+    // The active source expired but Expire was not called yet.
+    Expire(now);
+    if (priority > active_priority_) {
+      sources_[priority].Touch(now);
+      return false;
+    }
+  }
+  sources_[priority].Ping(now);
+  if (priority < active_priority_) {
+    boost::mutex::scoped_lock lock(mutex_);
+    if (priority < active_priority_) {
+      SetActivePriority(priority, now);
+    }
+  }
+  return true;
+}
+
+void PriorityArbiter::Expire(const ros::Time &now) {
+  boost::mutex::scoped_lock lock(mutex_);
+  if (active_priority_ == kNoSource || !sources_[active_priority_].IsExpired(now)) {
+    return;
+  }
+  size_t priority;
+  for (priority = 0; priority < sources_.size(); priority++) {
+    if (!sources_[priority].IsExpired(now)) {
+      break;
+    }
+  }
+  SetActivePriority(priority < sources_.size() ? priority : kNoSource, now);
+}
+
+ros::Time PriorityArbiter::ActiveDeadline() const {
+  size_t active_priority = active_priority_;
+  if (active_priority == kNoSource) {
+    return ros::Time();
+  }
+  return sources_[active_priority].deadline();
+}
+
+void PriorityArbiter::TakeTransitions(std::vector<PriorityTransition> *transitions) {
+  boost::mutex::scoped_lock lock(mutex_);
+  transitions->insert(transitions->end(), transitions_.begin(), transitions_.end());
+  transitions_.clear();
+}
+
+void PriorityArbiter::SetActivePriority(size_t priority, const ros::Time &now) {
+  PriorityTransition transition;
+  transition.stamp = now;
+  transition.from_priority = active_priority_;
+  transition.to_priority = priority;
+  transitions_.push_back(transition);
+  if (transitions_.size() > kMaxTransitions) {
+    transitions_.pop_front();
+  }
+  active_priority_ = priority;
+}
+
+}  // namespace priority_mux
@@ -15,15 +15,52 @@
 
 #include "priority_mux/priority_mux.h"
 
+#include <boost/function.hpp>
+#include <ros/subscription_callback_helper.h>
+
 #include <priority_mux_msgs/LogEntry.h>
 
 namespace priority_mux {
 
+namespace {
+
+typedef const ros::MessageEvent<topic_tools::ShapeShifter const> &ShapeShifterEvent;
+
+/**
+ * A subscription callback helper that asks a gate before it
+ * deserializes a message. Messages that the gate rejects are dropped
+ * without being copied into a ShapeShifter and never reach the
+ * callback.
+ */
+class GatedCallbackHelper : public ros::SubscriptionCallbackHelperT<ShapeShifterEvent> {
+ public:
+  GatedCallbackHelper(const boost::function<bool ()> &gate, const Callback &callback)
+      : ros::SubscriptionCallbackHelperT<ShapeShifterEvent>(callback),
+        gate_(gate) {}
+
+  virtual ros::VoidConstPtr deserialize(
+      const ros::SubscriptionCallbackHelperDeserializeParams &params) {
+    if (!gate_()) {
+      return ros::VoidConstPtr();
+    }
+    return ros::SubscriptionCallbackHelperT<ShapeShifterEvent>::deserialize(params);
+  }
+
+ private:
+  boost::function<bool ()> gate_;
+};
+
+}  // namespace
+
 PriorityMux::PriorityMux(const ros::NodeHandle &node_handle)
-    : private_node_handle_(node_handle) {
+    : private_node_handle_(node_handle),
+      statistics_(new InputStatistics[PriorityArbiter::kMaxSources]),
+      output_advertised_(false),
+      expiry_scheduled_(false) {
   double timeout;
   private_node_handle_.param("timeout", timeout, kDefaultTimeout);
   timeout_ = ros::Duration(timeout);
+  arbiter_.reset(new PriorityArbiter(timeout_));
 
   log_publisher_ = private_node_handle_.advertise<priority_mux_msgs::LogEntry>(
       "log", 10);
@@ -32,56 +69,118 @@ PriorityMux::PriorityMux(const ros::NodeHandle &node_handle)
   log_timer_ = private_node_handle_.createTimer(
       ros::Duration(log_rate),
       boost::bind(&PriorityMux::LogTimerCallback, this, _1));
+  expiry_timer_ = private_node_handle_.createTimer(
+      timeout_, boost::bind(&PriorityMux::ExpiryTimerCallback, this, _1), true);
 }
 
 void PriorityMux::AddTopic(const std::string &topic) {
-  size_t priority = expiring_subscriptions_.size();
   boost::mutex::scoped_lock lock(mutex_);
-  ros::Subscriber subscriber = global_node_handle_.subscribe<topic_tools::ShapeShifter>(
-      topic, 10, boost::bind(&PriorityMux::TopicCallback, this, priority, _1));
-  expiring_subscriptions_.push_back(ExpiringSubscription(topic, priority, timeout_, subscriber));
+  // The source needs to exist before its first message can arrive.
+  size_t priority = arbiter_->AddSource(topic);
+  ros::SubscribeOptions options;
+  options.topic = topic;
+  options.queue_size = 10;
+  options.md5sum = ros::message_traits::md5sum<topic_tools::ShapeShifter>();
+  options.datatype = ros::message_traits::datatype<topic_tools::ShapeShifter>();
+  options.helper.reset(new GatedCallbackHelper(
+      boost::bind(&PriorityMux::Gate, this, priority),
+      boost::bind(&PriorityMux::TopicCallback, this, priority, _1)));
+  subscribers_.push_back(global_node_handle_.subscribe(options));
 }
 
-void PriorityMux::TopicCallback(
-    size_t priority, const topic_tools::ShapeShifter::ConstPtr &message) {
-  if (priority > FindActivePriority()) {
-    return;
+bool PriorityMux::Gate(size_t priority) {
+  InputStatistics &statistics = statistics_[priority];
+  statistics.AddReceived();
+  ros::Time now = ros::Time::now();
+  if (!arbiter_->Arbitrate(priority, now)) {
+    statistics.AddDropped();
+    return false;
   }
-  boost::mutex::scoped_lock lock(mutex_);
-  expiring_subscriptions_[priority].Ping();
-  Republish(message);
+  // Pairs with the barrier in ScheduleExpiry: either the timer sees
+  // the source Arbitrate made active, or this sees the cleared flag.
+  __sync_synchronize();
+  if (!expiry_scheduled_) {
+    ScheduleExpiry(now);
+  }
+  return true;
+}
+
+void PriorityMux::TopicCallback(
+    size_t priority, const ros::MessageEvent<topic_tools::ShapeShifter const> &event) {
+  Republish(event.getMessage());
+  statistics_[priority].AddLatency(ros::Time::now() - event.getReceiptTime());
 }
 
 void PriorityMux::LogTimerCallback(const ros::TimerEvent &) {
   boost::mutex::scoped_lock lock(mutex_);
   priority_mux_msgs::LogEntry log;
   log.header.stamp = ros::Time::now();
-  for (size_t i = 0; i < expiring_subscriptions_.size(); i++) {
+  for (size_t i = 0; i < arbiter_->size(); i++) {
+    const ExpiringSubscription &source = arbiter_->source(i);
     priority_mux_msgs::TopicEntry entry;
-    entry.name = expiring_subscriptions_[i].name();
-    entry.priority = expiring_subscriptions_[i].priority();
-    entry.duration = expiring_subscriptions_[i].runtime();
+    entry.name = source.name();
+    entry.priority = source.priority();
+    entry.duration = source.runtime();
+    statistics_[i].Take(&entry.received, &entry.dropped, &entry.latency_histogram);
     log.topic_entries.push_back(entry);
   }
+  InputStatistics::GetLatencyBucketLimits(&log.latency_bucket_limits);
+  size_t active_priority = arbiter_->active_priority();
+  log.active_priority = active_priority == PriorityArbiter::kNoSource ?
+      -1 : static_cast<int>(active_priority);
+  std::vector<PriorityTransition> transitions;
+  arbiter_->TakeTransitions(&transitions);
+  for (size_t i = 0; i < transitions.size(); i++) {
+    priority_mux_msgs::Transition transition;
+    transition.stamp = transitions[i].stamp;
+    transition.from_priority = transitions[i].from_priority == PriorityArbiter::kNoSource ?
+        -1 : static_cast<int>(transitions[i].from_priority);
+    transition.to_priority = transitions[i].to_priority == PriorityArbiter::kNoSource ?
+        -1 : static_cast<int>(transitions[i].to_priority);
+    log.transitions.push_back(transition);
+  }
   log_publisher_.publish(log);
 }
 
-void PriorityMux::Republish(const topic_tools::ShapeShifter::ConstPtr &message) {
-  if (!output_publisher_) {
-    output_publisher_ = message->advertise(private_node_handle_, "output", 10);
-  }
-  output_publisher_.publish(message);
+void PriorityMux::ExpiryTimerCallback(const ros::TimerEvent &) {
+  ros::Time now = ros::Time::now();
+  arbiter_->Expire(now);
+  ScheduleExpiry(now);
 }
 
-size_t PriorityMux::FindActivePriority() {
+void PriorityMux::ScheduleExpiry(const ros::Time &now) {
   boost::mutex::scoped_lock lock(mutex_);
-  size_t i;
-  for(i = 0; i < expiring_subscriptions_.size(); i++) {
-    if (!expiring_subscriptions_[i].IsExpired()) {
-      break;
+  ros::Time deadline = arbiter_->ActiveDeadline();
+  if (deadline == ros::Time()) {
+    expiry_scheduled_ = false;
+    // Gate does not schedule while the flag is set, so a source that
+    // became active after the deadline was read would never expire.
+    __sync_synchronize();
+    deadline = arbiter_->ActiveDeadline();
+    if (deadline == ros::Time()) {
+      return;
     }
   }
-  return i;
+  // If the active source received messages since the timer was
+  // armed, the timer just fires again at the new deadline.
+  expiry_timer_.stop();
+  expiry_timer_.setPeriod(deadline - now + ros::Duration(kExpiryDelay));
+  expiry_timer_.start();
+  expiry_scheduled_ = true;
+}
+
+void PriorityMux::Republish(const topic_tools::ShapeShifter::ConstPtr &message) {
+  // The output can only be advertised once the type of the messages
+  // is known. Publishing itself is thread-safe.
+  if (!output_advertised_) {
+    boost::mutex::scoped_lock lock(mutex_);
+    if (!output_publisher_) {
+      output_publisher_ = message->advertise(private_node_handle_, "output", 10);
+    }
+    __sync_synchronize();
+    output_advertised_ = true;
+  }
+  output_publisher_.publish(message);
 }
 
 }  // namespace priority_mux
@@ -0,0 +1,67 @@
+// Copyright 2011 Google Inc.
+// Author: moesenle@google.com (Lorenz Moesenlechner)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "priority_mux/input_statistics.h"
+
+#include <gtest/gtest.h>
+#include <ros/ros.h>
+
+using priority_mux::InputStatistics;
+
+TEST(InputStatisticsTest, LatencyBuckets) {
+  EXPECT_EQ(InputStatistics::FindLatencyBucket(ros::Duration(0.0)), 0);
+  EXPECT_EQ(InputStatistics::FindLatencyBucket(ros::Duration(0.0000009)), 0);
+  EXPECT_EQ(InputStatistics::FindLatencyBucket(ros::Duration(0.000001)), 1);
+  EXPECT_EQ(InputStatistics::FindLatencyBucket(ros::Duration(0.000003)), 2);
+  EXPECT_EQ(InputStatistics::FindLatencyBucket(ros::Duration(0.001)), 10);
+  EXPECT_EQ(InputStatistics::FindLatencyBucket(ros::Duration(10.0)),
+            InputStatistics::kLatencyBuckets - 1);
+
+  std::vector<ros::Duration> limits;
+  InputStatistics::GetLatencyBucketLimits(&limits);
+  ASSERT_EQ(limits.size(), InputStatistics::kLatencyBuckets - 1);
+  for (size_t i = 0; i < limits.size(); i++) {
+    EXPECT_EQ(InputStatistics::FindLatencyBucket(limits[i]), i + 1);
+  }
+}
+
+TEST(InputStatisticsTest, TakeResets) {
+  InputStatistics statistics;
+  statistics.AddReceived();
+  statistics.AddReceived();
+  statistics.AddReceived();
+  statistics.AddDropped();
+  statistics.AddLatency(ros::Duration(0.000003));
+  statistics.AddLatency(ros::Duration(0.000003));
+
+  uint32_t received;
+  uint32_t dropped;
+  std::vector<uint32_t> latency_histogram;
+  statistics.Take(&received, &dropped, &latency_histogram);
+  EXPECT_EQ(received, 3);
+  EXPECT_EQ(dropped, 1);
+  ASSERT_EQ(latency_histogram.size(), InputStatistics::kLatencyBuckets);
+  EXPECT_EQ(latency_histogram[2], 2);
+
+  statistics.Take(&received, &dropped, &latency_histogram);
+  EXPECT_EQ(received, 0);
+  EXPECT_EQ(dropped, 0);
+  EXPECT_EQ(latency_histogram[2], 0);
+}
+
+int main(int argc, char *argv[]) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,134 @@
+// Copyright 2011 Google Inc.
+// Author: moesenle@google.com (Lorenz Moesenlechner)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Stress test of the arbitration PriorityMux does for every
+// message. Several threads, each feeding one source, arbitrate as
+// fast as they can. Compares the throughput and the 99th percentile
+// of the per-message latency of PriorityArbiter with the mutex based
+// arbitration PriorityMux used before.
+
+#include <algorithm>
+#include <cstdio>
+#include <vector>
+
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <ros/ros.h>
+
+#include "priority_mux/priority_arbiter.h"
+
+static const int kMessagesPerThread = 200000;
+static const int kNumberOfSources = 4;
+
+/**
+ * The arbitration of PriorityMux before it became lock-free.
+ */
+class LockingArbiter {
+ public:
+  explicit LockingArbiter(const ros::Duration &timeout) {
+    for (int i = 0; i < kNumberOfSources; i++) {
+      last_ping_times_.push_back(ros::Time());
+      timeouts_.push_back(timeout);
+    }
+  }
+
+  bool Arbitrate(size_t priority) {
+    if (priority > FindActivePriority()) {
+      return false;
+    }
+    boost::mutex::scoped_lock lock(mutex_);
+    ros::Time now = ros::Time::now();
+    last_ping_times_[priority] = now;
+    return true;
+  }
+
+ private:
+  boost::mutex mutex_;
+  std::vector<ros::Time> last_ping_times_;
+  std::vector<ros::Duration> timeouts_;
+
+  size_t FindActivePriority() {
+    boost::mutex::scoped_lock lock(mutex_);
+    size_t i;
+    for (i = 0; i < last_ping_times_.size(); i++) {
+      if (last_ping_times_[i] != ros::Time() &&
+          ros::Time::now() - last_ping_times_[i] <= timeouts_[i]) {
+        break;
+      }
+    }
+    return i;
+  }
+};
+
+struct LockFreeArbiter {
+  explicit LockFreeArbiter(const ros::Duration &timeout) : arbiter(timeout) {
+    for (int i = 0; i < kNumberOfSources; i++) {
+      arbiter.AddSource("source");
+    }
+  }
+
+  bool Arbitrate(size_t priority) {
+    return arbiter.Arbitrate(priority, ros::Time::now());
+  }
+
+  priority_mux::PriorityArbiter arbiter;
+};
+
+template<typename Arbiter>
+static void Feed(Arbiter *arbiter, size_t priority, std::vector<double> *latencies) {
+  latencies->resize(kMessagesPerThread);
+  for (int i = 0; i < kMessagesPerThread; i++) {
+    ros::WallTime start = ros::WallTime::now();
+    arbiter->Arbitrate(priority);
+    (*latencies)[i] = (ros::WallTime::now() - start).toSec();
+  }
+}
+
+template<typename Arbiter>
+static void Benchmark(const char *name, int number_of_threads) {
+  Arbiter arbiter(ros::Duration(1.0));
+  std::vector<std::vector<double> > latencies(number_of_threads);
+  boost::thread_group threads;
+  ros::WallTime start = ros::WallTime::now();
+  for (int i = 0; i < number_of_threads; i++) {
+    // The highest priority is fed by one thread only, so that the
+    // other sources keep losing.
+    threads.create_thread(boost::bind(
+        &Feed<Arbiter>, &arbiter, (i + 1) % kNumberOfSources, &latencies[i]));
+  }
+  threads.join_all();
+  double duration = (ros::WallTime::now() - start).toSec();
+
+  std::vector<double> all_latencies;
+  for (int i = 0; i < number_of_threads; i++) {
+    all_latencies.insert(all_latencies.end(), latencies[i].begin(), latencies[i].end());
+  }
+  std::vector<double>::iterator p99 = all_latencies.begin() + all_latencies.size() * 99 / 100;
+  std::nth_element(all_latencies.begin(), p99, all_latencies.end());
+  printf("%-10s %2d threads: %8.2f Mmsgs/s, p99 latency %6.2f us\n",
+         name, number_of_threads,
+         number_of_threads * kMessagesPerThread / duration / 1e6, *p99 * 1e6);
+}
+
+int main(int argc, char *argv[]) {
+  ros::Time::init();
+  int thread_counts[] = {1, 2, 4, 8};
+  for (size_t i = 0; i < sizeof(thread_counts) / sizeof(thread_counts[0]); i++) {
+    Benchmark<LockingArbiter>("locking", thread_counts[i]);
+    Benchmark<LockFreeArbiter>("lock-free", thread_counts[i]);
+  }
+  return 0;
+}
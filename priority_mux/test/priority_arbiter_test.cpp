@@ -0,0 +1,135 @@
+// Copyright 2011 Google Inc.
+// Author: moesenle@google.com (Lorenz Moesenlechner)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "priority_mux/priority_arbiter.h"
+
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+
+#include <gtest/gtest.h>
+#include <ros/ros.h>
+
+using priority_mux::ExpiringSubscription;
+using priority_mux::PriorityArbiter;
+
+TEST(PriorityArbiterTest, HighestActivePriorityWins) {
+  PriorityArbiter arbiter(ros::Duration(1.0));
+  EXPECT_EQ(arbiter.AddSource("topic_0"), 0);
+  EXPECT_EQ(arbiter.AddSource("topic_1"), 1);
+  EXPECT_EQ(arbiter.AddSource("topic_2"), 2);
+  EXPECT_EQ(arbiter.size(), 3);
+  EXPECT_EQ(arbiter.source(1).name(), "topic_1");
+
+  EXPECT_TRUE(arbiter.Arbitrate(2, ros::Time(10.0)));
+  EXPECT_TRUE(arbiter.Arbitrate(0, ros::Time(10.1)));
+  EXPECT_FALSE(arbiter.Arbitrate(1, ros::Time(10.2)));
+  EXPECT_FALSE(arbiter.Arbitrate(2, ros::Time(10.3)));
+  EXPECT_TRUE(arbiter.Arbitrate(0, ros::Time(10.4)));
+  // Losing sources stay alive.
+  EXPECT_FALSE(arbiter.source(1).IsExpired(ros::Time(10.4)));
+  EXPECT_TRUE(arbiter.Arbitrate(1, ros::Time(11.5)));
+  EXPECT_FALSE(arbiter.Arbitrate(2, ros::Time(11.6)));
+  EXPECT_TRUE(arbiter.Arbitrate(2, ros::Time(12.6)));
+}
+
+TEST(PriorityArbiterTest, Transitions) {
+  PriorityArbiter arbiter(ros::Duration(1.0));
+  arbiter.AddSource("topic_0");
+  arbiter.AddSource("topic_1");
+  EXPECT_EQ(arbiter.active_priority(), PriorityArbiter::kNoSource);
+  EXPECT_EQ(arbiter.ActiveDeadline(), ros::Time());
+
+  EXPECT_TRUE(arbiter.Arbitrate(1, ros::Time(10.0)));
+  EXPECT_EQ(arbiter.active_priority(), 1);
+  EXPECT_TRUE(arbiter.Arbitrate(0, ros::Time(10.5)));
+  EXPECT_EQ(arbiter.active_priority(), 0);
+  EXPECT_EQ(arbiter.ActiveDeadline(), ros::Time(11.5));
+
+  // Nothing expired yet.
+  arbiter.Expire(ros::Time(11.0));
+  EXPECT_EQ(arbiter.active_priority(), 0);
+  // Topic 1 loses but stays alive.
+  EXPECT_FALSE(arbiter.Arbitrate(1, ros::Time(11.2)));
+
+  // Topic 1 takes over right when topic 0 expires.
+  arbiter.Expire(ros::Time(11.6));
+  EXPECT_EQ(arbiter.active_priority(), 1);
+  EXPECT_EQ(arbiter.ActiveDeadline(), ros::Time(12.2));
+  arbiter.Expire(ros::Time(12.3));
+  EXPECT_EQ(arbiter.active_priority(), PriorityArbiter::kNoSource);
+
+  std::vector<priority_mux::PriorityTransition> transitions;
+  arbiter.TakeTransitions(&transitions);
+  ASSERT_EQ(transitions.size(), 4);
+  EXPECT_EQ(transitions[0].stamp, ros::Time(10.0));
+  EXPECT_EQ(transitions[0].from_priority, PriorityArbiter::kNoSource);
+  EXPECT_EQ(transitions[0].to_priority, 1);
+  EXPECT_EQ(transitions[1].stamp, ros::Time(10.5));
+  EXPECT_EQ(transitions[1].from_priority, 1);
+  EXPECT_EQ(transitions[1].to_priority, 0);
+  EXPECT_EQ(transitions[2].stamp, ros::Time(11.6));
+  EXPECT_EQ(transitions[2].from_priority, 0);
+  EXPECT_EQ(transitions[2].to_priority, 1);
+  EXPECT_EQ(transitions[3].stamp, ros::Time(12.3));
+  EXPECT_EQ(transitions[3].from_priority, 1);
+  EXPECT_EQ(transitions[3].to_priority, PriorityArbiter::kNoSource);
+  transitions.clear();
+  arbiter.TakeTransitions(&transitions);
+  EXPECT_TRUE(transitions.empty());
+}
+
+TEST(PriorityArbiterTest, MessageAfterDeadlineHandsOver) {
+  PriorityArbiter arbiter(ros::Duration(1.0));
+  arbiter.AddSource("topic_0");
+  arbiter.AddSource("topic_1");
+  EXPECT_TRUE(arbiter.Arbitrate(0, ros::Time(10.0)));
+  EXPECT_FALSE(arbiter.Arbitrate(1, ros::Time(10.5)));
+  // Expire was not called, the message still wins.
+  EXPECT_TRUE(arbiter.Arbitrate(1, ros::Time(11.1)));
+  EXPECT_EQ(arbiter.active_priority(), 1);
+  EXPECT_TRUE(arbiter.Arbitrate(0, ros::Time(11.2)));
+  EXPECT_EQ(arbiter.active_priority(), 0);
+}
+
+static void PingRepeatedly(ExpiringSubscription *subscription, int offset, int step, int count) {
+  for (int i = 0; i < count; i++) {
+    ros::Time stamp;
+    stamp.fromNSec(1000000000ULL + (offset + i * step) * 1000ULL);
+    subscription->Ping(stamp);
+  }
+}
+
+TEST(PriorityArbiterTest, ConcurrentPings) {
+  const int kThreads = 4;
+  const int kPings = 10000;
+  ExpiringSubscription subscription("topic", 0, ros::Duration(1.0), ros::Subscriber());
+  subscription.Ping(ros::Time(1.0));
+  boost::thread_group threads;
+  for (int i = 0; i < kThreads; i++) {
+    threads.create_thread(
+        boost::bind(&PingRepeatedly, &subscription, i + 1, kThreads, kPings));
+  }
+  threads.join_all();
+  // Pings that arrive late are ignored, so the runtime is the time
+  // between the first and the newest ping.
+  EXPECT_EQ(subscription.runtime().toNSec(), kThreads * kPings * 1000LL);
+  EXPECT_FALSE(subscription.IsExpired(ros::Time(1.5)));
+  EXPECT_TRUE(subscription.IsExpired(ros::Time(2.5)));
+}
+
+int main(int argc, char *argv[]) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
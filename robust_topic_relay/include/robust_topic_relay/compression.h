@@ -0,0 +1,86 @@
+// Copyright 2011 Google Inc.
+// Author: moesenle@google.com (Lorenz Moesenlechner)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef ROBUST_TOPIC_RELAY_COMPRESSION_H
+#define ROBUST_TOPIC_RELAY_COMPRESSION_H
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include <topic_tools/shape_shifter.h>
+
+namespace robust_topic_relay {
+
+/**
+ * The compression formats of
+ * robust_topic_relay_msgs/CompressedMessage.
+ */
+enum CompressionFormat {
+  kZlib = 0,
+  kBzip2 = 1
+};
+
+/**
+ * Returns false if name is neither "zlib" nor "bzip2".
+ */
+bool ParseCompressionFormat(const std::string &name, CompressionFormat *format);
+
+/**
+ * Compresses size bytes of data into compressed. level is between 1
+ * (fastest) and 9 (smallest). Returns false on errors.
+ */
+bool CompressBytes(CompressionFormat format, int level, const uint8_t *data, size_t size,
+                   std::vector<uint8_t> *compressed);
+
+/**
+ * Decompresses data that was compressed with CompressBytes into
+ * uncompressed_size bytes. Returns false on errors, including when
+ * the data does not decompress to exactly uncompressed_size bytes.
+ * Allocates uncompressed_size bytes before decompressing, so callers
+ * must bound sizes that come from untrusted messages.
+ */
+bool DecompressBytes(CompressionFormat format, const uint8_t *data, size_t size,
+                     size_t uncompressed_size, std::vector<uint8_t> *uncompressed);
+
+/**
+ * Returns true if size bytes of data are a serialized
+ * robust_topic_relay_msgs/CompressedMessage whose strings and data
+ * exactly fill them. Deserializing resizes the fields to the lengths
+ * the message claims before checking them, so untrusted messages are
+ * checked with this first.
+ */
+bool IsValidCompressedMessage(const uint8_t *data, size_t size);
+
+/**
+ * Wraps message into a robust_topic_relay_msgs/CompressedMessage.
+ * Returns a null pointer on errors.
+ */
+topic_tools::ShapeShifter::Ptr CompressMessage(
+    CompressionFormat format, int level, const topic_tools::ShapeShifter &message);
+
+/**
+ * Unwraps a message compressed by CompressMessage. Returns a null
+ * pointer if message is not a CompressedMessage of the same
+ * definition, is malformed, claims more than max_uncompressed_size
+ * uncompressed bytes or does not decompress.
+ */
+topic_tools::ShapeShifter::Ptr DecompressMessage(
+    size_t max_uncompressed_size, const topic_tools::ShapeShifter &message);
+
+}  // namespace robust_topic_relay
+
+#endif  // ROBUST_TOPIC_RELAY_COMPRESSION_H
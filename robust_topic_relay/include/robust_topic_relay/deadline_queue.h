@@ -0,0 +1,99 @@
+// Copyright 2011 Google Inc.
+// Author: moesenle@google.com (Lorenz Moesenlechner)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef ROBUST_TOPIC_RELAY_DEADLINE_QUEUE_H
+#define ROBUST_TOPIC_RELAY_DEADLINE_QUEUE_H
+
+#include <vector>
+
+#include <ros/time.h>
+
+namespace robust_topic_relay {
+
+/**
+ * A min-heap of deadlines keyed by (deadline, id). Every id is in
+ * the queue at most once and its deadline can be changed or removed
+ * in O(log n). Ids are small integers, e.g. indices into a vector.
+ */
+class DeadlineQueue {
+ public:
+  /**
+   * Sets the deadline of id. Adds id if it is not in the queue.
+   */
+  void Schedule(size_t id, const ros::Time &deadline);
+
+  /**
+   * Removes id if it is in the queue.
+   */
+  void Remove(size_t id);
+
+  bool Contains(size_t id) const {
+    return id < positions_.size() && positions_[id] != kNotQueued;
+  }
+
+  bool empty() const {
+    return heap_.empty();
+  }
+
+  size_t size() const {
+    return heap_.size();
+  }
+
+  /**
+   * The earliest deadline. The queue must not be empty.
+   */
+  const ros::Time &top_deadline() const {
+    return heap_[0].deadline;
+  }
+
+  /**
+   * The id with the earliest deadline. Ids with the same deadline
+   * are ordered by id. The queue must not be empty.
+   */
+  size_t top_id() const {
+    return heap_[0].id;
+  }
+
+  /**
+   * Removes the id with the earliest deadline.
+   */
+  void Pop();
+
+ private:
+  static const size_t kNotQueued = static_cast<size_t>(-1);
+
+  struct Entry {
+    ros::Time deadline;
+    size_t id;
+  };
+
+  std::vector<Entry> heap_;
+  // The position of every id in heap_ or kNotQueued.
+  std::vector<size_t> positions_;
+
+  static bool Earlier(const Entry &entry_1, const Entry &entry_2) {
+    return entry_1.deadline < entry_2.deadline ||
+        (entry_1.deadline == entry_2.deadline && entry_1.id < entry_2.id);
+  }
+
+  void RemoveAt(size_t position);
+  void SiftUp(size_t position);
+  void SiftDown(size_t position);
+  void Place(size_t position, const Entry &entry);
+};
+
+}  // namespace robust_topic_relay
+
+#endif  // ROBUST_TOPIC_RELAY_DEADLINE_QUEUE_H
@@ -0,0 +1,76 @@
+// Copyright 2011 Google Inc.
+// Author: moesenle@google.com (Lorenz Moesenlechner)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef ROBUST_TOPIC_RELAY_MESSAGE_BUFFER_H
+#define ROBUST_TOPIC_RELAY_MESSAGE_BUFFER_H
+
+#include <deque>
+#include <vector>
+
+#include <topic_tools/shape_shifter.h>
+
+namespace robust_topic_relay {
+
+/**
+ * Keeps the most recent messages of a topic, bounded by the number
+ * of messages and the total number of serialized bytes. The oldest
+ * messages are dropped first. A buffer of one message keeps only the
+ * latest message.
+ */
+class MessageBuffer {
+ public:
+  /**
+   * @param max_messages the most messages to keep. 0 disables the buffer.
+   * @param max_bytes the most serialized bytes to keep. 0 means
+   *     no byte limit.
+   */
+  MessageBuffer(size_t max_messages, size_t max_bytes);
+
+  /**
+   * Adds a message and drops the oldest messages that exceed the
+   * budgets. A message that is larger than the byte budget on its
+   * own is not kept.
+   */
+  void Add(const topic_tools::ShapeShifter::ConstPtr &message);
+
+  /**
+   * Appends the buffered messages to messages, oldest first.
+   */
+  void GetMessages(std::vector<topic_tools::ShapeShifter::ConstPtr> *messages) const;
+
+  bool enabled() const {
+    return max_messages_ > 0;
+  }
+
+  size_t size() const {
+    return messages_.size();
+  }
+
+  size_t bytes() const {
+    return bytes_;
+  }
+
+ private:
+  size_t max_messages_;
+  size_t max_bytes_;
+  std::deque<topic_tools::ShapeShifter::ConstPtr> messages_;
+  size_t bytes_;
+
+  void PopFront();
+};
+
+}  // namespace robust_topic_relay
+
+#endif  // ROBUST_TOPIC_RELAY_MESSAGE_BUFFER_H
@@ -0,0 +1,83 @@
+// Copyright 2011 Google Inc.
+// Author: moesenle@google.com (Lorenz Moesenlechner)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef ROBUST_TOPIC_RELAY_PENDING_MESSAGES_H
+#define ROBUST_TOPIC_RELAY_PENDING_MESSAGES_H
+
+#include <vector>
+
+#include <ros/time.h>
+#include <topic_tools/shape_shifter.h>
+
+#include "robust_topic_relay/deadline_queue.h"
+
+namespace robust_topic_relay {
+
+/**
+ * The messages of coalescing topics that wait for their throttle, at
+ * most one per topic, ordered by the time they may be sent. Topics
+ * are identified by small integers, like in DeadlineQueue.
+ */
+class PendingMessages {
+ public:
+  /**
+   * Keeps message until send_time. Replaces the pending message of
+   * topic_id if there is one.
+   *
+   * @return true if a pending message was replaced.
+   */
+  bool Add(size_t topic_id, const ros::Time &send_time,
+           const topic_tools::ShapeShifter::ConstPtr &message);
+
+  /**
+   * Drops the pending message of topic_id.
+   *
+   * @return false if topic_id had no pending message.
+   */
+  bool Remove(size_t topic_id);
+
+  /**
+   * Removes the message with the earliest send time if that is not
+   * after now.
+   *
+   * @return false if no message may be sent at now.
+   */
+  bool PopDue(const ros::Time &now, size_t *topic_id,
+              topic_tools::ShapeShifter::ConstPtr *message);
+
+  bool empty() const {
+    return send_times_.empty();
+  }
+
+  size_t size() const {
+    return send_times_.size();
+  }
+
+  /**
+   * The send times of the pending messages, keyed by topic id.
+   */
+  const DeadlineQueue &send_times() const {
+    return send_times_;
+  }
+
+ private:
+  DeadlineQueue send_times_;
+  // Indexed by topic id. Null if the topic has no pending message.
+  std::vector<topic_tools::ShapeShifter::ConstPtr> messages_;
+};
+
+}  // namespace robust_topic_relay
+
+#endif  // ROBUST_TOPIC_RELAY_PENDING_MESSAGES_H
@@ -18,54 +18,204 @@
 
 #include <string>
 #include <map>
+#include <vector>
+#include <boost/thread/condition_variable.hpp>
 #include <boost/thread/mutex.hpp>
 
 #include <ros/ros.h>
 #include <topic_tools/shape_shifter.h>
 
+#include "robust_topic_relay/compression.h"
+#include "robust_topic_relay/deadline_queue.h"
+#include "robust_topic_relay/message_buffer.h"
+#include "robust_topic_relay/pending_messages.h"
+#include "robust_topic_relay/topic_throttle.h"
+
 namespace robust_topic_relay {
 
+enum RelayMode {
+  // Relays messages unchanged.
+  kRelay,
+  // Publishes messages compressed as robust_topic_relay_msgs/CompressedMessage.
+  kCompress,
+  // Restores messages from robust_topic_relay_msgs/CompressedMessage.
+  kDecompress
+};
+
+/**
+ * How messages of a topic are converted before they are relayed.
+ */
+struct Conversion {
+  RelayMode mode;
+  // Only used by kCompress. kDecompress reads the format from the message.
+  CompressionFormat compression_format;
+  // Between 1 (fastest) and 9 (smallest).
+  int compression_level;
+  // Only used by kDecompress. Messages that claim to decompress to
+  // more bytes are dropped before any memory is allocated for them.
+  size_t max_uncompressed_size;
+
+  Conversion()
+    : mode(kRelay),
+      compression_format(kZlib),
+      compression_level(1),
+      max_uncompressed_size(64 * 1024 * 1024) {}
+};
+
+struct TopicOptions {
+  // The topic is reconnected if no message arrives for
+  // 1 / expected_frequency seconds.
+  double expected_frequency;
+  // The topic is reconnected again after 1 / reconnect_frequency
+  // seconds as long as no message arrives.
+  double reconnect_frequency;
+  // The last buffer_messages messages, at most buffer_bytes
+  // serialized bytes, are replayed to every subscriber that connects
+  // to the output topic, e.g. after the subscriber lost its
+  // connection. buffer_messages = 1 replays only the latest message,
+  // 0 disables replay. buffer_bytes = 0 means no byte limit.
+  size_t buffer_messages;
+  size_t buffer_bytes;
+  // The most messages per second to publish. 0 means no limit.
+  double max_frequency;
+  // If true, a message that exceeds the rate cap or the bandwidth
+  // share is published as soon as possible unless a newer message
+  // arrives before. Otherwise it is dropped.
+  bool coalesce;
+  // The weight of the topic when the bandwidth budget is split
+  // between topics.
+  int priority;
+  Conversion conversion;
+
+  TopicOptions()
+    : expected_frequency(0.0),
+      reconnect_frequency(0.0),
+      buffer_messages(0),
+      buffer_bytes(0),
+      max_frequency(0.0),
+      coalesce(false),
+      priority(1) {}
+};
+
 class RobustTopicRelay {
  public:
   RobustTopicRelay(const ros::NodeHandle &node_handle);
+
+  /**
+   * Relays input_topic_name to output_topic_name.
+   */
   void AddTopic(
       const std::string &input_topic_name, const std::string &output_topic_name,
-      double expected_frequency, double reconnect_frequency);
+      const TopicOptions &options);
+
+  /**
+   * Limits the bytes per second all output topics publish
+   * together. Every topic gets a share of the budget that is
+   * proportional to its priority. 0 means no limit.
+   */
+  void SetBandwidthBudget(double bandwidth_budget);
+
   void Run();
 
  private:
+  struct TopicStatistics {
+    unsigned int received;
+    unsigned int published;
+    uint64_t published_bytes;
+    unsigned int dropped;
+    unsigned int coalesced;
+
+    TopicStatistics()
+      : received(0),
+        published(0),
+        published_bytes(0),
+        dropped(0),
+        coalesced(0) {}
+  };
+
   struct RelayedTopic {
     std::string input_topic_name;
     std::string output_topic_name;
     ros::Subscriber subscriber;
     ros::Publisher publisher;
-    ros::Time expiration_time;
     ros::Duration expected_delay;
     ros::Duration reconnect_delay;
     bool connected;
+    MessageBuffer buffer;
+    TopicThrottle throttle;
+    bool coalesce;
+    int priority;
+    Conversion conversion;
+    TopicStatistics statistics;
 
-    RelayedTopic() {}
     RelayedTopic(const std::string &input_topic_name,
                  const std::string &output_topic_name,
-                 const ros::Duration &expected_delay,
-                 const ros::Duration &reconnect_delay)
+                 const TopicOptions &options)
       : input_topic_name(input_topic_name),
         output_topic_name(output_topic_name),
-        expected_delay(expected_delay),
-        reconnect_delay(reconnect_delay),
-        connected(false) {}
+        expected_delay(1.0 / options.expected_frequency),
+        reconnect_delay(1.0 / options.reconnect_frequency),
+        connected(false),
+        buffer(options.buffer_messages, options.buffer_bytes),
+        throttle(options.max_frequency, 0.0),
+        coalesce(options.coalesce),
+        priority(options.priority),
+        conversion(options.conversion) {}
   };
 
+  struct OutgoingMessage {
+    ros::Publisher publisher;
+    topic_tools::ShapeShifter::ConstPtr message;
+  };
+
+  // The longest Run waits without checking ros::ok().
+  static const double kMaxWaitDuration;
+  // The period of publishing statistics.
+  static const double kStatisticsPeriod;
+
   ros::NodeHandle node_handle_;
-  std::map<std::string, RelayedTopic> relayed_topics_;
-  std::map<ros::Time, std::string> expiring_topics_;
+  ros::Publisher statistics_publisher_;
+  // Relayed topics, indexed by topic id.
+  std::vector<RelayedTopic> relayed_topics_;
+  std::map<std::string, size_t> topic_ids_;
+  double bandwidth_budget_;
+  // The time each topic expires at if no message arrives before.
+  DeadlineQueue expiration_times_;
+  // The messages of coalescing topics that wait for the throttle.
+  PendingMessages pending_messages_;
+  ros::Time statistics_start_time_;
   boost::mutex mutex_;
-  
+  // Wakes up Run when a deadline earlier than all others is added.
+  boost::condition_variable deadlines_changed_;
+
   void MessageCallback(
-      const std::string topic_name, const topic_tools::ShapeShifter::ConstPtr &message);
-  bool FindNextExpirationDuration(ros::Duration *expire_duration);
-  void ReconnectExpiredTopics();
-  void ConnectRelayedTopic(const std::string &topic_name);
+      size_t topic_id, const Conversion &conversion,
+      const topic_tools::ShapeShifter::ConstPtr &message);
+  void SubscriberConnectCallback(
+      size_t topic_id, const ros::SingleSubscriberPublisher &subscriber);
+  void ReconnectExpiredTopics(const ros::Time &now);
+  void ConnectRelayedTopic(size_t topic_id);
+  /**
+   * Adds the message to outgoing_messages if the throttle of the
+   * topic allows to publish it now. Otherwise keeps the message as
+   * pending message of coalescing topics and drops it for all others.
+   */
+  void ThrottleMessage(size_t topic_id, const ros::Time &now,
+                       const topic_tools::ShapeShifter::ConstPtr &message,
+                       std::vector<OutgoingMessage> *outgoing_messages);
+  void SendPendingMessages(const ros::Time &now,
+                           std::vector<OutgoingMessage> *outgoing_messages);
+  void UpdateBandwidthShares();
+  void PublishStatistics(const ros::Time &now);
+  static ros::Duration FindWaitDuration(
+      const DeadlineQueue &deadlines, const ros::Time &now, const ros::Duration &wait_duration);
+  static void Publish(const std::vector<OutgoingMessage> &outgoing_messages);
+  /**
+   * Converts message according to conversion. Returns a null pointer
+   * if the message cannot be converted.
+   */
+  static topic_tools::ShapeShifter::ConstPtr ConvertMessage(
+      const Conversion &conversion, const topic_tools::ShapeShifter::ConstPtr &message);
 };
 
 }  // namespace robust_topic_relay
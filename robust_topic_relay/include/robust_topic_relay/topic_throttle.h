@@ -0,0 +1,84 @@
+// Copyright 2011 Google Inc.
+// Author: moesenle@google.com (Lorenz Moesenlechner)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef ROBUST_TOPIC_RELAY_TOPIC_THROTTLE_H
+#define ROBUST_TOPIC_RELAY_TOPIC_THROTTLE_H
+
+#include <vector>
+
+#include <ros/time.h>
+
+namespace robust_topic_relay {
+
+/**
+ * Limits the message rate and the bandwidth of a topic. The
+ * bandwidth is limited with a token bucket that holds up to one
+ * second of bandwidth. A message may be sent whenever the bucket is
+ * not empty, even if it is larger than the tokens left, and the
+ * following messages wait until the debt is paid back. This way,
+ * messages larger than the bucket are still sent.
+ */
+class TopicThrottle {
+ public:
+  /**
+   * @param max_frequency the most messages per second. 0 means no limit.
+   * @param bandwidth the most bytes per second. 0 means no limit.
+   */
+  TopicThrottle(double max_frequency, double bandwidth);
+
+  /**
+   * Returns the earliest time the next message may be sent. The
+   * message may be sent immediately if the result is not after now.
+   */
+  ros::Time FindNextSendTime(const ros::Time &now) const;
+
+  /**
+   * Records that a message of message_bytes was sent at now.
+   */
+  void Send(const ros::Time &now, size_t message_bytes);
+
+  /**
+   * Changes the bandwidth. 0 means no limit.
+   */
+  void set_bandwidth(double bandwidth);
+
+  double bandwidth() const {
+    return bandwidth_;
+  }
+
+ private:
+  // The duration of bandwidth the bucket holds.
+  static const double kBurstDuration;
+
+  ros::Duration min_period_;
+  double bandwidth_;
+  ros::Time last_send_time_;
+  // Tokens in the bucket at last_send_time_. Negative while in debt.
+  double tokens_;
+
+  double FindTokens(const ros::Time &now) const;
+};
+
+/**
+ * Splits bandwidth_budget into one share per topic that is
+ * proportional to the topic's priority. All priorities must be
+ * positive. A budget of 0, i.e. no limit, gives every topic 0.
+ */
+void SplitBandwidthBudget(double bandwidth_budget, const std::vector<int> &priorities,
+                          std::vector<double> *shares);
+
+}  // namespace robust_topic_relay
+
+#endif  // ROBUST_TOPIC_RELAY_TOPIC_THROTTLE_H
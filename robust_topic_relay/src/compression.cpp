@@ -0,0 +1,230 @@
+// Copyright 2011 Google Inc.
+// Author: moesenle@google.com (Lorenz Moesenlechner)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "robust_topic_relay/compression.h"
+
+#include <bzlib.h>
+#include <string.h>
+#include <zlib.h>
+
+#include <exception>
+
+#include <boost/shared_array.hpp>
+
+#include <ros/ros.h>
+#include <robust_topic_relay_msgs/CompressedMessage.h>
+
+namespace robust_topic_relay {
+
+namespace {
+
+void SerializeMessage(const topic_tools::ShapeShifter &message, std::vector<uint8_t> *data) {
+  data->resize(message.size());
+  ros::serialization::OStream stream(data->empty() ? NULL : &(*data)[0], data->size());
+  message.write(stream);
+}
+
+topic_tools::ShapeShifter::Ptr MakeShapeShifter(
+    const std::string &datatype, const std::string &md5sum,
+    const std::string &message_definition, uint8_t *data, size_t size) {
+  topic_tools::ShapeShifter::Ptr message(new topic_tools::ShapeShifter);
+  message->morph(md5sum, datatype, message_definition, "");
+  ros::serialization::IStream stream(data, size);
+  message->read(stream);
+  return message;
+}
+
+// Advances offset past the length prefix of a string or byte array
+// and the bytes it counts. Returns false if they do not fit into size.
+bool SkipByteArray(const uint8_t *data, size_t size, size_t *offset) {
+  uint32_t length;
+  if (size - *offset < sizeof(length)) {
+    return false;
+  }
+  memcpy(&length, data + *offset, sizeof(length));
+  *offset += sizeof(length);
+  if (length > size - *offset) {
+    return false;
+  }
+  *offset += length;
+  return true;
+}
+
+}  // namespace
+
+bool ParseCompressionFormat(const std::string &name, CompressionFormat *format) {
+  if (name == "zlib") {
+    *format = kZlib;
+    return true;
+  } else if (name == "bzip2") {
+    *format = kBzip2;
+    return true;
+  }
+  return false;
+}
+
+bool CompressBytes(CompressionFormat format, int level, const uint8_t *data, size_t size,
+                   std::vector<uint8_t> *compressed) {
+  switch (format) {
+    case kZlib: {
+      uLongf compressed_size = compressBound(size);
+      compressed->resize(compressed_size);
+      if (compress2(&(*compressed)[0], &compressed_size, data, size, level) != Z_OK) {
+        return false;
+      }
+      compressed->resize(compressed_size);
+      return true;
+    }
+    case kBzip2: {
+      // The worst case size documented for BZ2_bzBuffToBuffCompress.
+      unsigned int compressed_size = size + size / 100 + 600;
+      compressed->resize(compressed_size);
+      if (BZ2_bzBuffToBuffCompress(
+              reinterpret_cast<char *>(&(*compressed)[0]), &compressed_size,
+              reinterpret_cast<char *>(const_cast<uint8_t *>(data)), size,
+              level, 0, 0) != BZ_OK) {
+        return false;
+      }
+      compressed->resize(compressed_size);
+      return true;
+    }
+  }
+  return false;
+}
+
+bool DecompressBytes(CompressionFormat format, const uint8_t *data, size_t size,
+                     size_t uncompressed_size, std::vector<uint8_t> *uncompressed) {
+  // Reserve one more byte so that data that decompresses to more
+  // than uncompressed_size bytes is detected.
+  uncompressed->resize(uncompressed_size + 1);
+  switch (format) {
+    case kZlib: {
+      uLongf result_size = uncompressed->size();
+      if (uncompress(&(*uncompressed)[0], &result_size, data, size) != Z_OK ||
+          result_size != uncompressed_size) {
+        return false;
+      }
+      break;
+    }
+    case kBzip2: {
+      unsigned int result_size = uncompressed->size();
+      if (BZ2_bzBuffToBuffDecompress(
+              reinterpret_cast<char *>(&(*uncompressed)[0]), &result_size,
+              reinterpret_cast<char *>(const_cast<uint8_t *>(data)), size, 0, 0) != BZ_OK ||
+          result_size != uncompressed_size) {
+        return false;
+      }
+      break;
+    }
+    default:
+      return false;
+  }
+  uncompressed->resize(uncompressed_size);
+  return true;
+}
+
+bool IsValidCompressedMessage(const uint8_t *data, size_t size) {
+  size_t offset = 0;
+  // datatype, md5sum and message_definition.
+  for (int i = 0; i < 3; i++) {
+    if (!SkipByteArray(data, size, &offset)) {
+      return false;
+    }
+  }
+  // format and uncompressed_size.
+  if (size - offset < sizeof(uint8_t) + sizeof(uint32_t)) {
+    return false;
+  }
+  offset += sizeof(uint8_t) + sizeof(uint32_t);
+  return SkipByteArray(data, size, &offset) && offset == size;
+}
+
+topic_tools::ShapeShifter::Ptr CompressMessage(
+    CompressionFormat format, int level, const topic_tools::ShapeShifter &message) {
+  std::vector<uint8_t> data;
+  SerializeMessage(message, &data);
+  robust_topic_relay_msgs::CompressedMessage compressed_message;
+  compressed_message.datatype = message.getDataType();
+  compressed_message.md5sum = message.getMD5Sum();
+  compressed_message.message_definition = message.getMessageDefinition();
+  compressed_message.format = format;
+  compressed_message.uncompressed_size = data.size();
+  if (!CompressBytes(format, level, data.empty() ? NULL : &data[0], data.size(),
+                     &compressed_message.data)) {
+    return topic_tools::ShapeShifter::Ptr();
+  }
+
+  uint32_t size = ros::serialization::serializationLength(compressed_message);
+  boost::shared_array<uint8_t> buffer(new uint8_t[size]);
+  ros::serialization::OStream stream(buffer.get(), size);
+  ros::serialization::serialize(stream, compressed_message);
+  return MakeShapeShifter(
+      ros::message_traits::datatype(compressed_message),
+      ros::message_traits::md5sum(compressed_message),
+      ros::message_traits::definition(compressed_message),
+      buffer.get(), size);
+}
+
+topic_tools::ShapeShifter::Ptr DecompressMessage(
+    size_t max_uncompressed_size, const topic_tools::ShapeShifter &message) {
+  // A publisher with another version of CompressedMessage has the
+  // same datatype but a different md5sum.
+  if (message.getDataType() !=
+      ros::message_traits::datatype<robust_topic_relay_msgs::CompressedMessage>() ||
+      message.getMD5Sum() !=
+      ros::message_traits::md5sum<robust_topic_relay_msgs::CompressedMessage>()) {
+    ROS_WARN("Cannot decompress message of type %s with md5sum %s",
+             message.getDataType().c_str(), message.getMD5Sum().c_str());
+    return topic_tools::ShapeShifter::Ptr();
+  }
+  std::vector<uint8_t> serialized;
+  SerializeMessage(message, &serialized);
+  if (!IsValidCompressedMessage(serialized.empty() ? NULL : &serialized[0], serialized.size())) {
+    ROS_WARN("Malformed compressed message of %lu bytes",
+             static_cast<unsigned long>(serialized.size()));
+    return topic_tools::ShapeShifter::Ptr();
+  }
+  robust_topic_relay_msgs::CompressedMessage compressed_message;
+  try {
+    ros::serialization::IStream stream(serialized.empty() ? NULL : &serialized[0],
+                                       serialized.size());
+    ros::serialization::deserialize(stream, compressed_message);
+  } catch (std::exception &e) {
+    // Also catches ros::Exception.
+    ROS_WARN("Malformed compressed message: %s", e.what());
+    return topic_tools::ShapeShifter::Ptr();
+  }
+  // The size is not trusted. DecompressBytes allocates it up front.
+  if (compressed_message.uncompressed_size > max_uncompressed_size) {
+    ROS_WARN("Compressed message of type %s claims %u uncompressed bytes, more than the "
+             "maximum of %lu", compressed_message.datatype.c_str(),
+             compressed_message.uncompressed_size,
+             static_cast<unsigned long>(max_uncompressed_size));
+    return topic_tools::ShapeShifter::Ptr();
+  }
+  const std::vector<uint8_t> &compressed_data = compressed_message.data;
+  std::vector<uint8_t> data;
+  if (!DecompressBytes(static_cast<CompressionFormat>(compressed_message.format),
+                       compressed_data.empty() ? NULL : &compressed_data[0],
+                       compressed_data.size(), compressed_message.uncompressed_size,
+                       &data)) {
+    return topic_tools::ShapeShifter::Ptr();
+  }
+  return MakeShapeShifter(
+      compressed_message.datatype, compressed_message.md5sum,
+      compressed_message.message_definition, data.empty() ? NULL : &data[0], data.size());
+}
+
+}  // namespace robust_topic_relay
@@ -0,0 +1,102 @@
+// Copyright 2011 Google Inc.
+// Author: moesenle@google.com (Lorenz Moesenlechner)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "robust_topic_relay/deadline_queue.h"
+
+namespace robust_topic_relay {
+
+const size_t DeadlineQueue::kNotQueued;
+
+void DeadlineQueue::Schedule(size_t id, const ros::Time &deadline) {
+  if (id >= positions_.size()) {
+    positions_.resize(id + 1, kNotQueued);
+  }
+  Entry entry;
+  entry.deadline = deadline;
+  entry.id = id;
+  size_t position = positions_[id];
+  if (position == kNotQueued) {
+    heap_.push_back(entry);
+    positions_[id] = heap_.size() - 1;
+    SiftUp(heap_.size() - 1);
+  } else if (Earlier(entry, heap_[position])) {
+    heap_[position] = entry;
+    SiftUp(position);
+  } else {
+    heap_[position] = entry;
+    SiftDown(position);
+  }
+}
+
+void DeadlineQueue::Remove(size_t id) {
+  if (Contains(id)) {
+    RemoveAt(positions_[id]);
+  }
+}
+
+void DeadlineQueue::Pop() {
+  RemoveAt(0);
+}
+
+void DeadlineQueue::RemoveAt(size_t position) {
+  positions_[heap_[position].id] = kNotQueued;
+  Entry last = heap_.back();
+  heap_.pop_back();
+  if (position == heap_.size()) {
+    return;
+  }
+  Place(position, last);
+  SiftUp(position);
+  SiftDown(positions_[last.id]);
+}
+
+void DeadlineQueue::SiftUp(size_t position) {
+  Entry entry = heap_[position];
+  while (position > 0) {
+    size_t parent = (position - 1) / 2;
+    if (!Earlier(entry, heap_[parent])) {
+      break;
+    }
+    Place(position, heap_[parent]);
+    position = parent;
+  }
+  Place(position, entry);
+}
+
+void DeadlineQueue::SiftDown(size_t position) {
+  Entry entry = heap_[position];
+  while (true) {
+    size_t child = 2 * position + 1;
+    if (child >= heap_.size()) {
+      break;
+    }
+    if (child + 1 < heap_.size() && Earlier(heap_[child + 1], heap_[child])) {
+      child++;
+    }
+    if (!Earlier(heap_[child], entry)) {
+      break;
+    }
+    Place(position, heap_[child]);
+    position = child;
+  }
+  Place(position, entry);
+}
+
+void DeadlineQueue::Place(size_t position, const Entry &entry) {
+  heap_[position] = entry;
+  positions_[entry.id] = position;
+}
+
+}  // namespace robust_topic_relay
@@ -0,0 +1,52 @@
+// Copyright 2011 Google Inc.
+// Author: moesenle@google.com (Lorenz Moesenlechner)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "robust_topic_relay/message_buffer.h"
+
+namespace robust_topic_relay {
+
+MessageBuffer::MessageBuffer(size_t max_messages, size_t max_bytes)
+  : max_messages_(max_messages),
+    max_bytes_(max_bytes),
+    bytes_(0) {
+}
+
+void MessageBuffer::Add(const topic_tools::ShapeShifter::ConstPtr &message) {
+  if (!enabled()) {
+    return;
+  }
+  size_t message_bytes = message->size();
+  if (max_bytes_ > 0 && message_bytes > max_bytes_) {
+    return;
+  }
+  messages_.push_back(message);
+  bytes_ += message_bytes;
+  while (messages_.size() > max_messages_ ||
+         (max_bytes_ > 0 && bytes_ > max_bytes_)) {
+    PopFront();
+  }
+}
+
+void MessageBuffer::GetMessages(
+    std::vector<topic_tools::ShapeShifter::ConstPtr> *messages) const {
+  messages->insert(messages->end(), messages_.begin(), messages_.end());
+}
+
+void MessageBuffer::PopFront() {
+  bytes_ -= messages_.front()->size();
+  messages_.pop_front();
+}
+
+}  // namespace robust_topic_relay
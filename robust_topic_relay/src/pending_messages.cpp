@@ -0,0 +1,52 @@
+// Copyright 2011 Google Inc.
+// Author: moesenle@google.com (Lorenz Moesenlechner)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "robust_topic_relay/pending_messages.h"
+
+namespace robust_topic_relay {
+
+bool PendingMessages::Add(size_t topic_id, const ros::Time &send_time,
+                          const topic_tools::ShapeShifter::ConstPtr &message) {
+  if (topic_id >= messages_.size()) {
+    messages_.resize(topic_id + 1);
+  }
+  bool replaced = send_times_.Contains(topic_id);
+  messages_[topic_id] = message;
+  send_times_.Schedule(topic_id, send_time);
+  return replaced;
+}
+
+bool PendingMessages::Remove(size_t topic_id) {
+  if (!send_times_.Contains(topic_id)) {
+    return false;
+  }
+  send_times_.Remove(topic_id);
+  messages_[topic_id].reset();
+  return true;
+}
+
+bool PendingMessages::PopDue(const ros::Time &now, size_t *topic_id,
+                             topic_tools::ShapeShifter::ConstPtr *message) {
+  if (send_times_.empty() || send_times_.top_deadline() > now) {
+    return false;
+  }
+  *topic_id = send_times_.top_id();
+  send_times_.Pop();
+  message->reset();
+  message->swap(messages_[*topic_id]);
+  return true;
+}
+
+}  // namespace robust_topic_relay
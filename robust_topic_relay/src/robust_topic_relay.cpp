@@ -15,99 +15,250 @@
 
 #include "robust_topic_relay/robust_topic_relay.h"
 
+#include <algorithm>
+#include <vector>
+
 #include <ros_check/ros_check.h>
+#include <robust_topic_relay_msgs/RelayStatistics.h>
 #include <topic_tools/shape_shifter.h>
 
 namespace robust_topic_relay {
 
+const double RobustTopicRelay::kMaxWaitDuration = 1.0;
+const double RobustTopicRelay::kStatisticsPeriod = 1.0;
+
 RobustTopicRelay::RobustTopicRelay(const ros::NodeHandle &node_handle)
-  : node_handle_(node_handle) {
+  : node_handle_(node_handle),
+    bandwidth_budget_(0.0) {
+  statistics_publisher_ =
+      node_handle_.advertise<robust_topic_relay_msgs::RelayStatistics>("statistics", 10);
 }
 
 void RobustTopicRelay::AddTopic(
     const std::string &input_topic_name, const std::string &output_topic_name,
-    double expected_frequency, double reconnect_frequency) {
-  RobustTopicRelay::RelayedTopic relayed_topic(
-      input_topic_name, output_topic_name,
-      ros::Duration(1.0 / expected_frequency),
-      ros::Duration(1.0 / reconnect_frequency));
+    const TopicOptions &options) {
+  CHECK(options.priority > 0);
+  RobustTopicRelay::RelayedTopic relayed_topic(input_topic_name, output_topic_name, options);
+
+  boost::mutex::scoped_lock lock(mutex_);
+  CHECK(topic_ids_.find(input_topic_name) == topic_ids_.end());
+  size_t topic_id = relayed_topics_.size();
+  topic_ids_[input_topic_name] = topic_id;
+  relayed_topics_.push_back(relayed_topic);
+  UpdateBandwidthShares();
+  ConnectRelayedTopic(topic_id);
+  if (expiration_times_.top_id() == topic_id) {
+    deadlines_changed_.notify_all();
+  }
+}
 
+void RobustTopicRelay::SetBandwidthBudget(double bandwidth_budget) {
   boost::mutex::scoped_lock lock(mutex_);
-  CHECK(relayed_topics_.find(input_topic_name) == relayed_topics_.end());
-  relayed_topics_[input_topic_name] = relayed_topic;
-  ConnectRelayedTopic(input_topic_name);
+  bandwidth_budget_ = bandwidth_budget;
+  UpdateBandwidthShares();
 }
 
 void RobustTopicRelay::Run() {
+  boost::mutex::scoped_lock lock(mutex_);
+  statistics_start_time_ = ros::Time::now();
+  std::vector<OutgoingMessage> outgoing_messages;
   while (ros::ok()) {
-    ros::Duration expire_duration;
-    if (!FindNextExpirationDuration(&expire_duration)) {
-        ros::Duration(0.1).sleep();
-        continue;
+    ros::Time now = ros::Time::now();
+    ReconnectExpiredTopics(now);
+    SendPendingMessages(now, &outgoing_messages);
+    if (!outgoing_messages.empty()) {
+      lock.unlock();
+      Publish(outgoing_messages);
+      outgoing_messages.clear();
+      lock.lock();
+      continue;
     }
-    if (expire_duration < ros::Duration(0)) {
-      ReconnectExpiredTopics();
+    ros::Time next_statistics_time = statistics_start_time_ + ros::Duration(kStatisticsPeriod);
+    if (next_statistics_time <= now) {
+      PublishStatistics(now);
       continue;
     }
-    expire_duration.sleep();
+    ros::Duration wait_duration = std::min(
+        ros::Duration(kMaxWaitDuration), next_statistics_time - now);
+    wait_duration = FindWaitDuration(expiration_times_, now, wait_duration);
+    wait_duration = FindWaitDuration(pending_messages_.send_times(), now, wait_duration);
+    deadlines_changed_.timed_wait(lock, wait_duration.toBoost());
   }
 }
 
 void RobustTopicRelay::MessageCallback(
-    const std::string topic_name, const topic_tools::ShapeShifter::ConstPtr &message) {
-  RobustTopicRelay::RelayedTopic &relayed_topic = relayed_topics_[topic_name];
+    size_t topic_id, const Conversion &conversion,
+    const topic_tools::ShapeShifter::ConstPtr &input_message) {
+  topic_tools::ShapeShifter::ConstPtr message = ConvertMessage(conversion, input_message);
+  std::vector<OutgoingMessage> outgoing_messages;
   {
     boost::mutex::scoped_lock lock(mutex_);
+    RobustTopicRelay::RelayedTopic &relayed_topic = relayed_topics_[topic_id];
     if (!relayed_topic.connected) {
-      ROS_DEBUG("Connected to topic: %s", topic_name.c_str());
+      ROS_DEBUG("Connected to topic: %s", relayed_topic.input_topic_name.c_str());
       relayed_topic.connected = true;
     }
-    ros::Time next_expiration_time = ros::Time::now() + relayed_topic.expected_delay;
-    expiring_topics_.erase(relayed_topic.expiration_time);
-    relayed_topic.expiration_time = next_expiration_time;
-    expiring_topics_[next_expiration_time] = topic_name;
+    ros::Time now = ros::Time::now();
+    // Only moves the expiration time of the topic back, so Run does
+    // not need to wake up.
+    expiration_times_.Schedule(topic_id, now + relayed_topic.expected_delay);
+    relayed_topic.statistics.received++;
+    if (!message) {
+      ROS_ERROR("Unable to convert message of type %s on topic %s",
+                input_message->getDataType().c_str(), relayed_topic.input_topic_name.c_str());
+      relayed_topic.statistics.dropped++;
+      return;
+    }
+    if (!relayed_topic.publisher) {
+      ros::AdvertiseOptions options(
+          relayed_topic.output_topic_name, 10, message->getMD5Sum(),
+          message->getDataType(), message->getMessageDefinition());
+      if (relayed_topic.buffer.enabled()) {
+        options.connect_cb = boost::bind(
+            &RobustTopicRelay::SubscriberConnectCallback, this, topic_id, _1);
+      }
+      relayed_topic.publisher = node_handle_.advertise(options);
+    }
+    relayed_topic.buffer.Add(message);
+    ThrottleMessage(topic_id, now, message, &outgoing_messages);
   }
-  if (!relayed_topic.publisher) {
-    relayed_topic.publisher = message->advertise(
-        node_handle_, relayed_topic.output_topic_name, 10);
+  Publish(outgoing_messages);
+}
+
+void RobustTopicRelay::SubscriberConnectCallback(
+    size_t topic_id, const ros::SingleSubscriberPublisher &subscriber) {
+  std::vector<topic_tools::ShapeShifter::ConstPtr> messages;
+  {
+    boost::mutex::scoped_lock lock(mutex_);
+    relayed_topics_[topic_id].buffer.GetMessages(&messages);
+  }
+  ROS_DEBUG("Replaying %zu messages of topic %s to %s", messages.size(),
+            subscriber.getTopic().c_str(), subscriber.getSubscriberName().c_str());
+  for (size_t i = 0; i < messages.size(); i++) {
+    subscriber.publish(*messages[i]);
   }
-  relayed_topic.publisher.publish(message);
 }
 
-bool RobustTopicRelay::FindNextExpirationDuration(ros::Duration *expire_duration) {
-  boost::mutex::scoped_lock lock(mutex_);
+void RobustTopicRelay::ReconnectExpiredTopics(const ros::Time &now) {
+  while (!expiration_times_.empty() && expiration_times_.top_deadline() <= now) {
+    size_t topic_id = expiration_times_.top_id();
+    ROS_DEBUG("Reconnecting expired topic: %s",
+              relayed_topics_[topic_id].input_topic_name.c_str());
+    relayed_topics_[topic_id].subscriber.shutdown();
+    ConnectRelayedTopic(topic_id);
+  }
+}
 
-  if (expiring_topics_.empty() ||
-      expiring_topics_.begin()->first == ros::Time()) {
-    return false;
+void RobustTopicRelay::ConnectRelayedTopic(size_t topic_id) {
+  CHECK(topic_id < relayed_topics_.size());
+  RobustTopicRelay::RelayedTopic &relayed_topic = relayed_topics_[topic_id];
+  relayed_topic.subscriber = node_handle_.subscribe<topic_tools::ShapeShifter>(
+      relayed_topic.input_topic_name, 10,
+      boost::bind(&RobustTopicRelay::MessageCallback, this, topic_id,
+                  relayed_topic.conversion, _1));
+  expiration_times_.Schedule(topic_id, ros::Time::now() + relayed_topic.reconnect_delay);
+  relayed_topic.connected = false;
+}
+
+void RobustTopicRelay::ThrottleMessage(
+    size_t topic_id, const ros::Time &now, const topic_tools::ShapeShifter::ConstPtr &message,
+    std::vector<OutgoingMessage> *outgoing_messages) {
+  RobustTopicRelay::RelayedTopic &relayed_topic = relayed_topics_[topic_id];
+  ros::Time send_time = relayed_topic.throttle.FindNextSendTime(now);
+  if (send_time <= now) {
+    if (pending_messages_.Remove(topic_id)) {
+      // Latest wins.
+      relayed_topic.statistics.coalesced++;
+    }
+    relayed_topic.throttle.Send(now, message->size());
+    relayed_topic.statistics.published++;
+    relayed_topic.statistics.published_bytes += message->size();
+    OutgoingMessage outgoing_message;
+    outgoing_message.publisher = relayed_topic.publisher;
+    outgoing_message.message = message;
+    outgoing_messages->push_back(outgoing_message);
+  } else if (relayed_topic.coalesce) {
+    if (pending_messages_.Add(topic_id, send_time, message)) {
+      relayed_topic.statistics.coalesced++;
+    }
+    if (pending_messages_.send_times().top_id() == topic_id) {
+      deadlines_changed_.notify_all();
+    }
+  } else {
+    relayed_topic.statistics.dropped++;
   }
-  *expire_duration = expiring_topics_.begin()->first - ros::Time::now();
-  return true;
 }
 
-void RobustTopicRelay::ReconnectExpiredTopics() {
-  boost::mutex::scoped_lock lock(mutex_);
+void RobustTopicRelay::SendPendingMessages(
+    const ros::Time &now, std::vector<OutgoingMessage> *outgoing_messages) {
+  size_t topic_id;
+  topic_tools::ShapeShifter::ConstPtr message;
+  while (pending_messages_.PopDue(now, &topic_id, &message)) {
+    ThrottleMessage(topic_id, now, message, outgoing_messages);
+  }
+}
+
+void RobustTopicRelay::UpdateBandwidthShares() {
+  std::vector<int> priorities(relayed_topics_.size());
+  for (size_t i = 0; i < relayed_topics_.size(); i++) {
+    priorities[i] = relayed_topics_[i].priority;
+  }
+  std::vector<double> shares;
+  SplitBandwidthBudget(bandwidth_budget_, priorities, &shares);
+  for (size_t i = 0; i < relayed_topics_.size(); i++) {
+    relayed_topics_[i].throttle.set_bandwidth(shares[i]);
+  }
+}
+
+void RobustTopicRelay::PublishStatistics(const ros::Time &now) {
+  robust_topic_relay_msgs::RelayStatistics statistics;
+  statistics.header.stamp = now;
+  statistics.duration = now - statistics_start_time_;
+  double duration = statistics.duration.toSec();
+  statistics.topics.resize(relayed_topics_.size());
+  for (size_t i = 0; i < relayed_topics_.size(); i++) {
+    RobustTopicRelay::RelayedTopic &relayed_topic = relayed_topics_[i];
+    robust_topic_relay_msgs::TopicStatistics &topic_statistics = statistics.topics[i];
+    topic_statistics.input_topic = relayed_topic.input_topic_name;
+    topic_statistics.output_topic = relayed_topic.output_topic_name;
+    topic_statistics.received = relayed_topic.statistics.received;
+    topic_statistics.published = relayed_topic.statistics.published;
+    topic_statistics.published_bytes = relayed_topic.statistics.published_bytes;
+    topic_statistics.dropped = relayed_topic.statistics.dropped;
+    topic_statistics.coalesced = relayed_topic.statistics.coalesced;
+    topic_statistics.bandwidth = relayed_topic.statistics.published_bytes / duration;
+    topic_statistics.bandwidth_share = relayed_topic.throttle.bandwidth();
+    relayed_topic.statistics = TopicStatistics();
+  }
+  statistics_start_time_ = now;
+  statistics_publisher_.publish(statistics);
+}
 
-  while (!expiring_topics_.empty() &&
-         expiring_topics_.begin()->first < ros::Time::now()) {
-    std::string topic_name = expiring_topics_.begin()->second;
-    ROS_DEBUG("Reconnecting expired topic: %s", topic_name.c_str());
-    relayed_topics_[topic_name].subscriber.shutdown();
-    expiring_topics_.erase(expiring_topics_.begin());
-    ConnectRelayedTopic(topic_name);
+ros::Duration RobustTopicRelay::FindWaitDuration(
+    const DeadlineQueue &deadlines, const ros::Time &now, const ros::Duration &wait_duration) {
+  if (deadlines.empty()) {
+    return wait_duration;
   }
+  return std::min(wait_duration, deadlines.top_deadline() - now);
 }
 
-void RobustTopicRelay::ConnectRelayedTopic(const std::string &topic_name) {
-  std::map<std::string, RobustTopicRelay::RelayedTopic>::iterator relayed_topic =
-      relayed_topics_.find(topic_name);
-  CHECK(relayed_topic != relayed_topics_.end());
-  relayed_topic->second.subscriber = node_handle_.subscribe<topic_tools::ShapeShifter>(
-      topic_name, 10, boost::bind(&RobustTopicRelay::MessageCallback, this, topic_name, _1));
-  relayed_topic->second.expiration_time =
-      ros::Time::now() + relayed_topic->second.reconnect_delay;
-  expiring_topics_[relayed_topic->second.expiration_time] = topic_name;
-  relayed_topic->second.connected = false;
+void RobustTopicRelay::Publish(const std::vector<OutgoingMessage> &outgoing_messages) {
+  for (size_t i = 0; i < outgoing_messages.size(); i++) {
+    outgoing_messages[i].publisher.publish(outgoing_messages[i].message);
+  }
+}
+
+topic_tools::ShapeShifter::ConstPtr RobustTopicRelay::ConvertMessage(
+    const Conversion &conversion, const topic_tools::ShapeShifter::ConstPtr &message) {
+  switch (conversion.mode) {
+    case kRelay:
+      return message;
+    case kCompress:
+      return CompressMessage(conversion.compression_format, conversion.compression_level, *message);
+    case kDecompress:
+      return DecompressMessage(conversion.max_uncompressed_size, *message);
+  }
+  return topic_tools::ShapeShifter::ConstPtr();
 }
 
 }  // namespace robust_topic_relay
@@ -22,29 +22,61 @@
 
 static const int kDefaultSpinThreadCount = 10;
 static const double kDefaultReconnectFrequency = 0.5;
+static const int kDefaultBufferMessages = 0;
+static const int kDefaultBufferBytes = 0;
+static const double kDefaultMaxFrequency = 0.0;
+static const bool kDefaultCoalesce = false;
+static const int kDefaultPriority = 1;
+static const double kDefaultBandwidthBudget = 0.0;
+static const char kDefaultMode[] = "relay";
+static const char kDefaultCompression[] = "zlib";
+static const int kDefaultCompressionLevel = 1;
+static const int kDefaultMaxUncompressedSize = 64 * 1024 * 1024;
 
 namespace robust_topic_relay {
 
 struct TopicConfiguration {
   std::string input_topic;
   std::string output_topic;
-  double expected_frequency;
-  double reconnect_frequency;
+  TopicOptions options;
   
-  TopicConfiguration()
-    : expected_frequency(0.0) {}
+  TopicConfiguration() {}
   TopicConfiguration(const std::string &input_topic,
                      const std::string &output_topic,
-                     double expected_frequency,
-                     double reconnect_frequency)
+                     const TopicOptions &options)
     : input_topic(input_topic),
       output_topic(output_topic),
-      expected_frequency(expected_frequency),
-      reconnect_frequency(reconnect_frequency) {}
+      options(options) {}
 };
 
+static bool GetNumber(XmlRpc::XmlRpcValue &value, double *number) {
+  if (value.getType() == XmlRpc::XmlRpcValue::TypeDouble) {
+    *number = static_cast<double>(value);
+    return true;
+  } else if (value.getType() == XmlRpc::XmlRpcValue::TypeInt) {
+    *number = static_cast<int>(value);
+    return true;
+  }
+  return false;
+}
+
+static bool ParseRelayMode(const std::string &name, RelayMode *mode) {
+  if (name == "relay") {
+    *mode = kRelay;
+    return true;
+  } else if (name == "compress") {
+    *mode = kCompress;
+    return true;
+  } else if (name == "decompress") {
+    *mode = kDecompress;
+    return true;
+  }
+  return false;
+}
+
 static bool ParseParams(
-    ros::NodeHandle &node_handle, std::list<TopicConfiguration> *relay_configuration) {
+    ros::NodeHandle &node_handle, std::list<TopicConfiguration> *relay_configuration,
+    double *bandwidth_budget) {
   XmlRpc::XmlRpcValue relayed_topics;
   if (!node_handle.getParam("relayed_topics", relayed_topics)) {
     ROS_FATAL("Parameter not found: relayed_topics");
@@ -77,29 +109,124 @@ static bool ParseParams(
     }
     output_topic = static_cast<std::string>(relayed_topics[i]["output_topic"]);
 
-    double expected_frequency;
-    if (relayed_topics[i]["expected_frequency"].getType() ==
-        XmlRpc::XmlRpcValue::TypeDouble) {
-      expected_frequency = static_cast<double>(relayed_topics[i]["expected_frequency"]);
-    } else if (relayed_topics[i]["expected_frequency"].getType() ==
-               XmlRpc::XmlRpcValue::TypeInt) {
-      expected_frequency = static_cast<int>(relayed_topics[i]["expected_frequency"]);
-    } else {
+    TopicOptions options;
+    if (!GetNumber(relayed_topics[i]["expected_frequency"], &options.expected_frequency)) {
       ROS_FATAL("Invalid type. Expected number: "
                 "relayed_topics[%d]/expected_frequency", i);
       return false;
     }
 
-    double reconnect_frequency = kDefaultReconnectFrequency;
+    options.reconnect_frequency = kDefaultReconnectFrequency;
     if (relayed_topics[i]["reconnect_frequency"].getType() ==
         XmlRpc::XmlRpcValue::TypeDouble) {
-      reconnect_frequency = static_cast<double>(relayed_topics[i]["reconnect_frequency"]);
+      options.reconnect_frequency =
+          static_cast<double>(relayed_topics[i]["reconnect_frequency"]);
+    }
+
+    options.buffer_messages = kDefaultBufferMessages;
+    if (relayed_topics[i].hasMember("buffer_messages")) {
+      if (relayed_topics[i]["buffer_messages"].getType() != XmlRpc::XmlRpcValue::TypeInt ||
+          static_cast<int>(relayed_topics[i]["buffer_messages"]) < 0) {
+        ROS_FATAL("Invalid type. Expected non-negative integer: "
+                  "relayed_topics[%d]/buffer_messages", i);
+        return false;
+      }
+      options.buffer_messages = static_cast<int>(relayed_topics[i]["buffer_messages"]);
+    }
+
+    options.buffer_bytes = kDefaultBufferBytes;
+    if (relayed_topics[i].hasMember("buffer_bytes")) {
+      if (relayed_topics[i]["buffer_bytes"].getType() != XmlRpc::XmlRpcValue::TypeInt ||
+          static_cast<int>(relayed_topics[i]["buffer_bytes"]) < 0) {
+        ROS_FATAL("Invalid type. Expected non-negative integer: "
+                  "relayed_topics[%d]/buffer_bytes", i);
+        return false;
+      }
+      options.buffer_bytes = static_cast<int>(relayed_topics[i]["buffer_bytes"]);
+    }
+
+    options.max_frequency = kDefaultMaxFrequency;
+    if (relayed_topics[i].hasMember("max_frequency") &&
+        !GetNumber(relayed_topics[i]["max_frequency"], &options.max_frequency)) {
+      ROS_FATAL("Invalid type. Expected number: relayed_topics[%d]/max_frequency", i);
+      return false;
+    }
+
+    options.coalesce = kDefaultCoalesce;
+    if (relayed_topics[i].hasMember("coalesce")) {
+      if (relayed_topics[i]["coalesce"].getType() != XmlRpc::XmlRpcValue::TypeBoolean) {
+        ROS_FATAL("Invalid type. Expected bool: relayed_topics[%d]/coalesce", i);
+        return false;
+      }
+      options.coalesce = static_cast<bool>(relayed_topics[i]["coalesce"]);
+    }
+
+    options.priority = kDefaultPriority;
+    if (relayed_topics[i].hasMember("priority")) {
+      if (relayed_topics[i]["priority"].getType() != XmlRpc::XmlRpcValue::TypeInt ||
+          static_cast<int>(relayed_topics[i]["priority"]) <= 0) {
+        ROS_FATAL("Invalid type. Expected positive integer: relayed_topics[%d]/priority", i);
+        return false;
+      }
+      options.priority = static_cast<int>(relayed_topics[i]["priority"]);
+    }
+
+    std::string mode = kDefaultMode;
+    if (relayed_topics[i].hasMember("mode")) {
+      if (relayed_topics[i]["mode"].getType() != XmlRpc::XmlRpcValue::TypeString) {
+        ROS_FATAL("Invalid type. Expected string: relayed_topics[%d]/mode", i);
+        return false;
+      }
+      mode = static_cast<std::string>(relayed_topics[i]["mode"]);
+    }
+    if (!ParseRelayMode(mode, &options.conversion.mode)) {
+      ROS_FATAL("Invalid value. Expected relay, compress or decompress: "
+                "relayed_topics[%d]/mode", i);
+      return false;
+    }
+
+    std::string compression = kDefaultCompression;
+    if (relayed_topics[i].hasMember("compression")) {
+      if (relayed_topics[i]["compression"].getType() != XmlRpc::XmlRpcValue::TypeString) {
+        ROS_FATAL("Invalid type. Expected string: relayed_topics[%d]/compression", i);
+        return false;
+      }
+      compression = static_cast<std::string>(relayed_topics[i]["compression"]);
+    }
+    if (!ParseCompressionFormat(compression, &options.conversion.compression_format)) {
+      ROS_FATAL("Invalid value. Expected zlib or bzip2: relayed_topics[%d]/compression", i);
+      return false;
+    }
+
+    options.conversion.compression_level = kDefaultCompressionLevel;
+    if (relayed_topics[i].hasMember("compression_level")) {
+      if (relayed_topics[i]["compression_level"].getType() != XmlRpc::XmlRpcValue::TypeInt ||
+          static_cast<int>(relayed_topics[i]["compression_level"]) < 1 ||
+          static_cast<int>(relayed_topics[i]["compression_level"]) > 9) {
+        ROS_FATAL("Invalid type. Expected integer between 1 and 9: "
+                  "relayed_topics[%d]/compression_level", i);
+        return false;
+      }
+      options.conversion.compression_level =
+          static_cast<int>(relayed_topics[i]["compression_level"]);
+    }
+
+    options.conversion.max_uncompressed_size = kDefaultMaxUncompressedSize;
+    if (relayed_topics[i].hasMember("max_uncompressed_size")) {
+      if (relayed_topics[i]["max_uncompressed_size"].getType() != XmlRpc::XmlRpcValue::TypeInt ||
+          static_cast<int>(relayed_topics[i]["max_uncompressed_size"]) <= 0) {
+        ROS_FATAL("Invalid type. Expected positive integer: "
+                  "relayed_topics[%d]/max_uncompressed_size", i);
+        return false;
+      }
+      options.conversion.max_uncompressed_size =
+          static_cast<int>(relayed_topics[i]["max_uncompressed_size"]);
     }
     
-    relay_configuration->push_back(
-        TopicConfiguration(
-            input_topic, output_topic, expected_frequency, reconnect_frequency));
+    relay_configuration->push_back(TopicConfiguration(input_topic, output_topic, options));
   }
+
+  node_handle.param("bandwidth_budget", *bandwidth_budget, kDefaultBandwidthBudget);
   return true;
 }
 
@@ -113,16 +240,17 @@ int main(int argc, char *argv[]) {
 
   ros::NodeHandle node_handle("~");
   std::list<robust_topic_relay::TopicConfiguration> relay_configuration;
-  if (!robust_topic_relay::ParseParams(node_handle, &relay_configuration)) {
+  double bandwidth_budget;
+  if (!robust_topic_relay::ParseParams(node_handle, &relay_configuration, &bandwidth_budget)) {
     return 1;
   }
   robust_topic_relay::RobustTopicRelay robust_topic_relay(node_handle);
+  robust_topic_relay.SetBandwidthBudget(bandwidth_budget);
   for (std::list<robust_topic_relay::TopicConfiguration>::iterator it =
            relay_configuration.begin();
        it != relay_configuration.end(); it++) {
     ROS_INFO("Adding topic: %s", it->input_topic.c_str());
-    robust_topic_relay.AddTopic(it->input_topic, it->output_topic, it->expected_frequency,
-                                it->reconnect_frequency);
+    robust_topic_relay.AddTopic(it->input_topic, it->output_topic, it->options);
   }
   robust_topic_relay.Run();
 
@@ -0,0 +1,73 @@
+// Copyright 2011 Google Inc.
+// Author: moesenle@google.com (Lorenz Moesenlechner)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "robust_topic_relay/topic_throttle.h"
+
+#include <algorithm>
+
+namespace robust_topic_relay {
+
+const double TopicThrottle::kBurstDuration = 1.0;
+
+TopicThrottle::TopicThrottle(double max_frequency, double bandwidth)
+  : min_period_(max_frequency > 0.0 ? 1.0 / max_frequency : 0.0),
+    bandwidth_(bandwidth),
+    tokens_(bandwidth * kBurstDuration) {
+}
+
+ros::Time TopicThrottle::FindNextSendTime(const ros::Time &now) const {
+  if (last_send_time_.isZero()) {
+    return now;
+  }
+  ros::Time send_time = last_send_time_ + min_period_;
+  if (bandwidth_ > 0.0 && tokens_ < 0.0) {
+    send_time = std::max(send_time, last_send_time_ + ros::Duration(-tokens_ / bandwidth_));
+  }
+  return send_time;
+}
+
+void TopicThrottle::Send(const ros::Time &now, size_t message_bytes) {
+  if (bandwidth_ > 0.0) {
+    tokens_ = FindTokens(now) - message_bytes;
+  }
+  last_send_time_ = now;
+}
+
+void TopicThrottle::set_bandwidth(double bandwidth) {
+  bandwidth_ = bandwidth;
+  tokens_ = std::min(tokens_, bandwidth * kBurstDuration);
+}
+
+double TopicThrottle::FindTokens(const ros::Time &now) const {
+  if (last_send_time_.isZero()) {
+    return bandwidth_ * kBurstDuration;
+  }
+  double tokens = tokens_ + (now - last_send_time_).toSec() * bandwidth_;
+  return std::min(tokens, bandwidth_ * kBurstDuration);
+}
+
+void SplitBandwidthBudget(double bandwidth_budget, const std::vector<int> &priorities,
+                          std::vector<double> *shares) {
+  int total_priority = 0;
+  for (size_t i = 0; i < priorities.size(); i++) {
+    total_priority += priorities[i];
+  }
+  shares->resize(priorities.size());
+  for (size_t i = 0; i < priorities.size(); i++) {
+    (*shares)[i] = bandwidth_budget * priorities[i] / total_priority;
+  }
+}
+
+}  // namespace robust_topic_relay
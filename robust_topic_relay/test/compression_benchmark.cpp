@@ -0,0 +1,150 @@
+// Copyright 2011 Google Inc.
+// Author: moesenle@google.com (Lorenz Moesenlechner)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Reports the compression ratio and the CPU cost of the compression
+// formats of the compress relay mode on serialized messages.
+//
+// Usage: compression_benchmark [<file>...]
+//
+// Uses the contents of every file as one serialized message, e.g.
+// point clouds written with ShapeShifter::write. Without arguments,
+// uses synthetic clouds of a depth camera looking into a box-shaped
+// room.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include <ros/ros.h>
+
+#include "robust_topic_relay/compression.h"
+
+using robust_topic_relay::CompressionFormat;
+
+static const int kWidth = 640;
+static const int kHeight = 480;
+// x, y, z, padding and rgb like a PointCloud2 of a depth camera.
+static const int kPointStep = 32;
+
+static bool ReadFile(const std::string &file_name, std::vector<uint8_t> *message) {
+  FILE *file = fopen(file_name.c_str(), "rb");
+  if (!file) {
+    fprintf(stderr, "Unable to open %s\n", file_name.c_str());
+    return false;
+  }
+  uint8_t buffer[65536];
+  size_t size;
+  while ((size = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+    message->insert(message->end(), buffer, buffer + size);
+  }
+  bool ok = !ferror(file) && !message->empty();
+  fclose(file);
+  if (!ok) {
+    fprintf(stderr, "Unable to read %s\n", file_name.c_str());
+  }
+  return ok;
+}
+
+static void GenerateClouds(std::vector<std::vector<uint8_t> > *messages) {
+  const float kNan = std::numeric_limits<float>::quiet_NaN();
+  for (size_t i = 0; i < 10; i++) {
+    std::vector<uint8_t> cloud(kWidth * kHeight * kPointStep, 0);
+    for (int v = 0; v < kHeight; v++) {
+      for (int u = 0; u < kWidth; u++) {
+        // Rays through the image plane hit the walls of a 6 x 4 x 3
+        // room, with some sensor noise and missing returns.
+        double ray_y = (u - kWidth / 2) / 525.0;
+        double ray_z = (v - kHeight / 2) / 525.0;
+        double distance = std::min(6.0, std::min(2.0 / fabs(ray_y), 1.5 / fabs(ray_z)));
+        distance += 0.005 * rand() / RAND_MAX;
+        float point[4] = {static_cast<float>(distance), static_cast<float>(ray_y * distance),
+                          static_cast<float>(ray_z * distance), 0.0f};
+        if (rand() % 20 == 0) {
+          point[0] = point[1] = point[2] = kNan;
+        }
+        uint8_t *data = &cloud[(v * kWidth + u) * kPointStep];
+        memcpy(data, point, sizeof(point));
+        uint32_t rgb = 0x808080 + (static_cast<uint32_t>(distance * 16) & 0xff);
+        memcpy(data + 16, &rgb, sizeof(rgb));
+      }
+    }
+    messages->push_back(cloud);
+  }
+}
+
+static void Benchmark(const std::string &name, CompressionFormat format, int level,
+                      const std::vector<std::vector<uint8_t> > &messages) {
+  size_t bytes = 0;
+  size_t compressed_bytes = 0;
+  double compress_time = 0.0;
+  double decompress_time = 0.0;
+  std::vector<uint8_t> compressed;
+  std::vector<uint8_t> uncompressed;
+  for (size_t i = 0; i < messages.size(); i++) {
+    ros::WallTime start = ros::WallTime::now();
+    if (!robust_topic_relay::CompressBytes(
+            format, level, &messages[i][0], messages[i].size(), &compressed)) {
+      fprintf(stderr, "Compression failed\n");
+      exit(1);
+    }
+    compress_time += (ros::WallTime::now() - start).toSec();
+    start = ros::WallTime::now();
+    if (!robust_topic_relay::DecompressBytes(
+            format, &compressed[0], compressed.size(), messages[i].size(), &uncompressed) ||
+        uncompressed != messages[i]) {
+      fprintf(stderr, "Decompression failed\n");
+      exit(1);
+    }
+    decompress_time += (ros::WallTime::now() - start).toSec();
+    bytes += messages[i].size();
+    compressed_bytes += compressed.size();
+  }
+  double megabytes = bytes / 1e6;
+  printf("%-8s level %d: ratio %5.2f, compress %7.1f MB/s (%6.2f ms per message), "
+         "decompress %7.1f MB/s\n",
+         name.c_str(), level, static_cast<double>(bytes) / compressed_bytes,
+         megabytes / compress_time, compress_time / messages.size() * 1e3,
+         megabytes / decompress_time);
+}
+
+int main(int argc, char *argv[]) {
+  std::vector<std::vector<uint8_t> > messages;
+  if (argc > 1) {
+    messages.resize(argc - 1);
+    for (int i = 1; i < argc; i++) {
+      if (!ReadFile(argv[i], &messages[i - 1])) {
+        return 1;
+      }
+    }
+  } else {
+    GenerateClouds(&messages);
+  }
+  size_t bytes = 0;
+  for (size_t i = 0; i < messages.size(); i++) {
+    bytes += messages[i].size();
+  }
+  printf("%zu messages, %.1f kB on average\n", messages.size(), bytes / 1e3 / messages.size());
+  Benchmark("zlib", robust_topic_relay::kZlib, 1, messages);
+  Benchmark("zlib", robust_topic_relay::kZlib, 6, messages);
+  Benchmark("zlib", robust_topic_relay::kZlib, 9, messages);
+  Benchmark("bzip2", robust_topic_relay::kBzip2, 1, messages);
+  Benchmark("bzip2", robust_topic_relay::kBzip2, 9, messages);
+  return 0;
+}
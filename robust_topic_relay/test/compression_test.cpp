@@ -0,0 +1,183 @@
+// Copyright 2011 Google Inc.
+// Author: moesenle@google.com (Lorenz Moesenlechner)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "robust_topic_relay/compression.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdlib>
+#include <string.h>
+#include <vector>
+
+#include <robust_topic_relay_msgs/CompressedMessage.h>
+
+using robust_topic_relay::CompressBytes;
+using robust_topic_relay::CompressMessage;
+using robust_topic_relay::CompressionFormat;
+using robust_topic_relay::DecompressBytes;
+using robust_topic_relay::DecompressMessage;
+using robust_topic_relay::IsValidCompressedMessage;
+using robust_topic_relay::kBzip2;
+using robust_topic_relay::kZlib;
+
+static const size_t kMaxUncompressedSize = 1024 * 1024;
+
+static std::vector<uint8_t> Serialize(const topic_tools::ShapeShifter &message) {
+  std::vector<uint8_t> data(message.size());
+  ros::serialization::OStream stream(data.empty() ? NULL : &data[0], data.size());
+  message.write(stream);
+  return data;
+}
+
+static topic_tools::ShapeShifter::Ptr MakeMessage(
+    const std::string &datatype, const std::string &md5sum, std::vector<uint8_t> data) {
+  topic_tools::ShapeShifter::Ptr message(new topic_tools::ShapeShifter);
+  message->morph(md5sum, datatype, "", "");
+  ros::serialization::IStream stream(data.empty() ? NULL : &data[0], data.size());
+  message->read(stream);
+  return message;
+}
+
+// Wraps data, e.g. a corrupted CompressedMessage, as CompressedMessage.
+static topic_tools::ShapeShifter::Ptr MakeCompressedMessage(const std::vector<uint8_t> &data) {
+  return MakeMessage(
+      ros::message_traits::datatype<robust_topic_relay_msgs::CompressedMessage>(),
+      ros::message_traits::md5sum<robust_topic_relay_msgs::CompressedMessage>(),
+      data);
+}
+
+// Compressible data with some noise.
+static std::vector<uint8_t> MakeData(size_t size) {
+  srand(42);
+  std::vector<uint8_t> data(size);
+  for (size_t i = 0; i < size; i++) {
+    data[i] = i % 64 + (rand() % 8 == 0 ? rand() % 4 : 0);
+  }
+  return data;
+}
+
+class CompressionTest : public testing::TestWithParam<CompressionFormat> {
+ protected:
+  virtual void SetUp() {
+    message_ = MakeMessage("std_msgs/ByteMultiArray", "70ea4f5ab5f2bb2196aca83a23b19c9e",
+                           MakeData(10000));
+    compressed_ = CompressMessage(GetParam(), 6, *message_);
+    ASSERT_TRUE(compressed_);
+    serialized_ = Serialize(*compressed_);
+  }
+
+  // The offset of the length of the data array, the last field.
+  size_t DataLengthOffset() const {
+    robust_topic_relay_msgs::CompressedMessage compressed_message;
+    std::vector<uint8_t> serialized = serialized_;
+    ros::serialization::IStream stream(&serialized[0], serialized.size());
+    ros::serialization::deserialize(stream, compressed_message);
+    return serialized_.size() - compressed_message.data.size() - sizeof(uint32_t);
+  }
+
+  topic_tools::ShapeShifter::Ptr message_;
+  topic_tools::ShapeShifter::Ptr compressed_;
+  std::vector<uint8_t> serialized_;
+};
+
+TEST_P(CompressionTest, BytesRoundTrip) {
+  std::vector<uint8_t> data = MakeData(100000);
+  std::vector<uint8_t> compressed;
+  ASSERT_TRUE(CompressBytes(GetParam(), 9, &data[0], data.size(), &compressed));
+  EXPECT_LT(compressed.size(), data.size());
+  std::vector<uint8_t> uncompressed;
+  ASSERT_TRUE(DecompressBytes(GetParam(), &compressed[0], compressed.size(), data.size(),
+                              &uncompressed));
+  EXPECT_TRUE(uncompressed == data);
+  // The size must match exactly.
+  EXPECT_FALSE(DecompressBytes(GetParam(), &compressed[0], compressed.size(), data.size() - 1,
+                               &uncompressed));
+  EXPECT_FALSE(DecompressBytes(GetParam(), &compressed[0], compressed.size(), data.size() + 1,
+                               &uncompressed));
+}
+
+TEST_P(CompressionTest, MessageRoundTrip) {
+  EXPECT_EQ(compressed_->getDataType(),
+            ros::message_traits::datatype<robust_topic_relay_msgs::CompressedMessage>());
+  EXPECT_LT(compressed_->size(), message_->size());
+  EXPECT_TRUE(IsValidCompressedMessage(&serialized_[0], serialized_.size()));
+
+  topic_tools::ShapeShifter::Ptr decompressed = DecompressMessage(kMaxUncompressedSize,
+                                                                  *compressed_);
+  ASSERT_TRUE(decompressed);
+  EXPECT_EQ(decompressed->getDataType(), message_->getDataType());
+  EXPECT_EQ(decompressed->getMD5Sum(), message_->getMD5Sum());
+  EXPECT_TRUE(Serialize(*decompressed) == Serialize(*message_));
+}
+
+TEST_P(CompressionTest, RejectsOverLimit) {
+  EXPECT_TRUE(DecompressMessage(message_->size(), *compressed_));
+  EXPECT_FALSE(DecompressMessage(message_->size() - 1, *compressed_));
+}
+
+TEST_P(CompressionTest, RejectsOtherDefinition) {
+  topic_tools::ShapeShifter::Ptr other = MakeMessage(
+      compressed_->getDataType(), "00000000000000000000000000000000", serialized_);
+  EXPECT_FALSE(DecompressMessage(kMaxUncompressedSize, *other));
+  topic_tools::ShapeShifter::Ptr uncompressed = MakeMessage(
+      message_->getDataType(), message_->getMD5Sum(), Serialize(*message_));
+  EXPECT_FALSE(DecompressMessage(kMaxUncompressedSize, *uncompressed));
+}
+
+TEST_P(CompressionTest, RejectsTruncated) {
+  for (size_t size = 0; size < serialized_.size(); size += 97) {
+    std::vector<uint8_t> truncated(serialized_.begin(), serialized_.begin() + size);
+    EXPECT_FALSE(IsValidCompressedMessage(truncated.empty() ? NULL : &truncated[0],
+                                          truncated.size()));
+    EXPECT_FALSE(DecompressMessage(kMaxUncompressedSize, *MakeCompressedMessage(truncated)));
+  }
+}
+
+TEST_P(CompressionTest, RejectsTrailingBytes) {
+  std::vector<uint8_t> extended = serialized_;
+  extended.push_back(0);
+  EXPECT_FALSE(IsValidCompressedMessage(&extended[0], extended.size()));
+  EXPECT_FALSE(DecompressMessage(kMaxUncompressedSize, *MakeCompressedMessage(extended)));
+}
+
+TEST_P(CompressionTest, RejectsCorruptLengths) {
+  // A length prefix that claims almost 4 GB must be rejected before
+  // deserializing allocates it.
+  size_t offsets[] = {0, DataLengthOffset()};
+  for (size_t i = 0; i < 2; i++) {
+    std::vector<uint8_t> corrupt = serialized_;
+    uint32_t length = 0xfffffff0;
+    memcpy(&corrupt[offsets[i]], &length, sizeof(length));
+    EXPECT_FALSE(IsValidCompressedMessage(&corrupt[0], corrupt.size()));
+    EXPECT_FALSE(DecompressMessage(kMaxUncompressedSize, *MakeCompressedMessage(corrupt)));
+  }
+}
+
+TEST_P(CompressionTest, RejectsCorruptData) {
+  std::vector<uint8_t> corrupt = serialized_;
+  for (size_t i = DataLengthOffset() + sizeof(uint32_t); i < corrupt.size(); i += 7) {
+    corrupt[i] ^= 0x5a;
+  }
+  // The envelope is intact, only the data does not decompress.
+  EXPECT_TRUE(IsValidCompressedMessage(&corrupt[0], corrupt.size()));
+  EXPECT_FALSE(DecompressMessage(kMaxUncompressedSize, *MakeCompressedMessage(corrupt)));
+}
+
+INSTANTIATE_TEST_CASE_P(Formats, CompressionTest, testing::Values(kZlib, kBzip2));
+
+int main(int argc, char *argv[]) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
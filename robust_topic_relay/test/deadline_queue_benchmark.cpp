@@ -0,0 +1,141 @@
+// Copyright 2011 Google Inc.
+// Author: moesenle@google.com (Lorenz Moesenlechner)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Stress test of the expiration bookkeeping RobustTopicRelay does for
+// every message. Replays the messages of 500 topics at 100 Hz with
+// jittered receive times and compares the std::map keyed by
+// expiration time that RobustTopicRelay used before with
+// DeadlineQueue. The map also loses topics whenever two of them
+// expire at the same time, which is counted as well.
+
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <ros/time.h>
+
+#include "robust_topic_relay/deadline_queue.h"
+
+static const int kNumberOfTopics = 500;
+static const double kFrequency = 100.0;
+static const double kDuration = 60.0;
+// Receive times are rounded to this resolution, like the clock of a
+// simulation that advances in fixed steps.
+static const double kClockResolution = 1e-4;
+
+struct Message {
+  ros::Time stamp;
+  size_t topic_id;
+
+  bool operator<(const Message &other) const {
+    return stamp < other.stamp;
+  }
+};
+
+static std::vector<Message> GenerateMessages() {
+  std::multimap<ros::Time, size_t> messages;
+  for (int topic = 0; topic < kNumberOfTopics; topic++) {
+    double time = 1.0 + static_cast<double>(rand()) / RAND_MAX / kFrequency;
+    while (time < 1.0 + kDuration) {
+      double jitter = 0.1 / kFrequency * rand() / RAND_MAX;
+      double stamp = static_cast<int64_t>((time + jitter) / kClockResolution) * kClockResolution;
+      messages.insert(std::make_pair(ros::Time(stamp), topic));
+      time += 1.0 / kFrequency;
+    }
+  }
+  std::vector<Message> result;
+  for (std::multimap<ros::Time, size_t>::iterator it = messages.begin();
+       it != messages.end(); ++it) {
+    Message message;
+    message.stamp = it->first;
+    message.topic_id = it->second;
+    result.push_back(message);
+  }
+  return result;
+}
+
+/**
+ * The expiration bookkeeping of RobustTopicRelay before it used
+ * DeadlineQueue.
+ */
+class MapScheduler {
+ public:
+  explicit MapScheduler(const std::vector<std::string> &topic_names) {
+    for (size_t i = 0; i < topic_names.size(); i++) {
+      relayed_topics_[topic_names[i]] = ros::Time();
+    }
+  }
+
+  void Update(const std::string &topic_name, const ros::Time &expiration_time) {
+    ros::Time &topic_expiration_time = relayed_topics_[topic_name];
+    expiring_topics_.erase(topic_expiration_time);
+    topic_expiration_time = expiration_time;
+    expiring_topics_[expiration_time] = topic_name;
+  }
+
+  size_t size() const {
+    return expiring_topics_.size();
+  }
+
+ private:
+  std::map<std::string, ros::Time> relayed_topics_;
+  std::map<ros::Time, std::string> expiring_topics_;
+};
+
+int main(int argc, char *argv[]) {
+  srand(42);
+  std::vector<std::string> topic_names;
+  for (int i = 0; i < kNumberOfTopics; i++) {
+    std::ostringstream topic_name;
+    topic_name << "/robot/sensors/topic_" << i;
+    topic_names.push_back(topic_name.str());
+  }
+  std::vector<Message> messages = GenerateMessages();
+  ros::Duration expected_delay(1.0 / kFrequency);
+
+  MapScheduler map_scheduler(topic_names);
+  ros::WallTime start = ros::WallTime::now();
+  for (size_t i = 0; i < messages.size(); i++) {
+    map_scheduler.Update(topic_names[messages[i].topic_id], messages[i].stamp + expected_delay);
+  }
+  double map_time = (ros::WallTime::now() - start).toSec();
+
+  robust_topic_relay::DeadlineQueue deadline_queue;
+  start = ros::WallTime::now();
+  for (size_t i = 0; i < messages.size(); i++) {
+    deadline_queue.Schedule(messages[i].topic_id, messages[i].stamp + expected_delay);
+  }
+  double queue_time = (ros::WallTime::now() - start).toSec();
+
+  ros::Time last_deadline;
+  bool ordered = true;
+  while (!deadline_queue.empty()) {
+    ordered = ordered && last_deadline <= deadline_queue.top_deadline();
+    last_deadline = deadline_queue.top_deadline();
+    deadline_queue.Pop();
+  }
+
+  printf("%d topics at %.0f Hz, %zu messages\n", kNumberOfTopics, kFrequency, messages.size());
+  printf("map:   %7.1f ns per message, %6.4f%% of a core, %d of %d topics still scheduled\n",
+         map_time / messages.size() * 1e9, map_time / kDuration * 100,
+         static_cast<int>(map_scheduler.size()), kNumberOfTopics);
+  printf("queue: %7.1f ns per message, %6.4f%% of a core (speedup %.1fx), ordered: %s\n",
+         queue_time / messages.size() * 1e9, queue_time / kDuration * 100,
+         map_time / queue_time, ordered ? "yes" : "no");
+  return 0;
+}
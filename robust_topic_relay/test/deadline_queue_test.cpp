@@ -0,0 +1,126 @@
+// Copyright 2011 Google Inc.
+// Author: moesenle@google.com (Lorenz Moesenlechner)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "robust_topic_relay/deadline_queue.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdlib>
+#include <map>
+#include <set>
+#include <utility>
+#include <vector>
+
+using robust_topic_relay::DeadlineQueue;
+
+// Pops all ids and checks that they come out in (deadline, id) order.
+static void ExpectPopOrder(DeadlineQueue *queue, const std::vector<size_t> &ids) {
+  for (size_t i = 0; i < ids.size(); i++) {
+    ASSERT_FALSE(queue->empty());
+    EXPECT_EQ(queue->top_id(), ids[i]);
+    queue->Pop();
+    EXPECT_FALSE(queue->Contains(ids[i]));
+  }
+  EXPECT_TRUE(queue->empty());
+}
+
+TEST(DeadlineQueueTest, PopsInDeadlineOrder) {
+  DeadlineQueue queue;
+  queue.Schedule(0, ros::Time(3.0));
+  queue.Schedule(1, ros::Time(1.0));
+  queue.Schedule(2, ros::Time(2.0));
+  // Ties are broken by id.
+  queue.Schedule(3, ros::Time(1.0));
+  EXPECT_EQ(queue.size(), 4);
+  EXPECT_EQ(queue.top_deadline(), ros::Time(1.0));
+  size_t expected[] = {1, 3, 2, 0};
+  ExpectPopOrder(&queue, std::vector<size_t>(expected, expected + 4));
+}
+
+TEST(DeadlineQueueTest, ScheduleMovesDeadline) {
+  DeadlineQueue queue;
+  for (size_t i = 0; i < 5; i++) {
+    queue.Schedule(i, ros::Time(1.0 + i));
+  }
+  // Earlier.
+  queue.Schedule(4, ros::Time(0.5));
+  EXPECT_EQ(queue.top_id(), 4);
+  // Later.
+  queue.Schedule(4, ros::Time(10.0));
+  queue.Schedule(0, ros::Time(3.5));
+  EXPECT_EQ(queue.size(), 5);
+  EXPECT_EQ(queue.top_id(), 1);
+  size_t expected[] = {1, 2, 0, 3, 4};
+  ExpectPopOrder(&queue, std::vector<size_t>(expected, expected + 5));
+}
+
+TEST(DeadlineQueueTest, Remove) {
+  DeadlineQueue queue;
+  for (size_t i = 0; i < 5; i++) {
+    queue.Schedule(i, ros::Time(1.0 + i));
+  }
+  queue.Remove(0);
+  queue.Remove(3);
+  // Removing an id that is not queued does nothing.
+  queue.Remove(3);
+  queue.Remove(17);
+  EXPECT_FALSE(queue.Contains(0));
+  EXPECT_FALSE(queue.Contains(3));
+  EXPECT_TRUE(queue.Contains(4));
+  EXPECT_EQ(queue.size(), 3);
+  size_t expected[] = {1, 2, 4};
+  ExpectPopOrder(&queue, std::vector<size_t>(expected, expected + 3));
+}
+
+TEST(DeadlineQueueTest, MatchesSortedSet) {
+  srand(42);
+  DeadlineQueue queue;
+  std::map<size_t, ros::Time> deadlines;
+  std::set<std::pair<ros::Time, size_t> > expected;
+  for (int i = 0; i < 10000; i++) {
+    size_t id = rand() % 50;
+    int operation = rand() % 3;
+    if (operation == 0 && !expected.empty()) {
+      ASSERT_FALSE(queue.empty());
+      EXPECT_EQ(queue.top_id(), expected.begin()->second);
+      deadlines.erase(expected.begin()->second);
+      expected.erase(expected.begin());
+      queue.Pop();
+    } else {
+      if (deadlines.count(id)) {
+        expected.erase(std::make_pair(deadlines[id], id));
+        deadlines.erase(id);
+      }
+      if (operation == 1) {
+        queue.Remove(id);
+      } else {
+        ros::Time deadline(1.0 + rand() % 100);
+        queue.Schedule(id, deadline);
+        deadlines[id] = deadline;
+        expected.insert(std::make_pair(deadline, id));
+      }
+    }
+    ASSERT_EQ(queue.size(), expected.size());
+    if (!expected.empty()) {
+      EXPECT_EQ(queue.top_id(), expected.begin()->second);
+      EXPECT_EQ(queue.top_deadline(), expected.begin()->first);
+    }
+  }
+}
+
+int main(int argc, char *argv[]) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
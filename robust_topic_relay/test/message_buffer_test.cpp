@@ -0,0 +1,109 @@
+// Copyright 2011 Google Inc.
+// Author: moesenle@google.com (Lorenz Moesenlechner)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "robust_topic_relay/message_buffer.h"
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+using robust_topic_relay::MessageBuffer;
+
+// A message of size serialized bytes that all have the value tag.
+static topic_tools::ShapeShifter::ConstPtr MakeMessage(size_t size, uint8_t tag) {
+  std::vector<uint8_t> data(size, tag);
+  topic_tools::ShapeShifter::Ptr message(new topic_tools::ShapeShifter);
+  message->morph("*", "std_msgs/ByteMultiArray", "", "");
+  ros::serialization::IStream stream(data.empty() ? NULL : &data[0], data.size());
+  message->read(stream);
+  return message;
+}
+
+TEST(MessageBufferTest, Disabled) {
+  MessageBuffer buffer(0, 0);
+  EXPECT_FALSE(buffer.enabled());
+  buffer.Add(MakeMessage(10, 1));
+  EXPECT_EQ(buffer.size(), 0);
+  EXPECT_EQ(buffer.bytes(), 0);
+}
+
+TEST(MessageBufferTest, MessageBudget) {
+  MessageBuffer buffer(3, 0);
+  std::vector<topic_tools::ShapeShifter::ConstPtr> added;
+  for (int i = 0; i < 5; i++) {
+    added.push_back(MakeMessage(100, i));
+    buffer.Add(added.back());
+  }
+  EXPECT_EQ(buffer.size(), 3);
+  EXPECT_EQ(buffer.bytes(), 300);
+  std::vector<topic_tools::ShapeShifter::ConstPtr> messages;
+  buffer.GetMessages(&messages);
+  ASSERT_EQ(messages.size(), 3);
+  // The oldest are dropped first.
+  EXPECT_EQ(messages[0], added[2]);
+  EXPECT_EQ(messages[1], added[3]);
+  EXPECT_EQ(messages[2], added[4]);
+}
+
+TEST(MessageBufferTest, LatestOnly) {
+  MessageBuffer buffer(1, 0);
+  buffer.Add(MakeMessage(10, 1));
+  topic_tools::ShapeShifter::ConstPtr latest = MakeMessage(20, 2);
+  buffer.Add(latest);
+  std::vector<topic_tools::ShapeShifter::ConstPtr> messages;
+  buffer.GetMessages(&messages);
+  ASSERT_EQ(messages.size(), 1);
+  EXPECT_EQ(messages[0], latest);
+  EXPECT_EQ(buffer.bytes(), 20);
+}
+
+TEST(MessageBufferTest, ByteBudget) {
+  MessageBuffer buffer(10, 250);
+  std::vector<topic_tools::ShapeShifter::ConstPtr> added;
+  for (int i = 0; i < 4; i++) {
+    added.push_back(MakeMessage(100, i));
+    buffer.Add(added.back());
+    EXPECT_LE(buffer.bytes(), 250);
+  }
+  std::vector<topic_tools::ShapeShifter::ConstPtr> messages;
+  buffer.GetMessages(&messages);
+  ASSERT_EQ(messages.size(), 2);
+  EXPECT_EQ(messages[0], added[2]);
+  EXPECT_EQ(messages[1], added[3]);
+
+  // A message that needs the whole budget evicts everything else.
+  topic_tools::ShapeShifter::ConstPtr large = MakeMessage(250, 9);
+  buffer.Add(large);
+  EXPECT_EQ(buffer.size(), 1);
+  EXPECT_EQ(buffer.bytes(), 250);
+}
+
+TEST(MessageBufferTest, OversizedMessageNotKept) {
+  MessageBuffer buffer(10, 250);
+  topic_tools::ShapeShifter::ConstPtr small = MakeMessage(100, 1);
+  buffer.Add(small);
+  buffer.Add(MakeMessage(251, 2));
+  // The buffer keeps what it had instead of evicting it for nothing.
+  std::vector<topic_tools::ShapeShifter::ConstPtr> messages;
+  buffer.GetMessages(&messages);
+  ASSERT_EQ(messages.size(), 1);
+  EXPECT_EQ(messages[0], small);
+  EXPECT_EQ(buffer.bytes(), 100);
+}
+
+int main(int argc, char *argv[]) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,92 @@
+// Copyright 2011 Google Inc.
+// Author: moesenle@google.com (Lorenz Moesenlechner)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "robust_topic_relay/pending_messages.h"
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+using robust_topic_relay::PendingMessages;
+
+static topic_tools::ShapeShifter::ConstPtr MakeMessage() {
+  topic_tools::ShapeShifter::Ptr message(new topic_tools::ShapeShifter);
+  message->morph("*", "std_msgs/Empty", "", "");
+  return message;
+}
+
+TEST(PendingMessagesTest, LatestWins) {
+  PendingMessages pending;
+  topic_tools::ShapeShifter::ConstPtr first = MakeMessage();
+  topic_tools::ShapeShifter::ConstPtr second = MakeMessage();
+  EXPECT_FALSE(pending.Add(0, ros::Time(2.0), first));
+  EXPECT_TRUE(pending.Add(0, ros::Time(3.0), second));
+  EXPECT_EQ(pending.size(), 1);
+
+  size_t topic_id;
+  topic_tools::ShapeShifter::ConstPtr message;
+  // The replacing message also replaces the send time.
+  EXPECT_FALSE(pending.PopDue(ros::Time(2.5), &topic_id, &message));
+  ASSERT_TRUE(pending.PopDue(ros::Time(3.0), &topic_id, &message));
+  EXPECT_EQ(topic_id, 0);
+  EXPECT_EQ(message, second);
+  EXPECT_TRUE(pending.empty());
+}
+
+TEST(PendingMessagesTest, PopsDueMessagesInSendTimeOrder) {
+  PendingMessages pending;
+  std::vector<topic_tools::ShapeShifter::ConstPtr> messages;
+  double send_times[] = {3.0, 1.0, 2.0, 5.0};
+  for (size_t i = 0; i < 4; i++) {
+    messages.push_back(MakeMessage());
+    pending.Add(i, ros::Time(send_times[i]), messages[i]);
+  }
+  EXPECT_EQ(pending.send_times().top_id(), 1);
+
+  size_t topic_id;
+  topic_tools::ShapeShifter::ConstPtr message;
+  size_t expected[] = {1, 2, 0};
+  for (size_t i = 0; i < 3; i++) {
+    ASSERT_TRUE(pending.PopDue(ros::Time(4.0), &topic_id, &message));
+    EXPECT_EQ(topic_id, expected[i]);
+    EXPECT_EQ(message, messages[expected[i]]);
+  }
+  EXPECT_FALSE(pending.PopDue(ros::Time(4.0), &topic_id, &message));
+  EXPECT_EQ(pending.size(), 1);
+}
+
+TEST(PendingMessagesTest, Remove) {
+  PendingMessages pending;
+  EXPECT_FALSE(pending.Remove(0));
+  pending.Add(0, ros::Time(1.0), MakeMessage());
+  pending.Add(1, ros::Time(2.0), MakeMessage());
+  EXPECT_TRUE(pending.Remove(0));
+  EXPECT_FALSE(pending.Remove(0));
+  // After a removal, adding does not count as replacing.
+  EXPECT_FALSE(pending.Add(0, ros::Time(3.0), MakeMessage()));
+
+  size_t topic_id;
+  topic_tools::ShapeShifter::ConstPtr message;
+  ASSERT_TRUE(pending.PopDue(ros::Time(10.0), &topic_id, &message));
+  EXPECT_EQ(topic_id, 1);
+  ASSERT_TRUE(pending.PopDue(ros::Time(10.0), &topic_id, &message));
+  EXPECT_EQ(topic_id, 0);
+  EXPECT_TRUE(pending.empty());
+}
+
+int main(int argc, char *argv[]) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,105 @@
+// Copyright 2011 Google Inc.
+// Author: moesenle@google.com (Lorenz Moesenlechner)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "robust_topic_relay/topic_throttle.h"
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+using robust_topic_relay::SplitBandwidthBudget;
+using robust_topic_relay::TopicThrottle;
+
+TEST(TopicThrottleTest, Unlimited) {
+  TopicThrottle throttle(0.0, 0.0);
+  ros::Time now(10.0);
+  EXPECT_EQ(throttle.FindNextSendTime(now), now);
+  throttle.Send(now, 1000000);
+  EXPECT_LE(throttle.FindNextSendTime(now), now);
+}
+
+TEST(TopicThrottleTest, RateCap) {
+  TopicThrottle throttle(4.0, 0.0);
+  ros::Time now(10.0);
+  EXPECT_EQ(throttle.FindNextSendTime(now), now);
+  throttle.Send(now, 100);
+  EXPECT_EQ(throttle.FindNextSendTime(now), now + ros::Duration(0.25));
+  throttle.Send(ros::Time(11.0), 100);
+  EXPECT_EQ(throttle.FindNextSendTime(ros::Time(11.0)), ros::Time(11.25));
+}
+
+TEST(TopicThrottleTest, BandwidthDebt) {
+  // The bucket holds one second of bandwidth, 100 bytes.
+  TopicThrottle throttle(0.0, 100.0);
+  ros::Time now(10.0);
+  throttle.Send(now, 50);
+  // Tokens are left, so the next message may go immediately.
+  EXPECT_LE(throttle.FindNextSendTime(now), now);
+  // A message larger than the tokens left is still sent...
+  throttle.Send(now, 250);
+  // ...and the next one waits until the debt of 200 bytes is paid.
+  EXPECT_EQ(throttle.FindNextSendTime(now), ros::Time(12.0));
+}
+
+TEST(TopicThrottleTest, BucketIsCapped) {
+  TopicThrottle throttle(0.0, 100.0);
+  throttle.Send(ros::Time(10.0), 0);
+  // Idling for long does not save more than one second of bandwidth.
+  throttle.Send(ros::Time(100.0), 300);
+  EXPECT_EQ(throttle.FindNextSendTime(ros::Time(100.0)), ros::Time(102.0));
+}
+
+TEST(TopicThrottleTest, LowerBandwidthLowersTokens) {
+  TopicThrottle throttle(0.0, 1000.0);
+  throttle.Send(ros::Time(10.0), 0);
+  throttle.set_bandwidth(100.0);
+  EXPECT_EQ(throttle.bandwidth(), 100.0);
+  // Only the 100 tokens of the new bucket are left.
+  throttle.Send(ros::Time(10.0), 300);
+  EXPECT_EQ(throttle.FindNextSendTime(ros::Time(10.0)), ros::Time(12.0));
+}
+
+TEST(SplitBandwidthBudgetTest, ProportionalToPriority) {
+  std::vector<int> priorities;
+  priorities.push_back(1);
+  priorities.push_back(3);
+  priorities.push_back(4);
+  std::vector<double> shares;
+  SplitBandwidthBudget(8000.0, priorities, &shares);
+  ASSERT_EQ(shares.size(), 3);
+  EXPECT_DOUBLE_EQ(shares[0], 1000.0);
+  EXPECT_DOUBLE_EQ(shares[1], 3000.0);
+  EXPECT_DOUBLE_EQ(shares[2], 4000.0);
+}
+
+TEST(SplitBandwidthBudgetTest, NoBudget) {
+  std::vector<int> priorities(2, 1);
+  std::vector<double> shares;
+  SplitBandwidthBudget(0.0, priorities, &shares);
+  ASSERT_EQ(shares.size(), 2);
+  EXPECT_EQ(shares[0], 0.0);
+  EXPECT_EQ(shares[1], 0.0);
+}
+
+TEST(SplitBandwidthBudgetTest, NoTopics) {
+  std::vector<double> shares(1, 1.0);
+  SplitBandwidthBudget(1000.0, std::vector<int>(), &shares);
+  EXPECT_TRUE(shares.empty());
+}
+
+int main(int argc, char *argv[]) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}